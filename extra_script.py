@@ -2,6 +2,7 @@ Import("env")
 from pathlib import Path
 from subprocess import run
 from shutil import copyfile
+import re
 
 build_dir=Path(env["PROJECT_BUILD_DIR"]).joinpath(env["PIOENV"])
 env.Replace(COMPILATIONDB_INCLUDE_TOOLCHAIN=True)
@@ -27,3 +28,10 @@ cp = run([
     cwd=sectionLibPath
 )
 env.Replace(COMPILATIONDB_INCLUDE_TOOLCHAIN=True)
+
+# -DECRF_HEAP_GUARD=1: route the allocators through lib/ecrf_sys/ecrf_heap.c
+heapGuard = re.findall(r"-DECRF_HEAP_GUARD=(\w+)", " ".join(env.GetProjectOption("build_flags", [])))
+if heapGuard and heapGuard[-1] != "0":
+    env.Append(LINKFLAGS=["-Wl,--wrap=%s" % f for f in (
+        "malloc", "calloc", "realloc",
+        "heap_caps_malloc", "heap_caps_calloc", "heap_caps_realloc")])
@@ -28,6 +28,7 @@
 
 /* Standard includes. */
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* FreeRTOS includes. */
@@ -154,6 +155,16 @@ BaseType_t FreeRTOS_CLIProcessCommand(const char *const pcCommandInput,
                                       char *pcWriteBuffer,
                                       size_t xWriteBufferLen) {
   static const CLI_Definition_List_Item_t *pxCommand = NULL;
+
+  return FreeRTOS_CLIProcessCommandFrom(pcCommandInput, pcWriteBuffer,
+                                        xWriteBufferLen, &pxCommand);
+}
+/*-----------------------------------------------------------*/
+
+BaseType_t FreeRTOS_CLIProcessCommandFrom(
+    const char *const pcCommandInput, char *pcWriteBuffer,
+    size_t xWriteBufferLen, const CLI_Definition_List_Item_t **ppxCommand) {
+  const CLI_Definition_List_Item_t *pxCommand = *ppxCommand;
   BaseType_t xReturn = pdTRUE;
   const char *pcRegisteredCommandString;
   size_t xCommandStringLength;
@@ -223,6 +234,7 @@ BaseType_t FreeRTOS_CLIProcessCommand(const char *const pcCommandInput,
     xReturn = pdFALSE;
   }
 
+  *ppxCommand = pxCommand;
   return xReturn;
 }
 /*-----------------------------------------------------------*/
@@ -374,7 +386,11 @@ BaseType_t FreeRTOS_CLIGetParameterAsInt(const char *pcCommandString,
   BaseType_t idLen;
   const char *idStr =
       FreeRTOS_CLIGetParameter(pcCommandString, uxWantedParameter, &idLen);
+  /* optional parameters: leave the caller's default alone */
+  if (idStr == NULL)
+    return pdFALSE;
+
   *paramInt = atoi(idStr);
 
-  return pdFALSE;
+  return pdTRUE;
 }
@@ -111,6 +111,15 @@ BaseType_t FreeRTOS_CLIProcessCommand(const char *const pcCommandInput,
                                       char *pcWriteBuffer,
                                       size_t xWriteBufferLen);
 
+/*
+ * Same dispatch with the caller keeping the continuation state, NULL
+ * before the first call. Lets a command run other commands (a script
+ * runner) without disturbing the interpreter it was itself called from.
+ */
+BaseType_t FreeRTOS_CLIProcessCommandFrom(
+    const char *const pcCommandInput, char *pcWriteBuffer,
+    size_t xWriteBufferLen, const CLI_Definition_List_Item_t **ppxCommand);
+
 /*-----------------------------------------------------------*/
 
 /*
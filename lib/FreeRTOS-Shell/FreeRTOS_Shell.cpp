@@ -1,10 +1,12 @@
 /* FreeRTOS includes. */
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "freertos/message_buffer.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
 /* Standard includes. */
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -14,10 +16,33 @@
 #include "FreeRTOS_Shell_port.h"
 
 /* Private variables ---------------------------------------------------------*/
-QueueHandle_t FreeRTOS_ShellRecvQueue;
-static uint8_t inputBuffer[FREERTOS_SHELL_INPUT_BUFFER_LENGTH];
-static uint8_t *inputBuffer_ptr;
+static MessageBufferHandle_t lineBuffer = NULL;
+static StaticMessageBuffer_t lineBufferStruct;
+static uint8_t lineBufferStorage[FREERTOS_SHELL_LINE_BUFFER_LENGTH];
+/* a message buffer takes one writer at a time: the UART and the network */
+static SemaphoreHandle_t lineLock = NULL;
+static StaticSemaphore_t lineLockStruct;
+/* line being assembled by the receive callback */
+static char editBuffer[FREERTOS_SHELL_INPUT_BUFFER_LENGTH];
+static size_t editLength;
+static bool editTooLong;
+static bool editLastCR;
+/* line being run by the shell task */
+static char inputBuffer[FREERTOS_SHELL_INPUT_BUFFER_LENGTH];
 static uint8_t outputBuffer[FREERTOS_CLI_OUTPUT_MAX_BUFFER_SIZE];
+static CLI_Definition_List_Item_t cliListItems[FREERTOS_SHELL_MAX_COMMANDS];
+static char taskListBuffer[FREERTOS_SHELL_MAX_TASKS *
+                           FREERTOS_SHELL_EACH_TASKINFO_MAX_SIZE];
+
+/* input losses, counted where they happen and reported by the shell task */
+struct s_shell_losses {
+  uint32_t dropped;  /* lines, no room left in lineBuffer */
+  uint32_t tooLong;  /* lines, longer than the input buffer */
+  uint32_t overruns; /* upstream, reported by the port */
+};
+static struct s_shell_losses losses;
+static struct s_shell_losses reported;
+static FreeRTOS_ShellLineHook_t lineHook = NULL;
 
 /* Extern variables ---------------------------------------------------------*/
 extern uint8_t __freertos_shell_cmd_start;
@@ -25,20 +50,39 @@ extern uint8_t __freertos_shell_cmd_end;
 
 /* Private function prototypes -----------------------------------------------*/
 __attribute__((weak)) void FreeRTOS_Shell_init(void) {}
+/* called once every command is registered, right before the first prompt */
+__attribute__((weak)) void FreeRTOS_Shell_ready(void) {}
+
+static void FreeRTOS_ShellReportLosses(void) {
+  char report[96];
+  uint32_t dropped = losses.dropped - reported.dropped;
+  uint32_t tooLong = losses.tooLong - reported.tooLong;
+  uint32_t overruns = losses.overruns - reported.overruns;
+
+  if ((dropped == 0) && (tooLong == 0) && (overruns == 0))
+    return;
+
+  int len = snprintf(report, sizeof(report),
+                     "[E] [Shell] input lost: %lu lines dropped, %lu too long, %lu overruns\r\n",
+                     (unsigned long)dropped, (unsigned long)tooLong, (unsigned long)overruns);
+  FreeRTOS_ShellOutput(report, len);
+  reported.dropped += dropped;
+  reported.tooLong += tooLong;
+  reported.overruns += overruns;
+}
 
 /**
- * @brief A FreeRTOS thread, it will handle msg from a msgqueue, and output to
- * UART
+ * @brief A FreeRTOS thread, it runs the lines assembled by
+ * FreeRTOS_ShellReceive() and outputs to UART
  *
  * @note  when there is no input, the thread will suspend and take no CPU time.
  */
 void FreeRTOS_Shell(void *params) {
+  lineBuffer = xMessageBufferCreateStatic(sizeof(lineBufferStorage), lineBufferStorage,
+                                          &lineBufferStruct);
+  configASSERT(lineBuffer);
+  lineLock = xSemaphoreCreateMutexStatic(&lineLockStruct);
   FreeRTOS_Shell_init();
-  /* a shell task */
-  inputBuffer_ptr = inputBuffer;
-  FreeRTOS_ShellRecvQueue =
-      xQueueCreate(FREERTOS_SHELL_RECV_QUEUE_LENGTH, sizeof(uint8_t));
-  configASSERT(FreeRTOS_ShellRecvQueue);
 
   FreeRTOS_ShellOutput(FREERTOS_SHELL_START_LOGO,
                        strlen(FREERTOS_SHELL_START_LOGO));
@@ -50,64 +94,132 @@ void FreeRTOS_Shell(void *params) {
   uint8_t *start = &__freertos_shell_cmd_start;
   uint8_t *end = &__freertos_shell_cmd_end;
   int size = sizeof(CLI_Command_Definition_t);
+  int count = 0;
   for (uint8_t *i = start; i < end; i += size) {
     CLI_Command_Definition_t *cli_command = (CLI_Command_Definition_t *)i;
-    FreeRTOS_CLIRegisterCommand(cli_command);
+    configASSERT(count < FREERTOS_SHELL_MAX_COMMANDS);
+    FreeRTOS_CLIRegisterCommandStatic(cli_command, &cliListItems[count++]);
   }
+  FreeRTOS_Shell_ready();
 
   while (1) {
-    /* always wait a queue */
-    char recvChar = 0;
-    xQueueReceive(FreeRTOS_ShellRecvQueue, &recvChar, portMAX_DELAY);
+    /* one wake up per line, the line comes NUL terminated */
+    xMessageBufferReceive(lineBuffer, inputBuffer, sizeof(inputBuffer),
+                          portMAX_DELAY);
 
-    bool lineOver = false;
-    bool isInputBufferEmpty = inputBuffer_ptr == inputBuffer;
-    if (recvChar == '\r')
-      lineOver = true;
-
-    if (lineOver) {
+    FreeRTOS_ShellReportLosses();
+    if ((lineHook != NULL) && lineHook(inputBuffer)) {
+      /* the hook may have removed itself */
+      const char *prompt = (lineHook != NULL) ? FREERTOS_SHELL_HOOK_INFO
+                                              : FREERTOS_SHELL_USER_INFO;
+      FreeRTOS_ShellOutput(prompt, strlen(prompt));
+      continue;
+    }
+    if (inputBuffer[0] != 0) {
       BaseType_t ret = pdTRUE;
-      FreeRTOS_ShellOutput("\r\n", 2);
-      if (!isInputBufferEmpty) {
-        while (ret == pdTRUE) {
-          ret = FreeRTOS_CLIProcessCommand((const char *)inputBuffer,
-                                           (char *)outputBuffer,
-                                           FREERTOS_CLI_OUTPUT_MAX_BUFFER_SIZE);
-          FreeRTOS_ShellOutput((const char *)outputBuffer,
-                               strlen((const char *)outputBuffer));
-        }
-        memset(outputBuffer, 0, FREERTOS_CLI_OUTPUT_MAX_BUFFER_SIZE);
-        memset(inputBuffer, 0, FREERTOS_SHELL_INPUT_BUFFER_LENGTH);
-        inputBuffer_ptr = inputBuffer;
-        FreeRTOS_ShellOutput("\r\n", 2);
-      }
-      FreeRTOS_ShellOutput(FREERTOS_SHELL_USER_INFO,
-                           strlen(FREERTOS_SHELL_USER_INFO));
-    } else if (!lineOver) {
-      /* backspace */
-      if (((recvChar == '\n') || (recvChar == '\b')) && isInputBufferEmpty) {
-        __asm__("nop");
-      }
-      /* backspace*/
-      else if (recvChar == '\b' && !isInputBufferEmpty) {
-        *--inputBuffer_ptr = 0;
-        FreeRTOS_ShellOutput(&recvChar, 1);
+      while (ret == pdTRUE) {
+        ret = FreeRTOS_CLIProcessCommand((const char *)inputBuffer,
+                                         (char *)outputBuffer,
+                                         FREERTOS_CLI_OUTPUT_MAX_BUFFER_SIZE);
+        FreeRTOS_ShellOutput((const char *)outputBuffer,
+                             strlen((const char *)outputBuffer));
       }
-      /* tab */
-      /* TODO: when double click tab, trigger auto complete */
-      else if (recvChar == 0x08) {
-        __asm__("nop");
-      } else {
-        *inputBuffer_ptr++ = recvChar;
-        FreeRTOS_ShellOutput(&recvChar, 1);
+      memset(outputBuffer, 0, FREERTOS_CLI_OUTPUT_MAX_BUFFER_SIZE);
+      FreeRTOS_ShellOutput("\r\n", 2);
+    }
+    FreeRTOS_ShellOutput(FREERTOS_SHELL_USER_INFO,
+                         strlen(FREERTOS_SHELL_USER_INFO));
+  }
+}
+
+static bool FreeRTOS_ShellSend(const char *line, size_t len) {
+  bool sent;
+
+  xSemaphoreTake(lineLock, portMAX_DELAY);
+  sent = xMessageBufferSend(lineBuffer, line, len + 1,
+                            pdMS_TO_TICKS(FREERTOS_SHELL_LINE_TIMEOUT_MS)) != 0;
+  xSemaphoreGive(lineLock);
+  if (!sent)
+    losses.dropped++;
+
+  return sent;
+}
+
+static void FreeRTOS_ShellEndLine(void) {
+  FreeRTOS_ShellOutput("\r\n", 2);
+  if (editTooLong) {
+    losses.tooLong++;
+    editLength = 0;
+  }
+  editBuffer[editLength] = 0;
+  FreeRTOS_ShellSend(editBuffer, editLength);
+
+  editLength = 0;
+  editTooLong = false;
+}
+
+bool FreeRTOS_ShellSubmit(const char *line) {
+  size_t len = strlen(line);
+
+  if (lineBuffer == NULL)
+    return false;
+  if (len >= FREERTOS_SHELL_INPUT_BUFFER_LENGTH) {
+    losses.tooLong++;
+    return false;
+  }
+
+  return FreeRTOS_ShellSend(line, len);
+}
+
+void FreeRTOS_ShellReceive(const uint8_t *data, size_t len) {
+  /* the echo of a whole chunk goes out in one write */
+  const uint8_t *echo = data;
+
+  if (lineBuffer == NULL)
+    return;
+
+  for (size_t i = 0; i < len; i++) {
+    char recvChar = (char)data[i];
+    bool lastCR = editLastCR;
+    editLastCR = (recvChar == '\r');
+
+    if ((recvChar == '\r') || ((recvChar == '\n') && !lastCR)) {
+      FreeRTOS_ShellOutput((const char *)echo, &data[i] - echo);
+      echo = &data[i + 1];
+      FreeRTOS_ShellEndLine();
+    } else if (recvChar == '\n') {
+      /* second half of CRLF */
+      FreeRTOS_ShellOutput((const char *)echo, &data[i] - echo);
+      echo = &data[i + 1];
+    } else if ((recvChar == '\b') || (recvChar == 0x7F)) {
+      FreeRTOS_ShellOutput((const char *)echo, &data[i] - echo);
+      echo = &data[i + 1];
+      if (editLength > 0) {
+        editLength--;
+        FreeRTOS_ShellOutput("\b \b", 3);
       }
+    } else if (editLength < sizeof(editBuffer) - 1) {
+      editBuffer[editLength++] = recvChar;
+    } else {
+      /* keep echoing, the line is rejected once complete */
+      editTooLong = true;
     }
   }
+  FreeRTOS_ShellOutput((const char *)echo, &data[len] - echo);
 }
 
-void FreeRTOS_ShellIRQHandle(uint8_t recvData) {
-  /* send data to FreeRTOS queue */
-  xQueueSendToBackFromISR(FreeRTOS_ShellRecvQueue, &recvData, NULL);
+void FreeRTOS_ShellSetLineHook(FreeRTOS_ShellLineHook_t hook) {
+  lineHook = hook;
+}
+
+void FreeRTOS_ShellOverrun(void) {
+  losses.overruns++;
+}
+
+size_t FreeRTOS_ShellFootprint(void) {
+  return sizeof(lineBufferStruct) + sizeof(lineBufferStorage) + sizeof(lineLockStruct) +
+         sizeof(editBuffer) + sizeof(inputBuffer) + sizeof(outputBuffer) + sizeof(cliListItems) +
+         sizeof(taskListBuffer);
 }
 
 static size_t offsetInBuffer = 0;
@@ -118,9 +230,12 @@ static BaseType_t listAllThread(char *pcWriteBuffer, size_t xWriteBufferLen,
                                 const char *pcCommandString) {
   BaseType_t ret = pdTRUE;
   if (buffer == NULL) {
-    UBaseType_t taskNum = uxTaskGetNumberOfTasks();
-    int len = taskNum * FREERTOS_SHELL_EACH_TASKINFO_MAX_SIZE;
-    buffer = (char *)malloc(len * sizeof(char));
+    if (uxTaskGetNumberOfTasks() > FREERTOS_SHELL_MAX_TASKS) {
+      snprintf(pcWriteBuffer, xWriteBufferLen,
+               "too many tasks, raise FREERTOS_SHELL_MAX_TASKS\r\n");
+      return pdFALSE;
+    }
+    buffer = taskListBuffer;
     vTaskList(buffer);
     remaining = strlen(buffer);
     offsetInBuffer = 0;
@@ -137,7 +252,6 @@ static BaseType_t listAllThread(char *pcWriteBuffer, size_t xWriteBufferLen,
     ret = pdTRUE;
   } else {
     ret = pdFALSE;
-    free(buffer);
     buffer = NULL;
     remaining = 0;
     offsetInBuffer = 0;
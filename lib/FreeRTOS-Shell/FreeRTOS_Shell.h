@@ -5,20 +5,54 @@
 extern "C" {
 #endif
 /* FreeRTOS-Shell macro */
-#define FREERTOS_SHELL_RECV_QUEUE_LENGTH 32
+/* longest command line, terminator included */
+#ifndef FREERTOS_SHELL_INPUT_BUFFER_LENGTH
 #define FREERTOS_SHELL_INPUT_BUFFER_LENGTH 64
+#endif
+/* complete lines waiting for the shell task, a pasted script fits */
+#ifndef FREERTOS_SHELL_LINE_BUFFER_LENGTH
+#define FREERTOS_SHELL_LINE_BUFFER_LENGTH 512
+#endif
+/* how long input waits for room before a line is dropped */
+#ifndef FREERTOS_SHELL_LINE_TIMEOUT_MS
+#define FREERTOS_SHELL_LINE_TIMEOUT_MS 1000
+#endif
 #define FREERTOS_SHELL_USER_INFO "[root@FreeRTOS]# "
+#define FREERTOS_SHELL_HOOK_INFO "> "
 #define FREERTOS_SHELL_EACH_TASKINFO_MAX_SIZE                                  \
   40 // 40 bytes per task is described here:
      // https://www.freertos.org/a00021.html#vTaskList
+#define FREERTOS_SHELL_MAX_TASKS 24
+#define FREERTOS_SHELL_MAX_COMMANDS 48
 
 /* FreeRTOS-CLI macro */
 #define FREERTOS_CLI_OUTPUT_MAX_BUFFER_SIZE 128
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 void FreeRTOS_Shell(void *);
-void FreeRTOS_ShellIRQHandle(uint8_t recvData);
+/*
+ * Input path, from the port receive callback (task context): lines are
+ * edited and echoed here, and handed to the shell task whole. Overrun
+ * reports a loss upstream, such as a UART FIFO or driver buffer overflow.
+ */
+void FreeRTOS_ShellReceive(const uint8_t *data, size_t len);
+void FreeRTOS_ShellOverrun(void);
+/*
+ * A complete line from another console (a network client), queued behind
+ * the serial ones. The output of every console goes to the port mirror.
+ */
+bool FreeRTOS_ShellSubmit(const char *line);
+/*
+ * Line hook, run by the shell task ahead of the dispatch: returns true when
+ * it took the line (a script being recorded). NULL restores the dispatch.
+ */
+typedef bool (*FreeRTOS_ShellLineHook_t)(const char *line);
+void FreeRTOS_ShellSetLineHook(FreeRTOS_ShellLineHook_t hook);
+/* static memory held by the shell, in bytes */
+size_t FreeRTOS_ShellFootprint(void);
 
 #define FREERTOS_SHELL_CMD_REGISTER(pcCommand, pcHelpString,                   \
                                     pxCommandInterpreter,                      \
@@ -4,19 +4,35 @@
 
 static const uint32_t uartRxTimeout = 1;
 static const uint32_t uartBaudrate = 115200;
+static volatile FreeRTOS_ShellMirror_t outputMirror = NULL;
 
 EXTERNC void FreeRTOS_ShellOutput(const char *buffer, int length) {
+  FreeRTOS_ShellMirror_t mirror = outputMirror;
+
   Serial.write(buffer, length);
+  if (mirror != NULL)
+    mirror(buffer, length);
+}
+
+EXTERNC void FreeRTOS_ShellSetMirror(FreeRTOS_ShellMirror_t mirror) {
+  outputMirror = mirror;
 }
 
-// void serialEvent(void) {
+// Runs in the UART event task on RX timeout: drain what arrived in bulk
 void FreeRTOS_Shell_cb(void) {
-  while (Serial.available() > 0) {
-    uint8_t incomingByte = Serial.read();
-    FreeRTOS_ShellIRQHandle(incomingByte);
+  uint8_t chunk[64];
+  size_t len;
+
+  while ((len = Serial.read(chunk, sizeof(chunk))) > 0) {
+    FreeRTOS_ShellReceive(chunk, len);
   }
 }
 
+void FreeRTOS_Shell_error_cb(hardwareSerial_error_t error) {
+  if ((error == UART_BUFFER_FULL_ERROR) || (error == UART_FIFO_OVF_ERROR))
+    FreeRTOS_ShellOverrun();
+}
+
 void FreeRTOS_Shell_init(void) {
   Serial.setRxBufferSize(512);
   Serial.begin(uartBaudrate);
@@ -24,5 +40,6 @@ void FreeRTOS_Shell_init(void) {
   };
 
   Serial.setRxTimeout(uartRxTimeout);
+  Serial.onReceiveError(FreeRTOS_Shell_error_cb);
   Serial.onReceive(FreeRTOS_Shell_cb, true);
 }
@@ -7,5 +7,11 @@
 #define EXTERNC
 #endif
 EXTERNC void FreeRTOS_ShellOutput(const char *buffer, int length);
+/*
+ * A second console fed the same output after the UART, NULL removes it.
+ * Called from the shell task and from the UART event task (echo).
+ */
+typedef void (*FreeRTOS_ShellMirror_t)(const char *buffer, int length);
+EXTERNC void FreeRTOS_ShellSetMirror(FreeRTOS_ShellMirror_t mirror);
 
 #endif /* __FREERTOS_SHELL_PORT_H */
@@ -4,47 +4,39 @@
 #include <RadioLib.h>
 #include <eCC1101.h>
 #include <SPI.h>
+#include <new>
+#include "cc1101_ecrf.h"
+#include "ecrf_board.h"
+#include <ecrf_tasks.h>
+#include <ecrf_arena.h>
+#include <ecrf_boot.h>
+#include <ecrf_hex.h>
+#include <ecrf_symrate.h>
 
-#define CC1101_MOD_SCK 14
-#define CC1101_MOD_MISO 12
-#define CC1101_MOD_MOSI 13
-
-#define CC1101_MOD1_CSN 5
-#define CC1101_MOD1_GDO0 2
-#define CC1101_MOD1_GDO2 4
-#define CC1101_MOD1_IRQ CC1101_MOD1_GDO0
-#define CC1101_MOD1_GPIO RADIOLIB_NC
-
-#define CC1101_MOD2_CSN 27
-#define CC1101_MOD2_GDO0 25
-#define CC1101_MOD2_GDO2 26
-#define CC1101_MOD2_IRQ CC1101_MOD2_GDO0
-#define CC1101_MOD2_GPIO RADIOLIB_NC
-
-static SPIClass spi = SPIClass(HSPI);
-
-static struct eCC1101::s_eCC1101_pins cc1101_mod1_pins = {
-  .cs = CC1101_MOD1_CSN,
-  .rst = RADIOLIB_NC,
-  .clk = CC1101_MOD_SCK,
-  .miso = CC1101_MOD_MISO,
-  .mosi = CC1101_MOD_MOSI,
-  .gdo0 = CC1101_MOD1_GDO0, /* IRQ */
-  .gdo2 = RADIOLIB_NC       /* GPIO */
+/* indexed by ECRF_BUS_* */
+static const uint8_t ecrf_spi_bus_ids[] = {
+    HSPI,
+    VSPI,
 };
 
-static struct eCC1101::s_eCC1101_pins cc1101_mod2_pins = {
-  .cs = CC1101_MOD2_CSN,
-  .rst = RADIOLIB_NC,
-  .clk = CC1101_MOD_SCK,
-  .miso = CC1101_MOD_MISO,
-  .mosi = CC1101_MOD_MOSI,
-  .gdo0 = CC1101_MOD2_GDO0, /* IRQ */
-  .gdo2 = RADIOLIB_NC       /* GPIO */
+static SPIClass ecrf_spi_buses[] = {
+    SPIClass(HSPI),
+    SPIClass(VSPI),
 };
 
-static const std::vector<int32_t> cs_unused_mod1 = {CC1101_MOD2_CSN};
-static const std::vector<int32_t> cs_unused_mod2 = {CC1101_MOD1_CSN};
+#define ECRF_BUSES (sizeof(ecrf_spi_buses) / sizeof(ecrf_spi_buses[0]))
+
+/* init all gives up on a chip that does not answer within this */
+#define ECRF_INIT_TIMEOUT_MS 2000
+
+static const char *const ecrf_spi_bus_names[] = {
+    "HSPI",
+    "VSPI",
+};
+
+static const struct s_ecrf_board_radio ecrf_board[] = { ECRF_BOARD_RADIOS };
+
+#define ECRF_RADIO_COUNT (sizeof(ecrf_board) / sizeof(ecrf_board[0]))
 
 #ifndef SPI_CLK_FREQ
 #define SPI_CLK_FREQ 1000000
@@ -54,28 +46,331 @@ static const std::vector<int32_t> cs_unused_mod2 = {CC1101_MOD1_CSN};
 #define MAX(x, y) (x < y ? y : x)
 #define MIN(x, y) (x < y ? x : y)
 
-static eCC1101 ecrf_radios[] = {
-    eCC1101(cc1101_mod1_pins, spi, cs_unused_mod1, SPI_CLK_FREQ),
-    eCC1101(cc1101_mod2_pins, spi, cs_unused_mod2, SPI_CLK_FREQ),
-};
+/*
+ * Radios are built on first use into a pool of ECRF_MAX_ACTIVE_RADIOS slots
+ * and torn down when the last reference goes away: a module that is never
+ * used costs neither an RX task nor a capture buffer. Size the pool below
+ * the radio count to trade concurrency for RAM.
+ */
+#ifndef ECRF_MAX_ACTIVE_RADIOS
+#define ECRF_MAX_ACTIVE_RADIOS ECRF_RADIO_COUNT
+#endif
+
+alignas(eCC1101) static uint8_t ecrf_radio_storage[ECRF_MAX_ACTIVE_RADIOS][sizeof(eCC1101)];
+static int ecrf_slot_owner[ECRF_MAX_ACTIVE_RADIOS];
+static eCC1101 *ecrf_radios[ECRF_RADIO_COUNT];
+static uint8_t ecrf_radio_refs[ECRF_RADIO_COUNT];
+/* reference taken by the init command, dropped by release */
+static bool ecrf_radio_held[ECRF_RADIO_COUNT];
+/* background session keeping a radio to itself, see ecrf_radio_claim() */
+static const char *ecrf_radio_owner[ECRF_RADIO_COUNT];
+static SemaphoreHandle_t ecrf_registry_lock = NULL;
+static StaticSemaphore_t ecrf_registry_lock_buffer;
+
+/* Build the eCC1101 of a board entry into a free slot, sized by its own description */
+static eCC1101 *ecrf_radio_construct(int id) {
+  const struct s_ecrf_board_radio *desc = &ecrf_board[id];
+  int32_t cs_unused[ECC1101_MAX_CS_UNUSED];
+  size_t cs_unused_count = 0;
+  size_t slot;
+
+  for (slot = 0; slot < ECRF_MAX_ACTIVE_RADIOS; slot++) {
+    if (ecrf_slot_owner[slot] < 0)
+      break;
+  }
+  if (slot == ECRF_MAX_ACTIVE_RADIOS)
+    return NULL;
+
+  /* deselect every other chip sharing this bus */
+  for (size_t other = 0; other < ECRF_RADIO_COUNT; other++) {
+    if ((other != (size_t)id) && (ecrf_board[other].bus == desc->bus) &&
+        (ecrf_board[other].cs_group == desc->cs_group)) {
+      configASSERT(cs_unused_count < ECC1101_MAX_CS_UNUSED);
+      cs_unused[cs_unused_count++] = ecrf_board[other].pins.cs;
+    }
+  }
+
+  ecrf_slot_owner[slot] = id;
+  return new (ecrf_radio_storage[slot])
+      eCC1101(desc->pins, ecrf_spi_buses[desc->bus], cs_unused, cs_unused_count,
+              SPI_CLK_FREQ, desc->rx_buffer_size, desc->rx_trigger_level,
+              ecrf_spi_bus_ids[desc->bus]);
+}
+
+static void ecrf_radio_destroy(int id) {
+  eCC1101 *cc1101 = ecrf_radios[id];
+
+  /* stops the radio, gives the session buffer and the RX task back */
+  cc1101->~eCC1101();
+  for (size_t slot = 0; slot < ECRF_MAX_ACTIVE_RADIOS; slot++) {
+    if (ecrf_slot_owner[slot] == id)
+      ecrf_slot_owner[slot] = -1;
+  }
+  ecrf_radios[id] = NULL;
+}
+
+int ecrf_radio_count(void) {
+  return ECRF_RADIO_COUNT;
+}
+
+/*
+ * Boot time allocations: everything the radios would otherwise allocate on
+ * first use (capture arena, SPI bus locks, GPIO ISR service) is set up here,
+ * before the heap guard is armed.
+ */
+void ecrf_radio_boot(void) {
+  bool started[ECRF_BUSES] = {};
+
+  for (size_t slot = 0; slot < ECRF_MAX_ACTIVE_RADIOS; slot++)
+    ecrf_slot_owner[slot] = -1;
+  ecrf_registry_lock = xSemaphoreCreateMutexStatic(&ecrf_registry_lock_buffer);
+  ecrf_arena_init();
+
+  for (size_t id = 0; id < ECRF_RADIO_COUNT; id++) {
+    const struct s_ecrf_board_radio *desc = &ecrf_board[id];
+    if (started[desc->bus])
+      continue;
+
+#if ECC1101_SPI_IDF
+    /* the bus and its shared device stay up for good */
+    ecc1101_idf_bus_begin(ecrf_spi_bus_ids[desc->bus], desc->pins.clk, desc->pins.miso,
+                          desc->pins.mosi, SPI_CLK_FREQ);
+#else
+    ecrf_spi_buses[desc->bus].begin(desc->pins.clk, desc->pins.miso, desc->pins.mosi, -1);
+    ecrf_spi_buses[desc->bus].end();
+#endif
+    started[desc->bus] = true;
+  }
+
+  esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+  configASSERT((err == ESP_OK) || (err == ESP_ERR_INVALID_STATE));
+}
+
+size_t ecrf_radio_footprint(void) {
+  return sizeof(ecrf_radio_storage) + sizeof(ecrf_radios) + sizeof(ecrf_spi_buses);
+}
 
 static ssize_t rxReceived = 0;
 static ssize_t rxLength;
+static int64_t rxStart;
+/* carrier sense gate per radio, applied to the next rx/cap session */
+static struct s_cc1101_gate ecrf_gates[ECRF_RADIO_COUNT];
+/* busy-poll RX allowed per radio, see rxpoll */
+static bool ecrf_rx_poll[ECRF_RADIO_COUNT];
+/* frequency tracking of gated sessions per radio, see afc */
+static bool ecrf_afc[ECRF_RADIO_COUNT];
+
+struct s_ecrf_overflow {
+  enum ecc1101_overflow_policy policy;
+  uint16_t block_ms;
+};
+
+/* slow consumer handling per radio, see overflow */
+static struct s_ecrf_overflow ecrf_overflows[ECRF_RADIO_COUNT];
 static eCC1101 *pCC1101 = NULL;
 
-static eCC1101 *cc1101_init(int id) {
+void ecrf_radio_session_setup(eCC1101 *cc1101, int id) {
+  cc1101->setGate(&ecrf_gates[id]);
+  cc1101->setRxPoll(ecrf_rx_poll[id]);
+  cc1101->setTracking(ecrf_afc[id]);
+  cc1101->setOverflowPolicy(ecrf_overflows[id].policy, ecrf_overflows[id].block_ms);
+}
 
-  if ((id < 0) || (id > 1)) {
+static bool ecrf_radio_id_valid(int id) {
+  if ((id < 0) || (id >= (int)ECRF_RADIO_COUNT)) {
     Serial.print(F("[E] [CC1101] Wrong module id ... "));
+    return false;
+  }
+
+  return true;
+}
+
+eCC1101 *cc1101_get(int id) {
+
+  if (!ecrf_radio_id_valid(id))
+    return NULL;
+
+  return ecrf_radios[id];
+}
+
+eCC1101 *cc1101_acquire(int id) {
+  eCC1101 *cc1101;
+
+  if (!ecrf_radio_id_valid(id))
     return NULL;
+
+  configASSERT(ecrf_registry_lock != NULL);
+  xSemaphoreTake(ecrf_registry_lock, portMAX_DELAY);
+  if (ecrf_radios[id] == NULL)
+    ecrf_radios[id] = ecrf_radio_construct(id);
+  cc1101 = ecrf_radios[id];
+  if (cc1101 != NULL)
+    ecrf_radio_refs[id]++;
+  xSemaphoreGive(ecrf_registry_lock);
+
+  if (cc1101 == NULL)
+    Serial.print(F("[E] [CC1101] No free radio slot, release a module first ... "));
+
+  return cc1101;
+}
+
+void cc1101_release(eCC1101 *cc1101) {
+  if (cc1101 == NULL)
+    return;
+
+  xSemaphoreTake(ecrf_registry_lock, portMAX_DELAY);
+  for (size_t id = 0; id < ECRF_RADIO_COUNT; id++) {
+    if (ecrf_radios[id] != cc1101)
+      continue;
+
+    configASSERT(ecrf_radio_refs[id] > 0);
+    if (--ecrf_radio_refs[id] == 0)
+      ecrf_radio_destroy(id);
+    break;
+  }
+  xSemaphoreGive(ecrf_registry_lock);
+}
+
+bool ecrf_radio_claim(int id, const char *owner) {
+  bool claimed = false;
+
+  xSemaphoreTake(ecrf_registry_lock, portMAX_DELAY);
+  if (ecrf_radio_owner[id] == NULL) {
+    ecrf_radio_owner[id] = owner;
+    claimed = true;
+  }
+  xSemaphoreGive(ecrf_registry_lock);
+
+  return claimed;
+}
+
+void ecrf_radio_unclaim(int id) {
+  xSemaphoreTake(ecrf_registry_lock, portMAX_DELAY);
+  ecrf_radio_owner[id] = NULL;
+  xSemaphoreGive(ecrf_registry_lock);
+}
+
+static bool ecrf_radio_free(int id) {
+  if (ecrf_radio_owner[id] != NULL) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "[E] [CC1101] Module %d is taken by %s, stop it first ... ", id,
+             ecrf_radio_owner[id]);
+    Serial.print(buf);
+    return false;
+  }
+
+  return true;
+}
+
+/*
+ * Skip RadioLib's full init when the chip still holds our configuration.
+ * That takes the object that configured it: only a radio held by init
+ * survives between commands, any other one is built anew and fully
+ * initialized by each rx, scan or cap.
+ */
+eCC1101 *cc1101_init(int id) {
+  int64_t start = esp_timer_get_time();
+
+  if (!ecrf_radio_id_valid(id) || !ecrf_radio_free(id))
+    return NULL;
+
+  eCC1101 *cc1101 = cc1101_acquire(id);
+  if (cc1101 == NULL)
+    return NULL;
+
+  if (cc1101->probe()) {
+    ecrf_boot_span("init fast", id, start, esp_timer_get_time());
+    return cc1101;
   }
 
-  eCC1101 *cc1101 = &ecrf_radios[id];
   cc1101->begin();
   cc1101->get_radio_state();
+  ecrf_boot_span("init full", id, start, esp_timer_get_time());
   return cc1101;
 }
 
+/*
+ * Bring every radio up: buses are prepared one after the other, then each
+ * radio runs its full init on its own RX task, in rounds of one radio per
+ * bus so that only the waits of different buses overlap. The references
+ * are held as by init.
+ */
+int cc1101_init_all(void) {
+  bool pending[ECRF_RADIO_COUNT] = {};
+  int ready = 0;
+  int64_t start = esp_timer_get_time();
+
+  for (size_t id = 0; id < ECRF_RADIO_COUNT; id++) {
+    /* a claimed radio is configured and busy already */
+    if (ecrf_radio_owner[id] != NULL)
+      continue;
+
+    eCC1101 *cc1101 = cc1101_acquire(id);
+    if (cc1101 == NULL)
+      continue;
+
+    /* init keeps a single reference per radio */
+    if (ecrf_radio_held[id])
+      cc1101_release(cc1101);
+    ecrf_radio_held[id] = true;
+
+    if (cc1101->probe()) {
+      ecrf_boot_span("init fast", id, start, esp_timer_get_time());
+      ready++;
+      continue;
+    }
+    cc1101->prepareBus();
+    pending[id] = true;
+  }
+
+  /* one radio per bus and per round */
+  for (;;) {
+    int round[ECRF_BUSES];
+    int started = 0;
+    int notified = 0;
+    int64_t roundStart = esp_timer_get_time();
+
+    for (size_t bus = 0; bus < ECRF_BUSES; bus++) {
+      round[bus] = -1;
+      for (size_t id = 0; id < ECRF_RADIO_COUNT; id++) {
+        if (pending[id] && (ecrf_board[id].bus == bus)) {
+          pending[id] = false;
+          round[bus] = id;
+          ecrf_radios[id]->beginAsync(xTaskGetCurrentTaskHandle());
+          started++;
+          break;
+        }
+      }
+    }
+    if (started == 0)
+      break;
+
+    while ((notified < started) && ulTaskNotifyTake(pdFALSE, pdMS_TO_TICKS(ECRF_INIT_TIMEOUT_MS)))
+      notified++;
+    /* what a late radio still sends must not satisfy a later wait */
+    int taken = 0;
+    for (size_t bus = 0; bus < ECRF_BUSES; bus++) {
+      if ((round[bus] >= 0) && ecrf_radios[round[bus]]->beginAbandon())
+        taken++;
+    }
+    while (notified++ < taken)
+      ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+
+    for (size_t bus = 0; bus < ECRF_BUSES; bus++) {
+      if (round[bus] < 0)
+        continue;
+
+      eCC1101 *cc1101 = ecrf_radios[round[bus]];
+      ecrf_boot_span("init full", round[bus], roundStart, roundStart + cc1101->beginDuration());
+      if (cc1101->beginState() == RADIOLIB_ERR_NONE)
+        ready++;
+    }
+  }
+  ecrf_boot_span("init all", -1, start, esp_timer_get_time());
+
+  return ready;
+}
+
 
 #define LONG_TIME 0xffff
 
@@ -86,19 +381,57 @@ static BaseType_t cc1101_init_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
   char buf[16];
   const char *idStr = FreeRTOS_CLIGetParameter(pcCommandString, 1, &idLen);
 
+  if ((idLen == 3) && (strncmp(idStr, "all", idLen) == 0)) {
+    int64_t start = esp_timer_get_time();
+    int ready = cc1101_init_all();
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] %d/%d modules initialized in %u us\n",
+             ready, (int)ECRF_RADIO_COUNT, (unsigned)(esp_timer_get_time() - start));
+    return pdFALSE;
+  }
+
   int id = atoi(idStr);
+  if (!ecrf_radio_id_valid(id) || !ecrf_radio_free(id))
+    return pdFALSE;
 
-  eCC1101 *cc1101 = cc1101_init(id);
+  /* init keeps the module alive until release, re-running it only re-initializes */
+  bool held = (cc1101_get(id) != NULL) && ecrf_radio_held[id];
+  eCC1101 *cc1101 = held ? cc1101_get(id) : cc1101_init(id);
 
   if (cc1101 == NULL)
       return pdFALSE;
 
+  if (held) {
+    cc1101->begin();
+    cc1101->get_radio_state();
+  }
+  ecrf_radio_held[id] = true;
+
   sprintf(pcWriteBuffer, "[CC1101] Module %d initialized!\n", id);
   xWriteBufferLen = strlen(pcWriteBuffer);
 
   return pdFALSE;
 }
-FREERTOS_SHELL_CMD_REGISTER("init", "init <radio id>", cc1101_init_cmd, 1);
+FREERTOS_SHELL_CMD_REGISTER("init", "init <radio id>|all", cc1101_init_cmd, 1);
+
+static BaseType_t cc1101_release_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                     const char *pcCommandString) {
+  int id;
+
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
+  eCC1101 *cc1101 = cc1101_get(id);
+  if ((cc1101 == NULL) || !ecrf_radio_held[id]) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Module %d is not initialized\n", id);
+    return pdFALSE;
+  }
+
+  ecrf_radio_held[id] = false;
+  cc1101_release(cc1101);
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Module %d released%s\n", id,
+           cc1101_get(id) == NULL ? "" : " (still in use)");
+
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("release", "release <radio id>", cc1101_release_cmd, 1);
 
 static BaseType_t cc1101_scan_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
                                   const char *pcCommandString) {
@@ -132,20 +465,23 @@ static BaseType_t cc1101_scan_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
     if (rssi_scan.rssi_fine > rssi_threshold) {
       // Deliver results fine
       len = snprintf(pcWriteBuffer, xWriteBufferLen,
-                     "FINE        Frequency: %.2f  RSSI: %d\n",
-                     (float)rssi_scan.frequency_fine / 1000000.0,
+                     "FINE        Frequency: %u.%02u  RSSI: %d\n",
+                     (unsigned)(rssi_scan.frequency_fine / 1000000),
+                     (unsigned)((rssi_scan.frequency_fine % 1000000) / 10000),
                      rssi_scan.rssi_fine);
     } else if (rssi_scan.rssi_coarse > rssi_threshold) {
       // Deliver results coarse
       len = snprintf(pcWriteBuffer, xWriteBufferLen,
-                     "COARSE      Frequency: %.2f  RSSI: %d\n",
-                     (float)rssi_scan.frequency_coarse / 1000000.0,
+                     "COARSE      Frequency: %u.%02u  RSSI: %d\n",
+                     (unsigned)(rssi_scan.frequency_coarse / 1000000),
+                     (unsigned)((rssi_scan.frequency_coarse % 1000000) / 10000),
                      rssi_scan.rssi_coarse);
     }
     if (len)
       return pdTRUE;
   }
 
+  cc1101_release(pCC1101);
   pCC1101 = NULL;
   scan_loop = 0;
 
@@ -164,6 +500,20 @@ static BaseType_t cc1101_receive_cmd(char *pcWriteBuffer,
   const size_t maxLineLength = 128;
   if (pCC1101 == NULL) { 
     int id;
+    BaseType_t nameLen;
+    char name[ECC1101_PROFILE_NAME_LEN] = ECRF_PROFILE_DEFAULT;
+    struct s_cc1101_rf_profile stored;
+
+    const char *nameStr = FreeRTOS_CLIGetParameter(pcCommandString, 3, &nameLen);
+    if (nameStr != NULL) {
+      memset(name, 0, sizeof(name));
+      strncpy(name, nameStr, MIN((size_t)nameLen, sizeof(name) - 1));
+    }
+    const struct s_cc1101_rf_profile *profile = ecrf_profile_find(name, &stored);
+    if (profile == NULL) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Unknown profile %s\n", name);
+      return pdFALSE;
+    }
 
     FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
 
@@ -174,27 +524,70 @@ static BaseType_t cc1101_receive_cmd(char *pcWriteBuffer,
     FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, (int *)&rxLength);
     rxLength = ALIGN(rxLength, minLength);
 
-    struct s_cc1101_rf_rx_settings settings433M250kASK = {
-      .freq = 433.92,
-      .br = 10.0,
-      .freqDev = 0.0,
-      .rxBw = 250.0,
-      .modulation = RADIOLIB_CC1101_MOD_FORMAT_ASK_OOK,
-    };
-    pCC1101->startRawReceive(&settings433M250kASK);
+    /* per-session buffer sizing, 0 keeps the board defaults */
+    rxStart = esp_timer_get_time();
+    ecrf_radio_session_setup(pCC1101, id);
+    int bufferSize = 0;
+    int triggerLevel = 0;
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 4, &bufferSize);
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 5, &triggerLevel);
+
+    if (pCC1101->startRawReceive(profile, bufferSize, triggerLevel) != RADIOLIB_ERR_NONE) {
+      snprintf(pcWriteBuffer, xWriteBufferLen,
+               "[E] [CC1101] No room for a %d bytes session (arena largest %u)\n",
+               bufferSize, (unsigned)ecrf_arena_largest());
+      cc1101_release(pCC1101);
+      pCC1101 = NULL;
+      return pdFALSE;
+    }
   }
  
   if ((rxReceived % maxLineLength) == 0 ) {
     snprintf(pcWriteBuffer, xWriteBufferLen, "\n[%02u] ", (unsigned) (rxReceived / maxLineLength));
     pcWriteBuffer += 6;
-    xWriteBufferLen += 6;
+    xWriteBufferLen -= 6;
   }
 
+  /* gated sessions: tag each burst where it starts in the stream */
+  struct s_eCC1101_burst burst;
+  size_t burstLimit = SIZE_MAX;
+  uint32_t offset = pCC1101->rawOffset();
+  if (pCC1101->rawBurst(&burst, false)) {
+    if ((int32_t)(burst.offset - offset) <= 0) {
+      pCC1101->rawBurst(&burst);
+      int len;
+      if (burst.freq_offset == ECC1101_FREQ_OFFSET_NONE)
+        len = snprintf(pcWriteBuffer, xWriteBufferLen, "<burst %d dBm> ", burst.rssi);
+      else
+        len = snprintf(pcWriteBuffer, xWriteBufferLen, "<burst %d dBm %+ld Hz> ", burst.rssi,
+                       (long)burst.freq_offset);
+      pcWriteBuffer += len;
+      xWriteBufferLen -= len;
+    } else {
+      burstLimit = burst.offset - offset;
+    }
+  }
+
+  /*
+   * room for the longest gap marker ahead of the data: the hex of byte i
+   * then ends before byte i + 1 is read
+   */
   char *rxPtr = pcWriteBuffer + xWriteBufferLen / 2;
   //size_t xferLen = ALIGN(MIN(xWriteBufferLen / 2, rxLength), minLength);
-  size_t xferLen = MIN(xWriteBufferLen / 2, rxLength);
+  size_t xferLen = MIN(MIN(xWriteBufferLen / 2 - (sizeof("<gap 4294967295> ") - 1), rxLength),
+                       burstLimit);
 
-  int len = pCC1101->rawReceive((uint8_t *)rxPtr, xferLen, pdMS_TO_TICKS(5000));
+  struct s_eCC1101_gap gap;
+  int len = pCC1101->rawReceive((uint8_t *)rxPtr, xferLen, pdMS_TO_TICKS(5000), &gap);
+  if (gap.lost == ECC1101_GAP_UNKNOWN) {
+    int n = snprintf(pcWriteBuffer, xWriteBufferLen, "<gap ?> ");
+    pcWriteBuffer += n;
+    xWriteBufferLen -= n;
+  } else if (gap.lost != 0) {
+    int n = snprintf(pcWriteBuffer, xWriteBufferLen, "<gap %u> ", (unsigned)gap.lost);
+    pcWriteBuffer += n;
+    xWriteBufferLen -= n;
+  }
   //char buf[64];
   //snprintf(buf, sizeof(buf), "[%d]\n", len);
   //Serial.print(buf);
@@ -203,20 +596,592 @@ static BaseType_t cc1101_receive_cmd(char *pcWriteBuffer,
     Serial.println("Error");
   }
 
+  if ((rxReceived == 0) && (len > 0))
+    ecrf_boot_span("rx first byte", -1, rxStart, esp_timer_get_time());
   rxReceived += len;
-  while (len--) {
-    snprintf(pcWriteBuffer, xWriteBufferLen, "%02x", *rxPtr++);
-    pcWriteBuffer += 2;
-    xWriteBufferLen -= 2;
-  }
+  /* in place: the data sits in the upper half of the output buffer */
+  if (len > 0)
+    ecrf_hex_encode(pcWriteBuffer, (const uint8_t *)rxPtr, len);
 
   if ((rxLength - rxReceived) > 0) {
     return pdTRUE;
   } else {
     pCC1101->stopRawReceive();
+    pCC1101->closeRawSession();
+    cc1101_release(pCC1101);
     pCC1101 = NULL;
     rxReceived = 0;
     return pdFALSE;
   }
 }
-FREERTOS_SHELL_CMD_REGISTER("rx", "rx <radio id> <length>", cc1101_receive_cmd, 2);
+FREERTOS_SHELL_CMD_REGISTER("rx", "rx <radio id> <length> [profile] [bufsize] [trigger]", cc1101_receive_cmd, -1);
+
+/*
+ * Capture to RAM: the whole session buffer is filled at full rate with no
+ * console output in the loop, then dumped once the radio is stopped.
+ */
+static BaseType_t cc1101_capture_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                     const char *pcCommandString) {
+  const TickType_t timeout = pdMS_TO_TICKS(30000);
+  static eCC1101 *cc1101 = NULL;
+  static size_t dumped = 0;
+
+  if (cc1101 == NULL) {
+    int id;
+    int length = 0;
+    BaseType_t nameLen;
+    char name[ECC1101_PROFILE_NAME_LEN] = ECRF_PROFILE_DEFAULT;
+    struct s_cc1101_rf_profile stored;
+
+    const char *nameStr = FreeRTOS_CLIGetParameter(pcCommandString, 3, &nameLen);
+    if (nameStr != NULL) {
+      memset(name, 0, sizeof(name));
+      strncpy(name, nameStr, MIN((size_t)nameLen, sizeof(name) - 1));
+    }
+    const struct s_cc1101_rf_profile *profile = ecrf_profile_find(name, &stored);
+    if (profile == NULL) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Unknown profile %s\n", name);
+      return pdFALSE;
+    }
+
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &length);
+    if (length <= 0) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Wrong capture length\n");
+      return pdFALSE;
+    }
+
+    cc1101 = cc1101_init(id);
+    if (cc1101 == NULL)
+      return pdFALSE;
+
+    cc1101->setGate(&ecrf_gates[id]);
+    cc1101->setRxPoll(ecrf_rx_poll[id]);
+    cc1101->setTracking(ecrf_afc[id]);
+    if (cc1101->startRawCapture(profile, length) != RADIOLIB_ERR_NONE) {
+      snprintf(pcWriteBuffer, xWriteBufferLen,
+               "[E] [CC1101] No room for a %d bytes capture (arena largest %u)\n",
+               length, (unsigned)ecrf_arena_largest());
+      cc1101_release(cc1101);
+      cc1101 = NULL;
+      return pdFALSE;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    while (!cc1101->rawCaptureFull() && (cc1101->rawAvailable() < (size_t)length) &&
+           ((xTaskGetTickCount() - start) < timeout)) {
+      vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    cc1101->stopRawReceive();
+    dumped = 0;
+
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Captured %u bytes in %u ms",
+             (unsigned)cc1101->rawAvailable(),
+             (unsigned)pdTICKS_TO_MS(xTaskGetTickCount() - start));
+    return pdTRUE;
+  }
+
+  /* dump 32 bytes per line, behind a [offset] tag */
+  uint8_t chunk[32];
+  int len = cc1101->rawReceive(chunk, sizeof(chunk), 0);
+  if (len <= 0) {
+    cc1101->closeRawSession();
+    cc1101_release(cc1101);
+    cc1101 = NULL;
+    snprintf(pcWriteBuffer, xWriteBufferLen, "\n");
+    return pdFALSE;
+  }
+
+  size_t offset = snprintf(pcWriteBuffer, xWriteBufferLen, "\n[%05u] ", (unsigned)dumped);
+  ecrf_hex_encode(pcWriteBuffer + offset, chunk, MIN((size_t)len, (xWriteBufferLen - offset - 1) / 2));
+  dumped += len;
+
+  return pdTRUE;
+}
+FREERTOS_SHELL_CMD_REGISTER("cap", "cap <radio id> <length> [profile]", cc1101_capture_cmd, -1);
+
+static BaseType_t cc1101_gate_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                  const char *pcCommandString) {
+  BaseType_t paramLen;
+  int id = -1;
+  int threshold = 0;
+  int pre = 0;
+  int post = 0;
+  int wor = 0;
+
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
+  const char *param = FreeRTOS_CLIGetParameter(pcCommandString, 2, &paramLen);
+  if (!ecrf_radio_id_valid(id) || (param == NULL)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "Usage: gate <radio id> off | gate <radio id> <cs thr dB> [pre] [post] [wor ms]\n");
+    return pdFALSE;
+  }
+
+  struct s_cc1101_gate *gate = &ecrf_gates[id];
+  if ((paramLen == 3) && (strncmp(param, "off", 3) == 0)) {
+    *gate = {};
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Module %d streams everything\n", id);
+    return pdFALSE;
+  }
+
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &threshold);
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 3, &pre);
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 4, &post);
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 5, &wor);
+
+  gate->enabled = true;
+  gate->cs_abs_thr = MAX(-7, MIN(threshold, 7));
+  gate->cs_rel_thr = 0;
+  gate->pre = wor ? 0 : MIN(MAX(pre, 0), ECC1101_GATE_PRE_MAX);
+  gate->post = MIN(MAX(post, 0), 0xFFFF);
+  gate->wor_ms = MIN(MAX(wor, 0), 0xFFFF);
+  snprintf(pcWriteBuffer, xWriteBufferLen,
+           "[CC1101] Module %d gated at %+d dB, pre %u post %u bytes, wor %u ms\n", id,
+           gate->cs_abs_thr, gate->pre, gate->post, gate->wor_ms);
+
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("gate", "gate <radio id> off | <cs thr dB> [pre] [post] [wor ms]", cc1101_gate_cmd, -1);
+
+static size_t cc1101_rxstats_print(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                   const struct s_eCC1101_rx_stats *stats) {
+  uint32_t avg = stats->drains ? (uint32_t)(stats->latency_sum_us / stats->drains) : 0;
+
+  return snprintf(pcWriteBuffer, xWriteBufferLen,
+                  "irq %u drain %u bytes %u bursts %u ovf %u poll %u drop %u lat us %u/%u/%u\n",
+                  (unsigned)stats->irqs, (unsigned)stats->drains, (unsigned)stats->bytes,
+                  (unsigned)stats->bursts, (unsigned)stats->overflows, (unsigned)stats->polls,
+                  (unsigned)stats->dropped,
+                  (unsigned)(stats->drains ? stats->latency_min_us : 0),
+                  (unsigned)avg, (unsigned)stats->latency_max_us);
+}
+
+/*
+ * ISR-to-drain latency benchmark: stream noise in raw mode for a while and
+ * report the latency between the GDO0 interrupt and the FIFO drain.
+ */
+static BaseType_t cc1101_rxbench_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                     const char *pcCommandString) {
+  static uint8_t sink[64];
+  int id;
+  int duration;
+  struct s_eCC1101_rx_stats stats;
+  struct s_cc1101_rf_profile stored;
+
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &duration);
+
+  const struct s_cc1101_rf_profile *profile = ecrf_profile_find(ECRF_PROFILE_DEFAULT, &stored);
+  if (profile == NULL) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Unknown profile %s\n",
+             ECRF_PROFILE_DEFAULT);
+    return pdFALSE;
+  }
+
+  eCC1101 *cc1101 = cc1101_init(id);
+  if (cc1101 == NULL)
+    return pdFALSE;
+
+  cc1101->resetRxStats();
+  ecrf_radio_session_setup(cc1101, id);
+  /* without a session rawReceive() returns at once, the loop would spin */
+  if (cc1101->startRawReceive(profile) != RADIOLIB_ERR_NONE) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "[E] [CC1101] No room for a session (arena largest %u)\n",
+             (unsigned)ecrf_arena_largest());
+    cc1101_release(cc1101);
+    return pdFALSE;
+  }
+  TickType_t start = xTaskGetTickCount();
+  while ((xTaskGetTickCount() - start) < pdMS_TO_TICKS(duration)) {
+    cc1101->rawReceive(sink, sizeof(sink), pdMS_TO_TICKS(100));
+  }
+  cc1101->stopRawReceive();
+  cc1101->closeRawSession();
+  cc1101->getRxStats(&stats);
+  cc1101_release(cc1101);
+
+  /* the SPI backend is part of the result, compare runs of both builds */
+  size_t len = snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] %s core %d prio %u: ",
+                        ECC1101_SPI_BACKEND, (int)ecrf_task_plan(ECRF_TASK_RX)->core,
+                        (unsigned)ecrf_task_plan(ECRF_TASK_RX)->priority);
+  cc1101_rxstats_print(pcWriteBuffer + len, xWriteBufferLen - len, &stats);
+
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("rxbench", "rxbench <radio id> <ms>", cc1101_rxbench_cmd, 2);
+
+static BaseType_t cc1101_rxpoll_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                    const char *pcCommandString) {
+  BaseType_t paramLen;
+  int id = -1;
+
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
+  const char *param = FreeRTOS_CLIGetParameter(pcCommandString, 2, &paramLen);
+  if (!ecrf_radio_id_valid(id) || (param == NULL)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Usage: rxpoll <radio id> on|off\n");
+    return pdFALSE;
+  }
+
+  ecrf_rx_poll[id] = (paramLen == 2) && (strncmp(param, "on", 2) == 0);
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Module %d drains on %s\n", id,
+           ecrf_rx_poll[id] ? "interrupts, busy-poll at high rates" : "interrupts only");
+
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("rxpoll", "rxpoll <radio id> on|off", cc1101_rxpoll_cmd, 2);
+
+/*
+ * Frequency tracking: rx and cap sessions with a gate and an FSK profile
+ * follow a drifting transmitter burst after burst, rx reports the offset
+ * in each burst tag. Lets a narrow rxBw profile hold on to cheap remotes.
+ */
+static BaseType_t cc1101_afc_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                 const char *pcCommandString) {
+  BaseType_t paramLen;
+  int id = -1;
+
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
+  const char *param = FreeRTOS_CLIGetParameter(pcCommandString, 2, &paramLen);
+  if (!ecrf_radio_id_valid(id) || (param == NULL)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Usage: afc <radio id> on|off\n");
+    return pdFALSE;
+  }
+
+  ecrf_afc[id] = (paramLen == 2) && (strncmp(param, "on", 2) == 0);
+  if (ecrf_afc[id] && !ecrf_gates[id].enabled)
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "[CC1101] Module %d tracks frequency once a gate is set, FSK only\n", id);
+  else
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Module %d frequency tracking %s\n", id,
+             ecrf_afc[id] ? "on, FSK only" : "off");
+
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("afc", "afc <radio id> on|off", cc1101_afc_cmd, 2);
+
+/* indexed by enum ecc1101_overflow_policy */
+static const char *const ecrf_overflow_names[] = {
+    "newest",
+    "oldest",
+    "block",
+};
+
+#define ECRF_OVERFLOW_POLICIES (sizeof(ecrf_overflow_names) / sizeof(ecrf_overflow_names[0]))
+
+static BaseType_t cc1101_overflow_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                      const char *pcCommandString) {
+  BaseType_t paramLen;
+  int id = -1;
+  int block_ms = 100;
+  size_t policy = ECRF_OVERFLOW_POLICIES;
+
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
+  const char *param = FreeRTOS_CLIGetParameter(pcCommandString, 2, &paramLen);
+  for (size_t i = 0; (param != NULL) && (i < ECRF_OVERFLOW_POLICIES); i++) {
+    if ((strlen(ecrf_overflow_names[i]) == (size_t)paramLen) &&
+        (strncmp(param, ecrf_overflow_names[i], paramLen) == 0))
+      policy = i;
+  }
+  if (!ecrf_radio_id_valid(id) || (policy == ECRF_OVERFLOW_POLICIES)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Usage: overflow <radio id> newest|oldest|block [ms]\n");
+    return pdFALSE;
+  }
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 3, &block_ms);
+
+  ecrf_overflows[id].policy = (enum ecc1101_overflow_policy)policy;
+  ecrf_overflows[id].block_ms = (policy == ECC1101_BLOCK) ? MIN(MAX(block_ms, 0), 0xFFFF) : 0;
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Module %d on a full buffer: %s %u ms\n", id,
+           ecrf_overflow_names[policy], ecrf_overflows[id].block_ms);
+
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("overflow", "overflow <radio id> newest|oldest|block [ms]", cc1101_overflow_cmd, -1);
+
+/* 2-FSK data rates tried by rxmax, in kbps (500 is the chip maximum) */
+static const float ecrf_rxmax_rates[] = {50.0, 100.0, 150.0, 200.0, 250.0, 300.0, 400.0, 500.0};
+
+#define ECRF_RXMAX_RATES (sizeof(ecrf_rxmax_rates) / sizeof(ecrf_rxmax_rates[0]))
+
+/*
+ * Highest sustainable rate: stream noise at increasing data rates, each step
+ * passes when the chip never overflowed and the expected byte count made it
+ * to the stream buffer. Run with rxpoll on and off to compare.
+ */
+static BaseType_t cc1101_rxmax_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                   const char *pcCommandString) {
+  static uint8_t sink[64];
+  static eCC1101 *cc1101 = NULL;
+  static size_t step = 0;
+  static uint32_t best = 0;
+  static int duration;
+  int id = 0;
+  struct s_eCC1101_rx_stats stats;
+
+  if (cc1101 == NULL) {
+    duration = 1000;
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &duration);
+
+    cc1101 = cc1101_init(id);
+    if (cc1101 == NULL)
+      return pdFALSE;
+    cc1101->setGate(NULL);
+    cc1101->setRxPoll(ecrf_rx_poll[id]);
+    /* a slow consumer must show as a failed step, not stall the drain */
+    cc1101->setOverflowPolicy(ECC1101_DROP_NEWEST);
+    step = 0;
+    best = 0;
+  }
+
+  float kbps = ecrf_rxmax_rates[step];
+  struct s_cc1101_rf_profile profile =
+      ecc1101_profile_make("rxmax", 433.92, kbps, MIN(kbps / 2, 380.0f), 812.0,
+                           RADIOLIB_CC1101_MOD_FORMAT_2_FSK);
+  uint32_t bitrate = ecc1101_profile_bitrate(&profile);
+  uint32_t received = 0;
+
+  cc1101->resetRxStats();
+  cc1101->startRawReceive(&profile);
+  int64_t start = esp_timer_get_time();
+  while ((esp_timer_get_time() - start) < (int64_t)duration * 1000) {
+    received += cc1101->rawReceive(sink, sizeof(sink), pdMS_TO_TICKS(100));
+  }
+  int64_t elapsed = esp_timer_get_time() - start;
+  cc1101->stopRawReceive();
+  cc1101->closeRawSession();
+  cc1101->getRxStats(&stats);
+
+  /* 2% slack for the RX start and the last partial FIFO */
+  uint32_t expected = (uint32_t)(((uint64_t)bitrate * elapsed) / 8000000);
+  bool lossless = (stats.overflows == 0) && (received >= expected - expected / 50);
+  if (lossless && (bitrate > best))
+    best = bitrate;
+
+  snprintf(pcWriteBuffer, xWriteBufferLen, "%6lu bps: %lu/%lu bytes, ovf %u, poll %u, %s\n",
+           (unsigned long)bitrate, (unsigned long)received, (unsigned long)expected,
+           (unsigned)stats.overflows, (unsigned)stats.polls, lossless ? "ok" : "LOSS");
+  if (++step < ECRF_RXMAX_RATES)
+    return pdTRUE;
+
+  cc1101_release(cc1101);
+  cc1101 = NULL;
+  size_t len = strlen(pcWriteBuffer);
+  snprintf(pcWriteBuffer + len, xWriteBufferLen - len, "[CC1101] %s: %lu bps max without loss\n",
+           ECC1101_SPI_BACKEND, (unsigned long)best);
+
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("rxmax", "rxmax <radio id> [ms per rate]", cc1101_rxmax_cmd, -1);
+
+/*
+ * Symbol rate of an unknown signal: the raw stream is oversampled at
+ * ECRF_SYMRATE_SAMPLE_KBPS and its run lengths reduced to a symbol unit
+ * (ecrf_symrate.h). The radio is then retuned to ECRF_SYMRATE_OVERSAMPLE
+ * samples a symbol, and the profile saved for rx and cap when named.
+ * Noise between frames weighs against the fit, a gate helps.
+ */
+#ifndef ECRF_SYMRATE_SAMPLE_KBPS
+#define ECRF_SYMRATE_SAMPLE_KBPS 100.0
+#endif
+
+#ifndef ECRF_SYMRATE_OVERSAMPLE
+#define ECRF_SYMRATE_OVERSAMPLE 4
+#endif
+
+#define ECRF_SYMRATE_TOLERANCE 20
+#define ECRF_SYMRATE_MIN_FIT 70
+/* CC1101 data rate range */
+#define ECRF_SYMRATE_KBPS_MIN 0.6
+#define ECRF_SYMRATE_KBPS_MAX 500.0
+
+static struct s_ecrf_symrate ecrf_symrate;
+
+size_t ecrf_symrate_footprint(void) {
+  return sizeof(ecrf_symrate);
+}
+
+static BaseType_t cc1101_symrate_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                     const char *pcCommandString) {
+  static int step = 0;
+  static bool found;
+  static int id;
+  static uint32_t sampleRate;
+  static uint32_t tunedRate;
+  static int saved;
+  static struct s_ecrf_symrate_estimate estimate;
+  static char saveName[ECC1101_PROFILE_NAME_LEN];
+
+  if (step == 1) {
+    step = found ? 2 : 0;
+    if (!found) {
+      unsigned tenths = (unsigned)(estimate.unit * 10 + 0.5f);
+      snprintf(pcWriteBuffer, xWriteBufferLen,
+               "[E] [CC1101] No symbol rate: %u.%u samples explain %u%%, %u%% in short runs\n",
+               tenths / 10, tenths % 10, estimate.fit, estimate.short_runs);
+      return pdFALSE;
+    }
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "[CC1101] Symbol %lu us, %lu baud, %u%% fit, runs up to %u symbols\n",
+             (unsigned long)(estimate.unit * 1000000.0f / sampleRate),
+             (unsigned long)(sampleRate / estimate.unit), estimate.fit, estimate.longest);
+    return pdTRUE;
+  }
+
+  if (step == 2) {
+    step = 0;
+    if (saved < 0)
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] No NVS slot left for %s\n", saveName);
+    else
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] %lu bps profile saved as %s\n",
+               (unsigned long)tunedRate, saveName);
+    return pdFALSE;
+  }
+
+  int duration = 2000;
+  BaseType_t nameLen;
+  char name[ECC1101_PROFILE_NAME_LEN] = ECRF_PROFILE_DEFAULT;
+  struct s_cc1101_rf_profile stored;
+
+  const char *nameStr = FreeRTOS_CLIGetParameter(pcCommandString, 2, &nameLen);
+  if (nameStr != NULL) {
+    memset(name, 0, sizeof(name));
+    strncpy(name, nameStr, MIN((size_t)nameLen, sizeof(name) - 1));
+  }
+  const struct s_cc1101_rf_profile *base = ecrf_profile_find(name, &stored);
+  if (base == NULL) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Unknown profile %s\n", name);
+    return pdFALSE;
+  }
+
+  memset(saveName, 0, sizeof(saveName));
+  nameStr = FreeRTOS_CLIGetParameter(pcCommandString, 4, &nameLen);
+  if (nameStr != NULL)
+    strncpy(saveName, nameStr, MIN((size_t)nameLen, sizeof(saveName) - 1));
+  if (ecrf_profile_is_builtin(saveName)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] %s is a built-in profile\n", saveName);
+    return pdFALSE;
+  }
+
+  id = 0;
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 1, &id);
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 3, &duration);
+  /* the radio is not kept, the result lives on as a profile: one per module by default */
+  if (saveName[0] == 0)
+    snprintf(saveName, sizeof(saveName), "symrate%d", id);
+
+  eCC1101 *cc1101 = cc1101_init(id);
+  if (cc1101 == NULL)
+    return pdFALSE;
+
+  /* the base profile, only faster */
+  struct s_cc1101_rf_profile sampling = *base;
+  ecc1101_profile_set_bitrate(&sampling, ECRF_SYMRATE_SAMPLE_KBPS);
+  sampleRate = ecc1101_profile_bitrate(&sampling);
+
+  cc1101->setGate(&ecrf_gates[id]);
+  cc1101->setRxPoll(ecrf_rx_poll[id]);
+  cc1101->setTracking(ecrf_afc[id]);
+  cc1101->setOverflowPolicy(ECC1101_DROP_NEWEST);
+  if (cc1101->startRawReceive(&sampling) != RADIOLIB_ERR_NONE) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] No room for a session (arena largest %u)\n",
+             (unsigned)ecrf_arena_largest());
+    cc1101_release(cc1101);
+    return pdFALSE;
+  }
+
+  uint8_t chunk[64];
+  struct s_eCC1101_gap gap;
+  ecrf_symrate_reset(&ecrf_symrate);
+  int64_t start = esp_timer_get_time();
+  while ((esp_timer_get_time() - start) < (int64_t)duration * 1000) {
+    int len = cc1101->rawReceive(chunk, sizeof(chunk), pdMS_TO_TICKS(100), &gap);
+    /* a run is never joined across lost data */
+    if (gap.lost != 0)
+      ecrf_symrate_break(&ecrf_symrate);
+    if (len > 0)
+      ecrf_symrate_feed(&ecrf_symrate, chunk, len);
+  }
+  cc1101->stopRawReceive();
+  cc1101->closeRawSession();
+
+  found = ecrf_symrate_estimate(&ecrf_symrate, ECRF_SYMRATE_TOLERANCE, ECRF_SYMRATE_MIN_FIT,
+                                &estimate);
+  if (found) {
+    double kbps = sampleRate / estimate.unit * ECRF_SYMRATE_OVERSAMPLE / 1000.0;
+    kbps = MIN(kbps, ECRF_SYMRATE_KBPS_MAX);
+    kbps = MAX(kbps, ECRF_SYMRATE_KBPS_MIN);
+
+    struct s_cc1101_rf_profile tuned = *base;
+    memset(tuned.name, 0, sizeof(tuned.name));
+    strncpy(tuned.name, saveName, sizeof(tuned.name) - 1);
+    ecc1101_profile_set_bitrate(&tuned, kbps);
+    tunedRate = ecc1101_profile_bitrate(&tuned);
+    saved = ecrf_profile_save(&tuned);
+  }
+  cc1101_release(cc1101);
+
+  step = 1;
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] %lu runs in %d ms at %lu bps, %lu silences\n",
+           (unsigned long)ecrf_symrate.runs, duration, (unsigned long)sampleRate,
+           (unsigned long)ecrf_symrate.silences);
+  return pdTRUE;
+}
+FREERTOS_SHELL_CMD_REGISTER("symrate", "symrate <radio id> [profile] [ms] [save as, symrate<id>]",
+                            cc1101_symrate_cmd, -1);
+
+static BaseType_t cc1101_radios_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                    const char *pcCommandString) {
+  static size_t id = 0;
+
+  if (id == 0) {
+    size_t len = snprintf(pcWriteBuffer, xWriteBufferLen,
+                          "ID NAME     BUS  GRP  CS GDO0 GDO2  RXBUF TRIG REFS\n");
+    pcWriteBuffer += len;
+    xWriteBufferLen -= len;
+  }
+
+  const struct s_ecrf_board_radio *desc = &ecrf_board[id];
+  snprintf(pcWriteBuffer, xWriteBufferLen, "%2u %-8s %-4s %3u %3d %4d %4d %6u %4u %4u\n",
+           (unsigned)id, desc->name, ecrf_spi_bus_names[desc->bus], desc->cs_group,
+           (int)desc->pins.cs, (int)desc->pins.gdo0, (int)desc->pins.gdo2,
+           (unsigned)desc->rx_buffer_size, (unsigned)desc->rx_trigger_level,
+           (unsigned)ecrf_radio_refs[id]);
+
+  if (++id < ECRF_RADIO_COUNT)
+    return pdTRUE;
+
+  id = 0;
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("radios", "list the radios of the board", cc1101_radios_cmd, 0);
+
+static BaseType_t ecrf_boot_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                const char *pcCommandString) {
+  static size_t index = 0;
+  static int64_t previous = 0;
+  struct s_ecrf_boot_event event;
+
+  if (!ecrf_boot_event(index, &event)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "no event\n");
+    index = 0;
+    return pdFALSE;
+  }
+
+  if (index == 0)
+    previous = event.start_us;
+
+  /* start time, gap from the previous event end, duration */
+  snprintf(pcWriteBuffer, xWriteBufferLen, "%8u us  +%7u  %7u us  %-14s %s\n",
+           (unsigned)event.start_us, (unsigned)(event.start_us > previous ? event.start_us - previous : 0),
+           (unsigned)(event.end_us - event.start_us), event.phase,
+           ((event.radio >= 0) && (event.radio < (int)ECRF_RADIO_COUNT)) ? ecrf_board[event.radio].name : "");
+  previous = event.end_us;
+
+  if (ecrf_boot_event(++index, &event))
+    return pdTRUE;
+
+  index = 0;
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("boot", "boot and radio init timeline", ecrf_boot_cmd, 0);
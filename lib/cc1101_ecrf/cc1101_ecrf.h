@@ -0,0 +1,57 @@
+#ifndef _CC1101_ECRF_H
+#define _CC1101_ECRF_H
+
+#include <eCC1101.h>
+
+#define ECRF_PROFILE_DEFAULT "ook433"
+
+/*
+ * Radio access shared by the shell commands. Radios are constructed by the
+ * first cc1101_acquire()/cc1101_init() and torn down by the last
+ * cc1101_release(); cc1101_get() only returns a radio that is alive.
+ */
+int ecrf_radio_count(void);
+void ecrf_radio_boot(void);
+size_t ecrf_radio_footprint(void);
+eCC1101 *cc1101_acquire(int id);
+void cc1101_release(eCC1101 *cc1101);
+eCC1101 *cc1101_init(int id);
+int cc1101_init_all(void);
+eCC1101 *cc1101_get(int id);
+/*
+ * A background session (scheduler, push session) claims its radio for as
+ * long as it runs: cc1101_init() and init refuse a claimed radio, so no
+ * other command opens a session under it. False when already claimed.
+ */
+bool ecrf_radio_claim(int id, const char *owner);
+void ecrf_radio_unclaim(int id);
+/* gate, busy-poll, tracking and overflow settings of a radio, before a session */
+void ecrf_radio_session_setup(eCC1101 *cc1101, int id);
+size_t ecrf_survey_footprint(void);
+size_t ecrf_script_footprint(void);
+size_t ecrf_symrate_footprint(void);
+size_t ecrf_sched_footprint(void);
+
+/* radio id of the push session, -1 when none runs */
+int ecrf_sink_session(void);
+
+/*
+ * Network: WiFi station, the "net" sink streaming framed session data to a
+ * TCP or UDP receiver, and a shell on a TCP port. ecrf_net_boot() rejoins
+ * the network saved in NVS, before the heap guard is armed.
+ */
+void ecrf_net_boot(void);
+size_t ecrf_net_footprint(void);
+
+/*
+ * RF profiles: built-ins from the plugin registry first, then user profiles
+ * from NVS.
+ * NVS profiles are copied into storage, built-ins are returned in place.
+ */
+const struct s_cc1101_rf_profile *ecrf_profile_find(const char *name,
+                                                    struct s_cc1101_rf_profile *storage);
+bool ecrf_profile_is_builtin(const char *name);
+/* into the slot of the same name or the first free one, -1 when full */
+int ecrf_profile_save(const struct s_cc1101_rf_profile *profile);
+
+#endif /* _CC1101_ECRF_H */
@@ -0,0 +1,80 @@
+#ifndef _ECRF_BOARD_H
+#define _ECRF_BOARD_H
+
+#include <RadioLib.h>
+#include <eCC1101.h>
+
+/*
+ * Board description: one entry per CC1101 module. Radios in the same CS
+ * group share a SPI bus and deselect each other before talking to the chip.
+ * Define ECRF_BOARD_CUSTOM and provide ECRF_BOARD_RADIOS to describe
+ * another board.
+ */
+#define ECRF_BUS_HSPI 0
+#define ECRF_BUS_VSPI 1
+
+struct s_ecrf_board_radio {
+  const char *name;
+  uint8_t bus;
+  uint8_t cs_group;
+  struct eCC1101::s_eCC1101_pins pins;
+  size_t rx_buffer_size;
+  size_t rx_trigger_level;
+};
+
+#ifndef ECRF_BOARD_CUSTOM
+
+/* Evil Crow RF v2: two modules on HSPI */
+#define CC1101_MOD_SCK 14
+#define CC1101_MOD_MISO 12
+#define CC1101_MOD_MOSI 13
+
+#define CC1101_MOD1_CSN 5
+#define CC1101_MOD1_GDO0 2
+#define CC1101_MOD1_GDO2 4
+#define CC1101_MOD1_IRQ CC1101_MOD1_GDO0
+#define CC1101_MOD1_GPIO RADIOLIB_NC
+
+#define CC1101_MOD2_CSN 27
+#define CC1101_MOD2_GDO0 25
+#define CC1101_MOD2_GDO2 26
+#define CC1101_MOD2_IRQ CC1101_MOD2_GDO0
+#define CC1101_MOD2_GPIO RADIOLIB_NC
+
+#define ECRF_BOARD_RADIOS                                                      \
+  {                                                                            \
+    .name = "mod1",                                                            \
+    .bus = ECRF_BUS_HSPI,                                                      \
+    .cs_group = 0,                                                             \
+    .pins = {                                                                  \
+      .cs = CC1101_MOD1_CSN,                                                   \
+      .rst = RADIOLIB_NC,                                                      \
+      .clk = CC1101_MOD_SCK,                                                   \
+      .miso = CC1101_MOD_MISO,                                                 \
+      .mosi = CC1101_MOD_MOSI,                                                 \
+      .gdo0 = CC1101_MOD1_IRQ,                                                 \
+      .gdo2 = CC1101_MOD1_GPIO                                                 \
+    },                                                                         \
+    .rx_buffer_size = 1024,                                                    \
+    .rx_trigger_level = 32,                                                    \
+  },                                                                           \
+  {                                                                            \
+    .name = "mod2",                                                            \
+    .bus = ECRF_BUS_HSPI,                                                      \
+    .cs_group = 0,                                                             \
+    .pins = {                                                                  \
+      .cs = CC1101_MOD2_CSN,                                                   \
+      .rst = RADIOLIB_NC,                                                      \
+      .clk = CC1101_MOD_SCK,                                                   \
+      .miso = CC1101_MOD_MISO,                                                 \
+      .mosi = CC1101_MOD_MOSI,                                                 \
+      .gdo0 = CC1101_MOD2_IRQ,                                                 \
+      .gdo2 = CC1101_MOD2_GPIO                                                 \
+    },                                                                         \
+    .rx_buffer_size = 1024,                                                    \
+    .rx_trigger_level = 32,                                                    \
+  }
+
+#endif /* ECRF_BOARD_CUSTOM */
+
+#endif /* _ECRF_BOARD_H */
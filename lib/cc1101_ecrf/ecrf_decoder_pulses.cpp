@@ -0,0 +1,67 @@
+#include <Arduino.h>
+#include "ecrf_plugin.h"
+
+/* a frame ends after this many silent bytes, 32 samples */
+#define ECRF_PULSES_GAP_BYTES 4
+
+/*
+ * Reference decoder: splits an OOK sample stream into frames of pulses,
+ * a pulse being a run of 1 samples. Enough to tell whether a remote is on
+ * air before writing the decoder of its protocol.
+ */
+static struct {
+  uint32_t pulses;
+  uint32_t frames;
+  uint32_t frame_bytes;
+  uint32_t longest_frame;
+  uint32_t silent_bytes;
+  bool mark;
+} ecrf_pulses;
+
+static size_t ecrf_pulses_write(void *ctx, const uint8_t *data, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    uint8_t byte = data[i];
+
+    if (byte == 0) {
+      ecrf_pulses.mark = false;
+      if ((ecrf_pulses.frame_bytes > 0) && (++ecrf_pulses.silent_bytes == ECRF_PULSES_GAP_BYTES)) {
+        if (ecrf_pulses.frame_bytes > ecrf_pulses.longest_frame)
+          ecrf_pulses.longest_frame = ecrf_pulses.frame_bytes;
+        ecrf_pulses.frames++;
+        ecrf_pulses.frame_bytes = 0;
+      }
+      continue;
+    }
+
+    /* a pulse starts on every 0 to 1 edge, the previous byte included */
+    for (int bit = 7; bit >= 0; bit--) {
+      bool mark = (byte >> bit) & 1;
+      if (mark && !ecrf_pulses.mark)
+        ecrf_pulses.pulses++;
+      ecrf_pulses.mark = mark;
+    }
+    ecrf_pulses.frame_bytes += ecrf_pulses.silent_bytes + 1;
+    ecrf_pulses.silent_bytes = 0;
+  }
+
+  return len;
+}
+
+static void ecrf_pulses_reset(void) {
+  memset(&ecrf_pulses, 0, sizeof(ecrf_pulses));
+}
+
+static size_t ecrf_pulses_report(char *buf, size_t len) {
+  return snprintf(buf, len, "%lu pulses in %lu frames, longest %lu bytes\n",
+                  (unsigned long)ecrf_pulses.pulses, (unsigned long)ecrf_pulses.frames,
+                  (unsigned long)ecrf_pulses.longest_frame);
+}
+
+static struct s_eCC1101_sink ecrf_pulses_sink = {.name = "pulses", .write = ecrf_pulses_write};
+
+static const struct s_ecrf_decoder ecrf_pulses_decoder = {
+    .sink = &ecrf_pulses_sink,
+    .reset = ecrf_pulses_reset,
+    .report = ecrf_pulses_report,
+};
+ECRF_DECODER_REGISTER(ecrf_pulses_decoder);
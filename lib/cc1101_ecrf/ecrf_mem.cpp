@@ -0,0 +1,73 @@
+#include <Arduino.h>
+#include <FreeRTOS_CLI.h>
+#include <FreeRTOS_Shell.h>
+#include <esp_heap_caps.h>
+#include <ecrf_arena.h>
+#include <ecrf_heap.h>
+#include <ecrf_log.h>
+#include <ecrf_tasks.h>
+#include "cc1101_ecrf.h"
+
+struct s_ecrf_footprint {
+  const char *name;
+  size_t (*size)(void);
+};
+
+/* static memory per subsystem, fixed at link time */
+static const struct s_ecrf_footprint ecrf_footprints[] = {
+    {"radios", ecrf_radio_footprint},
+    {"tasks", ecrf_task_footprint},
+    {"shell", FreeRTOS_ShellFootprint},
+    {"survey", ecrf_survey_footprint},
+    {"sched", ecrf_sched_footprint},
+    {"log", ecrf_log_footprint},
+    {"script", ecrf_script_footprint},
+    {"symrate", ecrf_symrate_footprint},
+    {"net", ecrf_net_footprint},
+    {"arena", ecrf_arena_size},
+};
+
+#define ECRF_FOOTPRINTS (sizeof(ecrf_footprints) / sizeof(ecrf_footprints[0]))
+
+static BaseType_t ecrf_mem_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                               const char *pcCommandString) {
+  static size_t index = 0;
+
+  if (index < ECRF_FOOTPRINTS) {
+    const struct s_ecrf_footprint *footprint = &ecrf_footprints[index++];
+    snprintf(pcWriteBuffer, xWriteBufferLen, "%-8s %7u bytes\n", footprint->name,
+             (unsigned)footprint->size());
+    return pdTRUE;
+  }
+
+  if (index++ == ECRF_FOOTPRINTS) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "arena    %7u free, %u largest\n",
+             (unsigned)ecrf_arena_available(), (unsigned)ecrf_arena_largest());
+    return pdTRUE;
+  }
+
+  snprintf(pcWriteBuffer, xWriteBufferLen, "heap     %7u free, %u min, guard %s\n",
+           (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL),
+           (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+           ecrf_heap_guard_armed() ? "armed" : "off");
+  index = 0;
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("mem", "static footprint per subsystem and heap usage", ecrf_mem_cmd, 0);
+
+static BaseType_t ecrf_log_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                               const char *pcCommandString) {
+  static int core = 0;
+  struct s_ecrf_log_stats stats;
+
+  ecrf_log_stats(core, &stats);
+  snprintf(pcWriteBuffer, xWriteBufferLen, "core %d   %8lu logged, %lu dropped (level %d)\n", core,
+           (unsigned long)stats.logged, (unsigned long)stats.dropped, ECRF_LOG_LEVEL);
+
+  if (++core < portNUM_PROCESSORS)
+    return pdTRUE;
+
+  core = 0;
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("log", "deferred log records and drops per core", ecrf_log_cmd, 0);
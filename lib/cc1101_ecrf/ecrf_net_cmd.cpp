@@ -0,0 +1,408 @@
+#include <Arduino.h>
+#include <FreeRTOS_CLI.h>
+#include <FreeRTOS_Shell.h>
+#include <FreeRTOS_Shell_port.h>
+#include <Preferences.h>
+#include <WiFi.h>
+#include <ecrf_heap.h>
+#include <ecrf_netshell.h>
+#include <ecrf_stream.h>
+#include <ecrf_tasks.h>
+#include "cc1101_ecrf.h"
+#include "ecrf_plugin.h"
+
+#define ECRF_NET_NVS_NAMESPACE "ecrf_net"
+#define ECRF_NET_WIFI_TIMEOUT_MS 10000
+/* shell output waits this long at most for the next poll */
+#define ECRF_NET_SHELL_POLL_MS 20
+#define ECRF_NET_HOST_LEN 40
+
+/*
+ * WiFi station, the "net" sink streaming push sessions to a TCP or UDP
+ * receiver, and a shell on a TCP port. The WiFi driver and lwIP allocate
+ * as they go: the heap guard stays paused while WiFi is on.
+ */
+static bool ecrf_net_wifi_on = false;
+
+/* the sink task writes, the shell task opens and closes */
+static struct s_ecrf_stream ecrf_net_stream;
+static StaticSemaphore_t ecrf_net_stream_lock_buffer;
+static SemaphoreHandle_t ecrf_net_stream_lock = NULL;
+static char ecrf_net_stream_host[ECRF_NET_HOST_LEN];
+static uint16_t ecrf_net_stream_port;
+/* end of the last frame, the cursor jumps past what the sink lost */
+static uint32_t ecrf_net_stream_next;
+static bool ecrf_net_stream_started;
+
+/*
+ * The net shell task owns the sockets. The shell task (output, prompts)
+ * and the UART event task (echo) both feed the mirror, while the output
+ * ring takes a single producer: the lock serializes them.
+ */
+static struct s_ecrf_netshell ecrf_net_shell;
+static StaticSemaphore_t ecrf_net_shell_lock_buffer;
+static SemaphoreHandle_t ecrf_net_shell_lock = NULL;
+static TaskHandle_t ecrf_net_shell_task = NULL;
+static volatile uint16_t ecrf_net_shell_port = 0;
+static volatile int ecrf_net_shell_error = 0;
+
+size_t ecrf_net_footprint(void) {
+  return sizeof(ecrf_net_stream) + sizeof(ecrf_net_stream_lock_buffer) + sizeof(ecrf_net_shell) +
+         sizeof(ecrf_net_shell_lock_buffer);
+}
+
+static size_t ecrf_net_sink_write(void *ctx, const uint8_t *data, size_t len) {
+  const struct s_eCC1101_sink *sink = (const struct s_eCC1101_sink *)ctx;
+  uint32_t offset = sink->cursor.tail;
+
+  /* never waits: a command holding the stream gives it back shortly */
+  if ((ecrf_net_stream_lock == NULL) || (xSemaphoreTake(ecrf_net_stream_lock, 0) != pdTRUE))
+    return 0;
+
+  /* nothing to compare with on a new connection or a newly attached sink */
+  uint32_t lost = offset - ecrf_net_stream_next;
+  if (!ecrf_net_stream_started || (sink->delivered == 0))
+    lost = 0;
+  ecrf_net_stream.radio = (uint8_t)ecrf_sink_session();
+  size_t taken = ecrf_stream_write(&ecrf_net_stream, offset, lost, data, len);
+  /* the stream holds the loss now, a retry must not hand it over again */
+  ecrf_net_stream_next = offset + taken;
+  if (taken > 0)
+    ecrf_net_stream_started = true;
+  xSemaphoreGive(ecrf_net_stream_lock);
+
+  return taken;
+}
+
+static struct s_eCC1101_sink ecrf_net_sink = {
+    .name = "net",
+    .write = ecrf_net_sink_write,
+    .ctx = &ecrf_net_sink,
+};
+ECRF_SINK_REGISTER(ecrf_net_sink);
+
+static void ecrf_net_shell_line(void *ctx, const char *line) {
+  FreeRTOS_ShellSubmit(line);
+}
+
+static void ecrf_net_shell_mirror(const char *buffer, int length) {
+  xSemaphoreTake(ecrf_net_shell_lock, portMAX_DELAY);
+  ecrf_netshell_output(&ecrf_net_shell, buffer, length);
+  xSemaphoreGive(ecrf_net_shell_lock);
+}
+
+static void ecrf_net_shell_thread(void *param) {
+  uint16_t listening = 0;
+
+  for (;;) {
+    uint16_t port = ecrf_net_shell_port;
+    if (port != listening) {
+      FreeRTOS_ShellSetMirror(NULL);
+      ecrf_netshell_close(&ecrf_net_shell);
+      listening = 0;
+      if (port != 0) {
+        ecrf_net_shell_error = ecrf_netshell_listen(&ecrf_net_shell, port);
+        if (ecrf_net_shell_error == 0) {
+          listening = port;
+          FreeRTOS_ShellSetMirror(ecrf_net_shell_mirror);
+        } else {
+          ecrf_net_shell_port = 0;
+        }
+      }
+    }
+
+    if (listening == 0) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      continue;
+    }
+    ecrf_netshell_poll(&ecrf_net_shell, ECRF_NET_SHELL_POLL_MS, ecrf_net_shell_line, NULL);
+  }
+}
+
+static void ecrf_net_shell_set(uint16_t port) {
+  if ((ecrf_net_shell_task == NULL) && (port == 0))
+    return;
+  if (ecrf_net_shell_task == NULL) {
+    ecrf_netshell_init(&ecrf_net_shell);
+    ecrf_net_shell_lock = xSemaphoreCreateMutexStatic(&ecrf_net_shell_lock_buffer);
+    if (ecrf_task_create(ECRF_TASK_NET, ecrf_net_shell_thread, NULL, &ecrf_net_shell_task) != pdPASS)
+      return;
+  }
+
+  ecrf_net_shell_port = port;
+  xTaskNotifyGive(ecrf_net_shell_task);
+}
+
+static void ecrf_net_wifi_start(const char *ssid, const char *password) {
+  if (!ecrf_net_wifi_on) {
+    ecrf_heap_guard_pause();
+    ecrf_net_wifi_on = true;
+  }
+
+  WiFi.mode(WIFI_STA);
+  /* modem sleep costs throughput and latency, the board is powered anyway */
+  WiFi.setSleep(false);
+  WiFi.setAutoReconnect(true);
+  WiFi.begin(ssid, password);
+}
+
+static void ecrf_net_wifi_stop(void) {
+  if (!ecrf_net_wifi_on)
+    return;
+
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  ecrf_net_wifi_on = false;
+  ecrf_heap_guard_resume();
+}
+
+static void ecrf_net_save(const char *ssid, const char *password, int port) {
+  Preferences prefs;
+
+  ecrf_heap_guard_pause();
+  if (prefs.begin(ECRF_NET_NVS_NAMESPACE, false)) {
+    if (ssid != NULL) {
+      prefs.putString("ssid", ssid);
+      prefs.putString("pass", password);
+    }
+    if (port >= 0)
+      prefs.putUInt("shell", (uint32_t)port);
+    prefs.end();
+  }
+  ecrf_heap_guard_resume();
+}
+
+static void ecrf_net_forget(void) {
+  Preferences prefs;
+
+  ecrf_heap_guard_pause();
+  if (prefs.begin(ECRF_NET_NVS_NAMESPACE, false)) {
+    prefs.clear();
+    prefs.end();
+  }
+  ecrf_heap_guard_resume();
+}
+
+void ecrf_net_boot(void) {
+  Preferences prefs;
+  char ssid[33] = "";
+  char password[65] = "";
+  uint32_t port = 0;
+
+  ecrf_heap_guard_pause();
+  if (prefs.begin(ECRF_NET_NVS_NAMESPACE, true)) {
+    prefs.getString("ssid", ssid, sizeof(ssid));
+    prefs.getString("pass", password, sizeof(password));
+    port = prefs.getUInt("shell", 0);
+    prefs.end();
+  }
+  ecrf_heap_guard_resume();
+
+  /* joins in the background, the shell listens once the link is up */
+  if (ssid[0] == 0)
+    return;
+  ecrf_net_wifi_start(ssid, password);
+  if ((port != 0) && (port <= UINT16_MAX))
+    ecrf_net_shell_set((uint16_t)port);
+}
+
+/* a parameter copied NUL terminated, false when absent or too long */
+static bool ecrf_net_param(const char *pcCommandString, UBaseType_t index, char *dst, size_t size) {
+  BaseType_t len;
+  const char *param = FreeRTOS_CLIGetParameter(pcCommandString, index, &len);
+
+  if ((param == NULL) || ((size_t)len >= size))
+    return false;
+  memcpy(dst, param, len);
+  dst[len] = 0;
+  return true;
+}
+
+static BaseType_t ecrf_net_wifi_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                    const char *pcCommandString) {
+  char ssid[33];
+  char password[65] = "";
+
+  if (!ecrf_net_param(pcCommandString, 2, ssid, sizeof(ssid))) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Usage: net wifi <ssid> [password] | net wifi off\n");
+    return pdFALSE;
+  }
+
+  if (strcmp(ssid, "off") == 0) {
+    ecrf_net_shell_set(0);
+    xSemaphoreTake(ecrf_net_stream_lock, portMAX_DELAY);
+    ecrf_stream_close(&ecrf_net_stream);
+    xSemaphoreGive(ecrf_net_stream_lock);
+    ecrf_net_wifi_stop();
+    ecrf_net_forget();
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[Net] WiFi off, settings cleared\n");
+    return pdFALSE;
+  }
+
+  ecrf_net_param(pcCommandString, 3, password, sizeof(password));
+  ecrf_net_wifi_start(ssid, password);
+  uint8_t status = WiFi.waitForConnectResult(ECRF_NET_WIFI_TIMEOUT_MS);
+  if (status != WL_CONNECTED) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "[E] [Net] WiFi %s not joined (status %u), still trying\n", ssid, (unsigned)status);
+    return pdFALSE;
+  }
+
+  ecrf_net_save(ssid, password, -1);
+  IPAddress ip = WiFi.localIP();
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[Net] WiFi %s joined, %u.%u.%u.%u\n", ssid, ip[0],
+           ip[1], ip[2], ip[3]);
+  return pdFALSE;
+}
+
+/* lwIP is brought up with the station, there is no socket before */
+static bool ecrf_net_check_wifi(char *pcWriteBuffer, size_t xWriteBufferLen) {
+  if (!ecrf_net_wifi_on)
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [Net] WiFi is off, run net wifi first\n");
+  return ecrf_net_wifi_on;
+}
+
+static BaseType_t ecrf_net_stream_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                      const char *pcCommandString) {
+  char mode[4];
+  char host[ECRF_NET_HOST_LEN];
+  int port = 0;
+
+  if (!ecrf_net_param(pcCommandString, 2, mode, sizeof(mode)) ||
+      ((strcmp(mode, "off") != 0) &&
+       (((strcmp(mode, "tcp") != 0) && (strcmp(mode, "udp") != 0)) ||
+        !ecrf_net_param(pcCommandString, 3, host, sizeof(host)) ||
+        (FreeRTOS_CLIGetParameterAsInt(pcCommandString, 4, &port) != pdTRUE) || (port <= 0) ||
+        (port > UINT16_MAX)))) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Usage: net stream tcp|udp <host> <port> | off\n");
+    return pdFALSE;
+  }
+
+  if ((strcmp(mode, "off") != 0) && !ecrf_net_check_wifi(pcWriteBuffer, xWriteBufferLen))
+    return pdFALSE;
+
+  xSemaphoreTake(ecrf_net_stream_lock, portMAX_DELAY);
+  if (strcmp(mode, "off") == 0) {
+    ecrf_stream_close(&ecrf_net_stream);
+    xSemaphoreGive(ecrf_net_stream_lock);
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[Net] Stream closed\n");
+    return pdFALSE;
+  }
+
+  /* a TCP connect may take ECRF_STREAM_CONNECT_MS, the sink waits meanwhile */
+  int error = ecrf_stream_open(&ecrf_net_stream, host, (uint16_t)port, strcmp(mode, "udp") == 0,
+                               (uint8_t)ecrf_sink_session());
+  ecrf_net_stream_started = false;
+  strcpy(ecrf_net_stream_host, host);
+  ecrf_net_stream_port = (uint16_t)port;
+  xSemaphoreGive(ecrf_net_stream_lock);
+
+  if (error != 0) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [Net] Stream to %s:%d failed (errno %d)\n", host,
+             port, error);
+    return pdFALSE;
+  }
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[Net] Streaming to %s %s:%d, attach with sink add net\n",
+           mode, host, port);
+  return pdFALSE;
+}
+
+static BaseType_t ecrf_net_shell_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                     const char *pcCommandString) {
+  char mode[4];
+  int port = 0;
+
+  if (ecrf_net_param(pcCommandString, 2, mode, sizeof(mode)) && (strcmp(mode, "off") == 0)) {
+    ecrf_net_shell_set(0);
+    ecrf_net_save(NULL, NULL, 0);
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[Net] Shell closed\n");
+    return pdFALSE;
+  }
+
+  if ((FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &port) != pdTRUE) || (port <= 0) ||
+      (port > UINT16_MAX)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "Usage: net shell <port> | off\n");
+    return pdFALSE;
+  }
+  if (!ecrf_net_check_wifi(pcWriteBuffer, xWriteBufferLen))
+    return pdFALSE;
+
+  ecrf_net_shell_set((uint16_t)port);
+  ecrf_net_save(NULL, NULL, port);
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[Net] Shell on TCP port %d\n", port);
+  return pdFALSE;
+}
+
+static BaseType_t ecrf_net_status_line(char *pcWriteBuffer, size_t xWriteBufferLen) {
+  static int line = 0;
+
+  switch (line++) {
+  case 0:
+    if (!ecrf_net_wifi_on) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "wifi   off\n");
+    } else if (WiFi.status() != WL_CONNECTED) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "wifi   joining (status %u)\n",
+               (unsigned)WiFi.status());
+    } else {
+      IPAddress ip = WiFi.localIP();
+      snprintf(pcWriteBuffer, xWriteBufferLen, "wifi   %u.%u.%u.%u, %d dBm\n", ip[0], ip[1], ip[2],
+               ip[3], (int)WiFi.RSSI());
+    }
+    return pdTRUE;
+  case 1:
+    if (!ecrf_stream_is_open(&ecrf_net_stream)) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "stream closed (errno %d)\n", ecrf_net_stream.error);
+    } else {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "stream %s %s:%u, %lu frames, %lu bytes, %lu busy\n",
+               ecrf_net_stream.datagram ? "udp" : "tcp", ecrf_net_stream_host,
+               (unsigned)ecrf_net_stream_port, (unsigned long)ecrf_net_stream.frames,
+               (unsigned long)ecrf_net_stream.bytes, (unsigned long)ecrf_net_stream.busy);
+    }
+    return pdTRUE;
+  default:
+    if (ecrf_net_shell_port == 0) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "shell  off (errno %d)\n", ecrf_net_shell_error);
+    } else {
+      snprintf(pcWriteBuffer, xWriteBufferLen,
+               "shell  port %u, %s, %lu clients, %lu lost, %lu too long\n",
+               (unsigned)ecrf_net_shell_port,
+               ecrf_netshell_connected(&ecrf_net_shell) ? "connected" : "idle",
+               (unsigned long)ecrf_net_shell.clients, (unsigned long)ecrf_net_shell.output_lost,
+               (unsigned long)ecrf_net_shell.lines_too_long);
+    }
+    line = 0;
+    return pdFALSE;
+  }
+}
+
+static BaseType_t ecrf_net_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                               const char *pcCommandString) {
+  static bool listing = false;
+  BaseType_t actionLen;
+  const char *action = FreeRTOS_CLIGetParameter(pcCommandString, 1, &actionLen);
+
+  if (ecrf_net_stream_lock == NULL) {
+    ecrf_net_stream_lock = xSemaphoreCreateMutexStatic(&ecrf_net_stream_lock_buffer);
+    ecrf_stream_init(&ecrf_net_stream);
+  }
+
+  if (listing || (action == NULL)) {
+    listing = ecrf_net_status_line(pcWriteBuffer, xWriteBufferLen) == pdTRUE;
+    return listing ? pdTRUE : pdFALSE;
+  }
+
+  if (strncmp(action, "wifi", actionLen) == 0)
+    return ecrf_net_wifi_cmd(pcWriteBuffer, xWriteBufferLen, pcCommandString);
+  if (strncmp(action, "stream", actionLen) == 0)
+    return ecrf_net_stream_cmd(pcWriteBuffer, xWriteBufferLen, pcCommandString);
+  if (strncmp(action, "shell", actionLen) == 0)
+    return ecrf_net_shell_cmd(pcWriteBuffer, xWriteBufferLen, pcCommandString);
+
+  snprintf(pcWriteBuffer, xWriteBufferLen,
+           "Usage: net [wifi <ssid> [password] | wifi off | stream tcp|udp <host> <port> | "
+           "stream off | shell <port> | shell off]\n");
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("net",
+                            "net [wifi <ssid> [password]|off | stream tcp|udp <host> <port>|off | shell <port>|off]",
+                            ecrf_net_cmd, -1);
@@ -0,0 +1,73 @@
+#include <Arduino.h>
+#include <FreeRTOS_CLI.h>
+#include <FreeRTOS_Shell.h>
+#include <ecrf_log.h>
+#include "ecrf_plugin.h"
+
+static bool ecrf_plugin_name_is(const char *name, const char *str, size_t len) {
+  return (strlen(name) == len) && (strncmp(name, str, len) == 0);
+}
+
+struct s_eCC1101_sink *ecrf_plugin_sink_find(const char *name, size_t len,
+                                             const struct s_ecrf_decoder **decoder) {
+  *decoder = NULL;
+  for (size_t i = 0; i < ecrf_sink_count(); i++) {
+    if (ecrf_plugin_name_is(ecrf_sink_at(i)->name, name, len))
+      return ecrf_sink_at(i);
+  }
+
+  for (size_t i = 0; i < ecrf_decoder_count(); i++) {
+    if (ecrf_plugin_name_is(ecrf_decoder_at(i)->sink->name, name, len)) {
+      *decoder = ecrf_decoder_at(i);
+      return (*decoder)->sink;
+    }
+  }
+
+  return NULL;
+}
+
+void ecrf_plugin_boot(void) {
+  ECRF_LOGI("[Plugins] %u decoders, %u sinks, %u profiles", (unsigned)ecrf_decoder_count(),
+            (unsigned)ecrf_sink_count(), (unsigned)ecrf_profile_count());
+}
+
+/* one registered plugin per line, decoders with their report */
+static BaseType_t ecrf_plugin_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                  const char *pcCommandString) {
+  static size_t index = 0;
+  size_t decoders = ecrf_decoder_count();
+  size_t sinks = ecrf_sink_count();
+  size_t profiles = ecrf_profile_count();
+
+  if (index == 0) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "TYPE     NAME            REPORT\n");
+    index = 1;
+    return pdTRUE;
+  }
+
+  size_t i = index++ - 1;
+  if (i < decoders) {
+    const struct s_ecrf_decoder *decoder = ecrf_decoder_at(i);
+    size_t len = snprintf(pcWriteBuffer, xWriteBufferLen, "decoder  %-15s ", decoder->sink->name);
+    decoder->report(pcWriteBuffer + len, xWriteBufferLen - len);
+    return pdTRUE;
+  }
+  i -= decoders;
+
+  if (i < sinks) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "sink     %s\n", ecrf_sink_at(i)->name);
+    return pdTRUE;
+  }
+  i -= sinks;
+
+  if (i < profiles) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "profile  %s\n", ecrf_profile_at(i)->name);
+    return pdTRUE;
+  }
+
+  *pcWriteBuffer = 0;
+  index = 0;
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("plugins", "registered decoders, sinks and built-in profiles",
+                            ecrf_plugin_cmd, 0);
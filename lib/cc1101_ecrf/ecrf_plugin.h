@@ -0,0 +1,87 @@
+#ifndef _ECRF_PLUGIN_H
+#define _ECRF_PLUGIN_H
+
+#include <eCC1101.h>
+
+/*
+ * Plugin registries, filled by the linker the way the shell commands are:
+ * each registration puts a const pointer in the section of its type, and
+ * etc/ld/sections.ld.patch brackets the section with start/end symbols.
+ * Adding a decoder, sink or built-in profile is adding a file: nothing
+ * runs to register it and nothing is allocated. Order between files is
+ * the link order.
+ */
+
+/*
+ * Protocol decoder: a push session consumer the sink command attaches like
+ * any sink. reset() runs before it is attached, report() sums up what it
+ * decoded in one line, from the shell task while the sink task feeds it.
+ */
+struct s_ecrf_decoder {
+  struct s_eCC1101_sink *sink;
+  void (*reset)(void);
+  size_t (*report)(char *buf, size_t len);
+};
+
+#define ECRF_PLUGIN_REGISTER(type, sectionName, entry, target)                 \
+  static type *const ecrf_plugin_##entry                                       \
+      __attribute__((section(sectionName))) __attribute__((used)) = &target
+
+/* sink: a struct s_eCC1101_sink */
+#define ECRF_SINK_REGISTER(sink)                                               \
+  ECRF_PLUGIN_REGISTER(struct s_eCC1101_sink, ".ECRF_SINK_SECTION",            \
+                       sink_##sink, sink)
+
+/* decoder: a struct s_ecrf_decoder, named after its sink */
+#define ECRF_DECODER_REGISTER(decoder)                                         \
+  ECRF_PLUGIN_REGISTER(const struct s_ecrf_decoder, ".ECRF_DECODER_SECTION",   \
+                       decoder_##decoder, decoder)
+
+/* built-in profile, image computed by the compiler, named after id */
+#define ECRF_PROFILE_REGISTER(id, freq, br, freqDev, rxBw, modulation)         \
+  static constexpr struct s_cc1101_rf_profile ecrf_profile_##id =              \
+      ecc1101_profile_make(#id, freq, br, freqDev, rxBw, modulation);          \
+  ECRF_PLUGIN_REGISTER(const struct s_cc1101_rf_profile,                       \
+                       ".ECRF_PROFILE_SECTION", profile_##id,                  \
+                       ecrf_profile_##id)
+
+extern "C" {
+extern struct s_eCC1101_sink *const __ecrf_sink_start[];
+extern struct s_eCC1101_sink *const __ecrf_sink_end[];
+extern const struct s_ecrf_decoder *const __ecrf_decoder_start[];
+extern const struct s_ecrf_decoder *const __ecrf_decoder_end[];
+extern const struct s_cc1101_rf_profile *const __ecrf_profile_start[];
+extern const struct s_cc1101_rf_profile *const __ecrf_profile_end[];
+}
+
+static inline size_t ecrf_sink_count(void) {
+  return __ecrf_sink_end - __ecrf_sink_start;
+}
+
+static inline struct s_eCC1101_sink *ecrf_sink_at(size_t index) {
+  return __ecrf_sink_start[index];
+}
+
+static inline size_t ecrf_decoder_count(void) {
+  return __ecrf_decoder_end - __ecrf_decoder_start;
+}
+
+static inline const struct s_ecrf_decoder *ecrf_decoder_at(size_t index) {
+  return __ecrf_decoder_start[index];
+}
+
+static inline size_t ecrf_profile_count(void) {
+  return __ecrf_profile_end - __ecrf_profile_start;
+}
+
+static inline const struct s_cc1101_rf_profile *ecrf_profile_at(size_t index) {
+  return __ecrf_profile_start[index];
+}
+
+/* a sink or a decoder's sink by name, decoder set for a decoder */
+struct s_eCC1101_sink *ecrf_plugin_sink_find(const char *name, size_t len,
+                                             const struct s_ecrf_decoder **decoder);
+/* logs what the registries hold, once at boot */
+void ecrf_plugin_boot(void);
+
+#endif /* _ECRF_PLUGIN_H */
@@ -0,0 +1,250 @@
+#include <Arduino.h>
+#include <FreeRTOS_CLI.h>
+#include <FreeRTOS_Shell.h>
+#include <Preferences.h>
+#include <eCC1101.h>
+#include <ecrf_heap.h>
+#include "cc1101_ecrf.h"
+#include "ecrf_plugin.h"
+
+#define ECRF_PROFILE_NVS_NAMESPACE "ecrf_prof"
+#define ECRF_PROFILE_NVS_SLOTS 8
+
+/* Built-in images, computed by the compiler; other files can register more */
+ECRF_PROFILE_REGISTER(ook433, 433.92, 10.0, 0.0, 250.0, RADIOLIB_CC1101_MOD_FORMAT_ASK_OOK);
+ECRF_PROFILE_REGISTER(ook315, 315.00, 10.0, 0.0, 250.0, RADIOLIB_CC1101_MOD_FORMAT_ASK_OOK);
+ECRF_PROFILE_REGISTER(ook868, 868.35, 10.0, 0.0, 250.0, RADIOLIB_CC1101_MOD_FORMAT_ASK_OOK);
+ECRF_PROFILE_REGISTER(fsk433, 433.92, 4.8, 25.4, 101.0, RADIOLIB_CC1101_MOD_FORMAT_2_FSK);
+ECRF_PROFILE_REGISTER(fsk868, 868.35, 38.4, 20.0, 101.0, RADIOLIB_CC1101_MOD_FORMAT_2_FSK);
+
+static void ecrf_profile_key(char *key, size_t len, int slot) {
+  snprintf(key, len, "p%d", slot);
+}
+
+static bool ecrf_profile_load(Preferences &prefs, int slot, struct s_cc1101_rf_profile *profile) {
+  char key[8];
+  ecrf_profile_key(key, sizeof(key), slot);
+  if (prefs.getBytesLength(key) != sizeof(*profile))
+    return false;
+
+  return prefs.getBytes(key, profile, sizeof(*profile)) == sizeof(*profile);
+}
+
+static const struct s_cc1101_rf_profile *ecrf_profile_builtin(const char *name) {
+  for (size_t i = 0; i < ecrf_profile_count(); i++) {
+    if (strncmp(ecrf_profile_at(i)->name, name, ECC1101_PROFILE_NAME_LEN) == 0)
+      return ecrf_profile_at(i);
+  }
+
+  return NULL;
+}
+
+bool ecrf_profile_is_builtin(const char *name) {
+  return ecrf_profile_builtin(name) != NULL;
+}
+
+const struct s_cc1101_rf_profile *ecrf_profile_find(const char *name,
+                                                    struct s_cc1101_rf_profile *storage) {
+  const struct s_cc1101_rf_profile *builtin = ecrf_profile_builtin(name);
+  if (builtin != NULL)
+    return builtin;
+
+  Preferences prefs;
+  const struct s_cc1101_rf_profile *found = NULL;
+  /* the NVS handle is heap allocated by the IDF and released by end() */
+  ecrf_heap_guard_pause();
+  if (prefs.begin(ECRF_PROFILE_NVS_NAMESPACE, true)) {
+    for (int slot = 0; slot < ECRF_PROFILE_NVS_SLOTS; slot++) {
+      if (ecrf_profile_load(prefs, slot, storage) &&
+          (strncmp(storage->name, name, ECC1101_PROFILE_NAME_LEN) == 0)) {
+        found = storage;
+        break;
+      }
+    }
+    prefs.end();
+  }
+  ecrf_heap_guard_resume();
+
+  return found;
+}
+
+int ecrf_profile_save(const struct s_cc1101_rf_profile *profile) {
+  Preferences prefs;
+  struct s_cc1101_rf_profile stored;
+  int freeSlot = -1;
+  int slot;
+
+  ecrf_heap_guard_pause();
+  if (!prefs.begin(ECRF_PROFILE_NVS_NAMESPACE, false)) {
+    ecrf_heap_guard_resume();
+    return -1;
+  }
+
+  /* overwrite a profile of the same name, else take the first free slot */
+  for (slot = 0; slot < ECRF_PROFILE_NVS_SLOTS; slot++) {
+    if (!ecrf_profile_load(prefs, slot, &stored)) {
+      if (freeSlot < 0)
+        freeSlot = slot;
+    } else if (strncmp(stored.name, profile->name, ECC1101_PROFILE_NAME_LEN) == 0) {
+      break;
+    }
+  }
+  if (slot == ECRF_PROFILE_NVS_SLOTS)
+    slot = freeSlot;
+
+  if (slot >= 0) {
+    char key[8];
+    ecrf_profile_key(key, sizeof(key), slot);
+    if (prefs.putBytes(key, profile, sizeof(*profile)) != sizeof(*profile))
+      slot = -1;
+  }
+  prefs.end();
+  ecrf_heap_guard_resume();
+
+  return slot;
+}
+
+static const char *ecrf_profile_modulation(const struct s_cc1101_rf_profile *profile) {
+  switch (profile->regs[ECC1101_PROFILE_MDMCFG2] & 0x70) {
+    case RADIOLIB_CC1101_MOD_FORMAT_2_FSK:
+      return "2-FSK";
+    case RADIOLIB_CC1101_MOD_FORMAT_GFSK:
+      return "GFSK";
+    case RADIOLIB_CC1101_MOD_FORMAT_ASK_OOK:
+      return "OOK";
+    case RADIOLIB_CC1101_MOD_FORMAT_4_FSK:
+      return "4-FSK";
+    case RADIOLIB_CC1101_MOD_FORMAT_MFSK:
+      return "MSK";
+    default:
+      return "?";
+  }
+}
+
+static size_t ecrf_profile_describe(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                    const struct s_cc1101_rf_profile *profile, const char *origin) {
+  return snprintf(pcWriteBuffer, xWriteBufferLen, "%-15s %7lu kHz %7lu bps %-5s %s\n",
+                  profile->name,
+                  (unsigned long)ecc1101_profile_freq_khz(profile),
+                  (unsigned long)ecc1101_profile_bitrate(profile),
+                  ecrf_profile_modulation(profile), origin);
+}
+
+static BaseType_t cc1101_profile_list(char *pcWriteBuffer, size_t xWriteBufferLen) {
+  static int index = 0;
+  struct s_cc1101_rf_profile stored;
+  int builtins = (int)ecrf_profile_count();
+
+  *pcWriteBuffer = 0;
+  while (index < builtins + ECRF_PROFILE_NVS_SLOTS) {
+    int i = index++;
+    if (i < builtins) {
+      ecrf_profile_describe(pcWriteBuffer, xWriteBufferLen, ecrf_profile_at(i), "built-in");
+      return pdTRUE;
+    }
+
+    Preferences prefs;
+    ecrf_heap_guard_pause();
+    bool loaded = prefs.begin(ECRF_PROFILE_NVS_NAMESPACE, true) &&
+                  ecrf_profile_load(prefs, i - builtins, &stored);
+    prefs.end();
+    ecrf_heap_guard_resume();
+    if (loaded) {
+      ecrf_profile_describe(pcWriteBuffer, xWriteBufferLen, &stored, "nvs");
+      return pdTRUE;
+    }
+  }
+
+  index = 0;
+  return pdFALSE;
+}
+
+static bool ecrf_param_copy(char *dst, size_t len, const char *pcCommandString, UBaseType_t index) {
+  BaseType_t paramLen;
+  const char *param = FreeRTOS_CLIGetParameter(pcCommandString, index, &paramLen);
+  if (param == NULL)
+    return false;
+
+  size_t n = ((size_t)paramLen < len - 1) ? (size_t)paramLen : len - 1;
+  memcpy(dst, param, n);
+  dst[n] = 0;
+  return true;
+}
+
+static BaseType_t cc1101_profile_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                     const char *pcCommandString) {
+  static bool listing = false;
+  char action[8] = {0};
+  char name[ECC1101_PROFILE_NAME_LEN] = {0};
+  int id = 0;
+
+  if (listing) {
+    listing = cc1101_profile_list(pcWriteBuffer, xWriteBufferLen) == pdTRUE;
+    return listing ? pdTRUE : pdFALSE;
+  }
+
+  ecrf_param_copy(action, sizeof(action), pcCommandString, 1);
+
+  if (strcmp(action, "list") == 0) {
+    listing = cc1101_profile_list(pcWriteBuffer, xWriteBufferLen) == pdTRUE;
+    return listing ? pdTRUE : pdFALSE;
+  }
+
+  if (!ecrf_param_copy(name, sizeof(name), pcCommandString, 3) ||
+      ((strcmp(action, "apply") != 0) && (strcmp(action, "save") != 0))) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "Usage: profile list | profile apply <radio id> <name> | profile save <radio id> <name>\n");
+    return pdFALSE;
+  }
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &id);
+
+  if (strcmp(action, "apply") == 0) {
+    struct s_cc1101_rf_profile stored;
+    const struct s_cc1101_rf_profile *profile = ecrf_profile_find(name, &stored);
+    if (profile == NULL) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Unknown profile %s\n", name);
+      return pdFALSE;
+    }
+
+    eCC1101 *cc1101 = cc1101_init(id);
+    if (cc1101 == NULL)
+      return pdFALSE;
+
+    unsigned long start = micros();
+    int16_t state = cc1101->applyProfile(profile);
+    unsigned long elapsed = micros() - start;
+    cc1101_release(cc1101);
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Profile %s applied to module %d in %lu us (%d)\n",
+             name, id, elapsed, state);
+  } else {
+    struct s_cc1101_rf_profile profile = {};
+    if (ecrf_profile_builtin(name) != NULL) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] %s is a built-in profile\n", name);
+      return pdFALSE;
+    }
+
+    /* only a module kept alive by init has a configuration worth saving */
+    eCC1101 *cc1101 = cc1101_get(id);
+    if (cc1101 == NULL) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Module %d is not initialized\n", id);
+      return pdFALSE;
+    }
+
+    /* snapshot the live configuration, not a stale shadow */
+    cc1101->shadowLoad();
+    cc1101->getProfile(&profile);
+    strncpy(profile.name, name, sizeof(profile.name) - 1);
+
+    int slot = ecrf_profile_save(&profile);
+    if (slot < 0) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] No NVS slot left for %s\n", name);
+    } else {
+      size_t len = snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Saved to slot %d: ", slot);
+      ecrf_profile_describe(pcWriteBuffer + len, xWriteBufferLen - len, &profile, "nvs");
+    }
+  }
+
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("profile", "profile list | apply <radio id> <name> | save <radio id> <name>",
+                            cc1101_profile_cmd, -1);
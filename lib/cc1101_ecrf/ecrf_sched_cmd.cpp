@@ -0,0 +1,549 @@
+#include <Arduino.h>
+#include <FreeRTOS_CLI.h>
+#include <FreeRTOS_Shell.h>
+#include <eCC1101.h>
+#include <ecrf_arena.h>
+#include <ecrf_sched.h>
+#include <ecrf_survey.h>
+#include <ecrf_tasks.h>
+#include "cc1101_ecrf.h"
+
+#ifndef ECRF_SCHED_RADIOS
+#define ECRF_SCHED_RADIOS 2
+#endif
+
+/* RSSI settling after a sweep retune, at the 650 kHz sweep filter */
+#define ECRF_SCHED_RSSI_US 500
+/* cached calibrations are redone this often, they drift with temperature */
+#define ECRF_SCHED_RECAL_MS 60000
+#define ECRF_SCHED_SWEEP_THRESHOLD -75
+#define ECRF_SCHED_SWEEP_BW_KHZ 650
+
+#define MIN(x, y) (x < y ? x : y)
+
+/*
+ * Time slicing of a radio: one raw session stays open while a scheduler
+ * task retunes it from slot to slot, each slot serving a logical session
+ * (a listen window on a profile, or a part of a sweep of the scan table).
+ * Retunes reuse the calibration cached per configuration, see
+ * s_cc1101_fscal. Data received is accounted to the slot it was received
+ * in, by stream offset; nothing is printed until asked.
+ */
+enum ecrf_sched_kind {
+  ECRF_SCHED_LISTEN,
+  ECRF_SCHED_SWEEP,
+};
+
+struct s_ecrf_sched_entry {
+  enum ecrf_sched_kind kind;
+  struct s_cc1101_rf_profile profile;
+  struct s_cc1101_fscal cal;
+  /* listen windows: what they received */
+  uint32_t bytes;
+  uint32_t gaps;
+  uint32_t bursts;
+  int16_t rssi_max;
+  uint32_t last_burst_ms;
+};
+
+struct s_ecrf_sched_radio {
+  eCC1101 *cc1101;
+  struct s_ecrf_sched plan;
+  struct s_ecrf_sched_entry entry[ECRF_SCHED_MAX_SESSIONS];
+  int sweep; /* entry of the sweep, -1 without */
+  /* the sweep goes on where its previous slot stopped */
+  size_t channel;
+  int16_t channel_rssi[ECRF_SURVEY_MAX_CHANNELS];
+  struct s_cc1101_fscal channel_cal[ECRF_SURVEY_MAX_CHANNELS];
+  struct s_ecrf_survey survey;
+  /* entry the data being read was received for, -1 before the first slot */
+  int owner;
+  uint32_t retune_errors;
+  uint32_t recal_ms;
+  volatile bool running;
+  TaskHandle_t task;
+  TaskHandle_t waiter;
+  /* the shell reads what the scheduler task accounts */
+  StaticSemaphore_t lock_buffer;
+  SemaphoreHandle_t lock;
+  StackType_t stack[ECRF_TASK_STACK_WORDS(ECRF_TASK_SCHED_STACK)];
+  StaticTask_t tcb;
+};
+
+static struct s_ecrf_sched_radio ecrf_scheds[ECRF_SCHED_RADIOS];
+
+size_t ecrf_sched_footprint(void) {
+  return sizeof(ecrf_scheds);
+}
+
+static uint32_t ecrf_sched_now_ms(void) {
+  return pdTICKS_TO_MS(xTaskGetTickCount());
+}
+
+static struct s_ecrf_sched_radio *ecrf_sched_get(int id) {
+  if ((id < 0) || (id >= ECRF_SCHED_RADIOS) || (id >= ecrf_radio_count()))
+    return NULL;
+
+  struct s_ecrf_sched_radio *radio = &ecrf_scheds[id];
+  if (radio->lock == NULL) {
+    radio->lock = xSemaphoreCreateMutexStatic(&radio->lock_buffer);
+    radio->sweep = -1;
+  }
+  return radio;
+}
+
+/* one read on behalf of the owner, stopping at end when bounded */
+static size_t ecrf_sched_read(struct s_ecrf_sched_radio *radio, bool bounded, uint32_t end,
+                              TickType_t wait) {
+  uint8_t chunk[64];
+  struct s_eCC1101_gap gap;
+  struct s_eCC1101_burst burst;
+  eCC1101 *cc1101 = radio->cc1101;
+  size_t len = sizeof(chunk);
+
+  if (bounded) {
+    int32_t left = (int32_t)(end - cc1101->rawOffset());
+    if (left <= 0)
+      return 0;
+    len = MIN(len, (size_t)left);
+  }
+
+  int16_t received = cc1101->rawReceive(chunk, len, wait, &gap);
+  uint32_t offset = cc1101->rawOffset();
+  struct s_ecrf_sched_entry *entry = (radio->owner >= 0) ? &radio->entry[radio->owner] : NULL;
+  if ((entry != NULL) && (entry->kind != ECRF_SCHED_LISTEN))
+    entry = NULL;
+
+  xSemaphoreTake(radio->lock, portMAX_DELAY);
+  if (entry != NULL) {
+    entry->bytes += (received > 0) ? received : 0;
+    entry->gaps += (gap.lost != 0) ? 1 : 0;
+  }
+  /* bursts that opened in what was just read */
+  while (cc1101->rawBurst(&burst, false) && ((int32_t)(burst.offset - offset) < 0)) {
+    cc1101->rawBurst(&burst);
+    if (entry == NULL)
+      continue;
+    if ((entry->bursts == 0) || (burst.rssi > entry->rssi_max))
+      entry->rssi_max = burst.rssi;
+    entry->bursts++;
+    entry->last_burst_ms = ecrf_sched_now_ms();
+  }
+  xSemaphoreGive(radio->lock);
+
+  return (received > 0) ? received : 0;
+}
+
+/*
+ * Retune for entry index: what was received before the retune goes to the
+ * previous owner, the rest to the new one. False when the radio did not
+ * follow, the slot then hears nothing.
+ */
+static bool ecrf_sched_retune(struct s_ecrf_sched_radio *radio, size_t index,
+                              struct s_eCC1101_retune *retune) {
+  eCC1101 *cc1101 = radio->cc1101;
+
+  retune->offset = cc1101->rawOffset() + cc1101->rawAvailable();
+  int16_t state = cc1101->retuneRawReceive(retune);
+  while (ecrf_sched_read(radio, true, retune->offset, 0) > 0) {
+  }
+  radio->owner = index;
+
+  if (state != RADIOLIB_ERR_NONE) {
+    xSemaphoreTake(radio->lock, portMAX_DELAY);
+    radio->retune_errors++;
+    xSemaphoreGive(radio->lock);
+  }
+  return state == RADIOLIB_ERR_NONE;
+}
+
+static void ecrf_sched_listen(struct s_ecrf_sched_radio *radio, size_t index, int64_t begin) {
+  struct s_ecrf_sched_entry *entry = &radio->entry[index];
+  struct s_eCC1101_retune retune = {};
+
+  retune.profile = &entry->profile;
+  retune.cal = &entry->cal;
+  ecrf_sched_retune(radio, index, &retune);
+
+  int64_t tuned = esp_timer_get_time();
+  int64_t end = tuned + radio->plan.session[index].slot_us;
+  while (radio->running) {
+    /* a late wake up leaves nothing, not a negative wait */
+    int64_t left = end - esp_timer_get_time();
+    if (left <= 0)
+      break;
+    TickType_t wait = pdMS_TO_TICKS(left / 1000);
+    if (wait == 0)
+      break;
+    ecrf_sched_read(radio, false, 0, wait);
+  }
+
+  xSemaphoreTake(radio->lock, portMAX_DELAY);
+  ecrf_sched_account(&radio->plan, index, begin, tuned, esp_timer_get_time());
+  xSemaphoreGive(radio->lock);
+}
+
+/* as many channels as the slot holds, one RSSI reading each */
+static void ecrf_sched_sweep(struct s_ecrf_sched_radio *radio, size_t index, int64_t begin) {
+  struct s_cc1101_rf_profile channel = radio->entry[index].profile;
+  size_t count = MIN(eCC1101::scanChannelCount(), (size_t)ECRF_SURVEY_MAX_CHANNELS);
+  int64_t tuned = 0;
+  int64_t now;
+
+  do {
+    size_t c = radio->channel;
+    double mhz = eCC1101::scanChannelFrequency(c) / 1000000.0;
+    struct s_eCC1101_retune retune = {};
+
+    radio->channel_rssi[c] = ECC1101_RSSI_NONE;
+    if (ECC1101_FREQ_IN_BAND(mhz)) {
+      uint32_t frf = ecc1101_freq_word(mhz);
+      channel.regs[ECC1101_PROFILE_FREQ2] = (frf >> 16) & 0xFF;
+      channel.regs[ECC1101_PROFILE_FREQ1] = (frf >> 8) & 0xFF;
+      channel.regs[ECC1101_PROFILE_FREQ0] = frf & 0xFF;
+      retune.profile = &channel;
+      retune.cal = &radio->channel_cal[c];
+      retune.rssi_us = ECRF_SCHED_RSSI_US;
+      if (ecrf_sched_retune(radio, index, &retune))
+        radio->channel_rssi[c] = retune.rssi;
+    }
+    /* the RSSI dwell of the first channel is sweep time already */
+    if (tuned == 0)
+      tuned = esp_timer_get_time() - retune.rssi_us;
+    /* a sweep receives noise, keep the session buffer empty */
+    while (ecrf_sched_read(radio, false, 0, 0) > 0) {
+    }
+
+    if (++radio->channel == count) {
+      radio->channel = 0;
+      xSemaphoreTake(radio->lock, portMAX_DELAY);
+      ecrf_survey_add(&radio->survey, radio->channel_rssi, ecrf_sched_now_ms());
+      xSemaphoreGive(radio->lock);
+    }
+    now = esp_timer_get_time();
+  } while (radio->running && ((now - tuned) < radio->plan.session[index].slot_us));
+
+  xSemaphoreTake(radio->lock, portMAX_DELAY);
+  ecrf_sched_account(&radio->plan, index, begin, tuned, now);
+  xSemaphoreGive(radio->lock);
+}
+
+static void ecrf_sched_recalibrate(struct s_ecrf_sched_radio *radio) {
+  uint32_t now = ecrf_sched_now_ms();
+
+  if ((now - radio->recal_ms) < ECRF_SCHED_RECAL_MS)
+    return;
+
+  radio->recal_ms = now;
+  for (size_t i = 0; i < radio->plan.count; i++)
+    radio->entry[i].cal.valid = false;
+  for (size_t c = 0; c < ECRF_SURVEY_MAX_CHANNELS; c++)
+    radio->channel_cal[c].valid = false;
+}
+
+static void ecrf_sched_thread(void *param) {
+  struct s_ecrf_sched_radio *radio = (struct s_ecrf_sched_radio *)param;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    while (radio->running) {
+      ecrf_sched_recalibrate(radio);
+      int64_t begin = esp_timer_get_time();
+      size_t index = ecrf_sched_next(&radio->plan);
+      if (radio->entry[index].kind == ECRF_SCHED_SWEEP)
+        ecrf_sched_sweep(radio, index, begin);
+      else
+        ecrf_sched_listen(radio, index, begin);
+    }
+    /* the end of the last slot */
+    while (ecrf_sched_read(radio, false, 0, 0) > 0) {
+    }
+
+    xTaskNotifyGive(radio->waiter);
+  }
+}
+
+static BaseType_t ecrf_sched_add_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                     struct s_ecrf_sched_radio *radio, enum ecrf_sched_kind kind,
+                                     const char *name, int slot_ms) {
+  struct s_cc1101_rf_profile stored;
+
+  if (radio->running) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Stop the scheduler first\n");
+    return pdFALSE;
+  }
+  if ((kind == ECRF_SCHED_SWEEP) && (radio->sweep >= 0)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] One sweep per radio, slot %d\n",
+             radio->sweep);
+    return pdFALSE;
+  }
+  if ((kind == ECRF_SCHED_SWEEP) && (eCC1101::scanChannelCount() > ECRF_SURVEY_MAX_CHANNELS)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "[E] [CC1101] Scan table has %u channels, sweeps hold %u\n",
+             (unsigned)eCC1101::scanChannelCount(), (unsigned)ECRF_SURVEY_MAX_CHANNELS);
+    return pdFALSE;
+  }
+
+  const struct s_cc1101_rf_profile *profile = ecrf_profile_find(name, &stored);
+  if (profile == NULL) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Unknown profile %s\n", name);
+    return pdFALSE;
+  }
+
+  int index = (slot_ms > 0) ? ecrf_sched_add(&radio->plan, (uint32_t)slot_ms * 1000) : -1;
+  if (index < 0) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "[E] [CC1101] Wrong slot length or %u slots already\n", (unsigned)ECRF_SCHED_MAX_SESSIONS);
+    return pdFALSE;
+  }
+
+  struct s_ecrf_sched_entry *entry = &radio->entry[index];
+  memset(entry, 0, sizeof(*entry));
+  entry->kind = kind;
+  entry->profile = *profile;
+  if (kind == ECRF_SCHED_SWEEP) {
+    radio->sweep = index;
+    /* the default profile only gives the modulation, sweeps want a wide filter */
+    if (strcmp(name, ECRF_PROFILE_DEFAULT) == 0)
+      entry->profile.regs[ECC1101_PROFILE_MDMCFG4] =
+          (entry->profile.regs[ECC1101_PROFILE_MDMCFG4] & 0x0F) | ecc1101_chanbw(ECRF_SCHED_SWEEP_BW_KHZ);
+  }
+
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Slot %d: %s %s for %d ms, cycle %lu ms\n",
+           index, (kind == ECRF_SCHED_SWEEP) ? "sweep" : "listen", entry->profile.name, slot_ms,
+           (unsigned long)(ecrf_sched_cycle_us(&radio->plan) / 1000));
+  return pdFALSE;
+}
+
+static BaseType_t ecrf_sched_start_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                       struct s_ecrf_sched_radio *radio, int id) {
+  if (radio->running) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Scheduler already running on module %d\n", id);
+    return pdFALSE;
+  }
+  if (radio->plan.count == 0) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Nothing scheduled on module %d\n", id);
+    return pdFALSE;
+  }
+
+  if (radio->task == NULL) {
+    radio->task = ecrf_task_create_static(ECRF_TASK_SCHED, ecrf_sched_thread, radio, radio->stack,
+                                          &radio->tcb);
+    if (radio->task == NULL) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Scheduler task creation failed\n");
+      return pdFALSE;
+    }
+  }
+
+  radio->cc1101 = cc1101_init(id);
+  if (radio->cc1101 == NULL)
+    return pdFALSE;
+  /* the task reads the session until stop, nothing else may reopen it */
+  ecrf_radio_claim(id, "sched");
+
+  ecrf_radio_session_setup(radio->cc1101, id);
+  if (radio->cc1101->startRawReceive(&radio->entry[0].profile) != RADIOLIB_ERR_NONE) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] No room for a session (arena largest %u)\n",
+             (unsigned)ecrf_arena_largest());
+    ecrf_radio_unclaim(id);
+    cc1101_release(radio->cc1101);
+    radio->cc1101 = NULL;
+    return pdFALSE;
+  }
+
+  xSemaphoreTake(radio->lock, portMAX_DELAY);
+  ecrf_sched_start(&radio->plan, esp_timer_get_time());
+  for (size_t i = 0; i < radio->plan.count; i++) {
+    struct s_ecrf_sched_entry *entry = &radio->entry[i];
+    entry->bytes = 0;
+    entry->gaps = 0;
+    entry->bursts = 0;
+    entry->cal.valid = false;
+  }
+  for (size_t c = 0; c < ECRF_SURVEY_MAX_CHANNELS; c++)
+    radio->channel_cal[c].valid = false;
+  ecrf_survey_reset(&radio->survey, eCC1101::scanChannelCount(), ECRF_SCHED_SWEEP_THRESHOLD,
+                    ecrf_sched_now_ms());
+  radio->channel = 0;
+  radio->owner = -1;
+  radio->retune_errors = 0;
+  radio->recal_ms = ecrf_sched_now_ms();
+  xSemaphoreGive(radio->lock);
+
+  radio->running = true;
+  xTaskNotifyGive(radio->task);
+
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Scheduling %u slots on module %d, cycle %lu ms\n",
+           (unsigned)radio->plan.count, id, (unsigned long)(ecrf_sched_cycle_us(&radio->plan) / 1000));
+  return pdFALSE;
+}
+
+static void ecrf_sched_stop(struct s_ecrf_sched_radio *radio, int id) {
+  /* the task finishes its slot before the session goes away */
+  radio->waiter = xTaskGetCurrentTaskHandle();
+  radio->running = false;
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+  radio->cc1101->stopRawReceive();
+  radio->cc1101->closeRawSession();
+  cc1101_release(radio->cc1101);
+  radio->cc1101 = NULL;
+  ecrf_radio_unclaim(id);
+}
+
+/* percent with one decimal from permille */
+#define ECRF_SCHED_PCT(permille) (unsigned)((permille) / 10), (unsigned)((permille) % 10)
+
+static BaseType_t ecrf_sched_stats_line(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                        struct s_ecrf_sched_radio *radio, int id) {
+  static size_t line = 0;
+  /* a header, then two lines per slot */
+  size_t index = (line >= 2) ? (line - 2) / 2 : 0;
+  int64_t now = esp_timer_get_time();
+
+  xSemaphoreTake(radio->lock, portMAX_DELAY);
+  if (line == 0) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "module %d: %s, cycle %lu ms, %lu retune errors\n", id,
+             radio->running ? "running" : "stopped",
+             (unsigned long)(ecrf_sched_cycle_us(&radio->plan) / 1000),
+             (unsigned long)radio->retune_errors);
+  } else if (line == 1) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "#  KIND   PROFILE           SLOT   PLAN   DUTY  REVISIT  MAX   SWITCH  MAX\n");
+  } else if ((line % 2) == 0) {
+    const struct s_ecrf_sched_entry *entry = &radio->entry[index];
+    const struct s_ecrf_sched_session *session = &radio->plan.session[index];
+    uint16_t planned = ecrf_sched_planned_permille(&radio->plan, index);
+    uint16_t duty = ecrf_sched_duty_permille(&radio->plan, index, now);
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "%u  %-6s %-15s %4lu ms %2u.%u%% %2u.%u%% %4lu ms %4lu %5lu us %5lu\n", (unsigned)index,
+             (entry->kind == ECRF_SCHED_SWEEP) ? "sweep" : "listen", entry->profile.name,
+             (unsigned long)(session->slot_us / 1000), ECRF_SCHED_PCT(planned), ECRF_SCHED_PCT(duty),
+             (unsigned long)(ecrf_sched_revisit_us(&radio->plan, index) / 1000),
+             (unsigned long)(session->revisit_max_us / 1000),
+             (unsigned long)ecrf_sched_switch_mean_us(session), (unsigned long)session->switch_max_us);
+  } else if (radio->entry[index].kind == ECRF_SCHED_SWEEP) {
+    uint8_t top;
+    if (ecrf_survey_top(&radio->survey, &top, 1) == 1) {
+      uint32_t frequency = eCC1101::scanChannelFrequency(top);
+      const struct s_ecrf_survey_channel *channel = &radio->survey.channel[top];
+      snprintf(pcWriteBuffer, xWriteBufferLen,
+               "   %lu sweeps, busiest %u.%03u MHz: %lu hits, max %d dBm\n",
+               (unsigned long)radio->survey.sweeps, (unsigned)(frequency / 1000000),
+               (unsigned)((frequency % 1000000) / 1000), (unsigned long)channel->hits,
+               channel->rssi_max);
+    } else {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "   %lu sweeps, nothing above %d dBm\n",
+               (unsigned long)radio->survey.sweeps, radio->survey.threshold);
+    }
+  } else {
+    const struct s_ecrf_sched_entry *entry = &radio->entry[index];
+    if (entry->bursts > 0) {
+      snprintf(pcWriteBuffer, xWriteBufferLen,
+               "   %lu bytes, %lu gaps, %lu bursts, max %d dBm, last %lu s ago\n",
+               (unsigned long)entry->bytes, (unsigned long)entry->gaps, (unsigned long)entry->bursts,
+               entry->rssi_max, (unsigned long)((ecrf_sched_now_ms() - entry->last_burst_ms) / 1000));
+    } else {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "   %lu bytes, %lu gaps, no burst\n",
+               (unsigned long)entry->bytes, (unsigned long)entry->gaps);
+    }
+  }
+  size_t lines = 2 + 2 * radio->plan.count;
+  xSemaphoreGive(radio->lock);
+
+  if (++line < lines)
+    return pdTRUE;
+
+  line = 0;
+  return pdFALSE;
+}
+
+static BaseType_t ecrf_sched_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                 const char *pcCommandString) {
+  static struct s_ecrf_sched_radio *listing = NULL;
+  static int listingId = -1;
+  BaseType_t actionLen;
+  BaseType_t nameLen;
+  char name[ECC1101_PROFILE_NAME_LEN] = ECRF_PROFILE_DEFAULT;
+  int id = -1;
+  int slot_ms = 0;
+  const char *action = FreeRTOS_CLIGetParameter(pcCommandString, 1, &actionLen);
+
+  if (listing != NULL) {
+    if (ecrf_sched_stats_line(pcWriteBuffer, xWriteBufferLen, listing, listingId) == pdTRUE)
+      return pdTRUE;
+    listing = NULL;
+    return pdFALSE;
+  }
+
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &id);
+  struct s_ecrf_sched_radio *radio = ecrf_sched_get(id);
+  if ((action == NULL) || (radio == NULL)) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "Usage: sched listen <radio id> <profile> <ms> | sweep <radio id> <ms> [profile] |"
+             " start|stop|clear|stats <radio id>\n");
+    return pdFALSE;
+  }
+
+  if (strncmp(action, "listen", actionLen) == 0) {
+    const char *nameStr = FreeRTOS_CLIGetParameter(pcCommandString, 3, &nameLen);
+    if (nameStr != NULL) {
+      memset(name, 0, sizeof(name));
+      strncpy(name, nameStr, MIN((size_t)nameLen, sizeof(name) - 1));
+    }
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 4, &slot_ms);
+    return ecrf_sched_add_cmd(pcWriteBuffer, xWriteBufferLen, radio, ECRF_SCHED_LISTEN, name, slot_ms);
+  }
+
+  if (strncmp(action, "sweep", actionLen) == 0) {
+    const char *nameStr = FreeRTOS_CLIGetParameter(pcCommandString, 4, &nameLen);
+    if (nameStr != NULL) {
+      memset(name, 0, sizeof(name));
+      strncpy(name, nameStr, MIN((size_t)nameLen, sizeof(name) - 1));
+    }
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 3, &slot_ms);
+    return ecrf_sched_add_cmd(pcWriteBuffer, xWriteBufferLen, radio, ECRF_SCHED_SWEEP, name, slot_ms);
+  }
+
+  if (strncmp(action, "start", actionLen) == 0)
+    return ecrf_sched_start_cmd(pcWriteBuffer, xWriteBufferLen, radio, id);
+
+  if (strncmp(action, "stop", actionLen) == 0) {
+    if (!radio->running) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] No scheduler running on module %d\n", id);
+      return pdFALSE;
+    }
+    ecrf_sched_stop(radio, id);
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Scheduler stopped on module %d\n", id);
+    return pdFALSE;
+  }
+
+  if (strncmp(action, "clear", actionLen) == 0) {
+    if (radio->running) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Stop the scheduler first\n");
+      return pdFALSE;
+    }
+    xSemaphoreTake(radio->lock, portMAX_DELAY);
+    ecrf_sched_init(&radio->plan);
+    radio->sweep = -1;
+    xSemaphoreGive(radio->lock);
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Slots of module %d cleared\n", id);
+    return pdFALSE;
+  }
+
+  if (strncmp(action, "stats", actionLen) == 0) {
+    if (ecrf_sched_stats_line(pcWriteBuffer, xWriteBufferLen, radio, id) == pdFALSE)
+      return pdFALSE;
+    listing = radio;
+    listingId = id;
+    return pdTRUE;
+  }
+
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Unknown sched action\n");
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("sched",
+                            "sched listen <radio id> <profile> <ms> | sweep <radio id> <ms> [profile] |"
+                            " start|stop|clear|stats <radio id>",
+                            ecrf_sched_cmd, -1);
@@ -0,0 +1,505 @@
+#include <Arduino.h>
+#include <FreeRTOS_CLI.h>
+#include <FreeRTOS_Shell.h>
+#include <FreeRTOS_Shell_port.h>
+#include <Preferences.h>
+#include <ecrf_heap.h>
+#include "cc1101_ecrf.h"
+
+#define MIN(x, y) (x < y ? x : y)
+
+#define ECRF_SCRIPT_NVS_NAMESPACE "ecrf_script"
+#define ECRF_SCRIPT_NVS_SLOTS 8
+#define ECRF_SCRIPT_NAME_LEN 16
+
+#ifndef ECRF_SCRIPT_TEXT_LEN
+#define ECRF_SCRIPT_TEXT_LEN 1024
+#endif
+
+#ifndef ECRF_SCRIPT_MAX_LINES
+#define ECRF_SCRIPT_MAX_LINES 64
+#endif
+
+#ifndef ECRF_SCRIPT_REPORT_LEN
+#define ECRF_SCRIPT_REPORT_LEN 4096
+#endif
+
+/*
+ * Batch scripts: recorded line by line from the shell, kept in NVS and run
+ * in one go through the CLI dispatch. Besides shell commands a script knows
+ * "repeat <n>" ... "done" (nestable), "sleep <ms>" and "#" comments.
+ * Command output and per-step timing are gathered into one report, printed
+ * once the script is over.
+ */
+struct s_ecrf_script_header {
+  char name[ECRF_SCRIPT_NAME_LEN];
+};
+
+struct s_ecrf_script_step {
+  uint32_t runs;
+  uint32_t max_us;
+  uint64_t total_us;
+};
+
+/* recording and running share the text, both run in the shell task */
+static char ecrf_script_name[ECRF_SCRIPT_NAME_LEN];
+static char ecrf_script_text[ECRF_SCRIPT_TEXT_LEN];
+static size_t ecrf_script_length;
+static bool ecrf_script_overflow;
+
+static const char *ecrf_script_lines[ECRF_SCRIPT_MAX_LINES];
+static uint16_t ecrf_script_match[ECRF_SCRIPT_MAX_LINES];
+static uint32_t ecrf_script_remaining[ECRF_SCRIPT_MAX_LINES];
+static struct s_ecrf_script_step ecrf_script_steps[ECRF_SCRIPT_MAX_LINES];
+static size_t ecrf_script_line_count;
+
+static char ecrf_script_report[ECRF_SCRIPT_REPORT_LEN];
+static size_t ecrf_script_report_len;
+static size_t ecrf_script_truncated;
+static char ecrf_script_output[FREERTOS_CLI_OUTPUT_MAX_BUFFER_SIZE];
+static bool ecrf_script_running = false;
+
+size_t ecrf_script_footprint(void) {
+  return sizeof(ecrf_script_text) + sizeof(ecrf_script_lines) + sizeof(ecrf_script_match) +
+         sizeof(ecrf_script_remaining) + sizeof(ecrf_script_steps) + sizeof(ecrf_script_report) +
+         sizeof(ecrf_script_output);
+}
+
+static void ecrf_script_key(char *key, size_t len, int slot) {
+  snprintf(key, len, "s%d", slot);
+}
+
+static bool ecrf_script_slot_name(Preferences &prefs, int slot, char *name) {
+  struct s_ecrf_script_header header;
+  char key[8];
+
+  ecrf_script_key(key, sizeof(key), slot);
+  if (prefs.getBytesLength(key) < sizeof(header))
+    return false;
+  if (prefs.getBytes(key, &header, sizeof(header)) < sizeof(header))
+    return false;
+
+  memcpy(name, header.name, ECRF_SCRIPT_NAME_LEN);
+  name[ECRF_SCRIPT_NAME_LEN - 1] = 0;
+  return true;
+}
+
+/* slot holding name, else the first free one with *found false, -1 when full */
+static int ecrf_script_slot(Preferences &prefs, const char *name, bool *found) {
+  char stored[ECRF_SCRIPT_NAME_LEN];
+  int freeSlot = -1;
+
+  *found = false;
+  for (int slot = 0; slot < ECRF_SCRIPT_NVS_SLOTS; slot++) {
+    if (!ecrf_script_slot_name(prefs, slot, stored)) {
+      if (freeSlot < 0)
+        freeSlot = slot;
+    } else if (strcmp(stored, name) == 0) {
+      *found = true;
+      return slot;
+    }
+  }
+
+  return freeSlot;
+}
+
+/* the text buffer goes to NVS behind its header */
+static bool ecrf_script_save(void) {
+  static uint8_t blob[sizeof(struct s_ecrf_script_header) + ECRF_SCRIPT_TEXT_LEN];
+  struct s_ecrf_script_header header = {};
+  Preferences prefs;
+  bool found;
+  bool saved = false;
+
+  strncpy(header.name, ecrf_script_name, sizeof(header.name) - 1);
+  memcpy(blob, &header, sizeof(header));
+  memcpy(blob + sizeof(header), ecrf_script_text, ecrf_script_length);
+
+  ecrf_heap_guard_pause();
+  if (prefs.begin(ECRF_SCRIPT_NVS_NAMESPACE, false)) {
+    int slot = ecrf_script_slot(prefs, ecrf_script_name, &found);
+    if (slot >= 0) {
+      char key[8];
+      ecrf_script_key(key, sizeof(key), slot);
+      size_t len = sizeof(header) + ecrf_script_length;
+      saved = prefs.putBytes(key, blob, len) == len;
+    }
+    prefs.end();
+  }
+  ecrf_heap_guard_resume();
+
+  return saved;
+}
+
+static bool ecrf_script_load(const char *name) {
+  static uint8_t blob[sizeof(struct s_ecrf_script_header) + ECRF_SCRIPT_TEXT_LEN];
+  Preferences prefs;
+  bool found = false;
+  size_t len = 0;
+
+  ecrf_heap_guard_pause();
+  if (prefs.begin(ECRF_SCRIPT_NVS_NAMESPACE, true)) {
+    int slot = ecrf_script_slot(prefs, name, &found);
+    if (found) {
+      char key[8];
+      ecrf_script_key(key, sizeof(key), slot);
+      len = prefs.getBytes(key, blob, sizeof(blob));
+    }
+    prefs.end();
+  }
+  ecrf_heap_guard_resume();
+
+  if (!found || (len < sizeof(struct s_ecrf_script_header)))
+    return false;
+
+  strncpy(ecrf_script_name, name, sizeof(ecrf_script_name) - 1);
+  ecrf_script_length = len - sizeof(struct s_ecrf_script_header);
+  memcpy(ecrf_script_text, blob + sizeof(struct s_ecrf_script_header), ecrf_script_length);
+  return true;
+}
+
+static bool ecrf_script_delete(const char *name) {
+  Preferences prefs;
+  bool found = false;
+
+  ecrf_heap_guard_pause();
+  if (prefs.begin(ECRF_SCRIPT_NVS_NAMESPACE, false)) {
+    int slot = ecrf_script_slot(prefs, name, &found);
+    if (found) {
+      char key[8];
+      ecrf_script_key(key, sizeof(key), slot);
+      found = prefs.remove(key);
+    }
+    prefs.end();
+  }
+  ecrf_heap_guard_resume();
+
+  return found;
+}
+
+/* recording: every line goes to the text until "end" */
+static bool ecrf_script_record_line(const char *line) {
+  char report[80];
+
+  if (strcmp(line, "end") == 0) {
+    FreeRTOS_ShellSetLineHook(NULL);
+    if (ecrf_script_overflow) {
+      snprintf(report, sizeof(report), "[E] [Script] %s exceeds %u bytes, not saved\r\n",
+               ecrf_script_name, (unsigned)ECRF_SCRIPT_TEXT_LEN);
+    } else if (!ecrf_script_save()) {
+      snprintf(report, sizeof(report), "[E] [Script] No NVS slot left for %s\r\n", ecrf_script_name);
+    } else {
+      snprintf(report, sizeof(report), "[Script] %s saved, %u bytes\r\n", ecrf_script_name,
+               (unsigned)ecrf_script_length);
+    }
+    FreeRTOS_ShellOutput(report, strlen(report));
+    return true;
+  }
+
+  size_t len = strlen(line);
+  if (ecrf_script_length + len + 1 > sizeof(ecrf_script_text)) {
+    ecrf_script_overflow = true;
+  } else {
+    memcpy(&ecrf_script_text[ecrf_script_length], line, len);
+    ecrf_script_length += len;
+    ecrf_script_text[ecrf_script_length++] = '\n';
+  }
+
+  return true;
+}
+
+static const char *ecrf_script_skip_spaces(const char *line) {
+  while (*line == ' ')
+    line++;
+  return line;
+}
+
+static bool ecrf_script_is(const char *line, const char *keyword) {
+  size_t len = strlen(keyword);
+  return (strncmp(line, keyword, len) == 0) && ((line[len] == ' ') || (line[len] == 0));
+}
+
+/* cut the text into lines and pair each repeat with its done */
+static const char *ecrf_script_parse(size_t *errorLine) {
+  uint16_t open[ECRF_SCRIPT_MAX_LINES];
+  size_t depth = 0;
+  char *text = ecrf_script_text;
+  char *end = ecrf_script_text + ecrf_script_length;
+
+  ecrf_script_line_count = 0;
+  while (text < end) {
+    char *eol = (char *)memchr(text, '\n', end - text);
+    if (eol == NULL)
+      eol = end;
+    if (ecrf_script_line_count == ECRF_SCRIPT_MAX_LINES) {
+      *errorLine = ecrf_script_line_count;
+      return "too many lines";
+    }
+    *eol = 0;
+    ecrf_script_lines[ecrf_script_line_count++] = ecrf_script_skip_spaces(text);
+    text = eol + 1;
+  }
+
+  for (size_t i = 0; i < ecrf_script_line_count; i++) {
+    *errorLine = i + 1;
+    if (ecrf_script_is(ecrf_script_lines[i], "repeat")) {
+      open[depth++] = i;
+    } else if (ecrf_script_is(ecrf_script_lines[i], "done")) {
+      if (depth == 0)
+        return "done without repeat";
+      uint16_t start = open[--depth];
+      ecrf_script_match[start] = i;
+      ecrf_script_match[i] = start;
+    }
+  }
+  if (depth > 0) {
+    *errorLine = open[depth - 1] + 1;
+    return "repeat without done";
+  }
+
+  return NULL;
+}
+
+static void ecrf_script_append(const char *data, size_t len) {
+  size_t room = sizeof(ecrf_script_report) - 1 - ecrf_script_report_len;
+  size_t n = (len < room) ? len : room;
+
+  memcpy(&ecrf_script_report[ecrf_script_report_len], data, n);
+  ecrf_script_report_len += n;
+  ecrf_script_report[ecrf_script_report_len] = 0;
+  ecrf_script_truncated += len - n;
+}
+
+/* one command through the CLI dispatch, its output into the report */
+static void ecrf_script_dispatch(const char *line, bool quiet) {
+  const CLI_Definition_List_Item_t *command = NULL;
+  BaseType_t more;
+
+  do {
+    ecrf_script_output[0] = 0;
+    more = FreeRTOS_CLIProcessCommandFrom(line, ecrf_script_output, sizeof(ecrf_script_output),
+                                          &command);
+    if (!quiet)
+      ecrf_script_append(ecrf_script_output, strlen(ecrf_script_output));
+  } while (more == pdTRUE);
+}
+
+static uint32_t ecrf_script_execute(bool quiet) {
+  int64_t start = esp_timer_get_time();
+  size_t pc = 0;
+  char header[40];
+
+  memset(ecrf_script_steps, 0, sizeof(ecrf_script_steps));
+  ecrf_script_report_len = 0;
+  ecrf_script_report[0] = 0;
+  ecrf_script_truncated = 0;
+
+  while (pc < ecrf_script_line_count) {
+    const char *line = ecrf_script_lines[pc];
+
+    if ((line[0] == 0) || (line[0] == '#')) {
+      pc++;
+    } else if (ecrf_script_is(line, "repeat")) {
+      int count = atoi(line + strlen("repeat"));
+      ecrf_script_remaining[pc] = (count > 0) ? count : 0;
+      pc = (count > 0) ? pc + 1 : ecrf_script_match[pc] + 1;
+    } else if (ecrf_script_is(line, "done")) {
+      size_t loop = ecrf_script_match[pc];
+      pc = (--ecrf_script_remaining[loop] > 0) ? loop + 1 : pc + 1;
+    } else {
+      struct s_ecrf_script_step *step = &ecrf_script_steps[pc];
+      int64_t stepStart = esp_timer_get_time();
+
+      if (ecrf_script_is(line, "sleep")) {
+        vTaskDelay(pdMS_TO_TICKS(atoi(line + strlen("sleep"))));
+      } else {
+        int len = snprintf(header, sizeof(header), "[%02u] ", (unsigned)(pc + 1));
+        ecrf_script_append(header, len);
+        ecrf_script_dispatch(line, quiet);
+        ecrf_script_append("\n", 1);
+      }
+
+      uint32_t elapsed = (uint32_t)(esp_timer_get_time() - stepStart);
+      step->runs++;
+      step->total_us += elapsed;
+      step->max_us = (elapsed > step->max_us) ? elapsed : step->max_us;
+      pc++;
+    }
+  }
+
+  return (uint32_t)((esp_timer_get_time() - start) / 1000);
+}
+
+/* report: gathered output, then one timing line per step, then the total */
+static BaseType_t ecrf_script_report_chunk(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                           uint32_t elapsedMs) {
+  static size_t offset = 0;
+  static size_t line = 0;
+
+  if (offset < ecrf_script_report_len) {
+    size_t n = ecrf_script_report_len - offset;
+    n = (n < xWriteBufferLen - 1) ? n : xWriteBufferLen - 1;
+    memcpy(pcWriteBuffer, &ecrf_script_report[offset], n);
+    pcWriteBuffer[n] = 0;
+    offset += n;
+    return pdTRUE;
+  }
+
+  if (line == 0) {
+    line = 1;
+    if (ecrf_script_truncated > 0) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "... %u bytes of output dropped\n",
+               (unsigned)ecrf_script_truncated);
+      return pdTRUE;
+    }
+  }
+
+  while (line <= ecrf_script_line_count) {
+    const struct s_ecrf_script_step *step = &ecrf_script_steps[line - 1];
+    const char *text = ecrf_script_lines[line - 1];
+    line++;
+    if (step->runs == 0)
+      continue;
+
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[%02u] %5lu x %8lu us max %8lu us  %.40s\n",
+             (unsigned)(line - 1), (unsigned long)step->runs,
+             (unsigned long)(step->total_us / step->runs), (unsigned long)step->max_us, text);
+    return pdTRUE;
+  }
+
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[Script] %s done in %lu ms\n", ecrf_script_name,
+           (unsigned long)elapsedMs);
+  offset = 0;
+  line = 0;
+  return pdFALSE;
+}
+
+static BaseType_t ecrf_script_list(char *pcWriteBuffer, size_t xWriteBufferLen) {
+  static int slot = 0;
+  char name[ECRF_SCRIPT_NAME_LEN];
+  Preferences prefs;
+
+  *pcWriteBuffer = 0;
+  while (slot < ECRF_SCRIPT_NVS_SLOTS) {
+    int i = slot++;
+    ecrf_heap_guard_pause();
+    bool loaded = prefs.begin(ECRF_SCRIPT_NVS_NAMESPACE, true) &&
+                  ecrf_script_slot_name(prefs, i, name);
+    prefs.end();
+    ecrf_heap_guard_resume();
+    if (loaded) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "%s\n", name);
+      return pdTRUE;
+    }
+  }
+
+  slot = 0;
+  return pdFALSE;
+}
+
+static BaseType_t ecrf_script_show(char *pcWriteBuffer, size_t xWriteBufferLen) {
+  static size_t offset = 0;
+  size_t n = ecrf_script_length - offset;
+
+  n = (n < xWriteBufferLen - 1) ? n : xWriteBufferLen - 1;
+  memcpy(pcWriteBuffer, &ecrf_script_text[offset], n);
+  pcWriteBuffer[n] = 0;
+  offset += n;
+  if (offset < ecrf_script_length)
+    return pdTRUE;
+
+  offset = 0;
+  return pdFALSE;
+}
+
+enum ecrf_script_output_mode {
+  ECRF_SCRIPT_OUTPUT_NONE,
+  ECRF_SCRIPT_OUTPUT_LIST,
+  ECRF_SCRIPT_OUTPUT_SHOW,
+  ECRF_SCRIPT_OUTPUT_REPORT,
+};
+
+static BaseType_t ecrf_script_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                  const char *pcCommandString) {
+  static enum ecrf_script_output_mode mode = ECRF_SCRIPT_OUTPUT_NONE;
+  static uint32_t elapsedMs = 0;
+  BaseType_t more = pdFALSE;
+  BaseType_t actionLen;
+  BaseType_t nameLen;
+  char name[ECRF_SCRIPT_NAME_LEN] = {0};
+
+  if (mode == ECRF_SCRIPT_OUTPUT_NONE) {
+    const char *action = FreeRTOS_CLIGetParameter(pcCommandString, 1, &actionLen);
+    const char *nameStr = FreeRTOS_CLIGetParameter(pcCommandString, 2, &nameLen);
+    if (nameStr != NULL)
+      strncpy(name, nameStr, MIN((size_t)nameLen, sizeof(name) - 1));
+
+    if ((action != NULL) && (strncmp(action, "list", actionLen) == 0)) {
+      mode = ECRF_SCRIPT_OUTPUT_LIST;
+    } else if ((action == NULL) || (nameStr == NULL)) {
+      snprintf(pcWriteBuffer, xWriteBufferLen,
+               "Usage: script record|run|show|del <name> [quiet] | script list\n");
+      return pdFALSE;
+    } else if (ecrf_script_running) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [Script] Scripts cannot run scripts\n");
+      return pdFALSE;
+    } else if (strncmp(action, "record", actionLen) == 0) {
+      memset(ecrf_script_name, 0, sizeof(ecrf_script_name));
+      strncpy(ecrf_script_name, name, sizeof(ecrf_script_name) - 1);
+      ecrf_script_length = 0;
+      ecrf_script_overflow = false;
+      FreeRTOS_ShellSetLineHook(ecrf_script_record_line);
+      snprintf(pcWriteBuffer, xWriteBufferLen,
+               "[Script] Recording %s, one command per line, end to finish\n", name);
+      return pdFALSE;
+    } else if (strncmp(action, "del", actionLen) == 0) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, ecrf_script_delete(name) ? "[Script] %s deleted\n"
+                                                                          : "[E] [Script] Unknown script %s\n",
+               name);
+      return pdFALSE;
+    } else if (!ecrf_script_load(name)) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [Script] Unknown script %s\n", name);
+      return pdFALSE;
+    } else if (strncmp(action, "show", actionLen) == 0) {
+      mode = ECRF_SCRIPT_OUTPUT_SHOW;
+    } else if (strncmp(action, "run", actionLen) == 0) {
+      size_t errorLine = 0;
+      BaseType_t quietLen;
+      const char *quiet = FreeRTOS_CLIGetParameter(pcCommandString, 3, &quietLen);
+      const char *error = ecrf_script_parse(&errorLine);
+      if (error != NULL) {
+        snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [Script] %s line %u: %s\n", name,
+                 (unsigned)errorLine, error);
+        return pdFALSE;
+      }
+
+      ecrf_script_running = true;
+      elapsedMs = ecrf_script_execute((quiet != NULL) && (strncmp(quiet, "quiet", quietLen) == 0));
+      ecrf_script_running = false;
+      mode = ECRF_SCRIPT_OUTPUT_REPORT;
+    } else {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [Script] Unknown action\n");
+      return pdFALSE;
+    }
+  }
+
+  switch (mode) {
+    case ECRF_SCRIPT_OUTPUT_LIST:
+      more = ecrf_script_list(pcWriteBuffer, xWriteBufferLen);
+      break;
+    case ECRF_SCRIPT_OUTPUT_SHOW:
+      more = ecrf_script_show(pcWriteBuffer, xWriteBufferLen);
+      break;
+    case ECRF_SCRIPT_OUTPUT_REPORT:
+      more = ecrf_script_report_chunk(pcWriteBuffer, xWriteBufferLen, elapsedMs);
+      break;
+    default:
+      break;
+  }
+
+  if (more == pdFALSE)
+    mode = ECRF_SCRIPT_OUTPUT_NONE;
+  return more;
+}
+FREERTOS_SHELL_CMD_REGISTER("script", "script record|run|show|del <name> [quiet] | script list",
+                            ecrf_script_cmd, -1);
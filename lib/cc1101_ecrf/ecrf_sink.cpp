@@ -0,0 +1,269 @@
+#include <Arduino.h>
+#include <FreeRTOS_CLI.h>
+#include <FreeRTOS_Shell.h>
+#include <eCC1101.h>
+#include <ecrf_arena.h>
+#include <ecrf_hex.h>
+#include <ecrf_tasks.h>
+#include "cc1101_ecrf.h"
+#include "ecrf_plugin.h"
+
+#define MAX(x, y) (x < y ? y : x)
+#define MIN(x, y) (x < y ? x : y)
+
+/*
+ * Push session: one radio streams into its session buffer and the sink task
+ * fans it out to the attached sinks. Sinks can be attached and detached
+ * while the session runs; the rx command keeps pulling on its own radio.
+ * Sinks and decoders come from the plugin registries.
+ */
+static TaskHandle_t ecrf_sink_task = NULL;
+static TaskHandle_t ecrf_sink_waiter = NULL;
+static eCC1101 *ecrf_sink_radio = NULL;
+static int ecrf_sink_radio_id = -1;
+static volatile bool ecrf_sink_running = false;
+
+/* hex dump on the console, only what the UART FIFO takes right now */
+static size_t ecrf_sink_console_write(void *ctx, const uint8_t *data, size_t len) {
+  char hex[2 * ECC1101_SINK_CHUNK + 1];
+  size_t n = MIN(len, (size_t)MAX(Serial.availableForWrite(), 0) / 2);
+
+  if (n > 0) {
+    Serial.write((const uint8_t *)hex, ecrf_hex_encode(hex, data, n));
+  }
+
+  return n;
+}
+
+/* takes everything, stands for a decoder that keeps up */
+static size_t ecrf_sink_null_write(void *ctx, const uint8_t *data, size_t len) {
+  return len;
+}
+
+static struct s_eCC1101_sink ecrf_sink_console = {.name = "console", .write = ecrf_sink_console_write};
+static struct s_eCC1101_sink ecrf_sink_null = {.name = "null", .write = ecrf_sink_null_write};
+ECRF_SINK_REGISTER(ecrf_sink_console);
+ECRF_SINK_REGISTER(ecrf_sink_null);
+
+/* the radio takes ECC1101_MAX_SINKS at most, whatever the registries hold */
+static struct s_eCC1101_sink *ecrf_sink_attached[ECC1101_MAX_SINKS];
+
+static int ecrf_sink_slot(const struct s_eCC1101_sink *sink) {
+  for (int i = 0; i < ECC1101_MAX_SINKS; i++) {
+    if (ecrf_sink_attached[i] == sink)
+      return i;
+  }
+
+  return -1;
+}
+
+int ecrf_sink_session(void) {
+  return ecrf_sink_radio_id;
+}
+
+static void ecrf_sink_thread(void *param) {
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    /* the timeout catches data that landed before the task was known */
+    while (ecrf_sink_running) {
+      if (ecrf_sink_radio->pumpSinks() == 0)
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+    }
+
+    xTaskNotifyGive(ecrf_sink_waiter);
+  }
+}
+
+static BaseType_t ecrf_sink_start(char *pcWriteBuffer, size_t xWriteBufferLen, int id,
+                                  const char *name) {
+  struct s_cc1101_rf_profile stored;
+  const struct s_cc1101_rf_profile *profile = ecrf_profile_find(name, &stored);
+  if (profile == NULL) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Unknown profile %s\n", name);
+    return pdFALSE;
+  }
+
+  if (ecrf_sink_task == NULL) {
+    if (ecrf_task_create(ECRF_TASK_SINK, ecrf_sink_thread, NULL, &ecrf_sink_task) != pdPASS) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Sink task creation failed\n");
+      return pdFALSE;
+    }
+  }
+
+  ecrf_sink_radio = cc1101_init(id);
+  if (ecrf_sink_radio == NULL)
+    return pdFALSE;
+  ecrf_radio_claim(id, "sink");
+
+  /* nobody pulls from a push session, the pull side must not stall it */
+  ecrf_sink_radio->setOverflowPolicy(ECC1101_DROP_OLDEST);
+  ecrf_sink_radio->setSinkTask(ecrf_sink_task);
+  if (ecrf_sink_radio->startRawReceive(profile) != RADIOLIB_ERR_NONE) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "[E] [CC1101] No room for a session (arena largest %u)\n",
+             (unsigned)ecrf_arena_largest());
+    ecrf_sink_radio->setSinkTask(NULL);
+    ecrf_radio_unclaim(id);
+    cc1101_release(ecrf_sink_radio);
+    ecrf_sink_radio = NULL;
+    return pdFALSE;
+  }
+
+  ecrf_sink_radio_id = id;
+  ecrf_sink_running = true;
+  xTaskNotifyGive(ecrf_sink_task);
+
+  snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Push session on module %d (%s)\n", id, name);
+  return pdFALSE;
+}
+
+static void ecrf_sink_stop(void) {
+  ecrf_sink_radio->stopRawReceive();
+
+  /* the task leaves its pump before the radio goes away */
+  ecrf_sink_waiter = xTaskGetCurrentTaskHandle();
+  ecrf_sink_running = false;
+  xTaskNotifyGive(ecrf_sink_task);
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+  for (size_t i = 0; i < ECC1101_MAX_SINKS; i++) {
+    if (ecrf_sink_attached[i] != NULL) {
+      ecrf_sink_radio->removeSink(ecrf_sink_attached[i]);
+      ecrf_sink_attached[i] = NULL;
+    }
+  }
+  ecrf_sink_radio->setSinkTask(NULL);
+  ecrf_sink_radio->closeRawSession();
+  cc1101_release(ecrf_sink_radio);
+  ecrf_radio_unclaim(ecrf_sink_radio_id);
+  ecrf_sink_radio = NULL;
+  ecrf_sink_radio_id = -1;
+}
+
+static BaseType_t ecrf_sink_list_line(char *pcWriteBuffer, size_t xWriteBufferLen) {
+  static size_t index = 0;
+
+  if (index == 0) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "module %d\nSINK     DELIVERED      LAG  MAX LAG     LOST STATE\n", ecrf_sink_radio_id);
+    index = 1;
+    return pdTRUE;
+  }
+
+  while (index <= ECC1101_MAX_SINKS) {
+    const struct s_eCC1101_sink *sink = ecrf_sink_attached[index++ - 1];
+    if (sink == NULL)
+      continue;
+
+    snprintf(pcWriteBuffer, xWriteBufferLen, "%-8s %9lu %8lu %8lu %8lu %s\n", sink->name,
+             (unsigned long)sink->delivered, (unsigned long)ecrf_sink_radio->sinkLag(sink),
+             (unsigned long)sink->max_lag, (unsigned long)sink->lost,
+             sink->dropped ? "dropped" : "live");
+    return pdTRUE;
+  }
+
+  *pcWriteBuffer = 0;
+  index = 0;
+  return pdFALSE;
+}
+
+static BaseType_t ecrf_sink_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                const char *pcCommandString) {
+  static bool listing = false;
+  BaseType_t actionLen;
+  const char *action = FreeRTOS_CLIGetParameter(pcCommandString, 1, &actionLen);
+
+  if (listing) {
+    listing = ecrf_sink_list_line(pcWriteBuffer, xWriteBufferLen) == pdTRUE;
+    return listing ? pdTRUE : pdFALSE;
+  }
+
+  if ((action != NULL) && (strncmp(action, "start", actionLen) == 0)) {
+    int id = 0;
+    BaseType_t nameLen;
+    char name[ECC1101_PROFILE_NAME_LEN] = ECRF_PROFILE_DEFAULT;
+    if (ecrf_sink_running) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Push session already on module %d\n",
+               ecrf_sink_radio_id);
+      return pdFALSE;
+    }
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &id);
+    const char *nameStr = FreeRTOS_CLIGetParameter(pcCommandString, 3, &nameLen);
+    if (nameStr != NULL) {
+      memset(name, 0, sizeof(name));
+      strncpy(name, nameStr, MIN((size_t)nameLen, sizeof(name) - 1));
+    }
+    return ecrf_sink_start(pcWriteBuffer, xWriteBufferLen, id, name);
+  }
+
+  if (!ecrf_sink_running) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] No push session, run sink start first\n");
+    return pdFALSE;
+  }
+
+  if ((action != NULL) && (strncmp(action, "stop", actionLen) == 0)) {
+    ecrf_sink_stop();
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Push session stopped\n");
+    return pdFALSE;
+  }
+
+  if ((action != NULL) &&
+      ((strncmp(action, "add", actionLen) == 0) || (strncmp(action, "del", actionLen) == 0))) {
+    BaseType_t nameLen;
+    const struct s_ecrf_decoder *decoder;
+    const char *name = FreeRTOS_CLIGetParameter(pcCommandString, 2, &nameLen);
+    struct s_eCC1101_sink *sink =
+        (name != NULL) ? ecrf_plugin_sink_find(name, nameLen, &decoder) : NULL;
+    if (sink == NULL) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Unknown sink, see plugins\n");
+      return pdFALSE;
+    }
+
+    int slot = ecrf_sink_slot(sink);
+    if (strncmp(action, "del", actionLen) == 0) {
+      if (slot >= 0) {
+        ecrf_sink_radio->removeSink(sink);
+        ecrf_sink_attached[slot] = NULL;
+      }
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Sink %s detached\n", sink->name);
+      return pdFALSE;
+    }
+
+    if (slot >= 0) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Sink %s already attached\n", sink->name);
+      return pdFALSE;
+    }
+    int dropLag = 0;
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 3, &dropLag);
+    sink->drop_lag = MAX(dropLag, 0);
+    slot = ecrf_sink_slot(NULL);
+    if (decoder != NULL)
+      decoder->reset();
+    if ((slot < 0) || (ecrf_sink_radio->addSink(sink) != RADIOLIB_ERR_NONE)) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] No sink slot left (%u)\n",
+               (unsigned)ECC1101_MAX_SINKS);
+      return pdFALSE;
+    }
+    ecrf_sink_attached[slot] = sink;
+    if (sink->drop_lag == 0) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Sink %s attached\n", sink->name);
+    } else {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Sink %s attached, dropped %lu bytes behind\n",
+               sink->name, (unsigned long)sink->drop_lag);
+    }
+    return pdFALSE;
+  }
+
+  if ((action == NULL) || (strncmp(action, "list", actionLen) == 0)) {
+    listing = ecrf_sink_list_line(pcWriteBuffer, xWriteBufferLen) == pdTRUE;
+    return listing ? pdTRUE : pdFALSE;
+  }
+
+  snprintf(pcWriteBuffer, xWriteBufferLen,
+           "Usage: sink start <radio id> [profile] | stop | add <sink> [drop lag] | del <sink> | list\n");
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("sink",
+                            "sink start <radio id> [profile] | stop | add <sink|decoder> [drop lag] | del <sink> | list",
+                            ecrf_sink_cmd, -1);
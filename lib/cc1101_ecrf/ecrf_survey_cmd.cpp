@@ -0,0 +1,202 @@
+#include <Arduino.h>
+#include <FreeRTOS_CLI.h>
+#include <FreeRTOS_Shell.h>
+#include <eCC1101.h>
+#include <ecrf_survey.h>
+#include <ecrf_tasks.h>
+#include "cc1101_ecrf.h"
+
+#define ECRF_SURVEY_THRESHOLD -75
+#define ECRF_SURVEY_TOP_DEFAULT 8
+#define ECRF_SURVEY_TOP_MAX 16
+
+/*
+ * Long-running site survey: a background task sweeps the scan table and
+ * folds each sweep into the aggregate, nothing is printed until asked.
+ * The shell and the survey task share the aggregate under a mutex.
+ */
+static struct s_ecrf_survey ecrf_survey;
+static StaticSemaphore_t ecrf_survey_lock_buffer;
+static SemaphoreHandle_t ecrf_survey_lock = NULL;
+static TaskHandle_t ecrf_survey_task = NULL;
+static TaskHandle_t ecrf_survey_waiter = NULL;
+static eCC1101 *ecrf_survey_radio = NULL;
+static int ecrf_survey_radio_id = -1;
+static volatile bool ecrf_survey_running = false;
+
+size_t ecrf_survey_footprint(void) {
+  return sizeof(ecrf_survey) + sizeof(ecrf_survey_lock_buffer);
+}
+
+static uint32_t ecrf_survey_now_ms(void) {
+  return pdTICKS_TO_MS(xTaskGetTickCount());
+}
+
+static void ecrf_survey_thread(void *param) {
+  int16_t channel_rssi[ECRF_SURVEY_MAX_CHANNELS];
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    while (ecrf_survey_running) {
+      ecrf_survey_radio->sweep(channel_rssi);
+      xSemaphoreTake(ecrf_survey_lock, portMAX_DELAY);
+      ecrf_survey_add(&ecrf_survey, channel_rssi, ecrf_survey_now_ms());
+      xSemaphoreGive(ecrf_survey_lock);
+    }
+
+    xTaskNotifyGive(ecrf_survey_waiter);
+  }
+}
+
+static BaseType_t ecrf_survey_start(char *pcWriteBuffer, size_t xWriteBufferLen, int id,
+                                    int threshold) {
+  if (eCC1101::scanChannelCount() > ECRF_SURVEY_MAX_CHANNELS) {
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "[E] [CC1101] Scan table has %u channels, survey holds %u\n",
+             (unsigned)eCC1101::scanChannelCount(), (unsigned)ECRF_SURVEY_MAX_CHANNELS);
+    return pdFALSE;
+  }
+
+  if (ecrf_survey_task == NULL) {
+    ecrf_survey_lock = xSemaphoreCreateMutexStatic(&ecrf_survey_lock_buffer);
+    if (ecrf_task_create(ECRF_TASK_SURVEY, ecrf_survey_thread, NULL, &ecrf_survey_task) != pdPASS) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Survey task creation failed\n");
+      return pdFALSE;
+    }
+  }
+
+  ecrf_survey_radio = cc1101_init(id);
+  if (ecrf_survey_radio == NULL)
+    return pdFALSE;
+  ecrf_radio_claim(id, "survey");
+
+  xSemaphoreTake(ecrf_survey_lock, portMAX_DELAY);
+  ecrf_survey_reset(&ecrf_survey, eCC1101::scanChannelCount(), threshold, ecrf_survey_now_ms());
+  xSemaphoreGive(ecrf_survey_lock);
+
+  ecrf_survey_radio_id = id;
+  ecrf_survey_running = true;
+  xTaskNotifyGive(ecrf_survey_task);
+
+  snprintf(pcWriteBuffer, xWriteBufferLen,
+           "[CC1101] Survey of %u channels on module %d above %d dBm\n",
+           (unsigned)ecrf_survey.channels, id, threshold);
+  return pdFALSE;
+}
+
+static void ecrf_survey_stop(void) {
+  /* the task finishes its sweep before the radio goes away */
+  ecrf_survey_waiter = xTaskGetCurrentTaskHandle();
+  ecrf_survey_running = false;
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+  cc1101_release(ecrf_survey_radio);
+  ecrf_radio_unclaim(ecrf_survey_radio_id);
+  ecrf_survey_radio = NULL;
+  ecrf_survey_radio_id = -1;
+}
+
+static BaseType_t ecrf_survey_top_line(char *pcWriteBuffer, size_t xWriteBufferLen, int k) {
+  static uint8_t top[ECRF_SURVEY_TOP_MAX];
+  static size_t count = 0;
+  static size_t index = 0;
+  struct s_ecrf_survey_channel channel;
+
+  /* rank once, then print one channel per call */
+  if (index == 0) {
+    xSemaphoreTake(ecrf_survey_lock, portMAX_DELAY);
+    count = ecrf_survey_top(&ecrf_survey, top, k);
+    uint32_t sweeps = ecrf_survey.sweeps;
+    uint32_t elapsed = ecrf_survey_now_ms() - ecrf_survey.start_ms;
+    xSemaphoreGive(ecrf_survey_lock);
+
+    snprintf(pcWriteBuffer, xWriteBufferLen,
+             "%lu sweeps in %lu s\nFREQUENCY      HITS   MAX  MEAN  LAST SEEN\n",
+             (unsigned long)sweeps, (unsigned long)(elapsed / 1000));
+    index = (count > 0) ? 1 : 0;
+    return (count > 0) ? pdTRUE : pdFALSE;
+  }
+
+  size_t i = top[index - 1];
+  xSemaphoreTake(ecrf_survey_lock, portMAX_DELAY);
+  channel = ecrf_survey.channel[i];
+  xSemaphoreGive(ecrf_survey_lock);
+
+  uint32_t frequency = eCC1101::scanChannelFrequency(i);
+  snprintf(pcWriteBuffer, xWriteBufferLen, "%3u.%03u MHz %8lu %5d %5d %6lu s ago\n",
+           (unsigned)(frequency / 1000000), (unsigned)((frequency % 1000000) / 1000),
+           (unsigned long)channel.hits, channel.rssi_max, ecrf_survey_mean(&channel),
+           (unsigned long)((ecrf_survey_now_ms() - channel.last_seen_ms) / 1000));
+
+  if (index++ < count)
+    return pdTRUE;
+
+  index = 0;
+  return pdFALSE;
+}
+
+static BaseType_t ecrf_survey_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                  const char *pcCommandString) {
+  static bool listing = false;
+  static int k = ECRF_SURVEY_TOP_DEFAULT;
+  BaseType_t actionLen;
+  const char *action = FreeRTOS_CLIGetParameter(pcCommandString, 1, &actionLen);
+
+  if (listing) {
+    listing = ecrf_survey_top_line(pcWriteBuffer, xWriteBufferLen, k) == pdTRUE;
+    return listing ? pdTRUE : pdFALSE;
+  }
+
+  if ((action != NULL) && (strncmp(action, "start", actionLen) == 0)) {
+    int id = 0;
+    int threshold = ECRF_SURVEY_THRESHOLD;
+    if (ecrf_survey_running) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] Survey already running on module %d\n",
+               ecrf_survey_radio_id);
+      return pdFALSE;
+    }
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &id);
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 3, &threshold);
+    return ecrf_survey_start(pcWriteBuffer, xWriteBufferLen, id, threshold);
+  }
+
+  if ((action != NULL) && (strncmp(action, "stop", actionLen) == 0)) {
+    if (!ecrf_survey_running) {
+      snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] No survey running\n");
+      return pdFALSE;
+    }
+    ecrf_survey_stop();
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Survey stopped after %lu sweeps\n",
+             (unsigned long)ecrf_survey.sweeps);
+    return pdFALSE;
+  }
+
+  if (ecrf_survey_lock == NULL) {
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[E] [CC1101] No survey data, run survey start first\n");
+    return pdFALSE;
+  }
+
+  if ((action != NULL) && (strncmp(action, "reset", actionLen) == 0)) {
+    xSemaphoreTake(ecrf_survey_lock, portMAX_DELAY);
+    ecrf_survey_reset(&ecrf_survey, ecrf_survey.channels, ecrf_survey.threshold,
+                      ecrf_survey_now_ms());
+    xSemaphoreGive(ecrf_survey_lock);
+    snprintf(pcWriteBuffer, xWriteBufferLen, "[CC1101] Survey data cleared\n");
+    return pdFALSE;
+  }
+
+  if ((action != NULL) && (strncmp(action, "top", actionLen) == 0)) {
+    k = ECRF_SURVEY_TOP_DEFAULT;
+    FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &k);
+    k = (k < 1) ? 1 : ((k > ECRF_SURVEY_TOP_MAX) ? ECRF_SURVEY_TOP_MAX : k);
+    listing = ecrf_survey_top_line(pcWriteBuffer, xWriteBufferLen, k) == pdTRUE;
+    return listing ? pdTRUE : pdFALSE;
+  }
+
+  snprintf(pcWriteBuffer, xWriteBufferLen,
+           "Usage: survey start <radio id> [threshold dBm] | stop | top [k] | reset\n");
+  return pdFALSE;
+}
+FREERTOS_SHELL_CMD_REGISTER("survey", "survey start <radio id> [threshold dBm] | stop | top [k] | reset",
+                            ecrf_survey_cmd, -1);
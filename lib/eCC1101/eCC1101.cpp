@@ -1,138 +1,294 @@
 #include "eCC1101.h"
 #include "portmacro.h"
+#include <ecrf_arena.h>
+#include <ecrf_log.h>
+#include <ecrf_tasks.h>
 
 #define MAX(x, y) (x < y ? y : x)
 #define MIN(x, y) (x < y ? x : y)
 
-eCC1101::eCC1101(struct s_eCC1101_pins& pins, SPIClass& spi, const std::vector<int32_t> cs_unused, uint32_t spiClk):
-        CC1101(new Module(pins.cs, pins.gdo0, pins.rst, pins.gdo2, spi, SPISettings(spiClk, MSBFIRST, SPI_MODE0))),
-        _spi(&spi), _pins(pins), _cs_unused(cs_unused),
-        _rxBufferSize(1024), _rxBufferTriggerLevel(32) {
+/* CC1101 only keeps the Module pointer, _module is constructed right after */
+eCC1101::eCC1101(const struct s_eCC1101_pins& pins, SPIClass& spi, const int32_t *cs_unused, size_t cs_unused_count,
+                 uint32_t spiClk, size_t rxBufferSize, size_t rxBufferTriggerLevel, uint8_t spiBus):
+        CC1101(&_module),
+        _spi(&spi), _pins(pins), _cs_unused_count(cs_unused_count),
+#if ECC1101_SPI_IDF
+        _hal(spi, spiBus, pins.clk, pins.miso, pins.mosi, spiClk),
+#else
+        _hal(spi, SPISettings(spiClk, MSBFIRST, SPI_MODE0)),
+#endif
+        _module(&_hal, pins.cs, pins.gdo0, pins.rst, pins.gdo2),
+        _rxBufferSize(rxBufferSize), _rxBufferTriggerLevel(rxBufferTriggerLevel),
+        _regDirty(0), _regShadowValid(false),
+        _rxRing(), _rxStorage(NULL), _rxTrigger(0), _rxSpaceWanted(false), _rxStopping(false),
+        _rxPolicy(ECC1101_DROP_NEWEST), _rxBlockMs(0), _gapOpen(), _gapLapped(),
+        _gapHead(0), _gapTail(0), _sinks(), _sinkCount(0), _sinkTask(NULL), _rxRunning(false), _rxCapture(false), _rxCaptureFull(false),
+        _rxStopWaiter(NULL), _rxExitWaiter(NULL), _rxPoll(false), _rxLastIrqTime(0), _rxFastDrains(0), _busReady(false), _configured(false),
+        _beginState(RADIOLIB_ERR_UNKNOWN), _beginUs(0), _beginWaiter(NULL),
+        _rxOffset(0), _gate(), _gateOpen(false), _gatePostLeft(0), _gatePreHead(0), _gatePreLen(0),
+        _gateBurstHead(0), _gateBurstTail(0), _afcEnabled(false), _afcActive(false),
+        _afcPending(false), _afcEstimate(0), _afc(), _rxRetune(NULL), _rxRetuneWaiter(NULL),
+        _rxRetuneState(RADIOLIB_ERR_NONE), _fsCached(false) {
+
+    configASSERT(cs_unused_count <= ECC1101_MAX_CS_UNUSED);
+    for (size_t i = 0; i < cs_unused_count; i++)
+        _cs_unused[i] = cs_unused[i];
+
+    resetRxStats();
+    _rxData = xSemaphoreCreateBinaryStatic(&_rxDataBuffer);
+    _rxSpace = xSemaphoreCreateBinaryStatic(&_rxSpaceBuffer);
+    _sinkLock = xSemaphoreCreateMutexStatic(&_sinkLockBuffer);
+
+    _rx_task = ecrf_task_create_static(ECRF_TASK_RX, _rx_thread, (void *) this,
+                                       _rxTaskStack, &_rxTaskTcb);
+}
 
-    _rxStreamBuffer = xStreamBufferCreate(_rxBufferSize, _rxBufferTriggerLevel );
+/*
+ * Teardown: the RX task is asked to exit and parks itself once it is out
+ * of any SPI transaction, a bus lock is never deleted with it. Deleting a
+ * task that is not running is immediate, the static stack and TCB can be
+ * reused by the next radio built in the same slot; a task deleting itself
+ * would leave its TCB to the idle task for a while.
+ */
+eCC1101::~eCC1101() {
+    closeRawSession();
 
-    xTaskCreate(
-        _rx_thread,
-        "eCC1101 RX",
-        4096,
-        (void *) this,
-        tskRX_PRIORITY,
-        &_rx_task
-    );
+    _rxExitWaiter = xTaskGetCurrentTaskHandle();
+    xTaskNotify(_rx_task, EXIT_BIT, eSetBits);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    while (eTaskGetState(_rx_task) != eSuspended)
+        vTaskDelay(1);
+    vTaskDelete(_rx_task);
+    _rx_task = NULL;
+}
+
+void eCC1101::resetRxStats(void) {
+  _rxStats = {
+    .irqs = 0,
+    .drains = 0,
+    .bytes = 0,
+    .bursts = 0,
+    .overflows = 0,
+    .polls = 0,
+    .dropped = 0,
+    .latency_min_us = UINT32_MAX,
+    .latency_max_us = 0,
+    .latency_sum_us = 0,
+  };
 }
 
 void eCC1101::setPacketReceivedAction(void (*func)(void* pObj))
 {
-    setGdo0Action(func, this->mod->hal->GpioInterruptRising);
+    setGdo0Action(func, GPIO_INTR_POSEDGE);
 }
 
-void eCC1101::setGdo0Action(void (*func)(void* pObj), uint32_t dir) {
-  attachInterruptArg(this->mod->hal->pinToInterrupt(this->mod->getIrq()), func, this, dir);
+/*
+ * GDO0 goes straight through the ESP-IDF GPIO ISR service rather than
+ * attachInterruptArg() and the RadioLib HAL. The service is installed with
+ * ESP_INTR_FLAG_IRAM so that handlers keep running while the flash cache is
+ * disabled (NVS writes); handlers must be IRAM_ATTR and touch DRAM only.
+ */
+void eCC1101::setGdo0Action(void (*func)(void* pObj), gpio_int_type_t type) {
+  gpio_num_t pin = (gpio_num_t)this->mod->getIrq();
+
+  esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+  configASSERT((err == ESP_OK) || (err == ESP_ERR_INVALID_STATE));
+
+  gpio_set_intr_type(pin, type);
+  gpio_isr_handler_add(pin, func, this);
+  gpio_intr_enable(pin);
 }
 
+void eCC1101::releaseGdo0Action(void) {
+  gpio_num_t pin = (gpio_num_t)this->mod->getIrq();
+
+  gpio_intr_disable(pin);
+  gpio_isr_handler_remove(pin);
+}
+
+void IRAM_ATTR eCC1101::_rx_isr_cb(void *pObj) {
+  eCC1101 *instance = static_cast<eCC1101*>(pObj);
+  BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+  /* Serial is neither ISR-safe nor in IRAM, only the deferred log is */
+  instance->_rxIrqTime = esp_timer_get_time();
+  instance->_rxStats.irqs++;
+  ECRF_LOGD("[CC1101] GDO0 irq %lu", (unsigned long)instance->_rxStats.irqs);
+  xTaskNotifyFromISR(instance->_rx_task, RX_BIT | RAW_BIT, eSetBits, &xHigherPriorityTaskWoken);
+  portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+
+/*
+ * Deselect the other chips of the bus and start it, once per object: the
+ * bus is shared, it is never restarted while another radio may be using it.
+ */
+void eCC1101::prepareBus(void) {
+    if (_busReady)
+        return;
+
+    /* Unselect the others SPI Slaves */
+    for (size_t i = 0; i < _cs_unused_count; i++) {
+            pinMode(_cs_unused[i], OUTPUT);
+            digitalWrite(_cs_unused[i], HIGH);
+    }
+
+    /* no-op when another radio already started this bus, pins are the same */
+#if ECC1101_SPI_IDF
+    _hal.spiBegin();
+#else
+    _spi->begin(_pins.clk, _pins.miso, _pins.mosi, -1);
+#endif
+    ECRF_LOGD("[CC1101] SPI pins: clk: %d, miso: %d, mosi: %d, cs: %d", _pins.clk, _pins.miso,
+              _pins.mosi, _pins.cs);
+    _busReady = true;
+}
 
 int16_t eCC1101::begin(float freq, float br, float freqDev, float rxBw, int8_t pwr, uint8_t preambleLength){
-    char buf[128];
-    /* Unselect the others SPI Slaves */ 
-    for (auto it = _cs_unused.begin(); it != _cs_unused.end(); ++it) {
-            snprintf(buf, 128, "Unselect pin %d\n", *it);
-            Serial.print(buf);
-            pinMode(*it, OUTPUT);
-            digitalWrite(*it, HIGH);
+    prepareBus();
+    return _begin_chip(freq, br, freqDev, rxBw, pwr, preambleLength);
+}
+
+int16_t eCC1101::_begin_chip(float freq, float br, float freqDev, float rxBw, int8_t pwr, uint8_t preambleLength) {
+    int64_t start = esp_timer_get_time();
+
+    shadowInvalidate();
+    int16_t state = CC1101::begin(freq, br, freqDev, rxBw, pwr, preambleLength);
+    if (state == RADIOLIB_ERR_NONE)
+        SPIwriteRegister(RADIOLIB_CC1101_REG_ADDR, ECC1101_PROBE_MARK);
+    _configured = (state == RADIOLIB_ERR_NONE);
+    _beginUs = (uint32_t)(esp_timer_get_time() - start);
+    return state;
+}
+
+/*
+ * Fast path check: the chip answers with a CC1101 PARTNUM/VERSION and still
+ * holds the mark of our last begin(), which a power cycle clears. Only for
+ * the object that ran that begin(): RadioLib's module setup and cached
+ * settings live in the object, a fresh one always runs the full init.
+ */
+bool eCC1101::probe(void) {
+    if (!_configured)
+        return false;
+
+    prepareBus();
+    int16_t partnum = SPIgetRegValue(RADIOLIB_CC1101_REG_PARTNUM);
+    int16_t version = SPIgetRegValue(RADIOLIB_CC1101_REG_VERSION);
+    if ((partnum != RADIOLIB_CC1101_PARTNUM) ||
+        ((version != RADIOLIB_CC1101_VERSION_CURRENT) && (version != RADIOLIB_CC1101_VERSION_LEGACY) &&
+         (version != RADIOLIB_CC1101_VERSION_CLONE))) {
+        _configured = false;
+        return false;
     }
 
-    _spi->end();
+    if (SPIgetRegValue(RADIOLIB_CC1101_REG_ADDR) != ECC1101_PROBE_MARK) {
+        _configured = false;
+        return false;
+    }
 
-    /*Initialize the SPI pins for THIS device */ 
-    _spi->begin(_pins.clk, _pins.miso, _pins.mosi, _pins.cs);
-    snprintf(buf, 128, "SPI pins: clk: %d, miso: %d, mosi: %d, cs: %d\n", _pins.clk, _pins.miso, _pins.mosi, _pins.cs);
-    Serial.print(buf);
-    delay(150);
-    Serial.println("Module eCC1101 Initialized ");
+    return true;
+}
 
-    return CC1101::begin(freq, br, freqDev, rxBw, pwr, preambleLength);
+/*
+ * Run begin() with the default settings on the RX task, so that radios on
+ * different buses overlap their reset and calibration waits. prepareBus()
+ * must have been called from the requesting task. Not for two radios of a
+ * bus at once: RadioLib's reset() drives CS low outside any transaction.
+ */
+void eCC1101::beginAsync(TaskHandle_t waiter) {
+    _beginWaiter = waiter;
+    _beginState = RADIOLIB_ERR_UNKNOWN;
+    xTaskNotify(_rx_task, INIT_BIT, eSetBits);
 }
 
-BaseType_t eCC1101::scan(FrequencyRSSI *frequency_rssi, int rssi_threshold) {
-  static const uint32_t subghz_frequency_list[] = {
-      /* 300 - 348 */
-      300000000,
-      302757000,
-      303875000,
-      303900000,
-      304250000,
-      307000000,
-      307500000,
-      307800000,
-      309000000,
-      310000000,
-      312000000,
-      312100000,
-      312200000,
-      313000000,
-      313850000,
-      314000000,
-      314350000,
-      314980000,
-      315000000,
-      318000000,
-      330000000,
-      345000000,
-      348000000,
-      350000000,
-  
-      /* 387 - 464 */
-      387000000,
-      390000000,
-      418000000,
-      430000000,
-      430500000,
-      431000000,
-      431500000,
-      433075000, /* LPD433 first */
-      433220000,
-      433420000,
-      433657070,
-      433889000,
-      433920000, /* LPD433 mid */
-      434075000,
-      434176948,
-      434190000,
-      434390000,
-      434420000,
-      434620000,
-      434775000, /* LPD433 last channels */
-      438900000,
-      440175000,
-      464000000,
-      467750000,
-  
-      /* 779 - 928 */
-      779000000,
-      868350000,
-      868400000,
-      868800000,
-      868950000,
-      906400000,
-      915000000,
-      925000000,
-      928000000,
-  };
+bool eCC1101::beginAbandon(void) {
+    return __atomic_exchange_n(&_beginWaiter, (TaskHandle_t)NULL, __ATOMIC_ACQ_REL) == NULL;
+}
 
-  int rssi;
-  *frequency_rssi = {.frequency_coarse = 0,
-                     .rssi_coarse = -100,
-                     .frequency_fine = 0,
-                     .rssi_fine = -100};
+static const uint32_t subghz_frequency_list[] = {
+    /* 300 - 348 */
+    300000000,
+    302757000,
+    303875000,
+    303900000,
+    304250000,
+    307000000,
+    307500000,
+    307800000,
+    309000000,
+    310000000,
+    312000000,
+    312100000,
+    312200000,
+    313000000,
+    313850000,
+    314000000,
+    314350000,
+    314980000,
+    315000000,
+    318000000,
+    330000000,
+    345000000,
+    348000000,
+    350000000,
 
-  // First stage: coarse scan
+    /* 387 - 464 */
+    387000000,
+    390000000,
+    418000000,
+    430000000,
+    430500000,
+    431000000,
+    431500000,
+    433075000, /* LPD433 first */
+    433220000,
+    433420000,
+    433657070,
+    433889000,
+    433920000, /* LPD433 mid */
+    434075000,
+    434176948,
+    434190000,
+    434390000,
+    434420000,
+    434620000,
+    434775000, /* LPD433 last channels */
+    438900000,
+    440175000,
+    464000000,
+    467750000,
+
+    /* 779 - 928 */
+    779000000,
+    868350000,
+    868400000,
+    868800000,
+    868950000,
+    906400000,
+    915000000,
+    925000000,
+    928000000,
+};
+
+#define ECC1101_SCAN_CHANNEL_COUNT (sizeof(subghz_frequency_list) / sizeof(subghz_frequency_list[0]))
+
+size_t eCC1101::scanChannelCount(void) {
+  return ECC1101_SCAN_CHANNEL_COUNT;
+}
+
+uint32_t eCC1101::scanChannelFrequency(size_t channel) {
+  return (channel < ECC1101_SCAN_CHANNEL_COUNT) ? subghz_frequency_list[channel] : 0;
+}
+
+void eCC1101::sweep(int16_t *channel_rssi) {
+  /* the RadioLib setters below bypass the register shadow */
+  shadowInvalidate();
   setRxBandwidth(
       650); // 58, 68, 81, 102, 116, 135, 162, 203, 232, 270, 325, 406, 464,
   // 541, 650 and 812 kHz    (81kHz seems to work best for me)
-  size_t array_size =
-      sizeof(subghz_frequency_list) / sizeof(subghz_frequency_list[0]);
-  for (size_t i = 0; i < array_size; i++) {
+  for (size_t i = 0; i < ECC1101_SCAN_CHANNEL_COUNT; i++) {
     uint32_t frequency = subghz_frequency_list[i];
+    channel_rssi[i] = ECC1101_RSSI_NONE;
     if (frequency != 467750000 && frequency != 464000000 &&
         frequency != 390000000 && frequency != 312000000 &&
         frequency != 312100000 && frequency != 312200000 &&
@@ -140,12 +296,26 @@ BaseType_t eCC1101::scan(FrequencyRSSI *frequency_rssi, int rssi_threshold) {
       setFrequency((float)frequency / 1000000.0);
       receiveDirect();
       delay(2);
-      rssi = getRSSI();
+      channel_rssi[i] = getRSSI();
+    }
+  }
+}
 
-      if (frequency_rssi->rssi_coarse < rssi) {
-        frequency_rssi->rssi_coarse = rssi;
-        frequency_rssi->frequency_coarse = frequency;
-      }
+BaseType_t eCC1101::scan(FrequencyRSSI *frequency_rssi, int rssi_threshold) {
+  int16_t channel_rssi[ECC1101_SCAN_CHANNEL_COUNT];
+  int rssi;
+
+  *frequency_rssi = {.frequency_coarse = 0,
+                     .rssi_coarse = -100,
+                     .frequency_fine = 0,
+                     .rssi_fine = -100};
+
+  // First stage: coarse scan
+  sweep(channel_rssi);
+  for (size_t i = 0; i < ECC1101_SCAN_CHANNEL_COUNT; i++) {
+    if (frequency_rssi->rssi_coarse < channel_rssi[i]) {
+      frequency_rssi->rssi_coarse = channel_rssi[i];
+      frequency_rssi->frequency_coarse = subghz_frequency_list[i];
     }
   }
 
@@ -174,11 +344,7 @@ BaseType_t eCC1101::scan(FrequencyRSSI *frequency_rssi, int rssi_threshold) {
 uint8_t eCC1101::get_rxfifo_available(void) {
   uint8_t bytesInFIFO = SPIgetRegValue(RADIOLIB_CC1101_REG_RXBYTES, 6, 0);
 
-#if CC1101_DEBUG
-  char buf[64];
-  snprintf(buf, 64, "[CC1101] RXFIFO AVAILABLE: %d", bytesInFIFO);
-  Serial.println(F(buf));
-#endif
+  ECRF_LOGD("[CC1101] RXFIFO AVAILABLE: %d", bytesInFIFO);
 
   return bytesInFIFO;
 }
@@ -186,47 +352,153 @@ uint8_t eCC1101::get_rxfifo_available(void) {
 uint8_t eCC1101::get_radio_state(void) {
 
   int8_t radio_state = SPIgetRegValue(RADIOLIB_CC1101_REG_MARCSTATE, 4, 0);
-#if CC1101_DEBUG
-  char buf[64];
-  snprintf(buf, 64, "[CC1101] FSM: %#x", radio_state);
-  Serial.println(F(buf));
-#endif
+  ECRF_LOGD("[CC1101] FSM: %#x", radio_state);
 
   return radio_state;
 }
 
 int16_t eCC1101::setInfiniteLengthMode()
+{
+    _shadow_set_infinite_length();
+    return shadowCommit();
+}
+
+void eCC1101::_shadow_set_infinite_length(void)
 {
     // infinite packet mode
-    int16_t state = SPIsetRegValue(RADIOLIB_CC1101_REG_PKTCTRL0, RADIOLIB_CC1101_LENGTH_CONFIG_INFINITE, 1, 0);
-    RADIOLIB_ASSERT(state);
+    shadowSetRegValue(RADIOLIB_CC1101_REG_PKTCTRL0, RADIOLIB_CC1101_LENGTH_CONFIG_INFINITE, 1, 0);
     /* PKT MUST NOT BE 0 */
     size_t len = 255;
-    state = SPIsetRegValue(RADIOLIB_CC1101_REG_PKTLEN, len);
-    RADIOLIB_ASSERT(state);
+    shadowSetRegValue(RADIOLIB_CC1101_REG_PKTLEN, len);
     // no longer in a direct mode
     directModeEnabled = false;
     // update the cached values
     packetLength = len;
     packetLengthConfig = RADIOLIB_CC1101_LENGTH_CONFIG_INFINITE;
+}
 
-    return state;
+int16_t eCC1101::shadowLoad(void) {
+  SPIreadRegisterBurst(RADIOLIB_CC1101_REG_IOCFG2, ECC1101_REG_CONFIG_COUNT, _regShadow);
+  _regDirty = 0;
+  _regShadowValid = true;
+
+  return RADIOLIB_ERR_NONE;
 }
 
-BaseType_t eCC1101::set_rf(s_cc1101_rf_rx_settings *settings) {
-  setFrequency(settings->freq);
-  setBitRate(settings->br);
-  setFrequencyDeviation(settings->freqDev);
-  setRxBandwidth(settings->rxBw);
-  setOOK(settings->modulation == RADIOLIB_CC1101_MOD_FORMAT_ASK_OOK);
+int16_t eCC1101::shadowSetRegValue(uint8_t reg, uint8_t value, uint8_t msb, uint8_t lsb) {
+  if ((reg >= ECC1101_REG_CONFIG_COUNT) || (msb > 7) || (lsb > 7) || (lsb > msb)) {
+    return RADIOLIB_ERR_INVALID_BIT_RANGE;
+  }
 
-  return pdFALSE;
+  if (!_regShadowValid) {
+    shadowLoad();
+  }
+
+  /* same masking rule as SPIsetRegValue() */
+  uint8_t mask = ~((0b11111111 << (msb + 1)) | (0b11111111 >> (8 - lsb)));
+  uint8_t newValue = (_regShadow[reg] & ~mask) | (value & mask);
+  if (newValue != _regShadow[reg]) {
+    _regShadow[reg] = newValue;
+    _regDirty |= (uint64_t)1 << reg;
+  }
+
+  return RADIOLIB_ERR_NONE;
+}
+
+uint8_t eCC1101::shadowGetRegValue(uint8_t reg, uint8_t msb, uint8_t lsb) {
+  if (!_regShadowValid) {
+    shadowLoad();
+  }
+
+  uint8_t mask = ~((0b11111111 << (msb + 1)) | (0b11111111 >> (8 - lsb)));
+  return _regShadow[reg] & mask;
+}
+
+void eCC1101::_shadow_burst(uint8_t first, uint8_t last) {
+  SPIwriteRegisterBurst(first, &_regShadow[first], last - first + 1);
+}
+
+int16_t eCC1101::shadowCommit(void) {
+  if (_regDirty == 0) {
+    return RADIOLIB_ERR_NONE;
+  }
+
+  uint8_t first = __builtin_ctzll(_regDirty);
+  uint8_t last = 63 - __builtin_clzll(_regDirty);
+
+  /*
+   * Never write stale calibration results back: if the dirty range spans
+   * FSCAL3..FSCAL0, split it in two bursts around them.
+   */
+  if ((first < ECC1101_REG_FSCAL_FIRST) && (last > ECC1101_REG_FSCAL_LAST)) {
+    uint64_t low = _regDirty & (((uint64_t)1 << ECC1101_REG_FSCAL_FIRST) - 1);
+    uint64_t high = _regDirty & ~(((uint64_t)1 << (ECC1101_REG_FSCAL_LAST + 1)) - 1);
+    if (low) {
+      _shadow_burst(first, 63 - __builtin_clzll(low));
+    }
+    if (high) {
+      _shadow_burst(__builtin_ctzll(high), last);
+    }
+  } else {
+    _shadow_burst(first, last);
+  }
+  _regDirty = 0;
+
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t eCC1101::_shadow_set_rf(s_cc1101_rf_rx_settings *settings) {
+  if (!ECC1101_FREQ_IN_BAND(settings->freq)) {
+    return RADIOLIB_ERR_INVALID_FREQUENCY;
+  }
+  if ((settings->br < 0.025) || (settings->br > 600.0)) {
+    return RADIOLIB_ERR_INVALID_BIT_RATE;
+  }
+
+  /* lowest available deviation for OOK and digimodes, as CC1101 does */
+  float freqDev = MAX(settings->freqDev, 1.587);
+  if (freqDev > 380.859) {
+    return RADIOLIB_ERR_INVALID_FREQUENCY_DEVIATION;
+  }
+
+  uint32_t frf = ecc1101_freq_word(settings->freq);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_FREQ2, (frf >> 16) & 0xFF);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_FREQ1, (frf >> 8) & 0xFF);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_FREQ0, frf & 0xFF);
+
+  struct ecc1101_exp_mant drate = ecc1101_drate(settings->br);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MDMCFG4, drate.e, 3, 0);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MDMCFG3, drate.m);
+
+  shadowSetRegValue(RADIOLIB_CC1101_REG_DEVIATN, ecc1101_deviatn(freqDev));
+
+  /* nearest supported channel filter instead of failing on exact match */
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MDMCFG4, ecc1101_chanbw(settings->rxBw), 7, 4);
+
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MDMCFG2, settings->modulation, 6, 4);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_FREND0,
+                    settings->modulation == RADIOLIB_CC1101_MOD_FORMAT_ASK_OOK ? 1 : 0, 2, 0);
+
+  // update the cached values
+  frequency = settings->freq;
+  bitRate = settings->br;
+  modulation = settings->modulation;
+
+  return RADIOLIB_ERR_NONE;
+}
+
+int16_t eCC1101::set_rf(s_cc1101_rf_rx_settings *settings) {
+  int16_t state = _shadow_set_rf(settings);
+  RADIOLIB_ASSERT(state);
+
+  /* frequency registers must be written in IDLE; FS_AUTOCAL recalibrates on RX */
+  SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
+  return shadowCommit();
 }
 
 void eCC1101::_rx_cb()
 {
   const TickType_t x1000ms = pdMS_TO_TICKS(1000);
-  const TickType_t x100ms = pdMS_TO_TICKS(100);
   for(;;) {
     uint32_t ulNotifiedValue = 0;
     BaseType_t xResult;
@@ -235,24 +507,28 @@ void eCC1101::_rx_cb()
                               &ulNotifiedValue, /* Stores the notified value. */
                               x1000ms);
 
-#if CC1101_DEBUG
-    Serial.print(F("[CC1101] Thread Wakeup!\n"));
-#endif
+    ECRF_LOGD("[CC1101] Thread Wakeup!");
     if (xResult == pdPASS) {
       if ((ulNotifiedValue & RX_BIT) != 0) {
         if ((ulNotifiedValue & RAW_BIT) != 0) {
-            uint8_t bytesInFIFO = get_rxfifo_available();
-            SPIreadRegisterBurst(RADIOLIB_CC1101_REG_FIFO, bytesInFIFO, _rxFifo);
-            size_t bytesSent = xStreamBufferSend(_rxStreamBuffer,
-                          _rxFifo,
-                          bytesInFIFO,
-                          x100ms);
-#if CC1101_DEBUG
-            char buf[64];
-            snprintf(buf, sizeof(buf), "%d/%d\n", bytesSent, bytesInFIFO);
-            Serial.print(buf);
-#endif
-            configASSERT(bytesSent == bytesInFIFO);
+            int64_t irqTime = _rxIrqTime;
+            uint32_t latency = (uint32_t)(esp_timer_get_time() - irqTime);
+            _rxStats.latency_min_us = MIN(_rxStats.latency_min_us, latency);
+            _rxStats.latency_max_us = MAX(_rxStats.latency_max_us, latency);
+            _rxStats.latency_sum_us += latency;
+
+            _rx_drain(SPIgetRegValue(RADIOLIB_CC1101_REG_RXBYTES, 7, 0));
+
+            /* FIFO thresholds closer than the notification latency: poll */
+            if (_rxPoll && ((irqTime - _rxLastIrqTime) < ECC1101_POLL_ENTER_US)) {
+              if (++_rxFastDrains >= ECC1101_POLL_ENTER_DRAINS) {
+                _rxFastDrains = 0;
+                _rx_poll();
+              }
+            } else {
+              _rxFastDrains = 0;
+            }
+            _rxLastIrqTime = irqTime;
         }
         if ((ulNotifiedValue & PKT_BIT) != 0) {
         //    uint8_t lbuf[pktLen];
@@ -263,63 +539,854 @@ void eCC1101::_rx_cb()
         //    remaining -= len;
         }
       }
+      if ((ulNotifiedValue & RETUNE_BIT) != 0) {
+        _rx_retune(_rxRetune);
+        xTaskNotifyGive(_rxRetuneWaiter);
+      }
+      if ((ulNotifiedValue & STOP_BIT) != 0) {
+        /* a loss right before the stop still shows at the end of the stream */
+        _rx_gap_publish();
+        /* the session may go away now, acknowledge stopRawReceive() */
+        xTaskNotifyGive(_rxStopWaiter);
+      }
+      if ((ulNotifiedValue & EXIT_BIT) != 0) {
+        xTaskNotifyGive(_rxExitWaiter);
+        vTaskSuspend(NULL);
+      }
+      if ((ulNotifiedValue & INIT_BIT) != 0) {
+        _beginState = _begin_chip();
+        TaskHandle_t waiter = __atomic_exchange_n(&_beginWaiter, (TaskHandle_t)NULL, __ATOMIC_ACQ_REL);
+        if (waiter != NULL)
+          xTaskNotifyGive(waiter);
+      }
     } 
   }
 }
 
-int16_t eCC1101::startRawReceive(struct s_cc1101_rf_rx_settings *settings) {
-  setPromiscuousMode(true, false);
+/* one FIFO drain, rxBytes is the RXBYTES status register just read */
+size_t eCC1101::_rx_drain(uint8_t rxBytes) {
+  uint8_t bytesInFIFO = rxBytes & ECC1101_RXBYTES_NUM;
+
+  if ((rxBytes & ECC1101_RXBYTES_OVERFLOW) != 0) {
+    /* the chip stopped receiving, what is in the FIFO is not contiguous */
+    _rxStats.overflows++;
+    if (_rxRing.buf != NULL) {
+      _rx_gap(ECC1101_GAP_UNKNOWN);
+    }
+    SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
+    SPIsendCommand(RADIOLIB_CC1101_CMD_FLUSH_RX);
+    SPIsendCommand(RADIOLIB_CC1101_CMD_RX);
+    return 0;
+  }
+
+  _rxStats.drains++;
+  SPIreadRegisterBurst(RADIOLIB_CC1101_REG_FIFO, bytesInFIFO, _rxFifo);
+  if (_rxRing.buf != NULL) {
+    if (_gate.enabled) {
+      _rx_gate(bytesInFIFO);
+    } else {
+      _rx_forward(_rxFifo, bytesInFIFO);
+    }
+  }
+
+  return bytesInFIFO;
+}
+
+/*
+ * Busy-poll loop, entered from the RX task with the session running. Other
+ * requests end it and are re-posted for _rx_cb(), a stop leaves GDO0 to
+ * stopRawReceive(). Otherwise GDO0 is unmasked on the way out.
+ */
+void eCC1101::_rx_poll(void) {
+  gpio_num_t pin = (gpio_num_t)this->mod->getIrq();
+  int64_t lastChunk = esp_timer_get_time();
+
+  /* WOR sessions sleep between windows, nothing to poll */
+  if (!_rxRunning || _rxCaptureFull || (_gate.enabled && _gate.wor_ms)) {
+    return;
+  }
+
+  gpio_intr_disable(pin);
+  _rxStats.polls++;
+  for (;;) {
+    uint32_t pending = 0;
+    if (xTaskNotifyWait(0, ULONG_MAX, &pending, 0) == pdPASS) {
+      pending &= ~(RX_BIT | RAW_BIT);
+      if (pending != 0) {
+        xTaskNotify(_rx_task, pending, eSetBits);
+        /* GDO0 stays masked for a stop only, the session goes on otherwise */
+        if ((pending & (STOP_BIT | EXIT_BIT)) != 0) {
+          return;
+        }
+        break;
+      }
+    }
+
+    uint8_t rxBytes = SPIgetRegValue(RADIOLIB_CC1101_REG_RXBYTES, 7, 0);
+    int64_t now = esp_timer_get_time();
+    if (((rxBytes & ECC1101_RXBYTES_OVERFLOW) != 0) ||
+        ((rxBytes & ECC1101_RXBYTES_NUM) >= ECC1101_POLL_CHUNK)) {
+      _rx_drain(rxBytes);
+      lastChunk = now;
+      /* a full capture released GDO0 already */
+      if (_rxCaptureFull) {
+        return;
+      }
+    } else if ((now - lastChunk) > ECC1101_POLL_EXIT_US) {
+      break;
+    }
+    /* same priority RX tasks of the other radios */
+    taskYIELD();
+  }
+
+  /* GDO0 is a FIFO level: an edge missed while masked is replayed here */
+  gpio_intr_enable(pin);
+  if (SPIgetRegValue(RADIOLIB_CC1101_REG_RXBYTES, 6, 0) > 0) {
+    _rxIrqTime = esp_timer_get_time();
+    xTaskNotify(_rx_task, RX_BIT | RAW_BIT, eSetBits);
+  }
+}
+
+size_t eCC1101::_rx_forward(const uint8_t *data, size_t len) {
+  size_t bytesSent;
+
+  if (_rxCaptureFull || (len == 0)) {
+    return 0;
+  }
+
+  if (_rxCapture) {
+    bytesSent = ecrf_ring_write(&_rxRing, data, len, false);
+    /* capture buffer full: stop draining, keep what we have */
+    if ((bytesSent < len) || (ecrf_ring_free(&_rxRing) == 0)) {
+      _rxCaptureFull = true;
+      releaseGdo0Action();
+      xSemaphoreGive(_rxData);
+    }
+  } else {
+    bytesSent = _rx_push(data, len);
+  }
+  _rxStats.bytes += bytesSent;
+  _rxOffset += bytesSent;
+  ECRF_LOGD("[CC1101] forwarded %u/%u", (unsigned)bytesSent, (unsigned)len);
+  if (ecrf_ring_used(&_rxRing) >= _rxTrigger) {
+    xSemaphoreGive(_rxData);
+  }
+  if ((_sinkCount > 0) && (_sinkTask != NULL) && (bytesSent > 0)) {
+    xTaskNotifyGive(_sinkTask);
+  }
+
+  return bytesSent;
+}
+
+/* streaming sessions: apply the overflow policy, whatever is left is a gap */
+size_t eCC1101::_rx_push(const uint8_t *data, size_t len) {
+  size_t bytesSent = 0;
+
+  /* data may only follow a gap the consumer can be told about */
+  if (!_rx_gap_publish()) {
+    _rx_gap(len);
+    return 0;
+  }
+
+  if (_rxPolicy == ECC1101_DROP_OLDEST) {
+    /* the reader finds out how much it lost, see rawReceive() */
+    return ecrf_ring_write(&_rxRing, data, len, true);
+  }
+
+  bytesSent = ecrf_ring_write(&_rxRing, data, len, false);
+  if ((_rxPolicy == ECC1101_BLOCK) && (bytesSent < len)) {
+    TickType_t start = xTaskGetTickCount();
+    TickType_t timeout = pdMS_TO_TICKS(_rxBlockMs);
+
+    xSemaphoreGive(_rxData);
+    while (bytesSent < len) {
+      TickType_t elapsed = xTaskGetTickCount() - start;
+      if ((elapsed >= timeout) || _rxStopping) {
+        break;
+      }
+      /* armed before the last look at the ring, a read in between wakes us */
+      _rxSpaceWanted = true;
+      bytesSent += ecrf_ring_write(&_rxRing, data + bytesSent, len - bytesSent, false);
+      if (bytesSent < len) {
+        xSemaphoreTake(_rxSpace, timeout - elapsed);
+      }
+    }
+    _rxSpaceWanted = false;
+  }
+
+  if (bytesSent < len) {
+    _rx_gap(len - bytesSent);
+  }
+
+  return bytesSent;
+}
+
+/* open or grow the gap at the current end of the stream */
+void eCC1101::_rx_gap(uint32_t lost) {
+  if (lost != ECC1101_GAP_UNKNOWN) {
+    __atomic_fetch_add(&_rxStats.dropped, lost, __ATOMIC_RELAXED);
+  }
+
+  if ((_gapOpen.lost != 0) && (_gapOpen.offset == _rxRing.head)) {
+    bool unknown = (_gapOpen.lost == ECC1101_GAP_UNKNOWN) || (lost == ECC1101_GAP_UNKNOWN);
+    _gapOpen.lost = unknown ? ECC1101_GAP_UNKNOWN : _gapOpen.lost + lost;
+    return;
+  }
+
+  _rx_gap_publish();
+  _gapOpen.offset = _rxRing.head;
+  _gapOpen.lost = lost;
+}
+
+/* false while the marker ring is full, the open gap then has to stay open */
+bool eCC1101::_rx_gap_publish(void) {
+  if (_gapOpen.lost == 0) {
+    return true;
+  }
+
+  uint32_t head = _gapHead;
+  if ((head - _gapTail) >= ECC1101_GAPS) {
+    return false;
+  }
+
+  _gaps[head % ECC1101_GAPS] = _gapOpen;
+  __atomic_store_n(&_gapHead, head + 1, __ATOMIC_RELEASE);
+  _gapOpen.lost = 0;
+  return true;
+}
+
+bool eCC1101::_rx_gap_peek(struct s_eCC1101_gap *gap) {
+  if (_gapLapped.lost != 0) {
+    *gap = _gapLapped;
+    return true;
+  }
+
+  uint32_t tail = _gapTail;
+  if (tail == __atomic_load_n(&_gapHead, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+
+  *gap = _gaps[tail % ECC1101_GAPS];
+  return true;
+}
+
+void eCC1101::_rx_gap_consume(void) {
+  if (_gapLapped.lost != 0) {
+    _gapLapped.lost = 0;
+    return;
+  }
+
+  __atomic_store_n(&_gapTail, _gapTail + 1, __ATOMIC_RELEASE);
+}
+
+bool eCC1101::_gate_carrier(void) {
+  if (_pins.gdo2 != RADIOLIB_NC) {
+    return gpio_get_level((gpio_num_t)_pins.gdo2) != 0;
+  }
+
+  return SPIgetRegValue(RADIOLIB_CC1101_REG_PKTSTATUS, 6, 6) != 0;
+}
+
+/* RSSI status register to dBm, datasheet offset of 74 dB */
+int16_t eCC1101::_gate_rssi(void) {
+  int16_t raw = SPIgetRegValue(RADIOLIB_CC1101_REG_RSSI);
+
+  return ((raw >= 128) ? (raw - 256) : raw) / 2 - 74;
+}
+
+void eCC1101::_gate_pre_push(const uint8_t *data, size_t len) {
+  if (_gate.pre == 0) {
+    return;
+  }
+
+  for (size_t i = 0; i < len; i++) {
+    _gatePre[_gatePreHead] = data[i];
+    _gatePreHead = (_gatePreHead + 1) % _gate.pre;
+  }
+  _gatePreLen = MIN((size_t)_gate.pre, _gatePreLen + len);
+}
+
+/*
+ * Called on every drain of a gated session: silence goes to the pre padding
+ * ring, a carrier opens a burst (tag, then padding, then data) that stays
+ * open for post bytes after the carrier is lost.
+ */
+void eCC1101::_rx_gate(uint8_t len) {
+  bool carrier = _gate_carrier();
+
+  if (carrier && !_gateOpen) {
+    int32_t freqOffset = _afc_burst_open();
+    uint32_t head = _gateBurstHead;
+    if ((head - _gateBurstTail) < ECC1101_GATE_BURSTS) {
+      struct s_eCC1101_burst *burst = &_gateBursts[head % ECC1101_GATE_BURSTS];
+      burst->offset = _rxOffset;
+      burst->rssi = _gate_rssi();
+      burst->pre = _gatePreLen;
+      burst->freq_offset = freqOffset;
+      __atomic_store_n(&_gateBurstHead, head + 1, __ATOMIC_RELEASE);
+    }
+    _rxStats.bursts++;
+    _gateOpen = true;
+
+    /* oldest padding byte first */
+    size_t first = (_gatePreHead + _gate.pre - _gatePreLen) % MAX(_gate.pre, 1);
+    size_t chunk = MIN((size_t)_gatePreLen, (size_t)_gate.pre - first);
+    _rx_forward(&_gatePre[first], chunk);
+    _rx_forward(_gatePre, _gatePreLen - chunk);
+    _gatePreLen = 0;
+  }
+
+  if (carrier) {
+    _rx_forward(_rxFifo, len);
+    _gatePostLeft = _gate.post;
+    return;
+  }
+
+  if (_gateOpen) {
+    size_t tail = MIN((size_t)len, (size_t)_gatePostLeft);
+    _rx_forward(_rxFifo, tail);
+    _gatePostLeft -= tail;
+    if (_gatePostLeft > 0) {
+      return;
+    }
+
+    _gateOpen = false;
+    bool retune = _afc_burst_close();
+    if (_gate.wor_ms) {
+      /* the receiver stays on in infinite mode, put the chip back to WOR */
+      SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
+      if (retune) {
+        shadowCommit();
+      }
+      SPIsendCommand(RADIOLIB_CC1101_CMD_FLUSH_RX);
+      SPIsendCommand(RADIOLIB_CC1101_CMD_WOR);
+      return;
+    }
+    if (retune) {
+      /* a few samples of silence go by while the chip is in IDLE */
+      SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
+      shadowCommit();
+      SPIsendCommand(RADIOLIB_CC1101_CMD_RX);
+    }
+    _gate_pre_push(_rxFifo + tail, len - tail);
+    return;
+  }
+
+  _gate_pre_push(_rxFifo, len);
+}
+
+/*
+ * Runs on the RX task between two drains, so that no chunk straddles two
+ * configurations: what the FIFO holds was received before the retune and
+ * is forwarded first. Tracking restarts from 0 on the new carrier.
+ */
+void eCC1101::_rx_retune(struct s_eCC1101_retune *retune) {
+  int64_t start = esp_timer_get_time();
+
+  uint8_t rxBytes = SPIgetRegValue(RADIOLIB_CC1101_REG_RXBYTES, 7, 0);
+  if (rxBytes != 0) {
+    _rx_drain(rxBytes);
+  }
+  _gateOpen = false;
+  _gatePreLen = 0;
+
+  SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
+  SPIsendCommand(RADIOLIB_CC1101_CMD_FLUSH_RX);
+  _shadow_set_profile(retune->profile);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MDMCFG2, RADIOLIB_CC1101_SYNC_MODE_NONE, 2, 0);
+  _shadow_set_gate();
+  _shadow_set_tracking();
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MCSM0, (retune->cal != NULL) ?
+                    RADIOLIB_CC1101_FS_AUTOCAL_NEVER : RADIOLIB_CC1101_FS_AUTOCAL_IDLE_TO_RXTX, 5, 4);
+  shadowCommit();
+  _fsCached = (retune->cal != NULL);
+
+  _rxRetuneState = RADIOLIB_ERR_NONE;
+  if ((retune->cal != NULL) && retune->cal->valid) {
+    SPIwriteRegisterBurst(RADIOLIB_CC1101_REG_FSCAL3, retune->cal->regs, sizeof(retune->cal->regs));
+  } else if (retune->cal != NULL) {
+    /* first visit: calibrate by hand and keep the results */
+    SPIsendCommand(RADIOLIB_CC1101_CMD_CAL);
+    int64_t cal = esp_timer_get_time();
+    while (get_radio_state() != RADIOLIB_CC1101_MARCSTATE_IDLE) {
+      if ((esp_timer_get_time() - cal) > 2000) {
+        _rxRetuneState = RADIOLIB_ERR_SPI_CMD_TIMEOUT;
+        break;
+      }
+    }
+    SPIreadRegisterBurst(RADIOLIB_CC1101_REG_FSCAL3, sizeof(retune->cal->regs), retune->cal->regs);
+    retune->cal->valid = (_rxRetuneState == RADIOLIB_ERR_NONE);
+  }
+
+  retune->offset = _rxOffset;
+  SPIsendCommand(RADIOLIB_CC1101_CMD_RX);
+  retune->us = (uint32_t)(esp_timer_get_time() - start);
+  if (retune->rssi_us > 0) {
+    int64_t rx = esp_timer_get_time();
+    while ((esp_timer_get_time() - rx) < retune->rssi_us) {
+    }
+    retune->rssi = _gate_rssi();
+  }
+  if (_gate.enabled && _gate.wor_ms) {
+    SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
+    SPIsendCommand(RADIOLIB_CC1101_CMD_FLUSH_RX);
+    SPIsendCommand(RADIOLIB_CC1101_CMD_WOR);
+  }
+}
+
+/*
+ * The chip's own offset compensation (FOCCFG) locks on each burst within
+ * its FOC_LIMIT, FREQEST then holds what it found: read at the first drain
+ * with a carrier, folded into FSCTRL0 between bursts only. Frequency
+ * programming only changes in IDLE: the burst close updates the shadow,
+ * the gate commits it with the chip in IDLE.
+ */
+int32_t eCC1101::_afc_burst_open(void) {
+  if (!_afcActive) {
+    return ECC1101_FREQ_OFFSET_NONE;
+  }
+
+  _afcEstimate = (int8_t)SPIgetRegValue(RADIOLIB_CC1101_REG_FREQEST);
+  _afcPending = true;
+  return ecrf_afc_hz(ecrf_afc_offset(&_afc, _afcEstimate));
+}
+
+/* true when FSCTRL0 changed in the shadow, to be committed in IDLE */
+bool eCC1101::_afc_burst_close(void) {
+  if (!_afcPending) {
+    return false;
+  }
+
+  _afcPending = false;
+  int8_t correction = _afc.correction;
+  if (ecrf_afc_update(&_afc, _afcEstimate) == correction) {
+    return false;
+  }
+
+  shadowSetRegValue(RADIOLIB_CC1101_REG_FSCTRL0, (uint8_t)_afc.correction);
+  return true;
+}
+
+void eCC1101::_shadow_set_tracking(void) {
+  /* bursts come from the gate, and OOK has no carrier offset to estimate */
+  _afcActive = _afcEnabled && _gate.enabled && (modulation != RADIOLIB_CC1101_MOD_FORMAT_ASK_OOK);
+  _afcPending = false;
+  ecrf_afc_reset(&_afc, ECC1101_AFC_LIMIT, ECC1101_AFC_GAIN_SHIFT);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_FSCTRL0, 0);
+  if (_afcActive) {
+    shadowSetRegValue(RADIOLIB_CC1101_REG_FOCCFG, ECC1101_FOCCFG_TRACK);
+  }
+}
+
+void eCC1101::setGate(const struct s_cc1101_gate *gate) {
+  if (gate == NULL) {
+    _gate = {};
+    return;
+  }
+
+  _gate = *gate;
+  _gate.pre = _gate.wor_ms ? 0 : MIN(_gate.pre, (uint16_t)ECC1101_GATE_PRE_MAX);
+}
+
+int16_t eCC1101::addSink(struct s_eCC1101_sink *sink) {
+  int16_t state = RADIOLIB_ERR_NONE;
+
+  xSemaphoreTake(_sinkLock, portMAX_DELAY);
+  if (_sinkCount < ECC1101_MAX_SINKS) {
+    ecrf_ring_cursor_init(&_rxRing, &sink->cursor);
+    sink->delivered = 0;
+    sink->lost = 0;
+    sink->max_lag = 0;
+    sink->dropped = false;
+    _sinks[_sinkCount++] = sink;
+  } else {
+    state = RADIOLIB_ERR_MEMORY_ALLOCATION_FAILED;
+  }
+  xSemaphoreGive(_sinkLock);
+
+  return state;
+}
+
+void eCC1101::removeSink(struct s_eCC1101_sink *sink) {
+  xSemaphoreTake(_sinkLock, portMAX_DELAY);
+  for (size_t i = 0; i < _sinkCount; i++) {
+    if (_sinks[i] == sink) {
+      _sinks[i] = _sinks[--_sinkCount];
+      break;
+    }
+  }
+  xSemaphoreGive(_sinkLock);
+}
+
+uint32_t eCC1101::sinkLag(const struct s_eCC1101_sink *sink) {
+  if (_rxRing.buf == NULL) {
+    return 0;
+  }
+
+  return MIN(ecrf_ring_lag(&_rxRing, &sink->cursor), _rxRing.size);
+}
+
+/*
+ * One pass over the sinks, each gets at most a chunk: a sink with a lot to
+ * catch up on does not starve the others. Data is copied out of the ring
+ * before write() so that a lap during the call cannot tear it.
+ */
+size_t eCC1101::pumpSinks(void) {
+  uint8_t chunk[ECC1101_SINK_CHUNK];
+  size_t pumped = 0;
+
+  xSemaphoreTake(_sinkLock, portMAX_DELAY);
+  for (size_t i = 0; (i < _sinkCount) && (_rxRing.buf != NULL); i++) {
+    struct s_eCC1101_sink *sink = _sinks[i];
+    uint32_t lost;
+
+    if (sink->dropped) {
+      continue;
+    }
+
+    uint32_t lag = ecrf_ring_lag(&_rxRing, &sink->cursor);
+    sink->max_lag = MAX(sink->max_lag, MIN(lag, _rxRing.size));
+    if ((sink->drop_lag != 0) && (lag > sink->drop_lag)) {
+      sink->dropped = true;
+      continue;
+    }
+
+    size_t len = ecrf_ring_peek(&_rxRing, &sink->cursor, chunk, sizeof(chunk), &lost);
+    sink->lost += lost;
+    if (len == 0) {
+      continue;
+    }
+
+    size_t taken = sink->write(sink->ctx, chunk, len);
+    ecrf_ring_advance(&sink->cursor, taken);
+    sink->delivered += taken;
+    pumped += taken;
+  }
+  xSemaphoreGive(_sinkLock);
+
+  return pumped;
+}
+
+void eCC1101::setOverflowPolicy(enum ecc1101_overflow_policy policy, uint16_t block_ms) {
+  _rxPolicy = policy;
+  _rxBlockMs = block_ms;
+}
+
+bool eCC1101::rawBurst(struct s_eCC1101_burst *burst, bool consume) {
+  uint32_t tail = _gateBurstTail;
+
+  if (tail == __atomic_load_n(&_gateBurstHead, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+
+  *burst = _gateBursts[tail % ECC1101_GATE_BURSTS];
+  if (consume) {
+    _gateBurstTail = tail + 1;
+  }
+  return true;
+}
+
+void eCC1101::_shadow_set_gate(void) {
+  if (!_gate.enabled) {
+    shadowSetRegValue(RADIOLIB_CC1101_REG_MCSM2, ECC1101_MCSM2_DEFAULT);
+    return;
+  }
+
+  shadowSetRegValue(RADIOLIB_CC1101_REG_AGCCTRL1,
+                    ((_gate.cs_rel_thr & 0x03) << 4) | ((uint8_t)_gate.cs_abs_thr & 0x0F), 5, 0);
+  if (_gate.wor_ms == 0) {
+    shadowSetRegValue(RADIOLIB_CC1101_REG_MCSM2, ECC1101_MCSM2_DEFAULT);
+    return;
+  }
+
+  uint32_t event0 = MIN((uint32_t)(_gate.wor_ms * ECC1101_WOR_EVENT0_PER_MS), (uint32_t)0xFFFF);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_WOREVT1, event0 >> 8);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_WOREVT0, event0 & 0xFF);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_WORCTRL, ECC1101_WORCTRL_RC_CAL);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MCSM2, ECC1101_MCSM2_RX_TIME_RSSI);
+  /* only demodulate above the carrier sense threshold */
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MDMCFG2, RADIOLIB_CC1101_SYNC_MODE_NONE_THR, 2, 0);
+}
+
+void eCC1101::_shadow_set_profile(const struct s_cc1101_rf_profile *profile) {
+  for (uint8_t i = 0; i < ECC1101_PROFILE_REG_COUNT; i++) {
+    shadowSetRegValue(ECC1101_PROFILE_REG_FIRST + i, profile->regs[i]);
+  }
+
+  // update the cached values
+  frequency = ecc1101_profile_freq_khz(profile) / 1000.0;
+  bitRate = ecc1101_profile_bitrate(profile) / 1000.0;
+  modulation = profile->regs[ECC1101_PROFILE_MDMCFG2] & 0x70;
+}
+
+int16_t eCC1101::applyProfile(const struct s_cc1101_rf_profile *profile, bool calibrate) {
+  _shadow_set_profile(profile);
+
+  SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
+  int16_t state = shadowCommit();
+  RADIOLIB_ASSERT(state);
+
+  if (calibrate) {
+    /* manual calibration takes ~720 us, wait for the FSM to settle in IDLE */
+    SPIsendCommand(RADIOLIB_CC1101_CMD_CAL);
+    unsigned long start = micros();
+    while (get_radio_state() != RADIOLIB_CC1101_MARCSTATE_IDLE) {
+      if ((micros() - start) > 2000) {
+        return RADIOLIB_ERR_SPI_CMD_TIMEOUT;
+      }
+    }
+  }
+
+  return RADIOLIB_ERR_NONE;
+}
+
+void eCC1101::getProfile(struct s_cc1101_rf_profile *profile) {
+  for (uint8_t i = 0; i < ECC1101_PROFILE_REG_COUNT; i++) {
+    profile->regs[i] = shadowGetRegValue(ECC1101_PROFILE_REG_FIRST + i);
+  }
+}
+
+int16_t eCC1101::_open_raw_session(size_t bufferSize, size_t triggerLevel, bool capture) {
+  closeRawSession();
+
+  bufferSize = bufferSize ? bufferSize : _rxBufferSize;
+  triggerLevel = triggerLevel ? triggerLevel : _rxBufferTriggerLevel;
+  triggerLevel = MIN(triggerLevel, bufferSize);
+
+  /* stream offsets wrap at 4 GiB, long streams need a power of two */
+  if (!capture) {
+    bufferSize = ecrf_ring_floor_pow2(bufferSize);
+  }
+  _rxStorage = (uint8_t *)ecrf_arena_alloc(bufferSize);
+  if (_rxStorage == NULL) {
+    return RADIOLIB_ERR_MEMORY_ALLOCATION_FAILED;
+  }
+
+  _rxCapture = capture;
+  _rxCaptureFull = false;
+  _rxOffset = 0;
+  _gateOpen = false;
+  _gatePreHead = 0;
+  _gatePreLen = 0;
+  _gateBurstHead = 0;
+  _gateBurstTail = 0;
+  _gapOpen = {};
+  _gapLapped = {};
+  _gapHead = 0;
+  _gapTail = 0;
+  _rxTrigger = triggerLevel;
+  xSemaphoreTake(_rxData, 0);
+  xSemaphoreTake(_rxSpace, 0);
+  /* the RX task looks at buf, set it last */
+  ecrf_ring_init(&_rxRing, _rxStorage, bufferSize);
+
+  xSemaphoreTake(_sinkLock, portMAX_DELAY);
+  for (size_t i = 0; i < _sinkCount; i++) {
+    ecrf_ring_cursor_init(&_rxRing, &_sinks[i]->cursor);
+  }
+  xSemaphoreGive(_sinkLock);
+
+  return RADIOLIB_ERR_NONE;
+}
+
+void eCC1101::closeRawSession(void) {
+  if (_rxRing.buf == NULL) {
+    return;
+  }
+
+  if (_rxRunning) {
+    stopRawReceive();
+  }
+  /* a pump in progress is still copying out of the storage */
+  xSemaphoreTake(_sinkLock, portMAX_DELAY);
+  _rxRing.buf = NULL;
+  xSemaphoreGive(_sinkLock);
+  ecrf_arena_free(_rxStorage);
+  _rxStorage = NULL;
+}
+
+size_t eCC1101::rawAvailable(void) {
+  if (_rxRing.buf == NULL) {
+    return 0;
+  }
+
+  return ecrf_ring_used(&_rxRing);
+}
+
+int16_t eCC1101::startRawReceive(struct s_cc1101_rf_rx_settings *settings,
+                                 size_t bufferSize, size_t triggerLevel) {
+  int16_t state = _open_raw_session(bufferSize, triggerLevel, false);
+  RADIOLIB_ASSERT(state);
+
+  state = _shadow_set_rf(settings);
+  RADIOLIB_ASSERT(state);
+
+  return _start_raw_receive();
+}
+
+int16_t eCC1101::startRawReceive(const struct s_cc1101_rf_profile *profile,
+                                 size_t bufferSize, size_t triggerLevel) {
+  int16_t state = _open_raw_session(bufferSize, triggerLevel, false);
+  RADIOLIB_ASSERT(state);
+
+  /* FS_AUTOCAL calibrates on IDLE -> RX, no manual calibration needed */
+  _shadow_set_profile(profile);
+
+  return _start_raw_receive();
+}
+
+int16_t eCC1101::startRawCapture(const struct s_cc1101_rf_profile *profile, size_t len) {
+  /* nobody reads while capturing: wake up only once the buffer is full */
+  int16_t state = _open_raw_session(len, len, true);
+  RADIOLIB_ASSERT(state);
+
+  _shadow_set_profile(profile);
+
+  return _start_raw_receive();
+}
+
+int16_t eCC1101::_start_raw_receive(void) {
   setPacketReceivedAction(eCC1101::_rx_isr_cb);
-  SPIsetRegValue(RADIOLIB_CC1101_REG_PKTCTRL1, RADIOLIB_CC1101_APPEND_STATUS_OFF, 3, 3);
-  set_rf(settings);
-  disableAddressFiltering();
-  SPIsetRegValue(RADIOLIB_CC1101_REG_MCSM1, RADIOLIB_CC1101_RXOFF_RX, 3, 2);
-  setInfiniteLengthMode();
+
+  /* promiscuous mode: no sync word, no CRC */
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MDMCFG2, RADIOLIB_CC1101_SYNC_MODE_NONE, 2, 0);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_PKTCTRL0, RADIOLIB_CC1101_CRC_OFF, 2, 2);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_PKTCTRL1, RADIOLIB_CC1101_APPEND_STATUS_OFF, 3, 3);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_PKTCTRL1, RADIOLIB_CC1101_ADR_CHK_NONE, 1, 0);
+  shadowSetRegValue(RADIOLIB_CC1101_REG_MCSM1, RADIOLIB_CC1101_RXOFF_RX, 3, 2);
+  _shadow_set_infinite_length();
+  _shadow_set_gate();
+  _shadow_set_tracking();
+
+  SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
+  shadowCommit();
+  promiscuous = true;
 
   startReceive();
+  if (_gate.enabled && (_pins.gdo2 != RADIOLIB_NC)) {
+    pinMode(_pins.gdo2, INPUT);
+    SPIsetRegValue(RADIOLIB_CC1101_REG_IOCFG2, ECC1101_GDO_CARRIER_SENSE);
+  }
+  if (_gate.enabled && _gate.wor_ms) {
+    SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
+    SPIsendCommand(RADIOLIB_CC1101_CMD_FLUSH_RX);
+    SPIsendCommand(RADIOLIB_CC1101_CMD_WOR);
+  }
+  /* startReceive() remaps GDO0 behind the shadow, resync it once */
+  shadowLoad();
+  _rxRunning = true;
 
   return 0;
 }
 
-int16_t eCC1101::rawReceive(uint8_t *data, size_t len, TickType_t xTicksToWait) {
-    ssize_t remaining = len;
+int16_t eCC1101::rawReceive(uint8_t *data, size_t len, TickType_t xTicksToWait,
+                           struct s_eCC1101_gap *gap) {
+    if (_rxRing.buf == NULL) {
+        return 0;
+    }
+
+    size_t received = 0;
+    bool gapSeen = false;
     TickType_t startTime = xTaskGetTickCount();
 
-#if CC1101_DEBUG
-    char buf[64];
-    snprintf(buf, sizeof(buf), "RX: %u\n", len);
-    Serial.print(buf);
-#endif
+    ECRF_LOGD("[CC1101] RX: %u", (unsigned)len);
+    if (gap != NULL) {
+        gap->lost = 0;
+    }
 
-    while (remaining > 0) {
-        size_t received = xStreamBufferReceive( _rxStreamBuffer,
-                             data,
-                             remaining,
-                             xTicksToWait);
-#if CC1101_DEBUG
-    char buf[64];
-    snprintf(buf, sizeof(buf), "RX: %u %u %u\n", len, received, remaining);
-    Serial.print(buf);
-#endif
+    while (received < len) {
+        struct s_eCC1101_gap next;
+        size_t limit = len - received;
 
-        TickType_t endTime = xTaskGetTickCount();
+        if (_rx_gap_peek(&next)) {
+            uint32_t offset = _rxRing.tail;
+            if ((_gapLapped.lost != 0) || ((int32_t)(next.offset - offset) <= 0)) {
+                /* at the read position: report it first, one gap per call */
+                if ((received > 0) || gapSeen) {
+                    break;
+                }
+                _rx_gap_consume();
+                gapSeen = true;
+                if (gap != NULL) {
+                    *gap = next;
+                }
+                continue;
+            }
+            limit = MIN(limit, (size_t)(next.offset - offset));
+        }
 
-        if (received < 0)
-            break;
-        data += received;
-        remaining -= received;
-        if ((endTime - startTime) > xTicksToWait) {
+        uint32_t lost;
+        size_t n = ecrf_ring_read(&_rxRing, data + received, limit, &lost);
+        if (lost != 0) {
+            _gapLapped.offset = _rxRing.tail - lost;
+            _gapLapped.lost = lost;
+            __atomic_fetch_add(&_rxStats.dropped, lost, __ATOMIC_RELAXED);
+            continue;
+        }
+        received += n;
+
+        if (_rxSpaceWanted && (n > 0)) {
+            xSemaphoreGive(_rxSpace);
+        }
+
+        TickType_t elapsed = xTaskGetTickCount() - startTime;
+        if ((n == 0) && ((elapsed >= xTicksToWait) ||
+                         (xSemaphoreTake(_rxData, xTicksToWait - elapsed) != pdTRUE))) {
             break;
         }
     }
+    ECRF_LOGD("[CC1101] RX: %u %u", (unsigned)len, (unsigned)received);
 
-    return (len - remaining);
+    return received;
+}
+
+int16_t eCC1101::retuneRawReceive(struct s_eCC1101_retune *retune) {
+  /* captures stop on their own, there is nothing to retune */
+  if (!_rxRunning || _rxCapture) {
+    return RADIOLIB_ERR_UNKNOWN;
+  }
+
+  _rxRetune = retune;
+  _rxRetuneWaiter = xTaskGetCurrentTaskHandle();
+  xTaskNotify(_rx_task, RETUNE_BIT, eSetBits);
+  /*
+   * No timeout: the RX task always services the bit, and a caller gone
+   * before it did would leave it writing to a dead retune and notifying a
+   * later wait.
+   */
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  _rxRetune = NULL;
+
+  return _rxRetuneState;
 }
 
 int16_t eCC1101::stopRawReceive() {
-  clearPacketReceivedAction();
+  releaseGdo0Action();
+
+  /*
+   * wait for the RX task to be done with the current FIFO chunk, a block
+   * wait for room in the ring ends now: nobody reads any more
+   */
+  _rxStopping = true;
+  xSemaphoreGive(_rxSpace);
+  _rxStopWaiter = xTaskGetCurrentTaskHandle();
+  xTaskNotify(_rx_task, STOP_BIT, eSetBits);
+  ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  xSemaphoreTake(_rxSpace, 0);
+  _rxStopping = false;
+  _rxRunning = false;
+
+  /* also leaves WOR */
+  SPIsendCommand(RADIOLIB_CC1101_CMD_IDLE);
   SPIsendCommand(RADIOLIB_CC1101_CMD_FLUSH_RX);
+  if (_fsCached) {
+    /* the next sessions calibrate on their own again */
+    shadowSetRegValue(RADIOLIB_CC1101_REG_MCSM0, RADIOLIB_CC1101_FS_AUTOCAL_IDLE_TO_RXTX, 5, 4);
+    shadowCommit();
+    _fsCached = false;
+  }
   setPromiscuousMode(false, false);
+  shadowInvalidate();
   return 0;
 }
 
@@ -1,17 +1,53 @@
 #ifndef _RADIOLIB_ECC1101_H
+#define _RADIOLIB_ECC1101_H
 
 #include <RadioLib.h>
 //#include <CC1101.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+#include "eCC1101_regs.h"
+#include "eCC1101_profile.h"
+#include <ecrf_tasks.h>
+#include <ecrf_ring.h>
+#include <ecrf_afc.h>
+
+/*
+ * SPI backend: Arduino SPIClass (default) or the ESP-IDF spi_master driver
+ * with DMA bursts, -DECC1101_SPI_IDF=1.
+ */
+#ifndef ECC1101_SPI_IDF
+#define ECC1101_SPI_IDF 0
+#endif
+
+#if ECC1101_SPI_IDF
+#include "eCC1101_idf_hal.h"
+#define ECC1101_SPI_BACKEND "spi_master"
+#else
+#define ECC1101_SPI_BACKEND "SPIClass"
+#endif
 
 #define RX_BIT  BIT(0)
 #define TX_BIT  BIT(1)
+#define STOP_BIT BIT(2)
+#define INIT_BIT BIT(3)
+#define RETUNE_BIT BIT(4)
+#define EXIT_BIT BIT(5)
 #define PKT_BIT BIT(6)
 #define RAW_BIT BIT(7)
 
-#define tskRX_PRIORITY (configMAX_PRIORITIES - 10)
-
 #define DEFAULT_CC1101_SPI SPIClass(HSPI)
 
+/*
+ * Written to ADDR by begin(): address filtering is never enabled, and the
+ * chip comes out of a power cycle with ADDR at 0, see probe()
+ */
+#define ECC1101_PROBE_MARK 0xEC
+
+/* chip selects of the other devices on the bus, deselected by begin() */
+#ifndef ECC1101_MAX_CS_UNUSED
+#define ECC1101_MAX_CS_UNUSED 4
+#endif
+
 typedef struct {
   uint32_t frequency_coarse;
   int rssi_coarse;
@@ -19,6 +55,46 @@ typedef struct {
   int rssi_fine;
 } FrequencyRSSI;
 
+/*
+ * Busy-poll RX: when GDO0 interrupts come closer than ECC1101_POLL_ENTER_US
+ * for ECC1101_POLL_ENTER_DRAINS drains in a row, the RX task masks GDO0 and
+ * polls RXBYTES, draining ECC1101_POLL_CHUNK bytes at a time. It goes back
+ * to interrupts once a chunk takes longer than ECC1101_POLL_EXIT_US.
+ * The RX core is kept busy meanwhile, lower priority tasks there starve.
+ */
+#ifndef ECC1101_POLL_ENTER_US
+#define ECC1101_POLL_ENTER_US 2000
+#endif
+
+#ifndef ECC1101_POLL_ENTER_DRAINS
+#define ECC1101_POLL_ENTER_DRAINS 4
+#endif
+
+#ifndef ECC1101_POLL_EXIT_US
+#define ECC1101_POLL_EXIT_US 4000
+#endif
+
+#ifndef ECC1101_POLL_CHUNK
+#define ECC1101_POLL_CHUNK 32
+#endif
+
+/* sweep() result for channels the scan table skips */
+#define ECC1101_RSSI_NONE INT16_MIN
+
+/* RX path counters, latency is measured from GDO0 IRQ to FIFO drain */
+struct s_eCC1101_rx_stats {
+  uint32_t irqs;
+  uint32_t drains;
+  uint32_t bytes;
+  uint32_t bursts;
+  uint32_t overflows; /* FIFO overruns, data lost on the chip */
+  uint32_t polls;     /* switches to busy-poll mode */
+  uint32_t dropped;   /* bytes the consumer was too slow for */
+  uint32_t latency_min_us;
+  uint32_t latency_max_us;
+  uint64_t latency_sum_us;
+};
+
 struct s_cc1101_rf_rx_settings {
     float freq;
     float br;
@@ -27,6 +103,129 @@ struct s_cc1101_rf_rx_settings {
     uint8_t modulation;
 };
 
+/*
+ * Gated capture: FIFO data is only forwarded while the chip senses a
+ * carrier (AGCCTRL1 thresholds), plus pre/post padding. The carrier is
+ * read from GDO2 when it is wired, from PKTSTATUS otherwise, once per FIFO
+ * drain: padding and burst edges have the FIFO threshold granularity.
+ * With wor_ms the chip sleeps between RX windows and only streams while a
+ * carrier is present, pre padding is then not available.
+ */
+#ifndef ECC1101_GATE_PRE_MAX
+#define ECC1101_GATE_PRE_MAX 256
+#endif
+
+#ifndef ECC1101_GATE_BURSTS
+#define ECC1101_GATE_BURSTS 16
+#endif
+
+struct s_cc1101_gate {
+  bool enabled;
+  int8_t cs_abs_thr;  /* CARRIER_SENSE_ABS_THR, -7..7 dB from MAGN_TARGET, -8 off */
+  uint8_t cs_rel_thr; /* CARRIER_SENSE_REL_THR, 0 off, 1 +6 dB, 2 +10 dB, 3 +14 dB */
+  uint16_t pre;       /* bytes kept from before the carrier */
+  uint16_t post;      /* bytes still forwarded once the carrier is gone */
+  uint16_t wor_ms;    /* wake-on-radio period, 0 keeps the receiver on */
+};
+
+/*
+ * Frequency tracking of gated sessions (FSK): each burst's FREQEST is read
+ * when the burst opens and folded into FSCTRL0 once it closes, so the next
+ * burst starts centered even through a narrow rxBw. The correction starts
+ * from 0 with each session, within ECC1101_AFC_LIMIT steps of 1587 Hz.
+ */
+#ifndef ECC1101_AFC_LIMIT
+#define ECC1101_AFC_LIMIT 64
+#endif
+
+#ifndef ECC1101_AFC_GAIN_SHIFT
+#define ECC1101_AFC_GAIN_SHIFT 1
+#endif
+
+/* s_eCC1101_burst freq_offset of an untracked session */
+#define ECC1101_FREQ_OFFSET_NONE INT32_MIN
+
+/* one tag per burst, keyed by its stream offset (first pre padding byte) */
+struct s_eCC1101_burst {
+  uint32_t offset;
+  int16_t rssi;
+  uint16_t pre;
+  int32_t freq_offset; /* Hz from the profile's carrier, when tracking */
+};
+
+/*
+ * Fast retuning (datasheet "Frequency Hopping and Multi-Channel Systems",
+ * option 2): a configuration is calibrated once and its FSCAL3..FSCAL1
+ * results kept, later retunes write them back with FS_AUTOCAL off instead of
+ * spending ~720 us in the calibration. Results drift with temperature, the
+ * owner clears valid from time to time.
+ */
+struct s_cc1101_fscal {
+  bool valid;
+  uint8_t regs[3]; /* FSCAL3, FSCAL2, FSCAL1 */
+};
+
+/* retuneRawReceive() request, then its results */
+struct s_eCC1101_retune {
+  const struct s_cc1101_rf_profile *profile;
+  struct s_cc1101_fscal *cal; /* NULL: FS_AUTOCAL calibrates on every retune */
+  uint16_t rssi_us;           /* > 0: RSSI sampled after that long in RX */
+  uint32_t offset;            /* stream offset of the first byte of the new configuration */
+  int16_t rssi;
+  uint32_t us;                /* time the radio was not receiving */
+};
+
+/*
+ * What a raw session does when the consumer falls behind: drop the chunk
+ * being drained, overwrite the oldest unread data, or wait up to block_ms
+ * for room and then drop. Every loss leaves a gap marker at its stream
+ * offset, reported by rawReceive() before the data that follows it.
+ */
+enum ecc1101_overflow_policy {
+  ECC1101_DROP_NEWEST,
+  ECC1101_DROP_OLDEST,
+  ECC1101_BLOCK,
+};
+
+/* gap of unknown size: the chip FIFO overflowed */
+#define ECC1101_GAP_UNKNOWN UINT32_MAX
+#define ECC1101_GAPS 16
+
+struct s_eCC1101_gap {
+  uint32_t offset;
+  uint32_t lost;
+};
+
+/*
+ * Push consumers of a raw session, fed from the session buffer by
+ * pumpSinks(), each one from its own cursor. write() runs in the pumping
+ * task and must not block: it takes what it can and returns that count,
+ * the rest is offered again later. A sink never holds back the RX task nor
+ * the other sinks; when it falls a whole buffer behind it loses data, or is
+ * dropped once drop_lag bytes behind.
+ */
+#ifndef ECC1101_MAX_SINKS
+#define ECC1101_MAX_SINKS 4
+#endif
+
+/* bytes offered to a sink per pass, on the pumping task's stack */
+#ifndef ECC1101_SINK_CHUNK
+#define ECC1101_SINK_CHUNK 128
+#endif
+
+struct s_eCC1101_sink {
+  const char *name;
+  size_t (*write)(void *ctx, const uint8_t *data, size_t len);
+  void *ctx;
+  uint32_t drop_lag; /* 0: never dropped */
+  /* maintained by pumpSinks() */
+  struct s_ecrf_ring_cursor cursor;
+  uint32_t delivered;
+  uint32_t lost;
+  uint32_t max_lag;
+  bool dropped;
+};
+
 class eCC1101: public CC1101 {
 public:
   struct s_eCC1101_pins {
@@ -39,7 +238,10 @@ public:
     uint32_t gdo2;
   };
 
-  eCC1101(struct s_eCC1101_pins& pins, SPIClass& spi, const std::vector<int32_t> cs_unused = std::vector<int32_t>(), uint32_t spiClk = 1000000);
+  eCC1101(const struct s_eCC1101_pins& pins, SPIClass& spi, const int32_t *cs_unused = NULL, size_t cs_unused_count = 0,
+          uint32_t spiClk = 1000000, size_t rxBufferSize = 1024, size_t rxBufferTriggerLevel = 32,
+          uint8_t spiBus = HSPI);
+  ~eCC1101();
   int16_t begin(
     float freq = RADIOLIB_CC1101_DEFAULT_FREQ,
     float br = RADIOLIB_CC1101_DEFAULT_BR,
@@ -48,19 +250,128 @@ public:
     int8_t pwr = RADIOLIB_CC1101_DEFAULT_POWER,
     uint8_t preambleLength = RADIOLIB_CC1101_DEFAULT_PREAMBLELEN);
 
+  /*
+   * Bring-up: begin() prepares the bus then runs RadioLib's full init.
+   * probe() tells whether this object can skip it, beginAsync() runs the chip
+   * part on the RX task and notifies the waiter (ulTaskNotifyTake) when done.
+   * A waiter giving up calls beginAbandon(): true when the RX task took the
+   * request anyway, its notification is then sent or on the way.
+   */
+  void prepareBus(void);
+  bool probe(void);
+  void beginAsync(TaskHandle_t waiter);
+  bool beginAbandon(void);
+  int16_t beginState(void) {
+    return _beginState;
+  }
+  uint32_t beginDuration(void) {
+    return _beginUs;
+  }
+
   uint8_t get_rxfifo_available(void);
   uint8_t get_radio_state(void);
   int16_t setInfiniteLengthMode(void);
-  BaseType_t set_rf(s_cc1101_rf_rx_settings *settings);
+  int16_t set_rf(s_cc1101_rf_rx_settings *settings);
   BaseType_t scan(FrequencyRSSI *frequency_rssi, int rssi_threshold = -75);
-  int16_t startRawReceive(struct s_cc1101_rf_rx_settings *settings);
+  /*
+   * Coarse pass of scan() on its own: one RSSI reading per entry of the scan
+   * table, channel_rssi must hold scanChannelCount() entries.
+   */
+  void sweep(int16_t *channel_rssi);
+  static size_t scanChannelCount(void);
+  static uint32_t scanChannelFrequency(size_t channel);
+  /*
+   * Raw RX sessions: the stream buffer is carved from the capture arena with
+   * the requested size and trigger level (0 selects the board defaults), and
+   * given back by closeRawSession(). stopRawReceive() only stops the radio,
+   * data already buffered can still be read.
+   */
+  int16_t startRawReceive(struct s_cc1101_rf_rx_settings *settings,
+                          size_t bufferSize = 0, size_t triggerLevel = 0);
+  int16_t startRawReceive(const struct s_cc1101_rf_profile *profile,
+                          size_t bufferSize = 0, size_t triggerLevel = 0);
+  /* bounded capture: fill len bytes of RAM at FIFO speed, then stop draining */
+  int16_t startRawCapture(const struct s_cc1101_rf_profile *profile, size_t len);
+  bool rawCaptureFull(void) {
+    return _rxCaptureFull;
+  }
+  size_t rawAvailable(void);
+  void closeRawSession(void);
+  /* gate of the next session, NULL streams everything */
+  void setGate(const struct s_cc1101_gate *gate);
+  /* overflow policy of the next streaming session, captures just stop */
+  void setOverflowPolicy(enum ecc1101_overflow_policy policy, uint16_t block_ms = 0);
+  bool rawBurst(struct s_eCC1101_burst *burst, bool consume = true);
+  int16_t applyProfile(const struct s_cc1101_rf_profile *profile, bool calibrate = true);
+  void getProfile(struct s_cc1101_rf_profile *profile);
   int16_t stopRawReceive(void);
-  int16_t rawReceive(uint8_t *data, size_t len, TickType_t xTicksToWait = pdMS_TO_TICKS(5000));
+  /*
+   * Switch a running streaming session to another profile without closing
+   * it: the RX task forwards what the FIFO holds, then retunes between two
+   * drains. Gate and tracking settings carry over, an open burst is closed.
+   */
+  int16_t retuneRawReceive(struct s_eCC1101_retune *retune);
+  /*
+   * Data never spans a gap: reading stops before one, and a gap found at the
+   * start of the read is reported in *gap (lost != 0) then skipped, the data
+   * returned follows it. Without gap, gaps are skipped silently.
+   */
+  int16_t rawReceive(uint8_t *data, size_t len, TickType_t xTicksToWait = pdMS_TO_TICKS(5000),
+                     struct s_eCC1101_gap *gap = NULL);
+  /*
+   * Sinks start at the current end of the stream. Without a rawReceive()
+   * reader, use ECC1101_DROP_OLDEST so the unread pull side does not stop
+   * the stream. The sink task is notified (xTaskNotifyGive) on new data.
+   */
+  int16_t addSink(struct s_eCC1101_sink *sink);
+  void removeSink(struct s_eCC1101_sink *sink);
+  void setSinkTask(TaskHandle_t task) {
+    _sinkTask = task;
+  }
+  /* one round over the sinks, returns the bytes they took */
+  size_t pumpSinks(void);
+  uint32_t sinkLag(const struct s_eCC1101_sink *sink);
+  /* stream offset of the next byte rawReceive() returns */
+  uint32_t rawOffset(void) {
+    return _rxRing.tail;
+  }
   void setPacketReceivedAction(void (*isr)(void*pObj));
-  void setGdo0Action(void (*func)(void* pObj), uint32_t dir);
+  void setGdo0Action(void (*func)(void* pObj), gpio_int_type_t type);
+  void releaseGdo0Action(void);
   TaskHandle_t get_rx_task() {
     return _rx_task;
   }
+  void getRxStats(struct s_eCC1101_rx_stats *stats) {
+    *stats = _rxStats;
+  }
+  void resetRxStats(void);
+  /* opt-in busy-poll RX for high data rates, see ECC1101_POLL_ENTER_US */
+  void setRxPoll(bool enable) {
+    _rxPoll = enable;
+  }
+  /* frequency tracking of the next gated sessions, ignored with OOK */
+  void setTracking(bool enable) {
+    _afcEnabled = enable;
+  }
+  /* FSCTRL0 correction of the session, in steps of 1587 Hz */
+  int8_t trackingCorrection(void) {
+    return _afc.correction;
+  }
+
+  /*
+   * RAM shadow of the configuration registers. Field updates only touch the
+   * shadow; shadowCommit() writes the dirty range back in a single burst.
+   * Anything that writes the chip behind the shadow's back (RadioLib setters,
+   * begin(), receiveDirect()) must call shadowInvalidate().
+   */
+  int16_t shadowLoad(void);
+  void shadowInvalidate(void) {
+    _regShadowValid = false;
+    _regDirty = 0;
+  }
+  int16_t shadowSetRegValue(uint8_t reg, uint8_t value, uint8_t msb = 7, uint8_t lsb = 0);
+  uint8_t shadowGetRegValue(uint8_t reg, uint8_t msb = 7, uint8_t lsb = 0);
+  int16_t shadowCommit(void);
 
 private:
   uint8_t _rxFifo[64];
@@ -69,26 +380,118 @@ private:
     instance->_rx_cb();
   }
 
-  static void _rx_isr_cb(void *pObj) {
-    eCC1101 *instance = static_cast<eCC1101*>(pObj);
-    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+  static void _rx_isr_cb(void *pObj);
 
-#if CC1101_DEBUG
-    Serial.print(F("[CC1101] IRQ!\n"));
-#endif
-    xTaskNotifyFromISR(instance->get_rx_task(), RX_BIT | RAW_BIT, eSetBits, &xHigherPriorityTaskWoken);
-    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-  }
+  void _rx_cb();
+  size_t _rx_drain(uint8_t rxBytes);
+  void _rx_poll(void);
+  size_t _rx_forward(const uint8_t *data, size_t len);
+  size_t _rx_push(const uint8_t *data, size_t len);
+  void _rx_gap(uint32_t lost);
+  bool _rx_gap_publish(void);
+  bool _rx_gap_peek(struct s_eCC1101_gap *gap);
+  void _rx_gap_consume(void);
+  void _rx_gate(uint8_t len);
+  void _rx_retune(struct s_eCC1101_retune *retune);
+  bool _gate_carrier(void);
+  int16_t _gate_rssi(void);
+  void _gate_pre_push(const uint8_t *data, size_t len);
+  void _shadow_set_gate(void);
+  void _shadow_set_tracking(void);
+  int32_t _afc_burst_open(void);
+  bool _afc_burst_close(void);
+  int16_t _begin_chip(
+    float freq = RADIOLIB_CC1101_DEFAULT_FREQ,
+    float br = RADIOLIB_CC1101_DEFAULT_BR,
+    float freqDev = RADIOLIB_CC1101_DEFAULT_FREQDEV,
+    float rxBw = RADIOLIB_CC1101_DEFAULT_RXBW,
+    int8_t pwr = RADIOLIB_CC1101_DEFAULT_POWER,
+    uint8_t preambleLength = RADIOLIB_CC1101_DEFAULT_PREAMBLELEN);
+  int16_t _shadow_set_rf(s_cc1101_rf_rx_settings *settings);
+  void _shadow_set_infinite_length(void);
+  void _shadow_set_profile(const struct s_cc1101_rf_profile *profile);
+  int16_t _start_raw_receive(void);
+  int16_t _open_raw_session(size_t bufferSize, size_t triggerLevel, bool capture);
+  void _shadow_burst(uint8_t first, uint8_t last);
 
+  uint8_t _regShadow[ECC1101_REG_CONFIG_COUNT];
+  uint64_t _regDirty;
+  bool _regShadowValid;
 
-  void _rx_cb();
   TaskHandle_t _rx_task;
+  volatile int64_t _rxIrqTime;
+  struct s_eCC1101_rx_stats _rxStats;
   size_t _rxBufferSize;
   size_t _rxBufferTriggerLevel;
-  StreamBufferHandle_t _rxStreamBuffer;
+  struct s_ecrf_ring _rxRing;
+  uint8_t *_rxStorage;
+  size_t _rxTrigger;
+  SemaphoreHandle_t _rxData;
+  StaticSemaphore_t _rxDataBuffer;
+  SemaphoreHandle_t _rxSpace;
+  StaticSemaphore_t _rxSpaceBuffer;
+  volatile bool _rxSpaceWanted;
+  /* set by stopRawReceive(), ends a block wait at once */
+  volatile bool _rxStopping;
+  enum ecc1101_overflow_policy _rxPolicy;
+  uint16_t _rxBlockMs;
+  /* producer side gap, published once data follows it */
+  struct s_eCC1101_gap _gapOpen;
+  /* consumer side gap, the reader was lapped (drop-oldest) */
+  struct s_eCC1101_gap _gapLapped;
+  struct s_eCC1101_gap _gaps[ECC1101_GAPS];
+  volatile uint32_t _gapHead;
+  volatile uint32_t _gapTail;
+  struct s_eCC1101_sink *_sinks[ECC1101_MAX_SINKS];
+  volatile size_t _sinkCount;
+  SemaphoreHandle_t _sinkLock;
+  StaticSemaphore_t _sinkLockBuffer;
+  TaskHandle_t _sinkTask;
+  bool _rxRunning;
+  bool _rxCapture;
+  volatile bool _rxCaptureFull;
+  TaskHandle_t _rxStopWaiter;
+  TaskHandle_t _rxExitWaiter;
+  struct s_eCC1101_retune *_rxRetune;
+  TaskHandle_t _rxRetuneWaiter;
+  int16_t _rxRetuneState;
+  bool _fsCached; /* FS_AUTOCAL is off, calibration comes from retunes */
+  bool _rxPoll;
+  int64_t _rxLastIrqTime;
+  uint8_t _rxFastDrains;
+  uint32_t _rxOffset;
+  struct s_cc1101_gate _gate;
+  bool _gateOpen;
+  uint16_t _gatePostLeft;
+  uint8_t _gatePre[ECC1101_GATE_PRE_MAX];
+  uint16_t _gatePreHead;
+  uint16_t _gatePreLen;
+  struct s_eCC1101_burst _gateBursts[ECC1101_GATE_BURSTS];
+  volatile uint32_t _gateBurstHead;
+  volatile uint32_t _gateBurstTail;
+  bool _afcEnabled;
+  bool _afcActive;
+  bool _afcPending;
+  int8_t _afcEstimate;
+  struct s_ecrf_afc _afc;
+  bool _busReady;
+  bool _configured;
+  volatile int16_t _beginState;
+  uint32_t _beginUs;
+  TaskHandle_t _beginWaiter;
   SPIClass *_spi;
   struct s_eCC1101_pins _pins;
-  std::vector<int32_t> _cs_unused;
+  int32_t _cs_unused[ECC1101_MAX_CS_UNUSED];
+  size_t _cs_unused_count;
+  /* owned here rather than allocated by RadioLib's Module(cs, ..., spi) */
+#if ECC1101_SPI_IDF
+  EspIdfSpiHal _hal;
+#else
+  ArduinoHal _hal;
+#endif
+  Module _module;
+  StackType_t _rxTaskStack[ECRF_TASK_STACK_WORDS(ECRF_TASK_RX_STACK)];
+  StaticTask_t _rxTaskTcb;
 };
 #endif /*  _RADIOLIB_ECC1101_H */
 
@@ -0,0 +1,122 @@
+#include "eCC1101.h"
+
+#if ECC1101_SPI_IDF
+
+#define MIN(x, y) (x < y ? x : y)
+
+struct s_ecc1101_idf_bus {
+  /* DMA bounce buffers: RadioLib hands over unaligned stack buffers */
+  uint8_t tx[ECC1101_IDF_XFER_MAX] __attribute__((aligned(4)));
+  uint8_t rx[ECC1101_IDF_XFER_MAX] __attribute__((aligned(4)));
+  spi_device_handle_t device;
+  SemaphoreHandle_t lock;
+  StaticSemaphore_t lockBuffer;
+};
+
+/* static internal RAM, DMA capable; indexed by spi_host_device_t */
+static DRAM_ATTR struct s_ecc1101_idf_bus ecc1101_idf_buses[SPI_HOST_MAX];
+
+/* ESP32 numbering: HSPI is SPI2, VSPI is SPI3 */
+static spi_host_device_t ecc1101_idf_host(uint8_t spiBus) {
+  return (spiBus == VSPI) ? SPI3_HOST : SPI2_HOST;
+}
+
+bool ecc1101_idf_bus_begin(uint8_t spiBus, int clk, int miso, int mosi, uint32_t spiClk) {
+  struct s_ecc1101_idf_bus *bus = &ecc1101_idf_buses[ecc1101_idf_host(spiBus)];
+  if (bus->device != NULL)
+    return true;
+
+  spi_bus_config_t busConfig = {};
+  busConfig.mosi_io_num = mosi;
+  busConfig.miso_io_num = miso;
+  busConfig.sclk_io_num = clk;
+  busConfig.quadwp_io_num = -1;
+  busConfig.quadhd_io_num = -1;
+  busConfig.max_transfer_sz = ECC1101_IDF_XFER_MAX;
+  esp_err_t err = spi_bus_initialize(ecc1101_idf_host(spiBus), &busConfig, SPI_DMA_CH_AUTO);
+  if ((err != ESP_OK) && (err != ESP_ERR_INVALID_STATE)) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "[E] [CC1101] spi_bus_initialize failed (%d)\n", err);
+    Serial.print(buf);
+    return false;
+  }
+
+  spi_device_interface_config_t deviceConfig = {};
+  deviceConfig.mode = 0;
+  deviceConfig.clock_speed_hz = spiClk;
+  deviceConfig.spics_io_num = -1;
+  deviceConfig.queue_size = 1;
+  err = spi_bus_add_device(ecc1101_idf_host(spiBus), &deviceConfig, &bus->device);
+  if (err != ESP_OK) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "[E] [CC1101] spi_bus_add_device failed (%d)\n", err);
+    Serial.print(buf);
+    bus->device = NULL;
+    return false;
+  }
+  bus->lock = xSemaphoreCreateMutexStatic(&bus->lockBuffer);
+
+  return true;
+}
+
+EspIdfSpiHal::EspIdfSpiHal(SPIClass &spi, uint8_t spiBus, int clk, int miso, int mosi,
+                           uint32_t spiClk):
+    ArduinoHal(spi), _spiBus(spiBus), _clk(clk), _miso(miso), _mosi(mosi), _spiClk(spiClk),
+    _bus(&ecc1101_idf_buses[ecc1101_idf_host(spiBus)]) {
+}
+
+void EspIdfSpiHal::spiBegin() {
+  bool ready = ecc1101_idf_bus_begin(_spiBus, _clk, _miso, _mosi, _spiClk);
+  configASSERT(ready);
+  (void)ready;
+}
+
+void EspIdfSpiHal::spiBeginTransaction() {
+  xSemaphoreTake(_bus->lock, portMAX_DELAY);
+  /* no arbitration per transaction while the chip is selected */
+  spi_device_acquire_bus(_bus->device, portMAX_DELAY);
+}
+
+void EspIdfSpiHal::spiTransfer(uint8_t *out, size_t len, uint8_t *in) {
+  while (len > 0) {
+    size_t n = MIN(len, (size_t)ECC1101_IDF_XFER_MAX);
+    spi_transaction_t trans = {};
+    esp_err_t err;
+
+    trans.length = n * 8;
+    if (n <= ECC1101_IDF_POLL_MAX) {
+      /* register access: data in the descriptor, no DMA, busy wait */
+      trans.flags = SPI_TRANS_USE_TXDATA | SPI_TRANS_USE_RXDATA;
+      memcpy(trans.tx_data, out, n);
+      err = spi_device_polling_transmit(_bus->device, &trans);
+      if (in != NULL)
+        memcpy(in, trans.rx_data, n);
+    } else {
+      /* burst: DMA, the task blocks until the transfer is done */
+      memcpy(_bus->tx, out, n);
+      trans.tx_buffer = _bus->tx;
+      trans.rx_buffer = _bus->rx;
+      err = spi_device_transmit(_bus->device, &trans);
+      if (in != NULL)
+        memcpy(in, _bus->rx, n);
+    }
+    configASSERT(err == ESP_OK);
+
+    /* longer transfers keep CS low, the chip sees a single burst */
+    out += n;
+    if (in != NULL)
+      in += n;
+    len -= n;
+  }
+}
+
+void EspIdfSpiHal::spiEndTransaction() {
+  spi_device_release_bus(_bus->device);
+  xSemaphoreGive(_bus->lock);
+}
+
+/* the bus is shared and outlives the radios, it is never freed */
+void EspIdfSpiHal::spiEnd() {
+}
+
+#endif /* ECC1101_SPI_IDF */
@@ -0,0 +1,47 @@
+#ifndef _RADIOLIB_ECC1101_IDF_HAL_H
+#define _RADIOLIB_ECC1101_IDF_HAL_H
+
+#include <RadioLib.h>
+#include <driver/spi_master.h>
+
+/*
+ * RadioLib HAL on the ESP-IDF spi_master driver, selected with
+ * -DECC1101_SPI_IDF=1. GPIO and timing are inherited from ArduinoHal, only
+ * the SPI path changes: register accesses (up to ECC1101_IDF_POLL_MAX bytes)
+ * are polled transactions, longer ones such as FIFO bursts are queued DMA
+ * transactions and the calling task sleeps until the transfer completes.
+ *
+ * One device per host is shared by every radio of the bus: CS is driven by
+ * RadioLib, the bus lock serializes the radios like SPIClass does.
+ */
+#ifndef ECC1101_IDF_POLL_MAX
+#define ECC1101_IDF_POLL_MAX 4
+#endif
+
+/* FIFO burst and header byte, rounded up to words for DMA */
+#define ECC1101_IDF_XFER_MAX 68
+
+/* allocates the bus and its device once, call it before the heap guard is armed */
+bool ecc1101_idf_bus_begin(uint8_t spiBus, int clk, int miso, int mosi, uint32_t spiClk);
+
+class EspIdfSpiHal : public ArduinoHal {
+  public:
+    /* spiBus uses the Arduino numbering, HSPI or VSPI */
+    EspIdfSpiHal(SPIClass &spi, uint8_t spiBus, int clk, int miso, int mosi, uint32_t spiClk);
+
+    void spiBegin() override;
+    void spiBeginTransaction() override;
+    void spiTransfer(uint8_t *out, size_t len, uint8_t *in) override;
+    void spiEndTransaction() override;
+    void spiEnd() override;
+
+  private:
+    uint8_t _spiBus;
+    int _clk;
+    int _miso;
+    int _mosi;
+    uint32_t _spiClk;
+    struct s_ecc1101_idf_bus *_bus;
+};
+
+#endif /* _RADIOLIB_ECC1101_IDF_HAL_H */
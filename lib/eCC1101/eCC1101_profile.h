@@ -0,0 +1,88 @@
+#ifndef _RADIOLIB_ECC1101_PROFILE_H
+#define _RADIOLIB_ECC1101_PROFILE_H
+
+#include <stdint.h>
+#include "eCC1101_regs.h"
+
+/*
+ * An RF profile is a complete image of the contiguous register window
+ * FREQ2 (0x0D) .. DEVIATN (0x15): carrier, data rate, channel filter,
+ * modulation and deviation. Switching profiles is one burst write.
+ */
+#define ECC1101_PROFILE_REG_FIRST 0x0D
+#define ECC1101_PROFILE_REG_LAST 0x15
+#define ECC1101_PROFILE_REG_COUNT (ECC1101_PROFILE_REG_LAST - ECC1101_PROFILE_REG_FIRST + 1)
+#define ECC1101_PROFILE_NAME_LEN 16
+
+/* offsets of the registers inside the image */
+#define ECC1101_PROFILE_FREQ2 0
+#define ECC1101_PROFILE_FREQ1 1
+#define ECC1101_PROFILE_FREQ0 2
+#define ECC1101_PROFILE_MDMCFG4 3
+#define ECC1101_PROFILE_MDMCFG3 4
+#define ECC1101_PROFILE_MDMCFG2 5
+#define ECC1101_PROFILE_MDMCFG1 6
+#define ECC1101_PROFILE_MDMCFG0 7
+#define ECC1101_PROFILE_DEVIATN 8
+
+/* MDMCFG1/MDMCFG0 reset values: 4 preamble bytes, 199.95 kHz channel spacing */
+#define ECC1101_PROFILE_MDMCFG1_DEFAULT 0x22
+#define ECC1101_PROFILE_MDMCFG0_DEFAULT 0xF8
+
+struct s_cc1101_rf_profile {
+  char name[ECC1101_PROFILE_NAME_LEN];
+  uint8_t regs[ECC1101_PROFILE_REG_COUNT];
+};
+
+/*
+ * Build a raw-capture profile image (no sync word, no Manchester) from the
+ * same parameters as s_cc1101_rf_rx_settings. Evaluated at compile time for
+ * the built-in profiles.
+ */
+static constexpr struct s_cc1101_rf_profile ecc1101_profile_make(const char *name,
+        double freq, double br, double freqDev, double rxBw, uint8_t modulation) {
+  struct s_cc1101_rf_profile profile = {};
+  for (int i = 0; (i < ECC1101_PROFILE_NAME_LEN - 1) && name[i]; i++) {
+    profile.name[i] = name[i];
+  }
+
+  uint32_t frf = ecc1101_freq_word(freq);
+  struct ecc1101_exp_mant drate = ecc1101_drate(br);
+
+  profile.regs[ECC1101_PROFILE_FREQ2] = (frf >> 16) & 0xFF;
+  profile.regs[ECC1101_PROFILE_FREQ1] = (frf >> 8) & 0xFF;
+  profile.regs[ECC1101_PROFILE_FREQ0] = frf & 0xFF;
+  profile.regs[ECC1101_PROFILE_MDMCFG4] = ecc1101_chanbw(rxBw) | (drate.e & 0x0F);
+  profile.regs[ECC1101_PROFILE_MDMCFG3] = drate.m;
+  profile.regs[ECC1101_PROFILE_MDMCFG2] = modulation & 0x70;
+  profile.regs[ECC1101_PROFILE_MDMCFG1] = ECC1101_PROFILE_MDMCFG1_DEFAULT;
+  profile.regs[ECC1101_PROFILE_MDMCFG0] = ECC1101_PROFILE_MDMCFG0_DEFAULT;
+  profile.regs[ECC1101_PROFILE_DEVIATN] = ecc1101_deviatn(freqDev < 1.587 ? 1.587 : freqDev);
+
+  return profile;
+}
+
+/* carrier frequency of an image, in kHz */
+static inline uint32_t ecc1101_profile_freq_khz(const struct s_cc1101_rf_profile *profile) {
+  uint32_t frf = ((uint32_t)profile->regs[ECC1101_PROFILE_FREQ2] << 16) |
+                 ((uint32_t)profile->regs[ECC1101_PROFILE_FREQ1] << 8) |
+                 profile->regs[ECC1101_PROFILE_FREQ0];
+  return (uint32_t)(((uint64_t)frf * (uint64_t)ECC1101_XOSC_HZ) / 65536 / 1000);
+}
+
+/* data rate of an image, in bps */
+static inline uint32_t ecc1101_profile_bitrate(const struct s_cc1101_rf_profile *profile) {
+  uint8_t e = profile->regs[ECC1101_PROFILE_MDMCFG4] & 0x0F;
+  uint8_t m = profile->regs[ECC1101_PROFILE_MDMCFG3];
+  return (uint32_t)((((uint64_t)(256 + m) << e) * (uint64_t)ECC1101_XOSC_HZ) >> 28);
+}
+
+/* retune an image to another data rate, the rest of it is kept */
+static inline void ecc1101_profile_set_bitrate(struct s_cc1101_rf_profile *profile, double kbps) {
+  struct ecc1101_exp_mant drate = ecc1101_drate(kbps);
+  profile->regs[ECC1101_PROFILE_MDMCFG4] =
+      (profile->regs[ECC1101_PROFILE_MDMCFG4] & 0xF0) | (drate.e & 0x0F);
+  profile->regs[ECC1101_PROFILE_MDMCFG3] = drate.m;
+}
+
+#endif /* _RADIOLIB_ECC1101_PROFILE_H */
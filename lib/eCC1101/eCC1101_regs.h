@@ -0,0 +1,101 @@
+#ifndef _RADIOLIB_ECC1101_REGS_H
+#define _RADIOLIB_ECC1101_REGS_H
+
+#include <stdint.h>
+
+/* Configuration register space mirrored in RAM: IOCFG2 (0x00) .. TEST0 (0x2E) */
+#define ECC1101_REG_CONFIG_COUNT 0x2F
+
+/* FSCAL3 .. FSCAL0 are rewritten by the chip on every calibration */
+#define ECC1101_REG_FSCAL_FIRST 0x23
+#define ECC1101_REG_FSCAL_LAST 0x26
+
+#define ECC1101_XOSC_HZ 26000000.0
+
+/* IOCFGx: GDO asserted while RSSI is above the carrier sense threshold */
+#define ECC1101_GDO_CARRIER_SENSE 0x0E
+
+/* RXBYTES: FIFO level, bit 7 set once the FIFO overflowed (flush to recover) */
+#define ECC1101_RXBYTES_OVERFLOW 0x80
+#define ECC1101_RXBYTES_NUM 0x7F
+
+/*
+ * Wake-on-radio: EVENT0 period unit is 750 / fXOSC with WOR_RES = 0,
+ * WORCTRL keeps the RC oscillator on and calibrated, EVENT1 at 48 clocks.
+ * MCSM2 ends RX early when no carrier is sensed, with no sync timeout.
+ */
+#define ECC1101_WOR_EVENT0_PER_MS 34.667
+#define ECC1101_WORCTRL_RC_CAL 0x78
+#define ECC1101_MCSM2_RX_TIME_RSSI 0x17
+#define ECC1101_MCSM2_DEFAULT 0x07
+
+/*
+ * FOCCFG for frequency tracking (the reset value, set explicitly): offset
+ * compensation frozen until carrier sense, 3K gain before sync, K/2 after,
+ * saturating at +-BW/4 of the channel filter.
+ */
+#define ECC1101_FOCCFG_TRACK 0x36
+
+#define ECC1101_FREQ_IN_BAND(f) \
+  ((((f) >= 300.0) && ((f) <= 348.0)) || \
+   (((f) >= 387.0) && ((f) <= 464.0)) || \
+   (((f) >= 779.0) && ((f) <= 928.0)))
+
+struct ecc1101_exp_mant {
+  uint8_t e;
+  uint8_t m;
+};
+
+/*
+ * Register field encoders. They are constexpr so that the same arithmetic can
+ * be used at run time by set_rf() and at compile time for RF profile images.
+ */
+
+/* FREQ2/FREQ1/FREQ0 word for a carrier frequency in MHz */
+static constexpr uint32_t ecc1101_freq_word(double mhz) {
+  return (uint32_t)(mhz * 1000000.0 * 65536.0 / ECC1101_XOSC_HZ);
+}
+
+/* Same search as CC1101::getExpMant(): target = (offset + M) * 2^E * fxosc / 2^divExp */
+static constexpr struct ecc1101_exp_mant ecc1101_get_exp_mant(double target,
+        uint16_t mantOffset, uint8_t divExp, uint8_t expMax) {
+  double origin = (mantOffset * ECC1101_XOSC_HZ) / (double)(1UL << divExp);
+  for (int e = expMax; e >= 0; e--) {
+    double intervalStart = (double)(1UL << e) * origin;
+    if (target >= intervalStart) {
+      double stepSize = intervalStart / (double)mantOffset;
+      return { (uint8_t)e, (uint8_t)((target - intervalStart) / stepSize) };
+    }
+  }
+  return { 0, 0 };
+}
+
+/* DRATE_E (MDMCFG4[3:0]) and DRATE_M (MDMCFG3) for a bit rate in kbps */
+static constexpr struct ecc1101_exp_mant ecc1101_drate(double kbps) {
+  return ecc1101_get_exp_mant(kbps * 1000.0, 256, 28, 14);
+}
+
+/* DEVIATN register for a frequency deviation in kHz */
+static constexpr uint8_t ecc1101_deviatn(double khz) {
+  struct ecc1101_exp_mant em = ecc1101_get_exp_mant(khz * 1000.0, 8, 17, 7);
+  return (uint8_t)((em.e << 4) | (em.m & 0x07));
+}
+
+/* CHANBW_E/CHANBW_M (MDMCFG4[7:4]) of the supported bandwidth nearest to khz */
+static constexpr uint8_t ecc1101_chanbw(double khz) {
+  uint8_t best = 0;
+  double bestErr = 1e12;
+  for (int e = 0; e < 4; e++) {
+    for (int m = 0; m < 4; m++) {
+      double bw = ECC1101_XOSC_HZ / (8.0 * (4 + m) * (1 << e)) / 1000.0;
+      double err = (bw > khz) ? (bw - khz) : (khz - bw);
+      if (err < bestErr) {
+        bestErr = err;
+        best = (uint8_t)((e << 6) | (m << 4));
+      }
+    }
+  }
+  return best;
+}
+
+#endif /* _RADIOLIB_ECC1101_REGS_H */
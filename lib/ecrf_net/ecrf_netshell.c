@@ -0,0 +1,195 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ecrf_netshell.h"
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+void ecrf_netshell_init(struct s_ecrf_netshell *shell) {
+  memset(shell, 0, sizeof(*shell));
+  shell->listen_fd = -1;
+  shell->client_fd = -1;
+  ecrf_ring_init(&shell->ring, shell->ring_buf, sizeof(shell->ring_buf));
+}
+
+int ecrf_netshell_listen(struct s_ecrf_netshell *shell, uint16_t port) {
+  struct sockaddr_in addr;
+  int on = 1;
+
+  ecrf_netshell_close(shell);
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return errno;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(port);
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if ((bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) || (listen(fd, 1) < 0)) {
+    int error = errno;
+    close(fd);
+    return error;
+  }
+
+  shell->listen_fd = fd;
+  return 0;
+}
+
+uint16_t ecrf_netshell_port(const struct s_ecrf_netshell *shell) {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+
+  if ((shell->listen_fd < 0) ||
+      (getsockname(shell->listen_fd, (struct sockaddr *)&addr, &len) < 0))
+    return 0;
+  return ntohs(addr.sin_port);
+}
+
+static void ecrf_netshell_hangup(struct s_ecrf_netshell *shell) {
+  int fd = shell->client_fd;
+  uint32_t lost;
+
+  /* output stops being queued first, then what was queued is dropped */
+  shell->client_fd = -1;
+  if (fd >= 0)
+    close(fd);
+  while (ecrf_ring_read(&shell->ring, shell->out, sizeof(shell->out), &lost) > 0) {
+  }
+  shell->out_len = 0;
+  shell->out_pos = 0;
+  shell->len = 0;
+  shell->too_long = false;
+  shell->last_cr = false;
+}
+
+void ecrf_netshell_close(struct s_ecrf_netshell *shell) {
+  ecrf_netshell_hangup(shell);
+  if (shell->listen_fd >= 0)
+    close(shell->listen_fd);
+  shell->listen_fd = -1;
+}
+
+static void ecrf_netshell_accept(struct s_ecrf_netshell *shell) {
+  int fd = accept(shell->listen_fd, NULL, NULL);
+  if (fd < 0)
+    return;
+
+  ecrf_netshell_hangup(shell);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+  shell->clients++;
+  shell->client_fd = fd;
+}
+
+/* CR, LF and CRLF end a line, as on the serial console */
+static void ecrf_netshell_input(struct s_ecrf_netshell *shell, const uint8_t *data, size_t len,
+                                ecrf_netshell_line_t on_line, void *ctx) {
+  for (size_t i = 0; i < len; i++) {
+    char c = (char)data[i];
+    bool last_cr = shell->last_cr;
+    shell->last_cr = (c == '\r');
+
+    if ((c == '\r') || ((c == '\n') && !last_cr)) {
+      if (shell->too_long) {
+        shell->lines_too_long++;
+      } else {
+        shell->line[shell->len] = 0;
+        on_line(ctx, shell->line);
+      }
+      shell->len = 0;
+      shell->too_long = false;
+    } else if (c == '\n') {
+      /* second half of CRLF */
+    } else if ((c == '\b') || (c == 0x7F)) {
+      if (shell->len > 0)
+        shell->len--;
+    } else if (shell->len < sizeof(shell->line) - 1) {
+      shell->line[shell->len++] = c;
+    } else {
+      shell->too_long = true;
+    }
+  }
+}
+
+static void ecrf_netshell_send(struct s_ecrf_netshell *shell) {
+  uint32_t lost;
+
+  for (;;) {
+    if (shell->out_pos == shell->out_len) {
+      /* the ring never overwrites, nothing is lost on this side */
+      shell->out_len = ecrf_ring_read(&shell->ring, shell->out, sizeof(shell->out), &lost);
+      shell->out_pos = 0;
+      if (shell->out_len == 0)
+        return;
+    }
+
+    ssize_t sent = send(shell->client_fd, shell->out + shell->out_pos,
+                        shell->out_len - shell->out_pos, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (sent < 0) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+        ecrf_netshell_hangup(shell);
+      return;
+    }
+    shell->out_pos += (size_t)sent;
+  }
+}
+
+void ecrf_netshell_poll(struct s_ecrf_netshell *shell, unsigned timeout_ms,
+                        ecrf_netshell_line_t on_line, void *ctx) {
+  fd_set readable;
+  fd_set writable;
+  int top = -1;
+  int client = shell->client_fd;
+  bool sending = (shell->out_pos < shell->out_len) || (ecrf_ring_used(&shell->ring) > 0);
+  struct timeval timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+
+  FD_ZERO(&readable);
+  FD_ZERO(&writable);
+  if (shell->listen_fd >= 0) {
+    FD_SET(shell->listen_fd, &readable);
+    top = shell->listen_fd;
+  }
+  if (client >= 0) {
+    FD_SET(client, &readable);
+    if (sending)
+      FD_SET(client, &writable);
+    if (client > top)
+      top = client;
+  }
+
+  if (select(top + 1, &readable, &writable, NULL, &timeout) <= 0) {
+    /* output queued meanwhile is picked up by the next poll */
+    return;
+  }
+
+  if ((client >= 0) && FD_ISSET(client, &writable))
+    ecrf_netshell_send(shell);
+
+  if ((shell->client_fd >= 0) && FD_ISSET(client, &readable)) {
+    uint8_t data[64];
+    ssize_t len = recv(client, data, sizeof(data), MSG_DONTWAIT);
+    if (len > 0) {
+      ecrf_netshell_input(shell, data, (size_t)len, on_line, ctx);
+    } else if ((len == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))) {
+      ecrf_netshell_hangup(shell);
+    }
+  }
+
+  if ((shell->listen_fd >= 0) && FD_ISSET(shell->listen_fd, &readable))
+    ecrf_netshell_accept(shell);
+}
+
+void ecrf_netshell_output(struct s_ecrf_netshell *shell, const char *data, size_t len) {
+  if (shell->client_fd < 0)
+    return;
+
+  size_t taken = ecrf_ring_write(&shell->ring, (const uint8_t *)data, len, false);
+  shell->output_lost += (uint32_t)(len - taken);
+}
@@ -0,0 +1,74 @@
+#ifndef _ECRF_NETSHELL_H
+#define _ECRF_NETSHELL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ecrf_ring.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Shell over TCP: one client at a time, a new connection replaces the
+ * previous one (a stale session must not lock the board out). Input is cut
+ * into lines like on the serial console and handed to a callback; output
+ * goes through a ring, so the task producing it never waits on the network.
+ * One task runs ecrf_netshell_poll() and owns the sockets, one task writes
+ * ecrf_netshell_output().
+ */
+
+/* longest line, terminator included: the serial shell input buffer */
+#ifndef ECRF_NETSHELL_LINE_LENGTH
+#define ECRF_NETSHELL_LINE_LENGTH 64
+#endif
+
+/* output waiting for the client, a power of two */
+#ifndef ECRF_NETSHELL_OUTPUT_LENGTH
+#define ECRF_NETSHELL_OUTPUT_LENGTH 2048
+#endif
+
+typedef void (*ecrf_netshell_line_t)(void *ctx, const char *line);
+
+struct s_ecrf_netshell {
+  int listen_fd; /* -1 while not listening */
+  volatile int client_fd;
+  /* line being assembled */
+  char line[ECRF_NETSHELL_LINE_LENGTH];
+  size_t len;
+  bool too_long;
+  bool last_cr;
+  /* output, the poll side sends from out */
+  struct s_ecrf_ring ring;
+  uint8_t ring_buf[ECRF_NETSHELL_OUTPUT_LENGTH];
+  uint8_t out[256];
+  size_t out_len;
+  size_t out_pos;
+  uint32_t clients;
+  uint32_t lines_too_long;
+  uint32_t output_lost; /* bytes, ring full */
+};
+
+void ecrf_netshell_init(struct s_ecrf_netshell *shell);
+/* port 0 picks a free one; 0 or an errno value */
+int ecrf_netshell_listen(struct s_ecrf_netshell *shell, uint16_t port);
+uint16_t ecrf_netshell_port(const struct s_ecrf_netshell *shell);
+static inline bool ecrf_netshell_connected(const struct s_ecrf_netshell *shell) {
+  return shell->client_fd >= 0;
+}
+/*
+ * Waits up to timeout_ms for a client, its input or room for output, then
+ * does what it can: complete lines go to on_line, NUL terminated.
+ */
+void ecrf_netshell_poll(struct s_ecrf_netshell *shell, unsigned timeout_ms,
+                        ecrf_netshell_line_t on_line, void *ctx);
+/* to the client if there is one, what does not fit is lost */
+void ecrf_netshell_output(struct s_ecrf_netshell *shell, const char *data, size_t len);
+void ecrf_netshell_close(struct s_ecrf_netshell *shell);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_NETSHELL_H */
@@ -0,0 +1,187 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "ecrf_stream.h"
+
+/* lwIP has no SIGPIPE to silence */
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define ECRF_STREAM_SEND_FLAGS (MSG_DONTWAIT | MSG_NOSIGNAL)
+
+void ecrf_stream_init(struct s_ecrf_stream *stream) {
+  memset(stream, 0, sizeof(*stream));
+  stream->fd = -1;
+}
+
+static int ecrf_stream_connect(int fd, const struct sockaddr *addr, socklen_t addrlen) {
+  if (connect(fd, addr, addrlen) == 0)
+    return 0;
+  if (errno != EINPROGRESS)
+    return errno;
+
+  fd_set writable;
+  struct timeval timeout = {ECRF_STREAM_CONNECT_MS / 1000, (ECRF_STREAM_CONNECT_MS % 1000) * 1000};
+  FD_ZERO(&writable);
+  FD_SET(fd, &writable);
+  int ready = select(fd + 1, NULL, &writable, NULL, &timeout);
+  if (ready < 0)
+    return errno;
+  if (ready == 0)
+    return ETIMEDOUT;
+
+  int error = 0;
+  socklen_t len = sizeof(error);
+  if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0)
+    return errno;
+  return error;
+}
+
+int ecrf_stream_open(struct s_ecrf_stream *stream, const char *host, uint16_t port, bool datagram,
+                     uint8_t radio) {
+  struct addrinfo hints;
+  struct addrinfo *addr;
+  char service[8];
+
+  ecrf_stream_close(stream);
+  ecrf_stream_init(stream);
+  stream->datagram = datagram;
+  stream->radio = radio;
+
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = datagram ? SOCK_DGRAM : SOCK_STREAM;
+  snprintf(service, sizeof(service), "%u", (unsigned)port);
+  if (getaddrinfo(host, service, &hints, &addr) != 0)
+    return EHOSTUNREACH;
+
+  int error = 0;
+  int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+  if (fd < 0) {
+    error = errno;
+  } else if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0) {
+    error = errno;
+  } else {
+    /* a datagram socket connects at once, it only fixes the destination */
+    error = ecrf_stream_connect(fd, addr->ai_addr, addr->ai_addrlen);
+  }
+  freeaddrinfo(addr);
+
+  if (error != 0) {
+    if (fd >= 0)
+      close(fd);
+    return error;
+  }
+
+  stream->fd = fd;
+  return 0;
+}
+
+void ecrf_stream_close(struct s_ecrf_stream *stream) {
+  if (stream->fd >= 0)
+    close(stream->fd);
+  stream->fd = -1;
+  stream->pending_len = 0;
+  stream->pending_pos = 0;
+}
+
+/* no room in the socket buffer or the stack, the send is retried later */
+static bool ecrf_stream_busy(int error) {
+  return (error == EAGAIN) || (error == EWOULDBLOCK) || (error == ENOBUFS) ||
+         (error == ENOMEM) || (error == EINTR);
+}
+
+static void ecrf_stream_fail(struct s_ecrf_stream *stream, int error) {
+  if (ecrf_stream_busy(error)) {
+    stream->busy++;
+    return;
+  }
+
+  /* the receiver went away: the source keeps going without us */
+  stream->error = error;
+  ecrf_stream_close(stream);
+}
+
+/* the end of a frame the stack took only part of */
+static bool ecrf_stream_flush(struct s_ecrf_stream *stream) {
+  while (stream->pending_pos < stream->pending_len) {
+    ssize_t sent = send(stream->fd, stream->pending + stream->pending_pos,
+                        stream->pending_len - stream->pending_pos, ECRF_STREAM_SEND_FLAGS);
+    if (sent < 0) {
+      ecrf_stream_fail(stream, errno);
+      return false;
+    }
+    stream->pending_pos += (uint16_t)sent;
+  }
+
+  stream->pending_len = 0;
+  stream->pending_pos = 0;
+  return true;
+}
+
+size_t ecrf_stream_write(struct s_ecrf_stream *stream, uint32_t offset, uint32_t lost,
+                         const uint8_t *data, size_t len) {
+  /* counted before anything can fail, the loss is framed with the next data */
+  stream->gap += lost;
+  if ((stream->fd < 0) || !ecrf_stream_flush(stream) || (len == 0))
+    return 0;
+
+  if (len > ECRF_STREAM_MAX_PAYLOAD)
+    len = ECRF_STREAM_MAX_PAYLOAD;
+
+  uint8_t header[ECRF_FRAME_HEADER];
+  struct s_ecrf_frame frame = {
+      .flags = (uint8_t)((stream->gap != 0) ? ECRF_FRAME_GAP : 0),
+      .radio = stream->radio,
+      .len = (uint16_t)len,
+      .seq = stream->seq,
+      .offset = offset,
+      .lost = stream->gap,
+  };
+  ecrf_frame_encode(header, &frame);
+
+  struct iovec iov[2] = {
+      {.iov_base = header, .iov_len = sizeof(header)},
+      {.iov_base = (void *)data, .iov_len = len},
+  };
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+
+  ssize_t sent = sendmsg(stream->fd, &msg, ECRF_STREAM_SEND_FLAGS);
+  if (sent < 0) {
+    ecrf_stream_fail(stream, errno);
+    return 0;
+  }
+
+  /* datagrams go whole or not at all, only a stream can stop midway */
+  size_t total = sizeof(header) + len;
+  if ((size_t)sent < total) {
+    size_t from = (size_t)sent;
+    stream->pending_len = 0;
+    stream->pending_pos = 0;
+    if (from < sizeof(header)) {
+      memcpy(stream->pending, header + from, sizeof(header) - from);
+      stream->pending_len = (uint16_t)(sizeof(header) - from);
+      from = sizeof(header);
+    }
+    memcpy(stream->pending + stream->pending_len, data + (from - sizeof(header)),
+           total - from);
+    stream->pending_len += (uint16_t)(total - from);
+  }
+
+  stream->seq++;
+  stream->gap = 0;
+  stream->frames++;
+  stream->bytes += (uint32_t)len;
+  return len;
+}
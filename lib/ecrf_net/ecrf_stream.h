@@ -0,0 +1,68 @@
+#ifndef _ECRF_STREAM_H
+#define _ECRF_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ecrf_frame.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Raw session data to a network receiver over BSD sockets, lwIP on the
+ * board and the host stack for the loopback tests. Each chunk goes out
+ * behind an ecrf_frame header in a single gather send: the header from the
+ * stack, the payload from where the caller has it, nothing is staged in
+ * between. TCP carries a stream of frames, UDP one frame per datagram.
+ * Sends never block, like a sink write(): a full socket buffer takes
+ * nothing and the chunk is offered again. A stream socket may take part of
+ * a frame only; its end waits in pending and goes out before anything else.
+ */
+
+/* longest payload of a frame, longer chunks are cut */
+#ifndef ECRF_STREAM_MAX_PAYLOAD
+#define ECRF_STREAM_MAX_PAYLOAD 1024
+#endif
+
+#ifndef ECRF_STREAM_CONNECT_MS
+#define ECRF_STREAM_CONNECT_MS 3000
+#endif
+
+struct s_ecrf_stream {
+  int fd; /* -1 while closed */
+  bool datagram;
+  uint8_t radio;
+  uint32_t seq;
+  uint32_t gap; /* lost bytes not framed yet */
+  uint8_t pending[ECRF_FRAME_HEADER + ECRF_STREAM_MAX_PAYLOAD];
+  uint16_t pending_len;
+  uint16_t pending_pos;
+  uint32_t frames;
+  uint32_t bytes; /* payload */
+  uint32_t busy;  /* sends refused for lack of room */
+  int error;      /* errno the stream was closed on, 0 */
+};
+
+void ecrf_stream_init(struct s_ecrf_stream *stream);
+/* numeric or resolvable host; 0 or an errno value */
+int ecrf_stream_open(struct s_ecrf_stream *stream, const char *host, uint16_t port, bool datagram,
+                     uint8_t radio);
+static inline bool ecrf_stream_is_open(const struct s_ecrf_stream *stream) {
+  return stream->fd >= 0;
+}
+/*
+ * Frames data found at the stream offset, after lost bytes the source
+ * dropped since the previous call. Returns the payload bytes taken, 0 when
+ * the socket has no room or the stream is closed (an error closes it).
+ */
+size_t ecrf_stream_write(struct s_ecrf_stream *stream, uint32_t offset, uint32_t lost,
+                         const uint8_t *data, size_t len);
+void ecrf_stream_close(struct s_ecrf_stream *stream);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_STREAM_H */
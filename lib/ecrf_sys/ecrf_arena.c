@@ -0,0 +1,150 @@
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <esp_heap_caps.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ecrf_arena.h"
+
+#define ECRF_ARENA_ALIGN 8
+
+struct s_ecrf_arena_block {
+  uint32_t offset;
+  uint32_t size;
+  bool used;
+};
+
+#if defined(BOARD_HAS_PSRAM) && !defined(ECRF_ARENA_INTERNAL)
+#define ECRF_ARENA_BYTES ECRF_ARENA_PSRAM_SIZE
+static uint8_t *ecrf_arena_base = NULL;
+#else
+#define ECRF_ARENA_BYTES ECRF_ARENA_SIZE
+static uint8_t ecrf_arena_base[ECRF_ARENA_SIZE] __attribute__((aligned(ECRF_ARENA_ALIGN)));
+#endif
+
+/* sorted by offset, adjacent free blocks are always merged */
+static struct s_ecrf_arena_block ecrf_arena_blocks[ECRF_ARENA_BLOCKS];
+static size_t ecrf_arena_nblocks = 0;
+static portMUX_TYPE ecrf_arena_lock = portMUX_INITIALIZER_UNLOCKED;
+
+bool ecrf_arena_init(void) {
+  if (ecrf_arena_nblocks)
+    return true;
+
+#if defined(BOARD_HAS_PSRAM) && !defined(ECRF_ARENA_INTERNAL)
+  /* reserved once, never given back */
+  ecrf_arena_base = (uint8_t *)heap_caps_malloc(ECRF_ARENA_BYTES, MALLOC_CAP_SPIRAM);
+  if (ecrf_arena_base == NULL)
+    return false;
+#endif
+
+  ecrf_arena_blocks[0].offset = 0;
+  ecrf_arena_blocks[0].size = ECRF_ARENA_BYTES;
+  ecrf_arena_blocks[0].used = false;
+  ecrf_arena_nblocks = 1;
+
+  return true;
+}
+
+static void ecrf_arena_remove(size_t i) {
+  memmove(&ecrf_arena_blocks[i], &ecrf_arena_blocks[i + 1],
+          (ecrf_arena_nblocks - i - 1) * sizeof(ecrf_arena_blocks[0]));
+  ecrf_arena_nblocks--;
+}
+
+void *ecrf_arena_alloc(size_t size) {
+  void *ptr = NULL;
+
+  if (!ecrf_arena_init() || (size == 0))
+    return NULL;
+
+  size = (size + ECRF_ARENA_ALIGN - 1) & ~(size_t)(ECRF_ARENA_ALIGN - 1);
+
+  taskENTER_CRITICAL(&ecrf_arena_lock);
+  for (size_t i = 0; i < ecrf_arena_nblocks; i++) {
+    struct s_ecrf_arena_block *block = &ecrf_arena_blocks[i];
+    if (block->used || (block->size < size))
+      continue;
+
+    /* first fit, split the tail off as a new free block */
+    if (block->size > size) {
+      if (ecrf_arena_nblocks == ECRF_ARENA_BLOCKS)
+        break;
+      memmove(&ecrf_arena_blocks[i + 2], &ecrf_arena_blocks[i + 1],
+              (ecrf_arena_nblocks - i - 1) * sizeof(ecrf_arena_blocks[0]));
+      ecrf_arena_blocks[i + 1].offset = block->offset + size;
+      ecrf_arena_blocks[i + 1].size = block->size - size;
+      ecrf_arena_blocks[i + 1].used = false;
+      ecrf_arena_nblocks++;
+      block->size = size;
+    }
+    block->used = true;
+    ptr = ecrf_arena_base + block->offset;
+    break;
+  }
+  taskEXIT_CRITICAL(&ecrf_arena_lock);
+
+  return ptr;
+}
+
+void ecrf_arena_free(void *ptr) {
+  if (ptr == NULL)
+    return;
+
+  uint32_t offset = (uint8_t *)ptr - ecrf_arena_base;
+
+  taskENTER_CRITICAL(&ecrf_arena_lock);
+  for (size_t i = 0; i < ecrf_arena_nblocks; i++) {
+    if (ecrf_arena_blocks[i].offset != offset)
+      continue;
+
+    configASSERT(ecrf_arena_blocks[i].used);
+    ecrf_arena_blocks[i].used = false;
+    if ((i + 1 < ecrf_arena_nblocks) && !ecrf_arena_blocks[i + 1].used) {
+      ecrf_arena_blocks[i].size += ecrf_arena_blocks[i + 1].size;
+      ecrf_arena_remove(i + 1);
+    }
+    if ((i > 0) && !ecrf_arena_blocks[i - 1].used) {
+      ecrf_arena_blocks[i - 1].size += ecrf_arena_blocks[i].size;
+      ecrf_arena_remove(i);
+    }
+    break;
+  }
+  taskEXIT_CRITICAL(&ecrf_arena_lock);
+}
+
+size_t ecrf_arena_size(void) {
+  return ECRF_ARENA_BYTES;
+}
+
+size_t ecrf_arena_available(void) {
+  size_t available = 0;
+
+  if (!ecrf_arena_init())
+    return 0;
+
+  taskENTER_CRITICAL(&ecrf_arena_lock);
+  for (size_t i = 0; i < ecrf_arena_nblocks; i++) {
+    if (!ecrf_arena_blocks[i].used)
+      available += ecrf_arena_blocks[i].size;
+  }
+  taskEXIT_CRITICAL(&ecrf_arena_lock);
+
+  return available;
+}
+
+size_t ecrf_arena_largest(void) {
+  size_t largest = 0;
+
+  if (!ecrf_arena_init())
+    return 0;
+
+  taskENTER_CRITICAL(&ecrf_arena_lock);
+  for (size_t i = 0; i < ecrf_arena_nblocks; i++) {
+    if (!ecrf_arena_blocks[i].used && (ecrf_arena_blocks[i].size > largest))
+      largest = ecrf_arena_blocks[i].size;
+  }
+  taskEXIT_CRITICAL(&ecrf_arena_lock);
+
+  return largest;
+}
@@ -0,0 +1,41 @@
+#ifndef _ECRF_ARENA_H
+#define _ECRF_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Capture buffer arena: one region reserved once, carved into per-session
+ * buffers. Blocks are coalesced on release, so repeated sessions of any
+ * size never fragment the heap. On boards with PSRAM the region is taken
+ * from PSRAM (ECRF_ARENA_PSRAM_SIZE) unless ECRF_ARENA_INTERNAL is defined.
+ */
+#ifndef ECRF_ARENA_SIZE
+#define ECRF_ARENA_SIZE (32 * 1024)
+#endif
+
+#ifndef ECRF_ARENA_PSRAM_SIZE
+#define ECRF_ARENA_PSRAM_SIZE (1024 * 1024)
+#endif
+
+#ifndef ECRF_ARENA_BLOCKS
+#define ECRF_ARENA_BLOCKS 16
+#endif
+
+/* reserve the region, done on first use if not called at boot */
+bool ecrf_arena_init(void);
+void *ecrf_arena_alloc(size_t size);
+void ecrf_arena_free(void *ptr);
+size_t ecrf_arena_size(void);
+size_t ecrf_arena_available(void);
+size_t ecrf_arena_largest(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_ARENA_H */
@@ -0,0 +1,38 @@
+#include "freertos/FreeRTOS.h"
+#include <esp_timer.h>
+
+#include "ecrf_boot.h"
+
+static struct s_ecrf_boot_event ecrf_boot_log[ECRF_BOOT_LOG_SIZE];
+static size_t ecrf_boot_count = 0;
+static portMUX_TYPE ecrf_boot_lock = portMUX_INITIALIZER_UNLOCKED;
+
+void ecrf_boot_span(const char *phase, int radio, int64_t start_us, int64_t end_us) {
+  taskENTER_CRITICAL(&ecrf_boot_lock);
+  struct s_ecrf_boot_event *event = &ecrf_boot_log[ecrf_boot_count++ % ECRF_BOOT_LOG_SIZE];
+  event->phase = phase;
+  event->radio = radio;
+  event->start_us = start_us;
+  event->end_us = end_us;
+  taskEXIT_CRITICAL(&ecrf_boot_lock);
+}
+
+void ecrf_boot_mark(const char *phase, int radio) {
+  int64_t now = esp_timer_get_time();
+
+  ecrf_boot_span(phase, radio, now, now);
+}
+
+bool ecrf_boot_event(size_t index, struct s_ecrf_boot_event *event) {
+  bool found = false;
+
+  taskENTER_CRITICAL(&ecrf_boot_lock);
+  size_t first = (ecrf_boot_count > ECRF_BOOT_LOG_SIZE) ? ecrf_boot_count - ECRF_BOOT_LOG_SIZE : 0;
+  if (first + index < ecrf_boot_count) {
+    *event = ecrf_boot_log[(first + index) % ECRF_BOOT_LOG_SIZE];
+    found = true;
+  }
+  taskEXIT_CRITICAL(&ecrf_boot_lock);
+
+  return found;
+}
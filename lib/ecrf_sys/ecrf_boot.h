@@ -0,0 +1,36 @@
+#ifndef _ECRF_BOOT_H
+#define _ECRF_BOOT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Bring-up timeline: boot phases and radio init steps, timestamped with
+ * esp_timer (us since the application started). The log is a small ring,
+ * the newest ECRF_BOOT_LOG_SIZE events are kept.
+ */
+#ifndef ECRF_BOOT_LOG_SIZE
+#define ECRF_BOOT_LOG_SIZE 32
+#endif
+
+struct s_ecrf_boot_event {
+  const char *phase;
+  int radio; /* -1 when not tied to a radio */
+  int64_t start_us;
+  int64_t end_us;
+};
+
+void ecrf_boot_span(const char *phase, int radio, int64_t start_us, int64_t end_us);
+void ecrf_boot_mark(const char *phase, int radio);
+/* index 0 is the oldest event still in the log */
+bool ecrf_boot_event(size_t index, struct s_ecrf_boot_event *event);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_BOOT_H */
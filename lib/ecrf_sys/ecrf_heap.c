@@ -0,0 +1,69 @@
+#include "freertos/FreeRTOS.h"
+#include <esp_heap_caps.h>
+
+#include "ecrf_heap.h"
+
+static volatile bool ecrf_heap_armed = false;
+static volatile uint32_t ecrf_heap_paused = 0;
+
+void ecrf_heap_guard_arm(void) {
+  ecrf_heap_armed = true;
+}
+
+bool ecrf_heap_guard_armed(void) {
+  return ECRF_HEAP_GUARD && ecrf_heap_armed;
+}
+
+void ecrf_heap_guard_pause(void) {
+  __atomic_add_fetch(&ecrf_heap_paused, 1, __ATOMIC_SEQ_CST);
+}
+
+void ecrf_heap_guard_resume(void) {
+  configASSERT(ecrf_heap_paused > 0);
+  __atomic_sub_fetch(&ecrf_heap_paused, 1, __ATOMIC_SEQ_CST);
+}
+
+#if ECRF_HEAP_GUARD
+/* -Wl,--wrap=<allocator> entry points, see extra_script.py */
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__real_heap_caps_malloc(size_t size, uint32_t caps);
+void *__real_heap_caps_calloc(size_t n, size_t size, uint32_t caps);
+void *__real_heap_caps_realloc(void *ptr, size_t size, uint32_t caps);
+
+static inline void ecrf_heap_check(void) {
+  /* the backtrace of the assert points at the offender */
+  configASSERT(!ecrf_heap_armed || ecrf_heap_paused);
+}
+
+void *__wrap_malloc(size_t size) {
+  ecrf_heap_check();
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  ecrf_heap_check();
+  return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  ecrf_heap_check();
+  return __real_realloc(ptr, size);
+}
+
+void *__wrap_heap_caps_malloc(size_t size, uint32_t caps) {
+  ecrf_heap_check();
+  return __real_heap_caps_malloc(size, caps);
+}
+
+void *__wrap_heap_caps_calloc(size_t n, size_t size, uint32_t caps) {
+  ecrf_heap_check();
+  return __real_heap_caps_calloc(n, size, caps);
+}
+
+void *__wrap_heap_caps_realloc(void *ptr, size_t size, uint32_t caps) {
+  ecrf_heap_check();
+  return __real_heap_caps_realloc(ptr, size, caps);
+}
+#endif /* ECRF_HEAP_GUARD */
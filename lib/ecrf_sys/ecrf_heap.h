@@ -0,0 +1,30 @@
+#ifndef _ECRF_HEAP_H
+#define _ECRF_HEAP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Heap guard: build with -DECRF_HEAP_GUARD=1 to assert that nothing is
+ * allocated from the heap once boot is over. extra_script.py then wraps the
+ * allocators at link time. Code that must go through an allocating IDF API
+ * (NVS handles) brackets it with pause/resume; the allocation is expected
+ * to be released before resuming.
+ */
+#ifndef ECRF_HEAP_GUARD
+#define ECRF_HEAP_GUARD 0
+#endif
+
+void ecrf_heap_guard_arm(void);
+bool ecrf_heap_guard_armed(void);
+void ecrf_heap_guard_pause(void);
+void ecrf_heap_guard_resume(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_HEAP_H */
@@ -0,0 +1,136 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <esp_timer.h>
+
+#include "ecrf_log.h"
+
+struct s_ecrf_log_record {
+  const char *fmt;
+  uint32_t time_us;
+  /* index + 1 once the record is complete */
+  uint32_t seq;
+  uint8_t level;
+  uint8_t nargs;
+  uint32_t args[ECRF_LOG_MAX_ARGS];
+};
+
+/*
+ * Tasks and ISRs of the same core preempt each other, and a task may move
+ * to the other core between picking a ring and reserving a slot: slots are
+ * reserved with a CAS, the ring is multi-producer. Per-core rings keep the
+ * two cores off each other's cache lines and spinlocks.
+ */
+struct s_ecrf_log_ring {
+  struct s_ecrf_log_record records[ECRF_LOG_RECORDS];
+  uint32_t head;
+  uint32_t tail;
+  uint32_t logged;
+  uint32_t dropped;
+  /* consumer side */
+  uint32_t reported;
+};
+
+static struct s_ecrf_log_ring ecrf_log_rings[portNUM_PROCESSORS];
+
+static const char ecrf_log_levels[] = {' ', 'E', 'W', 'I', 'D'};
+
+void IRAM_ATTR ecrf_log_write(uint8_t level, const char *fmt, int nargs, ...) {
+  struct s_ecrf_log_ring *ring = &ecrf_log_rings[xPortGetCoreID()];
+  uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+  va_list ap;
+
+  do {
+    if ((head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) >= ECRF_LOG_RECORDS) {
+      __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+  } while (!__atomic_compare_exchange_n(&ring->head, &head, head + 1, true, __ATOMIC_ACQUIRE,
+                                        __ATOMIC_RELAXED));
+
+  struct s_ecrf_log_record *record = &ring->records[head % ECRF_LOG_RECORDS];
+  record->fmt = fmt;
+  record->time_us = (uint32_t)esp_timer_get_time();
+  record->level = level;
+  record->nargs = nargs;
+  va_start(ap, nargs);
+  for (int i = 0; i < nargs; i++) {
+    record->args[i] = va_arg(ap, uint32_t);
+  }
+  va_end(ap);
+
+  __atomic_store_n(&record->seq, head + 1, __ATOMIC_RELEASE);
+  __atomic_fetch_add(&ring->logged, 1, __ATOMIC_RELAXED);
+}
+
+/* the record at the tail of a ring, NULL when empty or still being written */
+static struct s_ecrf_log_record *ecrf_log_peek(struct s_ecrf_log_ring *ring) {
+  uint32_t tail = ring->tail;
+
+  if (tail == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE))
+    return NULL;
+
+  struct s_ecrf_log_record *record = &ring->records[tail % ECRF_LOG_RECORDS];
+  if (__atomic_load_n(&record->seq, __ATOMIC_ACQUIRE) != tail + 1)
+    return NULL;
+
+  return record;
+}
+
+bool ecrf_log_format(char *line, size_t len) {
+  struct s_ecrf_log_ring *oldest = NULL;
+  struct s_ecrf_log_record *next = NULL;
+
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    struct s_ecrf_log_ring *ring = &ecrf_log_rings[core];
+    uint32_t dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    if (dropped != ring->reported) {
+      snprintf(line, len, "[log] core %d: %lu records dropped\n", core,
+               (unsigned long)(dropped - ring->reported));
+      ring->reported = dropped;
+      return true;
+    }
+
+    /* merge the cores by timestamp */
+    struct s_ecrf_log_record *record = ecrf_log_peek(ring);
+    if ((record != NULL) && ((next == NULL) || ((int32_t)(record->time_us - next->time_us) < 0))) {
+      oldest = ring;
+      next = record;
+    }
+  }
+
+  if (next == NULL)
+    return false;
+
+  /* copy out and free the slot before the slow part */
+  struct s_ecrf_log_record record = *next;
+  __atomic_store_n(&oldest->tail, oldest->tail + 1, __ATOMIC_RELEASE);
+
+  int n = snprintf(line, len, "%5lu.%06lu %c ", (unsigned long)(record.time_us / 1000000),
+                   (unsigned long)(record.time_us % 1000000),
+                   ecrf_log_levels[record.level <= ECRF_LOG_DEBUG ? record.level : 0]);
+  if ((n < 0) || ((size_t)n >= len))
+    return true;
+
+  /* unused slots are passed too, printf ignores extra arguments */
+  size_t end = n + snprintf(line + n, len - n, record.fmt, record.args[0], record.args[1],
+                            record.args[2], record.args[3]);
+  end = (end < len - 1) ? end : len - 2;
+  if ((end == 0) || (line[end - 1] != '\n')) {
+    line[end++] = '\n';
+    line[end] = 0;
+  }
+
+  return true;
+}
+
+void ecrf_log_stats(int core, struct s_ecrf_log_stats *stats) {
+  stats->logged = __atomic_load_n(&ecrf_log_rings[core].logged, __ATOMIC_RELAXED);
+  stats->dropped = __atomic_load_n(&ecrf_log_rings[core].dropped, __ATOMIC_RELAXED);
+}
+
+size_t ecrf_log_footprint(void) {
+  return sizeof(ecrf_log_rings);
+}
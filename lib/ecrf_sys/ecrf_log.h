@@ -0,0 +1,75 @@
+#ifndef _ECRF_LOG_H
+#define _ECRF_LOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Deferred log: a call records the format pointer, a timestamp and up to
+ * ECRF_LOG_MAX_ARGS raw 32-bit arguments into a per-core ring, nothing is
+ * formatted on the spot. Safe from tasks and ISRs, never blocks; a full
+ * ring drops the record and counts it. Formatting happens later in
+ * ecrf_log_format(), so arguments must be integers or pointers to strings
+ * that outlive the record (literals), never stack buffers or floats.
+ */
+#define ECRF_LOG_NONE 0
+#define ECRF_LOG_ERROR 1
+#define ECRF_LOG_WARN 2
+#define ECRF_LOG_INFO 3
+#define ECRF_LOG_DEBUG 4
+
+/* calls above the level compile to nothing, arguments are not evaluated */
+#ifndef ECRF_LOG_LEVEL
+#if defined(CC1101_DEBUG) && CC1101_DEBUG
+#define ECRF_LOG_LEVEL ECRF_LOG_DEBUG
+#else
+#define ECRF_LOG_LEVEL ECRF_LOG_INFO
+#endif
+#endif
+
+/* records per core, a power of two */
+#ifndef ECRF_LOG_RECORDS
+#define ECRF_LOG_RECORDS 64
+#endif
+
+#define ECRF_LOG_MAX_ARGS 4
+
+#define ECRF_LOG_NARGS(...) ECRF_LOG_NARGS_(0, ##__VA_ARGS__, ECRF_LOG_TOO_MANY_ARGS, 4, 3, 2, 1, 0)
+#define ECRF_LOG_NARGS_(_0, _1, _2, _3, _4, _5, n, ...) n
+
+#define ECRF_LOG(level, fmt, ...)                                                       \
+  do {                                                                                  \
+    if ((level) <= ECRF_LOG_LEVEL)                                                      \
+      ecrf_log_write((level), (fmt), ECRF_LOG_NARGS(__VA_ARGS__), ##__VA_ARGS__);       \
+  } while (0)
+
+#define ECRF_LOGE(fmt, ...) ECRF_LOG(ECRF_LOG_ERROR, fmt, ##__VA_ARGS__)
+#define ECRF_LOGW(fmt, ...) ECRF_LOG(ECRF_LOG_WARN, fmt, ##__VA_ARGS__)
+#define ECRF_LOGI(fmt, ...) ECRF_LOG(ECRF_LOG_INFO, fmt, ##__VA_ARGS__)
+#define ECRF_LOGD(fmt, ...) ECRF_LOG(ECRF_LOG_DEBUG, fmt, ##__VA_ARGS__)
+
+struct s_ecrf_log_stats {
+  uint32_t logged;
+  uint32_t dropped;
+};
+
+void ecrf_log_write(uint8_t level, const char *fmt, int nargs, ...)
+    __attribute__((format(printf, 2, 4)));
+/*
+ * Pop the oldest pending record of any core and format it into line,
+ * newline terminated. Reports drops first. One consumer only, the log
+ * task. Returns false when there is nothing to print.
+ */
+bool ecrf_log_format(char *line, size_t len);
+void ecrf_log_stats(int core, struct s_ecrf_log_stats *stats);
+size_t ecrf_log_footprint(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_LOG_H */
@@ -0,0 +1,101 @@
+#include "ecrf_tasks.h"
+
+static StackType_t ecrf_shell_stack[ECRF_TASK_STACK_WORDS(ECRF_TASK_SHELL_STACK)];
+static StackType_t ecrf_sink_stack[ECRF_TASK_STACK_WORDS(ECRF_TASK_SINK_STACK)];
+static StackType_t ecrf_survey_stack[ECRF_TASK_STACK_WORDS(ECRF_TASK_SURVEY_STACK)];
+static StackType_t ecrf_net_stack[ECRF_TASK_STACK_WORDS(ECRF_TASK_NET_STACK)];
+static StackType_t ecrf_led_stack[ECRF_TASK_STACK_WORDS(ECRF_TASK_LED_STACK)];
+static StackType_t ecrf_log_stack[ECRF_TASK_STACK_WORDS(ECRF_TASK_LOG_STACK)];
+static StaticTask_t ecrf_task_tcbs[ECRF_TASK_COUNT];
+
+/* The one place where task priorities are decided, highest first */
+static const struct s_ecrf_task_plan ecrf_task_plans[ECRF_TASK_COUNT] = {
+    [ECRF_TASK_RX] = {
+        .name = "eCC1101 RX",
+        .core = ECRF_RX_CORE,
+        .priority = configMAX_PRIORITIES - 10,
+        .stack = ECRF_TASK_RX_STACK,
+        .stack_buffer = NULL,
+    },
+    [ECRF_TASK_SCHED] = {
+        .name = "Scheduler",
+        .core = ECRF_CONSOLE_CORE,
+        .priority = configMAX_PRIORITIES - 11,
+        .stack = ECRF_TASK_SCHED_STACK,
+        .stack_buffer = NULL,
+    },
+    [ECRF_TASK_SHELL] = {
+        .name = "Shell",
+        .core = ECRF_CONSOLE_CORE,
+        .priority = configMAX_PRIORITIES - 12,
+        .stack = ECRF_TASK_SHELL_STACK,
+        .stack_buffer = ecrf_shell_stack,
+    },
+    [ECRF_TASK_SINK] = {
+        .name = "Sinks",
+        .core = ECRF_CONSOLE_CORE,
+        .priority = 4,
+        .stack = ECRF_TASK_SINK_STACK,
+        .stack_buffer = ecrf_sink_stack,
+    },
+    [ECRF_TASK_SURVEY] = {
+        .name = "Survey",
+        .core = ECRF_CONSOLE_CORE,
+        .priority = 3,
+        .stack = ECRF_TASK_SURVEY_STACK,
+        .stack_buffer = ecrf_survey_stack,
+    },
+    [ECRF_TASK_NET] = {
+        .name = "Net shell",
+        .core = ECRF_CONSOLE_CORE,
+        .priority = 3,
+        .stack = ECRF_TASK_NET_STACK,
+        .stack_buffer = ecrf_net_stack,
+    },
+    [ECRF_TASK_LED] = {
+        .name = "Toggle LED",
+        .core = ECRF_CONSOLE_CORE,
+        .priority = 2,
+        .stack = ECRF_TASK_LED_STACK,
+        .stack_buffer = ecrf_led_stack,
+    },
+    [ECRF_TASK_LOG] = {
+        .name = "Log",
+        .core = ECRF_CONSOLE_CORE,
+        .priority = 1,
+        .stack = ECRF_TASK_LOG_STACK,
+        .stack_buffer = ecrf_log_stack,
+    },
+};
+
+const struct s_ecrf_task_plan *ecrf_task_plan(enum ecrf_task_id id) {
+  configASSERT(id < ECRF_TASK_COUNT);
+  return &ecrf_task_plans[id];
+}
+
+BaseType_t ecrf_task_create(enum ecrf_task_id id, TaskFunction_t fn, void *param,
+                            TaskHandle_t *handle) {
+  const struct s_ecrf_task_plan *plan = ecrf_task_plan(id);
+
+  configASSERT(plan->stack_buffer != NULL);
+  TaskHandle_t task = ecrf_task_create_static(id, fn, param, plan->stack_buffer,
+                                              &ecrf_task_tcbs[id]);
+  if (handle != NULL)
+    *handle = task;
+
+  return (task != NULL) ? pdPASS : pdFAIL;
+}
+
+TaskHandle_t ecrf_task_create_static(enum ecrf_task_id id, TaskFunction_t fn, void *param,
+                                     StackType_t *stack, StaticTask_t *tcb) {
+  const struct s_ecrf_task_plan *plan = ecrf_task_plan(id);
+
+  return xTaskCreateStaticPinnedToCore(fn, plan->name, plan->stack, param,
+                                       plan->priority, stack, tcb, plan->core);
+}
+
+size_t ecrf_task_footprint(void) {
+  return sizeof(ecrf_shell_stack) + sizeof(ecrf_sink_stack) + sizeof(ecrf_survey_stack) +
+         sizeof(ecrf_net_stack) + sizeof(ecrf_led_stack) + sizeof(ecrf_log_stack) +
+         sizeof(ecrf_task_tcbs);
+}
@@ -0,0 +1,94 @@
+#ifndef _ECRF_TASKS_H
+#define _ECRF_TASKS_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Core affinity and priority plan. RX draining runs on one core, the console
+ * and housekeeping on the other one, next to the WiFi/BT stacks (PRO_CPU).
+ * Override ECRF_RX_CORE / ECRF_CONSOLE_CORE from build_flags, use
+ * tskNO_AFFINITY to let the scheduler pick.
+ */
+#ifndef ECRF_RX_CORE
+#define ECRF_RX_CORE 1
+#endif
+
+#ifndef ECRF_CONSOLE_CORE
+#define ECRF_CONSOLE_CORE 0
+#endif
+
+/* stack sizes in bytes, the stacks themselves are static */
+#ifndef ECRF_TASK_RX_STACK
+#define ECRF_TASK_RX_STACK 4096
+#endif
+
+#ifndef ECRF_TASK_SCHED_STACK
+#define ECRF_TASK_SCHED_STACK 3072
+#endif
+
+#ifndef ECRF_TASK_SHELL_STACK
+#define ECRF_TASK_SHELL_STACK 4096
+#endif
+
+#ifndef ECRF_TASK_SURVEY_STACK
+#define ECRF_TASK_SURVEY_STACK 3072
+#endif
+
+#ifndef ECRF_TASK_SINK_STACK
+#define ECRF_TASK_SINK_STACK 3072
+#endif
+
+/* select() and the line callback, the commands run in the shell task */
+#ifndef ECRF_TASK_NET_STACK
+#define ECRF_TASK_NET_STACK 3072
+#endif
+
+#ifndef ECRF_TASK_LOG_STACK
+#define ECRF_TASK_LOG_STACK 3072
+#endif
+
+#ifndef ECRF_TASK_LED_STACK
+#define ECRF_TASK_LED_STACK 1008
+#endif
+
+#define ECRF_TASK_STACK_WORDS(bytes) ((bytes) / sizeof(StackType_t))
+
+enum ecrf_task_id {
+  ECRF_TASK_RX,
+  ECRF_TASK_SCHED,
+  ECRF_TASK_SHELL,
+  ECRF_TASK_SINK,
+  ECRF_TASK_SURVEY,
+  ECRF_TASK_NET,
+  ECRF_TASK_LED,
+  ECRF_TASK_LOG,
+  ECRF_TASK_COUNT,
+};
+
+struct s_ecrf_task_plan {
+  const char *name;
+  BaseType_t core;
+  UBaseType_t priority;
+  uint32_t stack;
+  /* static stack of single instance tasks, NULL when owned by the caller */
+  StackType_t *stack_buffer;
+};
+
+const struct s_ecrf_task_plan *ecrf_task_plan(enum ecrf_task_id id);
+/* single instance tasks, stack and TCB come from the plan */
+BaseType_t ecrf_task_create(enum ecrf_task_id id, TaskFunction_t fn, void *param,
+                            TaskHandle_t *handle);
+/* per-object tasks (one RX task per radio): the caller owns stack and TCB */
+TaskHandle_t ecrf_task_create_static(enum ecrf_task_id id, TaskFunction_t fn, void *param,
+                                     StackType_t *stack, StaticTask_t *tcb);
+size_t ecrf_task_footprint(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_TASKS_H */
@@ -0,0 +1,33 @@
+#include "ecrf_afc.h"
+
+void ecrf_afc_reset(struct s_ecrf_afc *afc, int8_t limit, uint8_t gain_shift) {
+  afc->correction = 0;
+  afc->limit = (limit < 0) ? -limit : limit;
+  afc->gain_shift = gain_shift;
+  afc->bursts = 0;
+}
+
+int16_t ecrf_afc_offset(const struct s_ecrf_afc *afc, int8_t freqest) {
+  return (int16_t)afc->correction + freqest;
+}
+
+int8_t ecrf_afc_update(struct s_ecrf_afc *afc, int8_t freqest) {
+  /* rounded to nearest both ways, a one step estimate still moves at half gain */
+  int16_t half = (afc->gain_shift > 0) ? (1 << (afc->gain_shift - 1)) : 0;
+  int16_t step = (freqest >= 0) ? ((freqest + half) >> afc->gain_shift)
+                                : -((-freqest + half) >> afc->gain_shift);
+  int16_t correction = afc->correction + step;
+
+  if (correction > afc->limit)
+    correction = afc->limit;
+  if (correction < -afc->limit)
+    correction = -afc->limit;
+
+  afc->correction = (int8_t)correction;
+  afc->bursts++;
+  return afc->correction;
+}
+
+int32_t ecrf_afc_hz(int16_t steps) {
+  return (int32_t)(((int64_t)steps * ECRF_AFC_XOSC_HZ) / 16384);
+}
@@ -0,0 +1,39 @@
+#ifndef _ECRF_AFC_H
+#define _ECRF_AFC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Frequency offset tracking across bursts. The CC1101 estimates the offset
+ * of the carrier it is locked on in FREQEST, relative to the synthesizer
+ * including the FSCTRL0 (FREQOFF) correction, in steps of fXOSC / 2^14
+ * (1587 Hz). Folding each burst's estimate into FSCTRL0 keeps a drifting
+ * transmitter in the middle of a narrow channel filter. FSK only: OOK has
+ * no frequency to estimate.
+ */
+#ifndef ECRF_AFC_XOSC_HZ
+#define ECRF_AFC_XOSC_HZ 26000000
+#endif
+
+struct s_ecrf_afc {
+  int8_t correction; /* FSCTRL0 */
+  int8_t limit;      /* largest correction either way */
+  uint8_t gain_shift; /* each estimate moves the correction by 1/2^gain_shift of it */
+  uint32_t bursts;
+};
+
+void ecrf_afc_reset(struct s_ecrf_afc *afc, int8_t limit, uint8_t gain_shift);
+/* carrier offset from the nominal frequency of a burst read with the current correction */
+int16_t ecrf_afc_offset(const struct s_ecrf_afc *afc, int8_t freqest);
+/* folds a burst's FREQEST into the correction, returns the next FSCTRL0 */
+int8_t ecrf_afc_update(struct s_ecrf_afc *afc, int8_t freqest);
+int32_t ecrf_afc_hz(int16_t steps);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_AFC_H */
@@ -0,0 +1,46 @@
+#include "ecrf_frame.h"
+
+static void ecrf_frame_put16(uint8_t *out, uint16_t value) {
+  out[0] = (uint8_t)value;
+  out[1] = (uint8_t)(value >> 8);
+}
+
+static void ecrf_frame_put32(uint8_t *out, uint32_t value) {
+  ecrf_frame_put16(out, (uint16_t)value);
+  ecrf_frame_put16(out + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t ecrf_frame_get16(const uint8_t *in) {
+  return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t ecrf_frame_get32(const uint8_t *in) {
+  return ecrf_frame_get16(in) | ((uint32_t)ecrf_frame_get16(in + 2) << 16);
+}
+
+void ecrf_frame_encode(uint8_t *out, const struct s_ecrf_frame *frame) {
+  out[0] = ECRF_FRAME_MAGIC0;
+  out[1] = ECRF_FRAME_MAGIC1;
+  out[2] = ECRF_FRAME_VERSION;
+  out[3] = frame->flags;
+  out[4] = frame->radio;
+  out[5] = 0;
+  ecrf_frame_put16(out + 6, frame->len);
+  ecrf_frame_put32(out + 8, frame->seq);
+  ecrf_frame_put32(out + 12, frame->offset);
+  ecrf_frame_put32(out + 16, frame->lost);
+}
+
+bool ecrf_frame_decode(const uint8_t *in, size_t len, struct s_ecrf_frame *frame) {
+  if ((len < ECRF_FRAME_HEADER) || (in[0] != ECRF_FRAME_MAGIC0) || (in[1] != ECRF_FRAME_MAGIC1) ||
+      (in[2] != ECRF_FRAME_VERSION))
+    return false;
+
+  frame->flags = in[3];
+  frame->radio = in[4];
+  frame->len = ecrf_frame_get16(in + 6);
+  frame->seq = ecrf_frame_get32(in + 8);
+  frame->offset = ecrf_frame_get32(in + 12);
+  frame->lost = ecrf_frame_get32(in + 16);
+  return true;
+}
@@ -0,0 +1,52 @@
+#ifndef _ECRF_FRAME_H
+#define _ECRF_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Network framing of raw session data: a fixed header ahead of each chunk,
+ * the same on a TCP stream and in UDP datagrams (one frame each). Fields
+ * are little endian whatever the host, a receiver resyncs on the magic.
+ *
+ *   0  'E' 'C'   magic
+ *   2  version
+ *   3  flags     ECRF_FRAME_*
+ *   4  radio     module id of the session
+ *   5  reserved  0
+ *   6  len       payload bytes following the header
+ *   8  seq       frame count of the stream, gaps in it are lost datagrams
+ *  12  offset    stream offset of the first payload byte
+ *  16  lost      bytes lost right before the payload
+ */
+#define ECRF_FRAME_MAGIC0 'E'
+#define ECRF_FRAME_MAGIC1 'C'
+#define ECRF_FRAME_VERSION 1
+#define ECRF_FRAME_HEADER 20
+
+/* lost is non zero, the payload does not follow the previous frame */
+#define ECRF_FRAME_GAP 0x01
+
+struct s_ecrf_frame {
+  uint8_t flags;
+  uint8_t radio;
+  uint16_t len;
+  uint32_t seq;
+  uint32_t offset;
+  uint32_t lost;
+};
+
+/* writes the ECRF_FRAME_HEADER bytes of the header */
+void ecrf_frame_encode(uint8_t *out, const struct s_ecrf_frame *frame);
+/* false on a short buffer, a wrong magic or an unknown version */
+bool ecrf_frame_decode(const uint8_t *in, size_t len, struct s_ecrf_frame *frame);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_FRAME_H */
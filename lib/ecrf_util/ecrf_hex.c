@@ -0,0 +1,14 @@
+#include "ecrf_hex.h"
+
+static const char ecrf_hex_digits[] = "0123456789abcdef";
+
+size_t ecrf_hex_encode(char *dst, const uint8_t *src, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    uint8_t byte = src[i];
+    dst[2 * i] = ecrf_hex_digits[byte >> 4];
+    dst[2 * i + 1] = ecrf_hex_digits[byte & 0x0F];
+  }
+  dst[2 * len] = 0;
+
+  return 2 * len;
+}
@@ -0,0 +1,21 @@
+#ifndef _ECRF_HEX_H
+#define _ECRF_HEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Lower case hex dump of len bytes, NUL terminated: dst needs 2 * len + 1
+ * bytes. Returns 2 * len. Expanding in place works when src sits at least
+ * len bytes past dst, each byte is read before its digits are written.
+ */
+size_t ecrf_hex_encode(char *dst, const uint8_t *src, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_HEX_H */
@@ -0,0 +1,127 @@
+#include <string.h>
+#include "ecrf_ring.h"
+
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
+void ecrf_ring_init(struct s_ecrf_ring *ring, uint8_t *buf, uint32_t size) {
+  ring->buf = buf;
+  ring->size = size;
+  ring->head = 0;
+  ring->reserve = 0;
+  ring->tail = 0;
+}
+
+uint32_t ecrf_ring_floor_pow2(uint32_t size) {
+  uint32_t pow2 = 1;
+
+  if (size == 0)
+    return 0;
+
+  while (pow2 <= size / 2)
+    pow2 <<= 1;
+
+  return pow2;
+}
+
+uint32_t ecrf_ring_used(const struct s_ecrf_ring *ring) {
+  uint32_t used = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) -
+                  __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+  return MIN(used, ring->size);
+}
+
+uint32_t ecrf_ring_free(const struct s_ecrf_ring *ring) {
+  return ring->size - ecrf_ring_used(ring);
+}
+
+static void ecrf_ring_copy_in(struct s_ecrf_ring *ring, uint32_t offset, const uint8_t *data,
+                              size_t len) {
+  uint32_t pos = offset % ring->size;
+  size_t first = MIN(len, (size_t)(ring->size - pos));
+
+  memcpy(&ring->buf[pos], data, first);
+  memcpy(ring->buf, data + first, len - first);
+}
+
+static void ecrf_ring_copy_out(const struct s_ecrf_ring *ring, uint32_t offset, uint8_t *data,
+                               size_t len) {
+  uint32_t pos = offset % ring->size;
+  size_t first = MIN(len, (size_t)(ring->size - pos));
+
+  memcpy(data, &ring->buf[pos], first);
+  memcpy(data + first, ring->buf, len - first);
+}
+
+size_t ecrf_ring_write(struct s_ecrf_ring *ring, const uint8_t *data, size_t len, bool overwrite) {
+  uint32_t head = ring->head;
+  size_t taken = len;
+
+  if (!overwrite) {
+    uint32_t room = ring->size - (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE));
+    len = MIN(len, (size_t)room);
+    taken = len;
+  } else if (len > ring->size) {
+    /* only the newest size bytes survive */
+    head += len - ring->size;
+    data += len - ring->size;
+    len = ring->size;
+  }
+
+  /* announce the overwrite before touching the bytes a reader may be copying */
+  __atomic_store_n(&ring->reserve, head + len, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  ecrf_ring_copy_in(ring, head, data, len);
+  __atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+
+  return taken;
+}
+
+static size_t ecrf_ring_copy_from(const struct s_ecrf_ring *ring, volatile uint32_t *cursor,
+                                  uint8_t *data, size_t len, uint32_t *lost) {
+  *lost = 0;
+
+  for (;;) {
+    uint32_t tail = *cursor;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    if ((head - tail) > ring->size) {
+      *lost = head - ring->size - tail;
+      __atomic_store_n(cursor, head - ring->size, __ATOMIC_RELEASE);
+      return 0;
+    }
+
+    len = MIN(len, (size_t)(head - tail));
+    ecrf_ring_copy_out(ring, tail, data, len);
+
+    /* torn copy: the producer got there meanwhile, the next pass sees the lap */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if ((__atomic_load_n(&ring->reserve, __ATOMIC_RELAXED) - tail) > ring->size)
+      continue;
+
+    return len;
+  }
+}
+
+size_t ecrf_ring_read(struct s_ecrf_ring *ring, uint8_t *data, size_t len, uint32_t *lost) {
+  len = ecrf_ring_copy_from(ring, &ring->tail, data, len, lost);
+  __atomic_store_n(&ring->tail, ring->tail + len, __ATOMIC_RELEASE);
+
+  return len;
+}
+
+void ecrf_ring_cursor_init(const struct s_ecrf_ring *ring, struct s_ecrf_ring_cursor *cursor) {
+  cursor->tail = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+}
+
+uint32_t ecrf_ring_lag(const struct s_ecrf_ring *ring, const struct s_ecrf_ring_cursor *cursor) {
+  return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - cursor->tail;
+}
+
+size_t ecrf_ring_peek(const struct s_ecrf_ring *ring, struct s_ecrf_ring_cursor *cursor,
+                      uint8_t *data, size_t len, uint32_t *lost) {
+  return ecrf_ring_copy_from(ring, &cursor->tail, data, len, lost);
+}
+
+void ecrf_ring_advance(struct s_ecrf_ring_cursor *cursor, size_t len) {
+  cursor->tail += len;
+}
@@ -0,0 +1,65 @@
+#ifndef _ECRF_RING_H
+#define _ECRF_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Single producer, single consumer byte ring with free running 32-bit
+ * offsets: head counts bytes ever written, tail bytes ever consumed, both
+ * are stream offsets. The producer may overwrite unread data; the consumer
+ * then learns how much it lost on its next read. Offsets wrap after 4 GiB,
+ * only sizes that divide 2^32 (powers of two) stay consistent past that.
+ * Lock free, no platform dependency: waking up the other side is left to
+ * the caller.
+ */
+struct s_ecrf_ring {
+  uint8_t *buf;
+  uint32_t size;
+  volatile uint32_t head;
+  /* end of the write in progress, lets readers detect torn copies */
+  volatile uint32_t reserve;
+  volatile uint32_t tail;
+};
+
+void ecrf_ring_init(struct s_ecrf_ring *ring, uint8_t *buf, uint32_t size);
+/* largest power of two not above size */
+uint32_t ecrf_ring_floor_pow2(uint32_t size);
+uint32_t ecrf_ring_used(const struct s_ecrf_ring *ring);
+uint32_t ecrf_ring_free(const struct s_ecrf_ring *ring);
+/*
+ * Producer side. Without overwrite, writes what fits and returns it; with
+ * overwrite, always takes the whole len and pushes the oldest bytes out.
+ */
+size_t ecrf_ring_write(struct s_ecrf_ring *ring, const uint8_t *data, size_t len, bool overwrite);
+/*
+ * Consumer side. When the producer lapped the reader, nothing is read, the
+ * tail jumps to the oldest byte still held and *lost tells how far.
+ */
+size_t ecrf_ring_read(struct s_ecrf_ring *ring, uint8_t *data, size_t len, uint32_t *lost);
+
+/*
+ * Extra readers: each one has its own cursor and never holds the producer
+ * back, a reader that is too slow gets lapped and loses data.
+ */
+struct s_ecrf_ring_cursor {
+  volatile uint32_t tail;
+};
+
+/* starts at the current end of the stream */
+void ecrf_ring_cursor_init(const struct s_ecrf_ring *ring, struct s_ecrf_ring_cursor *cursor);
+uint32_t ecrf_ring_lag(const struct s_ecrf_ring *ring, const struct s_ecrf_ring_cursor *cursor);
+/* copies without consuming, lapping is handled like ecrf_ring_read() */
+size_t ecrf_ring_peek(const struct s_ecrf_ring *ring, struct s_ecrf_ring_cursor *cursor,
+                      uint8_t *data, size_t len, uint32_t *lost);
+void ecrf_ring_advance(struct s_ecrf_ring_cursor *cursor, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_RING_H */
@@ -0,0 +1,87 @@
+#include <string.h>
+#include "ecrf_sched.h"
+
+void ecrf_sched_init(struct s_ecrf_sched *sched) {
+  memset(sched, 0, sizeof(*sched));
+}
+
+int ecrf_sched_add(struct s_ecrf_sched *sched, uint32_t slot_us) {
+  if ((slot_us == 0) || (sched->count >= ECRF_SCHED_MAX_SESSIONS))
+    return -1;
+
+  struct s_ecrf_sched_session *session = &sched->session[sched->count];
+  memset(session, 0, sizeof(*session));
+  session->slot_us = slot_us;
+  return (int)sched->count++;
+}
+
+void ecrf_sched_start(struct s_ecrf_sched *sched, int64_t now_us) {
+  for (size_t i = 0; i < sched->count; i++) {
+    uint32_t slot_us = sched->session[i].slot_us;
+    memset(&sched->session[i], 0, sizeof(sched->session[i]));
+    sched->session[i].slot_us = slot_us;
+  }
+  sched->next = 0;
+  sched->start_us = now_us;
+}
+
+size_t ecrf_sched_next(struct s_ecrf_sched *sched) {
+  size_t index = sched->next;
+
+  sched->next = (sched->count > 0) ? (index + 1) % sched->count : 0;
+  return index;
+}
+
+void ecrf_sched_account(struct s_ecrf_sched *sched, size_t index, int64_t begin_us,
+                        int64_t tuned_us, int64_t end_us) {
+  struct s_ecrf_sched_session *session = &sched->session[index];
+  uint32_t switch_us = (uint32_t)(tuned_us - begin_us);
+
+  /* deaf from the end of its previous slot until tuned again */
+  if (session->slots > 0) {
+    uint32_t revisit = (uint32_t)(tuned_us - session->last_end_us);
+    if (revisit > session->revisit_max_us)
+      session->revisit_max_us = revisit;
+  }
+  if (switch_us > session->switch_max_us)
+    session->switch_max_us = switch_us;
+  session->switch_us += switch_us;
+  session->on_air_us += (uint64_t)(end_us - tuned_us);
+  session->last_end_us = end_us;
+  session->slots++;
+}
+
+uint32_t ecrf_sched_cycle_us(const struct s_ecrf_sched *sched) {
+  uint32_t cycle = 0;
+
+  for (size_t i = 0; i < sched->count; i++)
+    cycle += sched->session[i].slot_us;
+  return cycle;
+}
+
+uint32_t ecrf_sched_revisit_us(const struct s_ecrf_sched *sched, size_t index) {
+  return ecrf_sched_cycle_us(sched) - sched->session[index].slot_us;
+}
+
+uint16_t ecrf_sched_planned_permille(const struct s_ecrf_sched *sched, size_t index) {
+  uint32_t cycle = ecrf_sched_cycle_us(sched);
+
+  if (cycle == 0)
+    return 0;
+  return (uint16_t)(((uint64_t)sched->session[index].slot_us * 1000) / cycle);
+}
+
+uint16_t ecrf_sched_duty_permille(const struct s_ecrf_sched *sched, size_t index, int64_t now_us) {
+  int64_t elapsed = now_us - sched->start_us;
+
+  if (elapsed <= 0)
+    return 0;
+  return (uint16_t)((sched->session[index].on_air_us * 1000) / (uint64_t)elapsed);
+}
+
+uint32_t ecrf_sched_switch_mean_us(const struct s_ecrf_sched_session *session) {
+  if (session->slots == 0)
+    return 0;
+
+  return (uint32_t)(session->switch_us / session->slots);
+}
@@ -0,0 +1,66 @@
+#ifndef _ECRF_SCHED_H
+#define _ECRF_SCHED_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Time slicing of one radio between logical sessions: each session owns a
+ * slot of slot_us, slots run round-robin, so a session is deaf for at most
+ * the other slots of the cycle plus the retunes in between. The plan and
+ * its accounting only, the caller retunes and keeps time (microseconds).
+ */
+#ifndef ECRF_SCHED_MAX_SESSIONS
+#define ECRF_SCHED_MAX_SESSIONS 8
+#endif
+
+struct s_ecrf_sched_session {
+  uint32_t slot_us;
+  /* accounting since ecrf_sched_start() */
+  uint32_t slots;
+  uint64_t on_air_us;
+  uint64_t switch_us;
+  uint32_t switch_max_us;
+  uint32_t revisit_max_us; /* longest time between two of its slots, deaf */
+  int64_t last_end_us;
+};
+
+struct s_ecrf_sched {
+  size_t count;
+  size_t next;
+  int64_t start_us;
+  struct s_ecrf_sched_session session[ECRF_SCHED_MAX_SESSIONS];
+};
+
+void ecrf_sched_init(struct s_ecrf_sched *sched);
+/* index of the new session, -1 when full or for an empty slot */
+int ecrf_sched_add(struct s_ecrf_sched *sched, uint32_t slot_us);
+/* clears the accounting, the plan is kept */
+void ecrf_sched_start(struct s_ecrf_sched *sched, int64_t now_us);
+/* session of the next slot */
+size_t ecrf_sched_next(struct s_ecrf_sched *sched);
+/*
+ * One slot done: the retune was requested at begin_us, the radio listened
+ * for the session from tuned_us to end_us.
+ */
+void ecrf_sched_account(struct s_ecrf_sched *sched, size_t index, int64_t begin_us,
+                        int64_t tuned_us, int64_t end_us);
+/* sum of the slots, retunes excluded */
+uint32_t ecrf_sched_cycle_us(const struct s_ecrf_sched *sched);
+/* planned worst case between two slots of a session, retunes excluded */
+uint32_t ecrf_sched_revisit_us(const struct s_ecrf_sched *sched, size_t index);
+/* share of the cycle, then share of the time since start actually on air */
+uint16_t ecrf_sched_planned_permille(const struct s_ecrf_sched *sched, size_t index);
+uint16_t ecrf_sched_duty_permille(const struct s_ecrf_sched *sched, size_t index, int64_t now_us);
+/* mean retune cost of a session */
+uint32_t ecrf_sched_switch_mean_us(const struct s_ecrf_sched_session *session);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_SCHED_H */
@@ -0,0 +1,67 @@
+#include <string.h>
+#include "ecrf_survey.h"
+
+void ecrf_survey_reset(struct s_ecrf_survey *survey, size_t channels, int16_t threshold,
+                       uint32_t now_ms) {
+  memset(survey, 0, sizeof(*survey));
+  survey->channels = (channels < ECRF_SURVEY_MAX_CHANNELS) ? channels : ECRF_SURVEY_MAX_CHANNELS;
+  survey->threshold = threshold;
+  survey->start_ms = now_ms;
+}
+
+void ecrf_survey_add(struct s_ecrf_survey *survey, const int16_t *channel_rssi, uint32_t now_ms) {
+  for (size_t i = 0; i < survey->channels; i++) {
+    struct s_ecrf_survey_channel *channel = &survey->channel[i];
+    int16_t rssi = channel_rssi[i];
+
+    if (rssi <= survey->threshold)
+      continue;
+
+    if ((channel->hits == 0) || (rssi > channel->rssi_max))
+      channel->rssi_max = rssi;
+    channel->hits++;
+    channel->rssi_sum += rssi;
+    channel->last_seen_ms = now_ms;
+  }
+  survey->sweeps++;
+}
+
+int16_t ecrf_survey_mean(const struct s_ecrf_survey_channel *channel) {
+  if (channel->hits == 0)
+    return 0;
+
+  return (int16_t)(channel->rssi_sum / (int32_t)channel->hits);
+}
+
+static int ecrf_survey_before(const struct s_ecrf_survey_channel *a,
+                              const struct s_ecrf_survey_channel *b) {
+  if (a->hits != b->hits)
+    return a->hits > b->hits;
+
+  return a->rssi_max > b->rssi_max;
+}
+
+size_t ecrf_survey_top(const struct s_ecrf_survey *survey, uint8_t *top, size_t k) {
+  size_t count = 0;
+
+  /* insertion into a sorted window of k entries, k is small */
+  for (size_t i = 0; i < survey->channels; i++) {
+    const struct s_ecrf_survey_channel *channel = &survey->channel[i];
+    if (channel->hits == 0)
+      continue;
+
+    size_t pos = count;
+    while ((pos > 0) && ecrf_survey_before(channel, &survey->channel[top[pos - 1]]))
+      pos--;
+    if (pos >= k)
+      continue;
+
+    size_t last = (count < k) ? count : k - 1;
+    memmove(&top[pos + 1], &top[pos], last - pos);
+    top[pos] = (uint8_t)i;
+    if (count < k)
+      count++;
+  }
+
+  return count;
+}
@@ -0,0 +1,49 @@
+#ifndef _ECRF_SURVEY_H
+#define _ECRF_SURVEY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Site survey: per channel activity accumulated over many sweeps of the scan
+ * table, in a fixed-size structure. A channel scores a hit each time a sweep
+ * reads it above the threshold; mean RSSI is taken over the hits only.
+ */
+#ifndef ECRF_SURVEY_MAX_CHANNELS
+#define ECRF_SURVEY_MAX_CHANNELS 64
+#endif
+
+struct s_ecrf_survey_channel {
+  uint32_t hits;
+  int32_t rssi_sum; /* ~20M hits before it wraps, weeks of surveying */
+  uint32_t last_seen_ms;
+  int16_t rssi_max;
+};
+
+struct s_ecrf_survey {
+  size_t channels;
+  int16_t threshold;
+  uint32_t sweeps;
+  uint32_t start_ms;
+  struct s_ecrf_survey_channel channel[ECRF_SURVEY_MAX_CHANNELS];
+};
+
+void ecrf_survey_reset(struct s_ecrf_survey *survey, size_t channels, int16_t threshold,
+                       uint32_t now_ms);
+/* one reading per channel, samples at or below the threshold are ignored */
+void ecrf_survey_add(struct s_ecrf_survey *survey, const int16_t *channel_rssi, uint32_t now_ms);
+int16_t ecrf_survey_mean(const struct s_ecrf_survey_channel *channel);
+/*
+ * Most active channels first (hits, then max RSSI), at most k of them and
+ * only channels with hits. Returns the number of indexes written.
+ */
+size_t ecrf_survey_top(const struct s_ecrf_survey *survey, uint8_t *top, size_t k);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_SURVEY_H */
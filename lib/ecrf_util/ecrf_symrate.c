@@ -0,0 +1,200 @@
+#include <string.h>
+#include "ecrf_symrate.h"
+
+void ecrf_symrate_reset(struct s_ecrf_symrate *symrate) {
+  memset(symrate, 0, sizeof(*symrate));
+  symrate->level = ECRF_SYMRATE_NO_LEVEL;
+}
+
+void ecrf_symrate_break(struct s_ecrf_symrate *symrate) {
+  symrate->level = ECRF_SYMRATE_NO_LEVEL;
+  symrate->run = 0;
+}
+
+static void ecrf_symrate_add(struct s_ecrf_symrate *symrate, uint32_t run) {
+  if (run < ECRF_SYMRATE_MIN_RUN) {
+    symrate->glitches++;
+    return;
+  }
+  if (run >= ECRF_SYMRATE_MAX_RUN) {
+    symrate->silences++;
+    return;
+  }
+
+  /* a full bin halves them all, the shape is what matters */
+  if (symrate->hist[run] == UINT16_MAX) {
+    for (size_t i = 0; i < ECRF_SYMRATE_MAX_RUN; i++)
+      symrate->hist[i] /= 2;
+  }
+  symrate->hist[run]++;
+  symrate->runs++;
+}
+
+void ecrf_symrate_feed(struct s_ecrf_symrate *symrate, const uint8_t *data, size_t len) {
+  uint8_t level = symrate->level;
+  uint32_t run = symrate->run;
+  bool whole = symrate->whole;
+
+  for (size_t i = 0; i < len; i++) {
+    uint8_t byte = data[i];
+    /* the run before the first edge started before the capture */
+    if (level == ECRF_SYMRATE_NO_LEVEL) {
+      level = byte >> 7;
+      run = 0;
+      whole = false;
+    }
+
+    /* a byte at a time inside a run, else from edge to edge */
+    unsigned left = 8;
+    uint8_t ones = level ? 0xFF : 0x00;
+    while (left > 0) {
+      uint8_t edges = (uint8_t)((byte ^ ones) & (0xFF >> (8 - left)));
+      unsigned same = edges ? (unsigned)__builtin_clz((uint32_t)edges << 24) - (8 - left) : left;
+      run += same;
+      left -= same;
+      if (left == 0)
+        break;
+
+      if (whole)
+        ecrf_symrate_add(symrate, run);
+      whole = true;
+      level ^= 1;
+      ones ^= 0xFF;
+      run = 0;
+    }
+  }
+
+  symrate->level = level;
+  symrate->run = run;
+  symrate->whole = whole;
+}
+
+struct s_ecrf_symrate_fit {
+  uint64_t weight; /* samples in runs on a multiple */
+  uint64_t symbols;
+  uint8_t longest;
+};
+
+/* quantization takes a sample off either edge, on top of the jitter */
+static float ecrf_symrate_slack(float unit, unsigned tolerance) {
+  return unit * tolerance / 100.0f + 1.0f;
+}
+
+static void ecrf_symrate_fit(const struct s_ecrf_symrate *symrate, float unit, unsigned tolerance,
+                             struct s_ecrf_symrate_fit *fit) {
+  float slack = ecrf_symrate_slack(unit, tolerance);
+
+  memset(fit, 0, sizeof(*fit));
+  for (uint32_t run = ECRF_SYMRATE_MIN_RUN; run < ECRF_SYMRATE_MAX_RUN; run++) {
+    if (symrate->hist[run] == 0)
+      continue;
+
+    uint32_t k = (uint32_t)(run / unit + 0.5f);
+    float error = run - k * unit;
+    if ((k == 0) || (k > ECRF_SYMRATE_MAX_SYMBOLS) || (error > slack) || (error < -slack))
+      continue;
+
+    fit->weight += (uint64_t)run * symrate->hist[run];
+    fit->symbols += (uint64_t)k * symrate->hist[run];
+    if (k > fit->longest)
+      fit->longest = (uint8_t)k;
+  }
+}
+
+/* run-weighted count of the bins within the slack of run */
+static uint64_t ecrf_symrate_window(const struct s_ecrf_symrate *symrate, uint32_t run,
+                                    unsigned tolerance, uint64_t *count) {
+  uint32_t slack = (uint32_t)ecrf_symrate_slack(run, tolerance);
+  if (slack >= run)
+    slack = run - 1;
+
+  uint64_t weight = 0;
+  uint32_t last = run + slack;
+  if (last >= ECRF_SYMRATE_MAX_RUN)
+    last = ECRF_SYMRATE_MAX_RUN - 1;
+  if (count != NULL)
+    *count = 0;
+  for (uint32_t i = run - slack; i <= last; i++) {
+    weight += (uint64_t)i * symrate->hist[i];
+    if (count != NULL)
+      *count += symrate->hist[i];
+  }
+
+  return weight;
+}
+
+/*
+ * Next peak from *run on holding its share of the signal: the first run
+ * length over the share, then up its slope. *run is left past its window.
+ */
+static bool ecrf_symrate_peak(const struct s_ecrf_symrate *symrate, unsigned tolerance,
+                              uint64_t total, uint32_t *run, float *centroid) {
+  uint32_t peak = *run;
+  while ((peak < ECRF_SYMRATE_MAX_RUN - 1) &&
+         (ecrf_symrate_window(symrate, peak, tolerance, NULL) * 100 < total * ECRF_SYMRATE_PEAK_SHARE))
+    peak++;
+  if (peak >= ECRF_SYMRATE_MAX_RUN - 1)
+    return false;
+  while ((peak < ECRF_SYMRATE_MAX_RUN - 2) &&
+         (ecrf_symrate_window(symrate, peak + 1, tolerance, NULL) >
+          ecrf_symrate_window(symrate, peak, tolerance, NULL)))
+    peak++;
+
+  uint64_t count;
+  uint64_t weight = ecrf_symrate_window(symrate, peak, tolerance, &count);
+  *centroid = (float)weight / (float)count;
+  *run = peak + (uint32_t)ecrf_symrate_slack(peak, tolerance) + 1;
+  return true;
+}
+
+static void ecrf_symrate_result(const struct s_ecrf_symrate_fit *fit, float unit, uint64_t total,
+                                struct s_ecrf_symrate_estimate *estimate) {
+  estimate->unit = unit;
+  estimate->fit = (uint8_t)(fit->weight * 100 / total);
+  estimate->longest = fit->longest;
+}
+
+bool ecrf_symrate_estimate(const struct s_ecrf_symrate *symrate, unsigned tolerance,
+                           unsigned min_fit, struct s_ecrf_symrate_estimate *estimate) {
+  uint64_t total = symrate->glitches;
+  for (uint32_t run = ECRF_SYMRATE_MIN_RUN; run < ECRF_SYMRATE_MAX_RUN; run++)
+    total += (uint64_t)run * symrate->hist[run];
+
+  memset(estimate, 0, sizeof(*estimate));
+  if (total == 0)
+    return false;
+
+  /* noise, or a signal too fast for the sampling rate */
+  uint64_t short_runs = symrate->glitches;
+  for (uint32_t run = ECRF_SYMRATE_MIN_RUN; run < ECRF_SYMRATE_MIN_UNIT; run++)
+    short_runs += (uint64_t)run * symrate->hist[run];
+  estimate->short_runs = (uint8_t)(short_runs * 100 / total);
+
+  /* a peak of noise explains nothing, the next one is tried */
+  uint32_t from = ECRF_SYMRATE_MIN_UNIT;
+  float centroid;
+  struct s_ecrf_symrate_fit fit;
+  while (ecrf_symrate_peak(symrate, tolerance, total, &from, &centroid)) {
+    /* the largest unit the runs are multiples of: the peak, or a fraction */
+    for (unsigned divisor = 1; divisor <= ECRF_SYMRATE_MAX_DIVISOR; divisor++) {
+      float unit = centroid / divisor;
+      if (unit < ECRF_SYMRATE_MIN_UNIT)
+        break;
+
+      ecrf_symrate_fit(symrate, unit, tolerance, &fit);
+      /* the best guess is still reported when nothing qualifies */
+      if ((divisor == 1) && (fit.weight * 100 / total > estimate->fit))
+        ecrf_symrate_result(&fit, unit, total, estimate);
+      if (fit.weight * 100 < total * min_fit)
+        continue;
+
+      /* the fitted runs averaged into the unit, then their share once more */
+      unit = (float)fit.weight / (float)fit.symbols;
+      ecrf_symrate_fit(symrate, unit, tolerance, &fit);
+      ecrf_symrate_result(&fit, unit, total, estimate);
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,81 @@
+#ifndef _ECRF_SYMRATE_H
+#define _ECRF_SYMRATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Symbol rate of an unknown signal from an oversampled raw stream: the
+ * length of every run between two edges goes into a histogram, in samples.
+ * The estimate takes the shortest strong peak and looks for the largest
+ * unit (the peak or a fraction of it) that the runs are whole multiples
+ * of, a GCD that tolerates jitter. Shares are weighted by run length, so
+ * the short runs of noise between bursts count for little.
+ */
+
+/* histogram size, longer runs are silences between frames */
+#ifndef ECRF_SYMRATE_MAX_RUN
+#define ECRF_SYMRATE_MAX_RUN 1024
+#endif
+
+/* shorter runs are glitches, they only count against the fit */
+#ifndef ECRF_SYMRATE_MIN_RUN
+#define ECRF_SYMRATE_MIN_RUN 2
+#endif
+
+/*
+ * Shortest unit tried: with the one sample slack of each multiple, a finer
+ * unit fits about anything. Sample at 8 times the symbol rate or more.
+ */
+#ifndef ECRF_SYMRATE_MIN_UNIT
+#define ECRF_SYMRATE_MIN_UNIT 8
+#endif
+
+/* longest run tried as a multiple of the unit (sync pulses), and smallest fraction of a peak */
+#define ECRF_SYMRATE_MAX_SYMBOLS 32
+#define ECRF_SYMRATE_MAX_DIVISOR 4
+
+/* share of the signal time a peak needs, in percent */
+#define ECRF_SYMRATE_PEAK_SHARE 5
+
+struct s_ecrf_symrate {
+  uint8_t level; /* ECRF_SYMRATE_NO_LEVEL until the first edge */
+  uint32_t run;
+  bool whole; /* the run in progress started on an edge */
+  uint32_t runs;
+  uint32_t glitches;
+  uint32_t silences;
+  uint16_t hist[ECRF_SYMRATE_MAX_RUN];
+};
+
+#define ECRF_SYMRATE_NO_LEVEL 0xFF
+
+struct s_ecrf_symrate_estimate {
+  float unit;       /* samples per symbol */
+  uint8_t fit;      /* percent of the signal time on multiples of the unit */
+  uint8_t longest;  /* longest fitted run, in symbols */
+  uint8_t short_runs; /* percent of the signal time in runs under the shortest unit */
+};
+
+void ecrf_symrate_reset(struct s_ecrf_symrate *symrate);
+/* raw samples, MSB first as the chip streams them */
+void ecrf_symrate_feed(struct s_ecrf_symrate *symrate, const uint8_t *data, size_t len);
+/* lost data: the run in progress is dropped rather than joined across */
+void ecrf_symrate_break(struct s_ecrf_symrate *symrate);
+/*
+ * tolerance is the slack around each multiple in percent of the unit (one
+ * sample at least), min_fit the share of the signal time the unit must
+ * explain. False when no unit qualifies.
+ */
+bool ecrf_symrate_estimate(const struct s_ecrf_symrate *symrate, unsigned tolerance,
+                           unsigned min_fit, struct s_ecrf_symrate_estimate *estimate);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _ECRF_SYMRATE_H */
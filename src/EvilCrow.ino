@@ -1,5 +1,11 @@
 #include <Arduino.h>
 #include <FreeRTOS_Shell.h>
+#include <ecrf_tasks.h>
+#include <ecrf_heap.h>
+#include <ecrf_boot.h>
+#include <ecrf_log.h>
+#include <cc1101_ecrf.h>
+#include <ecrf_plugin.h>
 
 void toggleLED(void * parameter){
   int led = 32;
@@ -20,27 +26,49 @@ void toggleLED(void * parameter){
   }
 }
 
+// Formats and prints the deferred log records, lowest priority on the console core
+void emitLog(void * parameter){
+  char line[160];
+  for(;;){
+    while (ecrf_log_format(line, sizeof(line)))
+      Serial.print(line);
+    vTaskDelay(20 / portTICK_PERIOD_MS);
+  }
+}
+
+// Build with -DECRF_BOOT_INIT_RADIOS=1 to bring every radio up at boot
+#ifndef ECRF_BOOT_INIT_RADIOS
+#define ECRF_BOOT_INIT_RADIOS 0
+#endif
+
+// Runs once the shell has set up the console: nothing allocates from here on
+void FreeRTOS_Shell_ready(void) {
+  ecrf_boot_mark("shell ready", -1);
+  // Decoders, sinks and profiles the linker collected
+  ecrf_plugin_boot();
+  if (ECRF_BOOT_INIT_RADIOS)
+    cc1101_init_all();
+  // Rejoins the WiFi network saved by the net command, if any
+  ecrf_net_boot();
+  ecrf_heap_guard_arm();
+}
+
 void setup() {
-  xTaskCreate(
-    toggleLED,    // Function that should be called
-    "Toggle LED",   // Name of the task (for debugging)
-    1008,            // Stack size (bytes)
-    NULL,            // Parameter to pass
-    2,               // Task priority
-    NULL             // Task handle
-  );
-
-  xTaskCreate(
-    FreeRTOS_Shell,
-    "Shell",
-    4096,
-    NULL,
-    configMAX_PRIORITIES - 12,
-    NULL
-  );
+  ecrf_boot_mark("setup", -1);
+  // Registry, capture arena and driver state, before the heap guard is armed
+  ecrf_radio_boot();
+  ecrf_boot_mark("radio boot", -1);
+
+  // Name, stack, priority and core come from the task plan
+  ecrf_task_create(ECRF_TASK_LED, toggleLED, NULL, NULL);
+  ecrf_task_create(ECRF_TASK_LOG, emitLog, NULL, NULL);
+  ecrf_task_create(ECRF_TASK_SHELL, FreeRTOS_Shell, NULL, NULL);
+
+  // Nothing runs in loop(): drop the Arduino loop task instead of waking it
+  // up every 10 ms on the RX core
+  vTaskDelete(NULL);
 }
 
 void loop() {
-  delay(10);
 }
 
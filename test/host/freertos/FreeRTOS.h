@@ -0,0 +1,27 @@
+#ifndef _ECRF_HOST_FREERTOS_H
+#define _ECRF_HOST_FREERTOS_H
+
+/*
+ * Just enough of the FreeRTOS port types for the portable sources (the CLI
+ * parser) to build on the native env. Single threaded: critical sections
+ * are no-ops.
+ */
+#include <assert.h>
+#include <stdint.h>
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#define pdFALSE ((BaseType_t)0)
+#define pdTRUE ((BaseType_t)1)
+#define pdFAIL pdFALSE
+#define pdPASS pdTRUE
+
+#define configASSERT(x) assert(x)
+#define configSUPPORT_STATIC_ALLOCATION 1
+#define configSUPPORT_DYNAMIC_ALLOCATION 0
+
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+
+#endif /* _ECRF_HOST_FREERTOS_H */
@@ -0,0 +1,9 @@
+#ifndef _ECRF_HOST_TASK_H
+#define _ECRF_HOST_TASK_H
+
+#include "FreeRTOS.h"
+
+#define taskENTER_CRITICAL(mux) ((void)(mux))
+#define taskEXIT_CRITICAL(mux) ((void)(mux))
+
+#endif /* _ECRF_HOST_TASK_H */
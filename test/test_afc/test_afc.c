@@ -0,0 +1,159 @@
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unity.h>
+
+#include <ecrf_afc.h>
+
+/*
+ * Frequency tracking against a simulated chip and a drifting transmitter.
+ * The chip model: a 58 kHz channel filter senses a carrier within half its
+ * width, the offset compensation locks within BW/4 (FOCCFG FOC_LIMIT) and
+ * FREQEST reads what it found to a step, with a step of noise.
+ */
+#define AFC_STEP_HZ (26000000.0 / 16384)
+#define AFC_BW_HZ 58000.0
+#define AFC_FOC_LIMIT_HZ (AFC_BW_HZ / 4)
+
+struct afc_burst {
+  bool sensed;
+  bool locked;
+  int8_t freqest;
+};
+
+static unsigned afc_seed;
+
+static int afc_noise_step(void) {
+  afc_seed = afc_seed * 1103515245u + 12345u;
+  return (int)((afc_seed >> 16) % 3) - 1;
+}
+
+static struct afc_burst afc_chip(double carrier_hz, int8_t fsctrl0) {
+  struct afc_burst burst = {false, false, 0};
+  double residual = carrier_hz - fsctrl0 * AFC_STEP_HZ;
+
+  if ((residual > AFC_BW_HZ / 2) || (residual < -AFC_BW_HZ / 2))
+    return burst;
+
+  /* beyond FOC_LIMIT the compensation saturates, the burst is garbled */
+  double found = residual;
+  if (found > AFC_FOC_LIMIT_HZ)
+    found = AFC_FOC_LIMIT_HZ;
+  if (found < -AFC_FOC_LIMIT_HZ)
+    found = -AFC_FOC_LIMIT_HZ;
+  int estimate = (int)(found / AFC_STEP_HZ + (found >= 0 ? 0.5 : -0.5)) + afc_noise_step();
+
+  burst.sensed = true;
+  burst.locked = found == residual;
+  burst.freqest = (int8_t)estimate;
+  return burst;
+}
+
+/* a cheap remote: 25 kHz off at power on, then -60 kHz of drift with jitter */
+static double afc_remote_hz(int burst, int bursts) {
+  afc_seed = afc_seed * 1103515245u + 12345u;
+  double jitter = (double)((int)((afc_seed >> 16) % 2001) - 1000);
+  return 25000.0 - 60000.0 * burst / bursts + jitter;
+}
+
+struct afc_run {
+  int sensed;
+  int locked;
+  int locked_after_settle;
+  double worst_report_hz;
+};
+
+/* the driver's loop: FREQEST at burst open, into FSCTRL0 at burst close */
+static struct afc_run afc_simulate(bool track, int bursts, int settle) {
+  struct s_ecrf_afc afc;
+  struct afc_run run = {0, 0, 0, 0};
+
+  afc_seed = 7;
+  ecrf_afc_reset(&afc, 64, 1);
+  for (int i = 0; i < bursts; i++) {
+    double carrier = afc_remote_hz(i, bursts);
+    struct afc_burst burst = afc_chip(carrier, afc.correction);
+    if (!burst.sensed)
+      continue;
+
+    run.sensed++;
+    run.locked += burst.locked;
+    if (i >= settle) {
+      run.locked_after_settle += burst.locked;
+      double error = ecrf_afc_hz(ecrf_afc_offset(&afc, burst.freqest)) - carrier;
+      if (error < 0)
+        error = -error;
+      if (error > run.worst_report_hz)
+        run.worst_report_hz = error;
+    }
+    if (track)
+      ecrf_afc_update(&afc, burst.freqest);
+  }
+
+  return run;
+}
+
+static void test_afc_follows_drift(void) {
+  struct afc_run run = afc_simulate(true, 500, 10);
+
+  TEST_ASSERT_EQUAL_INT(500, run.sensed);
+  /* pulled in from 25 kHz within a few bursts, then never lost */
+  TEST_ASSERT_EQUAL_INT(490, run.locked_after_settle);
+  /* reported offsets within a step and a half: rounding plus noise */
+  TEST_ASSERT_TRUE(run.worst_report_hz < 1.5 * AFC_STEP_HZ + 1000);
+}
+
+static void test_afc_untracked_drifts_away(void) {
+  struct afc_run run = afc_simulate(false, 500, 10);
+
+  /* the fixed tuning only holds the middle of the drift, then loses it */
+  TEST_ASSERT_TRUE(run.locked < 500 * 55 / 100);
+  TEST_ASSERT_TRUE(run.sensed < 500 * 95 / 100);
+}
+
+static void test_afc_limit(void) {
+  struct s_ecrf_afc afc;
+
+  ecrf_afc_reset(&afc, 10, 0);
+  for (int i = 0; i < 5; i++)
+    ecrf_afc_update(&afc, 4);
+  TEST_ASSERT_EQUAL_INT(10, afc.correction);
+  TEST_ASSERT_EQUAL_INT(5, afc.bursts);
+  TEST_ASSERT_EQUAL_INT(13, ecrf_afc_offset(&afc, 3));
+
+  for (int i = 0; i < 10; i++)
+    ecrf_afc_update(&afc, -128);
+  TEST_ASSERT_EQUAL_INT(-10, afc.correction);
+}
+
+static void test_afc_gain(void) {
+  struct s_ecrf_afc afc;
+
+  /* half gain, rounded away from 0: a one step estimate still moves */
+  ecrf_afc_reset(&afc, 64, 1);
+  TEST_ASSERT_EQUAL_INT(1, ecrf_afc_update(&afc, 1));
+  TEST_ASSERT_EQUAL_INT(0, ecrf_afc_update(&afc, -1));
+  TEST_ASSERT_EQUAL_INT(5, ecrf_afc_update(&afc, 9));
+  TEST_ASSERT_EQUAL_INT(0, ecrf_afc_update(&afc, -9));
+}
+
+static void test_afc_hz(void) {
+  TEST_ASSERT_EQUAL_INT(0, ecrf_afc_hz(0));
+  TEST_ASSERT_EQUAL_INT(1586, ecrf_afc_hz(1));
+  TEST_ASSERT_EQUAL_INT(-101562, ecrf_afc_hz(-64));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_afc_follows_drift);
+  RUN_TEST(test_afc_untracked_drifts_away);
+  RUN_TEST(test_afc_limit);
+  RUN_TEST(test_afc_gain);
+  RUN_TEST(test_afc_hz);
+  return UNITY_END();
+}
@@ -0,0 +1,25 @@
+#ifndef _ECRF_BENCH_BASELINE_H
+#define _ECRF_BENCH_BASELINE_H
+
+/*
+ * Reference results in ns/op, from a -DECRF_BENCH_RECORD=1 run on the
+ * reference workstation. Re-record after a deliberate change or on another
+ * machine; 0 or a missing entry only reports.
+ */
+struct s_ecrf_bench_baseline {
+  const char *name;
+  double ns_per_op;
+};
+
+static const struct s_ecrf_bench_baseline ecrf_bench_baselines[] = {
+    {"cli_lookup", 327.1},
+    {"cli_params", 393.3},
+    {"hex_encode", 144.6},
+    {"hex_snprintf", 9414.4},
+    {"ring_rw", 109.8},
+    {"survey_add", 110.1},
+    {"survey_top", 592.6},
+    {"symrate_feed", 1997.0},
+};
+
+#endif /* _ECRF_BENCH_BASELINE_H */
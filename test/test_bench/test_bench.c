@@ -0,0 +1,285 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unity.h>
+
+#include <freertos/FreeRTOS.h>
+#include <FreeRTOS_CLI.h>
+#include <ecrf_hex.h>
+#include <ecrf_ring.h>
+#include <ecrf_survey.h>
+#include <ecrf_symrate.h>
+
+#include "bench_baseline.h"
+
+/*
+ * Microbenchmarks of the CPU-bound firmware paths. Each benchmark is timed
+ * over batches of ECRF_BENCH_BATCH_NS and the best batch is kept. A result
+ * slower than its baseline by more than ECRF_BENCH_TOLERANCE percent fails
+ * the run.
+ * Build with -DECRF_BENCH_RECORD=1 to print a new bench_baseline.h table.
+ */
+#ifndef ECRF_BENCH_TOLERANCE
+#define ECRF_BENCH_TOLERANCE 25
+#endif
+
+#ifndef ECRF_BENCH_BATCH_NS
+#define ECRF_BENCH_BATCH_NS 20000000ULL
+#endif
+
+#ifndef ECRF_BENCH_BATCHES
+#define ECRF_BENCH_BATCHES 7
+#endif
+
+#ifndef ECRF_BENCH_RECORD
+#define ECRF_BENCH_RECORD 0
+#endif
+
+struct s_ecrf_bench {
+  const char *name;
+  void (*setup)(void);
+  void (*run)(void);
+  /* payload of one operation, 0 when throughput means nothing */
+  size_t bytes;
+};
+
+/* keeps the compiler from dropping the work */
+static volatile uintptr_t ecrf_bench_sink;
+
+static uint64_t ecrf_bench_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* Shell: the firmware's command table, stub handlers */
+static BaseType_t ecrf_bench_cmd(char *pcWriteBuffer, size_t xWriteBufferLen,
+                                 const char *pcCommandString) {
+  int id = 0;
+  FreeRTOS_CLIGetParameterAsInt(pcCommandString, 2, &id);
+  pcWriteBuffer[0] = (char)id;
+  return pdFALSE;
+}
+
+#define ECRF_BENCH_CMD(name) {name, "", ecrf_bench_cmd, -1}
+
+static const CLI_Command_Definition_t ecrf_bench_commands[] = {
+    ECRF_BENCH_CMD("mem"),     ECRF_BENCH_CMD("log"),     ECRF_BENCH_CMD("profile"),
+    ECRF_BENCH_CMD("init"),    ECRF_BENCH_CMD("release"), ECRF_BENCH_CMD("scan"),
+    ECRF_BENCH_CMD("rx"),      ECRF_BENCH_CMD("cap"),     ECRF_BENCH_CMD("gate"),
+    ECRF_BENCH_CMD("rxbench"), ECRF_BENCH_CMD("rxpoll"),  ECRF_BENCH_CMD("overflow"),
+    ECRF_BENCH_CMD("rxmax"),   ECRF_BENCH_CMD("radios"),  ECRF_BENCH_CMD("boot"),
+    ECRF_BENCH_CMD("sink"),    ECRF_BENCH_CMD("survey"),  ECRF_BENCH_CMD("ps"),
+};
+
+#define ECRF_BENCH_COMMANDS (sizeof(ecrf_bench_commands) / sizeof(ecrf_bench_commands[0]))
+
+static CLI_Definition_List_Item_t ecrf_bench_items[ECRF_BENCH_COMMANDS];
+static char ecrf_bench_output[128];
+
+static void ecrf_bench_cli_setup(void) {
+  static bool registered = false;
+
+  if (registered)
+    return;
+
+  for (size_t i = 0; i < ECRF_BENCH_COMMANDS; i++)
+    FreeRTOS_CLIRegisterCommandStatic(&ecrf_bench_commands[i], &ecrf_bench_items[i]);
+  registered = true;
+}
+
+#define ECRF_BENCH_LOOKUP "sink add console 4096"
+
+static void ecrf_bench_cli_lookup(void) {
+  FreeRTOS_CLIProcessCommand(ECRF_BENCH_LOOKUP, ecrf_bench_output, sizeof(ecrf_bench_output));
+  ecrf_bench_sink += (uint8_t)ecrf_bench_output[0];
+}
+
+#define ECRF_BENCH_PARAMS "rx 1 1024 fsk868 4096 32"
+
+static void ecrf_bench_cli_params(void) {
+  int value = 0;
+  for (UBaseType_t i = 1; i <= 5; i++) {
+    FreeRTOS_CLIGetParameterAsInt(ECRF_BENCH_PARAMS, i, &value);
+    ecrf_bench_sink += value;
+  }
+}
+
+/* rx output: one 128 bytes output buffer holds ~58 data bytes */
+#define ECRF_BENCH_HEX_LEN 58
+
+static uint8_t ecrf_bench_data[4096];
+static char ecrf_bench_text[2 * sizeof(ecrf_bench_data) + 1];
+
+static void ecrf_bench_data_setup(void) {
+  for (size_t i = 0; i < sizeof(ecrf_bench_data); i++)
+    ecrf_bench_data[i] = (uint8_t)(i * 131 + 7);
+}
+
+static void ecrf_bench_hex(void) {
+  ecrf_bench_sink += ecrf_hex_encode(ecrf_bench_text, ecrf_bench_data, ECRF_BENCH_HEX_LEN);
+}
+
+/* what the rx command did before ecrf_hex_encode(), for reference */
+static void ecrf_bench_hex_snprintf(void) {
+  char *text = ecrf_bench_text;
+  for (size_t i = 0; i < ECRF_BENCH_HEX_LEN; i++) {
+    snprintf(text, 3, "%02x", ecrf_bench_data[i]);
+    text += 2;
+  }
+  ecrf_bench_sink += (uint8_t)ecrf_bench_text[0];
+}
+
+/* RX path: FIFO sized writes, shell sized reads */
+static uint8_t ecrf_bench_ring_storage[1024];
+static struct s_ecrf_ring ecrf_bench_ring;
+
+static void ecrf_bench_ring_setup(void) {
+  ecrf_bench_data_setup();
+  ecrf_ring_init(&ecrf_bench_ring, ecrf_bench_ring_storage, sizeof(ecrf_bench_ring_storage));
+}
+
+static void ecrf_bench_ring_rw(void) {
+  uint8_t out[64];
+  uint32_t lost;
+
+  ecrf_ring_write(&ecrf_bench_ring, ecrf_bench_data, 32, false);
+  ecrf_ring_write(&ecrf_bench_ring, ecrf_bench_data + 32, 32, false);
+  ecrf_bench_sink += ecrf_ring_read(&ecrf_bench_ring, out, sizeof(out), &lost);
+}
+
+/* Survey: one sweep of the 59 entries scan table */
+#define ECRF_BENCH_CHANNELS 59
+
+static struct s_ecrf_survey ecrf_bench_survey;
+static int16_t ecrf_bench_rssi[ECRF_BENCH_CHANNELS];
+static uint32_t ecrf_bench_clock;
+
+static void ecrf_bench_survey_setup(void) {
+  ecrf_survey_reset(&ecrf_bench_survey, ECRF_BENCH_CHANNELS, -75, 0);
+  for (size_t i = 0; i < ECRF_BENCH_CHANNELS; i++)
+    ecrf_bench_rssi[i] = (int16_t)(-100 + (int)((i * 37) % 50));
+  for (int sweep = 0; sweep < 100; sweep++)
+    ecrf_survey_add(&ecrf_bench_survey, ecrf_bench_rssi, sweep);
+}
+
+static void ecrf_bench_survey_add(void) {
+  ecrf_survey_add(&ecrf_bench_survey, ecrf_bench_rssi, ++ecrf_bench_clock);
+}
+
+static void ecrf_bench_survey_top(void) {
+  uint8_t top[16];
+  ecrf_bench_sink += ecrf_survey_top(&ecrf_bench_survey, top, 8);
+}
+
+/* Symbol rate: a raw read, edges on most samples is the slow case */
+static struct s_ecrf_symrate ecrf_bench_symrate;
+
+static void ecrf_bench_symrate_setup(void) {
+  ecrf_bench_data_setup();
+  ecrf_symrate_reset(&ecrf_bench_symrate);
+}
+
+static void ecrf_bench_symrate_feed(void) {
+  ecrf_symrate_feed(&ecrf_bench_symrate, ecrf_bench_data, 64);
+}
+
+static const struct s_ecrf_bench ecrf_benches[] = {
+    {"cli_lookup", ecrf_bench_cli_setup, ecrf_bench_cli_lookup, sizeof(ECRF_BENCH_LOOKUP) - 1},
+    {"cli_params", NULL, ecrf_bench_cli_params, sizeof(ECRF_BENCH_PARAMS) - 1},
+    {"hex_encode", ecrf_bench_data_setup, ecrf_bench_hex, ECRF_BENCH_HEX_LEN},
+    {"hex_snprintf", ecrf_bench_data_setup, ecrf_bench_hex_snprintf, ECRF_BENCH_HEX_LEN},
+    {"ring_rw", ecrf_bench_ring_setup, ecrf_bench_ring_rw, 64},
+    {"survey_add", ecrf_bench_survey_setup, ecrf_bench_survey_add, 0},
+    {"survey_top", ecrf_bench_survey_setup, ecrf_bench_survey_top, 0},
+    {"symrate_feed", ecrf_bench_symrate_setup, ecrf_bench_symrate_feed, 64},
+};
+
+#define ECRF_BENCHES (sizeof(ecrf_benches) / sizeof(ecrf_benches[0]))
+
+static double ecrf_bench_results[ECRF_BENCHES];
+
+static double ecrf_bench_baseline(const char *name) {
+  for (size_t i = 0; i < sizeof(ecrf_bench_baselines) / sizeof(ecrf_bench_baselines[0]); i++) {
+    if (strcmp(ecrf_bench_baselines[i].name, name) == 0)
+      return ecrf_bench_baselines[i].ns_per_op;
+  }
+
+  return 0;
+}
+
+/* best ns/op over the batches, the batch size is calibrated first */
+static double ecrf_bench_measure(const struct s_ecrf_bench *bench) {
+  uint64_t iterations = 1;
+  double best = 0;
+
+  if (bench->setup != NULL)
+    bench->setup();
+
+  for (;;) {
+    uint64_t start = ecrf_bench_now_ns();
+    for (uint64_t i = 0; i < iterations; i++)
+      bench->run();
+    uint64_t elapsed = ecrf_bench_now_ns() - start;
+    if (elapsed >= ECRF_BENCH_BATCH_NS / 10)
+      break;
+    iterations *= 2;
+  }
+  iterations *= 10;
+
+  for (int batch = 0; batch < ECRF_BENCH_BATCHES; batch++) {
+    uint64_t start = ecrf_bench_now_ns();
+    for (uint64_t i = 0; i < iterations; i++)
+      bench->run();
+    double ns = (double)(ecrf_bench_now_ns() - start) / (double)iterations;
+    if ((batch == 0) || (ns < best))
+      best = ns;
+  }
+
+  return best;
+}
+
+static size_t ecrf_bench_index;
+
+static void test_bench(void) {
+  const struct s_ecrf_bench *bench = &ecrf_benches[ecrf_bench_index];
+  double ns = ecrf_bench_measure(bench);
+  double baseline = ecrf_bench_baseline(bench->name);
+  char line[160];
+
+  ecrf_bench_results[ecrf_bench_index] = ns;
+  int len = snprintf(line, sizeof(line), "%-14s %10.1f ns/op", bench->name, ns);
+  if (bench->bytes != 0)
+    len += snprintf(line + len, sizeof(line) - len, " %9.1f MB/s", bench->bytes * 1000.0 / ns);
+  if (baseline > 0)
+    snprintf(line + len, sizeof(line) - len, "  baseline %.1f (%+.0f%%)", baseline,
+             (ns - baseline) * 100.0 / baseline);
+  TEST_MESSAGE(line);
+
+  if (!ECRF_BENCH_RECORD && (baseline > 0) && (ns > baseline * (100 + ECRF_BENCH_TOLERANCE) / 100)) {
+    snprintf(line, sizeof(line), "%s regressed beyond %d%%", bench->name, ECRF_BENCH_TOLERANCE);
+    TEST_FAIL_MESSAGE(line);
+  }
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  for (ecrf_bench_index = 0; ecrf_bench_index < ECRF_BENCHES; ecrf_bench_index++)
+    UnityDefaultTestRun(test_bench, ecrf_benches[ecrf_bench_index].name, __LINE__);
+
+  if (ECRF_BENCH_RECORD) {
+    printf("\n/* bench_baseline.h */\n");
+    for (size_t i = 0; i < ECRF_BENCHES; i++)
+      printf("    {\"%s\", %.1f},\n", ecrf_benches[i].name, ecrf_bench_results[i]);
+  }
+
+  return UNITY_END();
+}
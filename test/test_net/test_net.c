@@ -0,0 +1,411 @@
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include <ecrf_frame.h>
+#include <ecrf_netshell.h>
+#include <ecrf_stream.h>
+
+/*
+ * Network output and shell against receivers on the loopback interface.
+ */
+
+/* stream content at an offset, any offset can be checked on its own */
+static uint8_t net_byte(uint32_t offset) {
+  return (uint8_t)((offset * 2654435761u) >> 24);
+}
+
+static void net_fill(uint8_t *data, uint32_t offset, size_t len) {
+  for (size_t i = 0; i < len; i++)
+    data[i] = net_byte(offset + (uint32_t)i);
+}
+
+static int net_listener(int type, uint16_t *port) {
+  struct sockaddr_in addr;
+  socklen_t len = sizeof(addr);
+  int fd = socket(AF_INET, type, 0);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  TEST_ASSERT_EQUAL_INT(0, bind(fd, (struct sockaddr *)&addr, sizeof(addr)));
+  if (type == SOCK_STREAM)
+    TEST_ASSERT_EQUAL_INT(0, listen(fd, 2));
+  getsockname(fd, (struct sockaddr *)&addr, &len);
+  *port = ntohs(addr.sin_port);
+  return fd;
+}
+
+static int net_connect(uint16_t port) {
+  struct sockaddr_in addr;
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  TEST_ASSERT_EQUAL_INT(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+  return fd;
+}
+
+static void test_frame_codec(void) {
+  uint8_t header[ECRF_FRAME_HEADER];
+  struct s_ecrf_frame frame = {ECRF_FRAME_GAP, 3, 128, 0x01020304, 0xA0B0C0D0, 77};
+  struct s_ecrf_frame decoded;
+
+  ecrf_frame_encode(header, &frame);
+  TEST_ASSERT_EQUAL_INT('E', header[0]);
+  TEST_ASSERT_EQUAL_INT(0x04, header[8]);
+  TEST_ASSERT_EQUAL_INT(0xA0, header[15]);
+  TEST_ASSERT_TRUE(ecrf_frame_decode(header, sizeof(header), &decoded));
+  TEST_ASSERT_EQUAL_INT(ECRF_FRAME_GAP, decoded.flags);
+  TEST_ASSERT_EQUAL_INT(3, decoded.radio);
+  TEST_ASSERT_EQUAL_INT(128, decoded.len);
+  TEST_ASSERT_EQUAL_UINT32(0x01020304, decoded.seq);
+  TEST_ASSERT_EQUAL_UINT32(0xA0B0C0D0, decoded.offset);
+  TEST_ASSERT_EQUAL_UINT32(77, decoded.lost);
+
+  TEST_ASSERT_FALSE(ecrf_frame_decode(header, sizeof(header) - 1, &decoded));
+  header[1] = 'X';
+  TEST_ASSERT_FALSE(ecrf_frame_decode(header, sizeof(header), &decoded));
+}
+
+/* one frame per datagram, a loss of the source flagged on the next one */
+static void test_stream_udp(void) {
+  static struct s_ecrf_stream stream;
+  uint8_t data[128];
+  uint8_t datagram[ECRF_FRAME_HEADER + sizeof(data)];
+  struct s_ecrf_frame frame;
+  uint16_t port;
+  int receiver = net_listener(SOCK_DGRAM, &port);
+
+  ecrf_stream_init(&stream);
+  TEST_ASSERT_EQUAL_INT(0, ecrf_stream_open(&stream, "127.0.0.1", port, true, 2));
+  uint32_t offset = 1000;
+  for (int i = 0; i < 4; i++) {
+    uint32_t lost = (i == 2) ? 300 : 0;
+    offset += lost;
+    net_fill(data, offset, sizeof(data));
+    TEST_ASSERT_EQUAL_INT(sizeof(data), ecrf_stream_write(&stream, offset, lost, data, sizeof(data)));
+    offset += sizeof(data);
+  }
+
+  offset = 1000;
+  for (uint32_t seq = 0; seq < 4; seq++) {
+    ssize_t len = recv(receiver, datagram, sizeof(datagram), 0);
+    TEST_ASSERT_EQUAL_INT(sizeof(datagram), len);
+    TEST_ASSERT_TRUE(ecrf_frame_decode(datagram, (size_t)len, &frame));
+    TEST_ASSERT_EQUAL_UINT32(seq, frame.seq);
+    TEST_ASSERT_EQUAL_INT(2, frame.radio);
+    TEST_ASSERT_EQUAL_INT(sizeof(data), frame.len);
+    TEST_ASSERT_EQUAL_UINT32((seq == 2) ? 300 : 0, frame.lost);
+    TEST_ASSERT_EQUAL_INT((seq == 2) ? ECRF_FRAME_GAP : 0, frame.flags);
+    offset += frame.lost;
+    TEST_ASSERT_EQUAL_UINT32(offset, frame.offset);
+    net_fill(data, offset, sizeof(data));
+    TEST_ASSERT_EQUAL_MEMORY(data, datagram + ECRF_FRAME_HEADER, sizeof(data));
+    offset += frame.len;
+  }
+  TEST_ASSERT_EQUAL_UINT32(4, stream.frames);
+  TEST_ASSERT_EQUAL_UINT32(4 * sizeof(data), stream.bytes);
+
+  ecrf_stream_close(&stream);
+  close(receiver);
+}
+
+/* frames parsed back out of the TCP byte stream, checked against the source */
+struct net_parser {
+  uint8_t buf[64 * 1024];
+  size_t len;
+  uint32_t seq;
+  uint32_t offset;
+  uint32_t bytes;
+  uint32_t lost;
+};
+
+static void net_parse(struct net_parser *parser) {
+  struct s_ecrf_frame frame;
+  size_t pos = 0;
+
+  while (ecrf_frame_decode(parser->buf + pos, parser->len - pos, &frame) &&
+         (parser->len - pos >= (size_t)ECRF_FRAME_HEADER + frame.len)) {
+    TEST_ASSERT_EQUAL_UINT32(parser->seq, frame.seq);
+    TEST_ASSERT_EQUAL_UINT32(parser->offset + frame.lost, frame.offset);
+    TEST_ASSERT_EQUAL_INT((frame.lost != 0) ? ECRF_FRAME_GAP : 0, frame.flags);
+    for (uint32_t i = 0; i < frame.len; i++) {
+      if (parser->buf[pos + ECRF_FRAME_HEADER + i] != net_byte(frame.offset + i))
+        TEST_ASSERT_EQUAL_INT(net_byte(frame.offset + i), parser->buf[pos + ECRF_FRAME_HEADER + i]);
+    }
+    parser->seq++;
+    parser->lost += frame.lost;
+    parser->offset = frame.offset + frame.len;
+    parser->bytes += frame.len;
+    pos += ECRF_FRAME_HEADER + frame.len;
+  }
+  memmove(parser->buf, parser->buf + pos, parser->len - pos);
+  parser->len -= pos;
+}
+
+static void net_drain(int fd, struct net_parser *parser) {
+  ssize_t len;
+
+  while ((parser->len < sizeof(parser->buf)) &&
+         ((len = recv(fd, parser->buf + parser->len, sizeof(parser->buf) - parser->len,
+                      MSG_DONTWAIT)) > 0)) {
+    parser->len += (size_t)len;
+    net_parse(parser);
+  }
+}
+
+/*
+ * A receiver that stops reading fills the socket buffers: sends are
+ * refused, some frames go out in part, and the stream still parses back
+ * whole, in order, with nothing lost.
+ */
+static void test_stream_tcp_backpressure(void) {
+  static struct s_ecrf_stream stream;
+  static struct net_parser parser;
+  uint8_t data[100];
+  uint16_t port;
+  int small = 4096;
+  int listener = net_listener(SOCK_STREAM, &port);
+
+  ecrf_stream_init(&stream);
+  memset(&parser, 0, sizeof(parser));
+  TEST_ASSERT_EQUAL_INT(0, ecrf_stream_open(&stream, "localhost", port, false, 0));
+  setsockopt(stream.fd, SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+  int receiver = accept(listener, NULL, NULL);
+  TEST_ASSERT_TRUE(receiver >= 0);
+  setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+
+  /* odd chunk sizes, the frames do not line up with the socket buffers */
+  uint32_t offset = 0;
+  uint32_t refused = 0;
+  while (refused < 50) {
+    size_t len = 37 + offset % 61;
+    net_fill(data, offset, len);
+    size_t taken = ecrf_stream_write(&stream, offset, 0, data, len);
+    if (taken == 0) {
+      refused++;
+    } else {
+      TEST_ASSERT_EQUAL_INT(len, taken);
+      offset += taken;
+    }
+  }
+  TEST_ASSERT_TRUE(stream.busy >= 50);
+  TEST_ASSERT_TRUE(ecrf_stream_is_open(&stream));
+
+  /* the receiver catches up while the source keeps writing */
+  for (int i = 0; i < 20000; i++) {
+    size_t len = 37 + offset % 61;
+    net_fill(data, offset, len);
+    offset += ecrf_stream_write(&stream, offset, 0, data, len);
+    net_drain(receiver, &parser);
+  }
+  /* the end of a frame cut short is flushed by the next write */
+  for (int i = 0; (i < 1000) && (stream.pending_len != 0); i++) {
+    ecrf_stream_write(&stream, offset, 0, data, 0);
+    net_drain(receiver, &parser);
+  }
+  for (int i = 0; (i < 1000) && (parser.offset != offset); i++) {
+    net_drain(receiver, &parser);
+    usleep(1000);
+  }
+  TEST_ASSERT_EQUAL_UINT32(offset, parser.offset);
+  TEST_ASSERT_EQUAL_UINT32(stream.frames, parser.seq);
+  TEST_ASSERT_EQUAL_UINT32(stream.bytes, parser.bytes);
+  TEST_ASSERT_EQUAL_UINT32(0, parser.lost);
+  TEST_ASSERT_EQUAL_INT(0, parser.len);
+
+  /* the receiver hangs up: the stream closes on the error and takes nothing */
+  close(receiver);
+  for (int i = 0; (i < 1000) && ecrf_stream_is_open(&stream); i++) {
+    ecrf_stream_write(&stream, offset, 0, data, sizeof(data));
+    usleep(1000);
+  }
+  TEST_ASSERT_FALSE(ecrf_stream_is_open(&stream));
+  TEST_ASSERT_TRUE(stream.error != 0);
+  TEST_ASSERT_EQUAL_INT(0, ecrf_stream_write(&stream, offset, 0, data, sizeof(data)));
+  close(listener);
+}
+
+/*
+ * A loss handed over while the socket is full is framed once, on the
+ * first frame that goes out, however many times the send is retried.
+ */
+static void test_stream_busy_loss(void) {
+  static struct s_ecrf_stream stream;
+  static struct net_parser parser;
+  uint8_t data[100];
+  uint16_t port;
+  int small = 4096;
+  int listener = net_listener(SOCK_STREAM, &port);
+
+  ecrf_stream_init(&stream);
+  memset(&parser, 0, sizeof(parser));
+  TEST_ASSERT_EQUAL_INT(0, ecrf_stream_open(&stream, "localhost", port, false, 0));
+  setsockopt(stream.fd, SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+  int receiver = accept(listener, NULL, NULL);
+  TEST_ASSERT_TRUE(receiver >= 0);
+  setsockopt(receiver, SOL_SOCKET, SO_RCVBUF, &small, sizeof(small));
+
+  uint32_t offset = 0;
+  for (;;) {
+    net_fill(data, offset, sizeof(data));
+    size_t taken = ecrf_stream_write(&stream, offset, 0, data, sizeof(data));
+    if (taken == 0)
+      break;
+    offset += taken;
+  }
+
+  /* the source drops 500 bytes, then retries the same chunk until it goes */
+  offset += 500;
+  net_fill(data, offset, sizeof(data));
+  uint32_t retries = 0;
+  size_t taken = ecrf_stream_write(&stream, offset, 500, data, sizeof(data));
+  while (taken == 0) {
+    if (++retries % 8 == 0)
+      net_drain(receiver, &parser);
+    taken = ecrf_stream_write(&stream, offset, 0, data, sizeof(data));
+  }
+  TEST_ASSERT_TRUE(retries > 1);
+  offset += taken;
+
+  for (int i = 0; (i < 1000) && (stream.pending_len != 0); i++) {
+    ecrf_stream_write(&stream, offset, 0, data, 0);
+    net_drain(receiver, &parser);
+  }
+  for (int i = 0; (i < 1000) && (parser.offset != offset); i++) {
+    net_drain(receiver, &parser);
+    usleep(1000);
+  }
+  TEST_ASSERT_EQUAL_UINT32(offset, parser.offset);
+  TEST_ASSERT_EQUAL_UINT32(500, parser.lost);
+  TEST_ASSERT_EQUAL_UINT32(0, stream.gap);
+
+  ecrf_stream_close(&stream);
+  close(receiver);
+  close(listener);
+}
+
+static void test_stream_refused(void) {
+  static struct s_ecrf_stream stream;
+  uint16_t port;
+  int listener = net_listener(SOCK_STREAM, &port);
+
+  /* nobody listens on that port any more */
+  close(listener);
+  ecrf_stream_init(&stream);
+  TEST_ASSERT_EQUAL_INT(ECONNREFUSED, ecrf_stream_open(&stream, "127.0.0.1", port, false, 0));
+  TEST_ASSERT_FALSE(ecrf_stream_is_open(&stream));
+}
+
+struct net_lines {
+  char lines[4][ECRF_NETSHELL_LINE_LENGTH];
+  int count;
+};
+
+static void net_on_line(void *ctx, const char *line) {
+  struct net_lines *lines = (struct net_lines *)ctx;
+
+  if (lines->count < 4)
+    strcpy(lines->lines[lines->count], line);
+  lines->count++;
+}
+
+static void net_poll(struct s_ecrf_netshell *shell, struct net_lines *lines, int times) {
+  for (int i = 0; i < times; i++)
+    ecrf_netshell_poll(shell, 10, net_on_line, lines);
+}
+
+static size_t net_recv(int fd, char *buf, size_t len, struct s_ecrf_netshell *shell) {
+  size_t got = 0;
+
+  fcntl(fd, F_SETFL, O_NONBLOCK);
+  for (int i = 0; (i < 100) && (got < len); i++) {
+    ecrf_netshell_poll(shell, 10, net_on_line, NULL);
+    ssize_t n = recv(fd, buf + got, len - got, 0);
+    if (n > 0)
+      got += (size_t)n;
+  }
+  return got;
+}
+
+static void test_netshell(void) {
+  static struct s_ecrf_netshell shell;
+  struct net_lines lines;
+  char reply[32];
+  const char *overlong = "0123456789012345678901234567890123456789012345678901234567890123456789\n";
+
+  memset(&lines, 0, sizeof(lines));
+  ecrf_netshell_init(&shell);
+  TEST_ASSERT_EQUAL_INT(0, ecrf_netshell_listen(&shell, 0));
+  uint16_t port = ecrf_netshell_port(&shell);
+  TEST_ASSERT_TRUE(port != 0);
+
+  /* output without a client goes nowhere */
+  ecrf_netshell_output(&shell, "lost", 4);
+  int client = net_connect(port);
+  net_poll(&shell, &lines, 5);
+  TEST_ASSERT_TRUE(ecrf_netshell_connected(&shell));
+  TEST_ASSERT_EQUAL_INT(1, shell.clients);
+
+  /* lines split across segments, every line ending, an edit, one too long */
+  const char *input[] = {"help\r\nsink li", "st\nbad\b\b\bok\r", "\n", overlong, "ps\n"};
+  for (size_t i = 0; i < sizeof(input) / sizeof(input[0]); i++) {
+    TEST_ASSERT_EQUAL_INT(strlen(input[i]), send(client, input[i], strlen(input[i]), 0));
+    net_poll(&shell, &lines, 3);
+  }
+  TEST_ASSERT_EQUAL_INT(4, lines.count);
+  TEST_ASSERT_EQUAL_STRING("help", lines.lines[0]);
+  TEST_ASSERT_EQUAL_STRING("sink list", lines.lines[1]);
+  TEST_ASSERT_EQUAL_STRING("ok", lines.lines[2]);
+  TEST_ASSERT_EQUAL_STRING("ps", lines.lines[3]);
+  TEST_ASSERT_EQUAL_INT(1, shell.lines_too_long);
+
+  ecrf_netshell_output(&shell, "[root@FreeRTOS]# ", 17);
+  memset(reply, 0, sizeof(reply));
+  TEST_ASSERT_EQUAL_INT(17, net_recv(client, reply, 17, &shell));
+  TEST_ASSERT_EQUAL_STRING("[root@FreeRTOS]# ", reply);
+
+  /* a second client takes over, the first one is hung up on */
+  int second = net_connect(port);
+  net_poll(&shell, &lines, 5);
+  TEST_ASSERT_EQUAL_INT(2, shell.clients);
+  TEST_ASSERT_EQUAL_INT(0, recv(client, reply, sizeof(reply), 0));
+  ecrf_netshell_output(&shell, "ok\r\n", 4);
+  memset(reply, 0, sizeof(reply));
+  TEST_ASSERT_EQUAL_INT(4, net_recv(second, reply, 4, &shell));
+  TEST_ASSERT_EQUAL_STRING("ok\r\n", reply);
+
+  /* hang up from the client side */
+  close(second);
+  net_poll(&shell, &lines, 5);
+  TEST_ASSERT_FALSE(ecrf_netshell_connected(&shell));
+
+  close(client);
+  ecrf_netshell_close(&shell);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frame_codec);
+  RUN_TEST(test_stream_udp);
+  RUN_TEST(test_stream_tcp_backpressure);
+  RUN_TEST(test_stream_busy_loss);
+  RUN_TEST(test_stream_refused);
+  RUN_TEST(test_netshell);
+  return UNITY_END();
+}
@@ -0,0 +1,310 @@
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <unity.h>
+
+#include <ecrf_ring.h>
+
+/*
+ * Byte ring: both overflow policies, lap and loss reporting, extra reader
+ * cursors, and a producer thread overwriting what a reader is copying.
+ */
+#define RING_SIZE 64
+
+/* stream content at an offset, differs between laps of the ring */
+static uint8_t ring_pattern(uint32_t offset) {
+  return (uint8_t)((offset * 2654435761u) >> 24);
+}
+
+static void ring_fill(uint8_t *data, uint32_t offset, size_t len) {
+  for (size_t i = 0; i < len; i++)
+    data[i] = ring_pattern(offset + i);
+}
+
+static bool ring_check(const uint8_t *data, uint32_t offset, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] != ring_pattern(offset + i))
+      return false;
+  }
+  return true;
+}
+
+/* a ring whose offsets start at base, to cross the 4 GiB wrap */
+static void ring_init_at(struct s_ecrf_ring *ring, uint8_t *buf, uint32_t base) {
+  ecrf_ring_init(ring, buf, RING_SIZE);
+  ring->head = base;
+  ring->reserve = base;
+  ring->tail = base;
+}
+
+static void test_ring_floor_pow2(void) {
+  TEST_ASSERT_EQUAL_UINT32(0, ecrf_ring_floor_pow2(0));
+  TEST_ASSERT_EQUAL_UINT32(1, ecrf_ring_floor_pow2(1));
+  TEST_ASSERT_EQUAL_UINT32(2, ecrf_ring_floor_pow2(3));
+  TEST_ASSERT_EQUAL_UINT32(64, ecrf_ring_floor_pow2(64));
+  TEST_ASSERT_EQUAL_UINT32(64, ecrf_ring_floor_pow2(127));
+  TEST_ASSERT_EQUAL_UINT32(16384, ecrf_ring_floor_pow2(20000));
+  TEST_ASSERT_EQUAL_UINT32(0x80000000u, ecrf_ring_floor_pow2(0xFFFFFFFFu));
+}
+
+/* copies split at the end of the buffer, offsets wrap past 4 GiB */
+static void test_ring_wrap(void) {
+  static uint8_t buf[RING_SIZE];
+  struct s_ecrf_ring ring;
+  uint8_t data[RING_SIZE];
+  uint32_t offset = 0xFFFFFFF0u;
+  uint32_t lost;
+
+  ring_init_at(&ring, buf, offset);
+  for (int round = 0; round < 20; round++) {
+    size_t len = 13 + (round % 5) * 9;
+
+    ring_fill(data, offset, len);
+    TEST_ASSERT_EQUAL_INT(len, ecrf_ring_write(&ring, data, len, false));
+    TEST_ASSERT_EQUAL_UINT32(len, ecrf_ring_used(&ring));
+    TEST_ASSERT_EQUAL_UINT32(RING_SIZE - len, ecrf_ring_free(&ring));
+
+    memset(data, 0, sizeof(data));
+    TEST_ASSERT_EQUAL_INT(len, ecrf_ring_read(&ring, data, sizeof(data), &lost));
+    TEST_ASSERT_EQUAL_UINT32(0, lost);
+    TEST_ASSERT_TRUE(ring_check(data, offset, len));
+    offset += len;
+  }
+  /* the run crossed both the end of the buffer and the end of the offsets */
+  TEST_ASSERT_TRUE(offset < 0xFFFFFFF0u);
+  TEST_ASSERT_EQUAL_UINT32(offset, ring.head);
+  TEST_ASSERT_EQUAL_UINT32(0, ecrf_ring_used(&ring));
+}
+
+/* without overwrite, a full ring takes what fits and keeps the oldest */
+static void test_ring_drop_newest(void) {
+  static uint8_t buf[RING_SIZE];
+  struct s_ecrf_ring ring;
+  uint8_t data[2 * RING_SIZE];
+  uint32_t lost;
+
+  ring_init_at(&ring, buf, 0xFFFFFFE0u);
+  ring_fill(data, 0xFFFFFFE0u, sizeof(data));
+  TEST_ASSERT_EQUAL_INT(40, ecrf_ring_write(&ring, data, 40, false));
+  TEST_ASSERT_EQUAL_INT(24, ecrf_ring_write(&ring, data + 40, 40, false));
+  TEST_ASSERT_EQUAL_UINT32(0, ecrf_ring_free(&ring));
+  TEST_ASSERT_EQUAL_INT(0, ecrf_ring_write(&ring, data + 64, 1, false));
+
+  memset(data, 0, sizeof(data));
+  TEST_ASSERT_EQUAL_INT(RING_SIZE, ecrf_ring_read(&ring, data, sizeof(data), &lost));
+  TEST_ASSERT_EQUAL_UINT32(0, lost);
+  TEST_ASSERT_TRUE(ring_check(data, 0xFFFFFFE0u, RING_SIZE));
+}
+
+/* with overwrite, the reader is lapped: nothing read, the loss reported */
+static void test_ring_overwrite(void) {
+  static uint8_t buf[RING_SIZE];
+  struct s_ecrf_ring ring;
+  uint8_t data[3 * RING_SIZE];
+  uint32_t lost;
+
+  ring_init_at(&ring, buf, 0xFFFFFFE0u);
+  ring_fill(data, 0xFFFFFFE0u, sizeof(data));
+  TEST_ASSERT_EQUAL_INT(40, ecrf_ring_write(&ring, data, 40, true));
+  TEST_ASSERT_EQUAL_INT(40, ecrf_ring_write(&ring, data + 40, 40, true));
+  TEST_ASSERT_EQUAL_UINT32(RING_SIZE, ecrf_ring_used(&ring));
+  TEST_ASSERT_EQUAL_UINT32(0, ecrf_ring_free(&ring));
+
+  uint8_t out[RING_SIZE];
+  TEST_ASSERT_EQUAL_INT(0, ecrf_ring_read(&ring, out, sizeof(out), &lost));
+  TEST_ASSERT_EQUAL_UINT32(16, lost);
+  TEST_ASSERT_EQUAL_INT(RING_SIZE, ecrf_ring_read(&ring, out, sizeof(out), &lost));
+  TEST_ASSERT_EQUAL_UINT32(0, lost);
+  TEST_ASSERT_TRUE(ring_check(out, 0xFFFFFFE0u + 16, RING_SIZE));
+
+  /* a write longer than the ring keeps only its newest bytes */
+  TEST_ASSERT_EQUAL_INT(100, ecrf_ring_write(&ring, data + 80, 100, true));
+  TEST_ASSERT_EQUAL_INT(0, ecrf_ring_read(&ring, out, sizeof(out), &lost));
+  TEST_ASSERT_EQUAL_UINT32(36, lost);
+  TEST_ASSERT_EQUAL_INT(RING_SIZE, ecrf_ring_read(&ring, out, sizeof(out), &lost));
+  TEST_ASSERT_TRUE(ring_check(out, 0xFFFFFFE0u + 116, RING_SIZE));
+  TEST_ASSERT_EQUAL_UINT32(0, ecrf_ring_used(&ring));
+}
+
+/* extra readers move on their own and never hold the producer back */
+static void test_ring_cursors(void) {
+  static uint8_t buf[RING_SIZE];
+  struct s_ecrf_ring ring;
+  struct s_ecrf_ring_cursor fast, slow, late;
+  uint8_t data[RING_SIZE];
+  uint8_t out[RING_SIZE];
+  uint32_t lost;
+
+  /* a cursor starts at the current end of the stream */
+  ring_init_at(&ring, buf, 0xFFFFFFF8u);
+  ring_fill(data, 0xFFFFFFF8u, 16);
+  ecrf_ring_write(&ring, data, 16, false);
+  ecrf_ring_cursor_init(&ring, &late);
+  TEST_ASSERT_EQUAL_UINT32(0, ecrf_ring_lag(&ring, &late));
+
+  ring_init_at(&ring, buf, 0xFFFFFFF8u);
+  ecrf_ring_cursor_init(&ring, &fast);
+  ecrf_ring_cursor_init(&ring, &slow);
+  ring_fill(data, 0xFFFFFFF8u, 48);
+  TEST_ASSERT_EQUAL_INT(48, ecrf_ring_write(&ring, data, 48, false));
+  TEST_ASSERT_EQUAL_UINT32(48, ecrf_ring_lag(&ring, &fast));
+
+  /* peek copies without consuming, advance consumes */
+  TEST_ASSERT_EQUAL_INT(20, ecrf_ring_peek(&ring, &fast, out, 20, &lost));
+  TEST_ASSERT_EQUAL_UINT32(0, lost);
+  TEST_ASSERT_TRUE(ring_check(out, 0xFFFFFFF8u, 20));
+  TEST_ASSERT_EQUAL_UINT32(48, ecrf_ring_lag(&ring, &fast));
+  ecrf_ring_advance(&fast, 20);
+  TEST_ASSERT_EQUAL_UINT32(28, ecrf_ring_lag(&ring, &fast));
+  TEST_ASSERT_EQUAL_INT(28, ecrf_ring_peek(&ring, &fast, out, sizeof(out), &lost));
+  TEST_ASSERT_TRUE(ring_check(out, 0xFFFFFFF8u + 20, 28));
+  ecrf_ring_advance(&fast, 28);
+
+  /* the main reader drains, the cursors still lag: the ring takes more */
+  TEST_ASSERT_EQUAL_INT(48, ecrf_ring_read(&ring, out, sizeof(out), &lost));
+  ring_fill(data, 0xFFFFFFF8u + 48, 48);
+  TEST_ASSERT_EQUAL_INT(48, ecrf_ring_write(&ring, data, 48, false));
+  TEST_ASSERT_EQUAL_UINT32(48, ecrf_ring_lag(&ring, &fast));
+  TEST_ASSERT_EQUAL_UINT32(96, ecrf_ring_lag(&ring, &slow));
+
+  /* the slow cursor was lapped and learns how far */
+  TEST_ASSERT_EQUAL_INT(0, ecrf_ring_peek(&ring, &slow, out, sizeof(out), &lost));
+  TEST_ASSERT_EQUAL_UINT32(32, lost);
+  TEST_ASSERT_EQUAL_UINT32(RING_SIZE, ecrf_ring_lag(&ring, &slow));
+  TEST_ASSERT_EQUAL_INT(RING_SIZE, ecrf_ring_peek(&ring, &slow, out, sizeof(out), &lost));
+  TEST_ASSERT_EQUAL_UINT32(0, lost);
+  TEST_ASSERT_TRUE(ring_check(out, 0xFFFFFFF8u + 32, RING_SIZE));
+
+  /* the fast cursor was not */
+  TEST_ASSERT_EQUAL_INT(48, ecrf_ring_peek(&ring, &fast, out, sizeof(out), &lost));
+  TEST_ASSERT_EQUAL_UINT32(0, lost);
+  TEST_ASSERT_TRUE(ring_check(out, 0xFFFFFFF8u + 48, 48));
+}
+
+/*
+ * Torn copy: the producer announced an overwrite in reserve and was held up
+ * before finishing it. A reader copying meanwhile must not return the
+ * bytes being overwritten: it retries until the write lands, then sees the
+ * lap.
+ */
+struct ring_reader {
+  struct s_ecrf_ring *ring;
+  uint8_t out[RING_SIZE];
+  size_t len;
+  uint32_t lost;
+};
+
+static void *ring_reader_run(void *arg) {
+  struct ring_reader *reader = arg;
+
+  reader->len = ecrf_ring_read(reader->ring, reader->out, sizeof(reader->out), &reader->lost);
+
+  return NULL;
+}
+
+static void test_ring_torn_copy(void) {
+  static uint8_t buf[RING_SIZE];
+  struct s_ecrf_ring ring;
+  struct ring_reader reader = {.ring = &ring};
+  uint8_t data[RING_SIZE + 16];
+  pthread_t thread;
+
+  ring_init_at(&ring, buf, 0xFFFFFFF0u);
+  ring_fill(data, 0xFFFFFFF0u, sizeof(data));
+  ecrf_ring_write(&ring, data, RING_SIZE, true);
+
+  /* the first half of a 16 byte overwrite, then the reader runs */
+  ring.reserve = ring.head + 16;
+  TEST_ASSERT_EQUAL_INT(0, pthread_create(&thread, NULL, ring_reader_run, &reader));
+  usleep(20000);
+  ecrf_ring_write(&ring, data + RING_SIZE, 16, true);
+  pthread_join(thread, NULL);
+
+  TEST_ASSERT_EQUAL_INT(0, reader.len);
+  TEST_ASSERT_EQUAL_UINT32(16, reader.lost);
+  TEST_ASSERT_EQUAL_INT(RING_SIZE, ecrf_ring_read(&ring, reader.out, sizeof(reader.out), &reader.lost));
+  TEST_ASSERT_EQUAL_UINT32(0, reader.lost);
+  TEST_ASSERT_TRUE(ring_check(reader.out, 0xFFFFFFF0u + 16, RING_SIZE));
+}
+
+/*
+ * A producer overwrites the ring flat out while a reader copies from it:
+ * every byte read is the byte of its offset, what was missed is reported.
+ */
+#define RING_STRESS_BYTES (8u << 20)
+
+struct ring_stress {
+  struct s_ecrf_ring ring;
+  uint8_t buf[RING_SIZE];
+  bool done;
+};
+
+static void *ring_stress_producer(void *arg) {
+  struct ring_stress *stress = arg;
+  uint8_t data[RING_SIZE + 8];
+  uint32_t offset = stress->ring.head;
+  uint32_t end = offset + RING_STRESS_BYTES;
+
+  for (size_t len = 1; offset != end; len = (len % sizeof(data)) + 1) {
+    if (len > end - offset)
+      len = end - offset;
+    ring_fill(data, offset, len);
+    ecrf_ring_write(&stress->ring, data, len, true);
+    offset += len;
+  }
+  __atomic_store_n(&stress->done, true, __ATOMIC_RELEASE);
+
+  return NULL;
+}
+
+static void test_ring_concurrent(void) {
+  static struct ring_stress stress;
+  pthread_t producer;
+  uint8_t out[RING_SIZE / 2];
+  uint32_t offset = 0xFFFF0000u;
+  uint32_t total_lost = 0;
+  uint32_t torn = 0;
+
+  ring_init_at(&stress.ring, stress.buf, offset);
+  stress.done = false;
+  TEST_ASSERT_EQUAL_INT(0, pthread_create(&producer, NULL, ring_stress_producer, &stress));
+
+  for (;;) {
+    bool done = __atomic_load_n(&stress.done, __ATOMIC_ACQUIRE);
+    uint32_t lost;
+    size_t len = ecrf_ring_read(&stress.ring, out, sizeof(out), &lost);
+
+    offset += lost;
+    total_lost += lost;
+    if (!ring_check(out, offset, len))
+      torn++;
+    offset += len;
+    if (done && (len == 0) && (lost == 0))
+      break;
+  }
+  pthread_join(producer, NULL);
+
+  TEST_ASSERT_EQUAL_UINT32(0, torn);
+  TEST_ASSERT_EQUAL_UINT32(stress.ring.head, offset);
+  TEST_ASSERT_EQUAL_UINT32(RING_STRESS_BYTES, offset - 0xFFFF0000u);
+  TEST_ASSERT_TRUE(total_lost < RING_STRESS_BYTES);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_ring_floor_pow2);
+  RUN_TEST(test_ring_wrap);
+  RUN_TEST(test_ring_drop_newest);
+  RUN_TEST(test_ring_overwrite);
+  RUN_TEST(test_ring_cursors);
+  RUN_TEST(test_ring_torn_copy);
+  RUN_TEST(test_ring_concurrent);
+  return UNITY_END();
+}
@@ -0,0 +1,147 @@
+#include <stdbool.h>
+#include <unity.h>
+
+#include <ecrf_sched.h>
+
+/*
+ * Slot planning and accounting against a simulated clock.
+ * The radio model: a retune costs ~720 us of calibration on the first visit
+ * of a session, then 100 us with the calibration results cached.
+ */
+#define SCHED_CAL_US 720
+#define SCHED_RETUNE_US 100
+
+struct sched_sim {
+  struct s_ecrf_sched sched;
+  bool calibrated[ECRF_SCHED_MAX_SESSIONS];
+  int64_t now_us;
+};
+
+static void sched_sim_slot(struct sched_sim *sim, uint32_t extra_us) {
+  size_t i = ecrf_sched_next(&sim->sched);
+  int64_t begin = sim->now_us;
+
+  sim->now_us += sim->calibrated[i] ? SCHED_RETUNE_US : SCHED_CAL_US;
+  sim->calibrated[i] = true;
+  int64_t tuned = sim->now_us;
+  sim->now_us += sim->sched.session[i].slot_us + extra_us;
+  ecrf_sched_account(&sim->sched, i, begin, tuned, sim->now_us);
+}
+
+static void sched_sim_init(struct sched_sim *sim) {
+  ecrf_sched_init(&sim->sched);
+  for (size_t i = 0; i < ECRF_SCHED_MAX_SESSIONS; i++)
+    sim->calibrated[i] = false;
+  sim->now_us = 1000000;
+  /* a sweep, then listen windows on 433.92 and 868.35 */
+  TEST_ASSERT_EQUAL_INT(0, ecrf_sched_add(&sim->sched, 20000));
+  TEST_ASSERT_EQUAL_INT(1, ecrf_sched_add(&sim->sched, 50000));
+  TEST_ASSERT_EQUAL_INT(2, ecrf_sched_add(&sim->sched, 30000));
+  ecrf_sched_start(&sim->sched, sim->now_us);
+}
+
+/* one cycle to calibrate every session, then accounting starts over */
+static void sched_sim_warm_up(struct sched_sim *sim) {
+  for (size_t i = 0; i < sim->sched.count; i++)
+    sched_sim_slot(sim, 0);
+  ecrf_sched_start(&sim->sched, sim->now_us);
+}
+
+static void test_sched_plan(void) {
+  struct sched_sim sim;
+
+  sched_sim_init(&sim);
+  TEST_ASSERT_EQUAL_UINT32(100000, ecrf_sched_cycle_us(&sim.sched));
+  TEST_ASSERT_EQUAL_UINT32(80000, ecrf_sched_revisit_us(&sim.sched, 0));
+  TEST_ASSERT_EQUAL_UINT32(50000, ecrf_sched_revisit_us(&sim.sched, 1));
+  TEST_ASSERT_EQUAL_INT(200, ecrf_sched_planned_permille(&sim.sched, 0));
+  TEST_ASSERT_EQUAL_INT(500, ecrf_sched_planned_permille(&sim.sched, 1));
+  TEST_ASSERT_EQUAL_INT(300, ecrf_sched_planned_permille(&sim.sched, 2));
+
+  /* round-robin in the order of the plan */
+  for (size_t i = 0; i < 7; i++)
+    TEST_ASSERT_EQUAL_INT(i % 3, ecrf_sched_next(&sim.sched));
+}
+
+static void test_sched_rejects(void) {
+  struct s_ecrf_sched sched;
+
+  ecrf_sched_init(&sched);
+  TEST_ASSERT_EQUAL_INT(-1, ecrf_sched_add(&sched, 0));
+  for (int i = 0; i < ECRF_SCHED_MAX_SESSIONS; i++)
+    TEST_ASSERT_EQUAL_INT(i, ecrf_sched_add(&sched, 1000));
+  TEST_ASSERT_EQUAL_INT(-1, ecrf_sched_add(&sched, 1000));
+  TEST_ASSERT_EQUAL_INT(0, ecrf_sched_duty_permille(&sched, 0, sched.start_us));
+}
+
+static void test_sched_accounting(void) {
+  struct sched_sim sim;
+
+  sched_sim_init(&sim);
+  sched_sim_warm_up(&sim);
+  for (int i = 0; i < 300; i++)
+    sched_sim_slot(&sim, 0);
+
+  for (size_t i = 0; i < 3; i++) {
+    const struct s_ecrf_sched_session *session = &sim.sched.session[i];
+    TEST_ASSERT_EQUAL_UINT32(100, session->slots);
+    TEST_ASSERT_EQUAL_UINT32(SCHED_RETUNE_US, session->switch_max_us);
+    TEST_ASSERT_EQUAL_UINT32(SCHED_RETUNE_US, ecrf_sched_switch_mean_us(session));
+    /* deaf for the other slots plus the three retunes of a cycle */
+    TEST_ASSERT_EQUAL_UINT32(ecrf_sched_revisit_us(&sim.sched, i) + 3 * SCHED_RETUNE_US,
+                             session->revisit_max_us);
+    TEST_ASSERT_EQUAL_UINT32((uint64_t)session->slot_us * 100, session->on_air_us);
+  }
+
+  /* retunes take 0.3 % of the cycle, off the planned shares */
+  TEST_ASSERT_EQUAL_INT(199, ecrf_sched_duty_permille(&sim.sched, 0, sim.now_us));
+  TEST_ASSERT_EQUAL_INT(498, ecrf_sched_duty_permille(&sim.sched, 1, sim.now_us));
+  TEST_ASSERT_EQUAL_INT(299, ecrf_sched_duty_permille(&sim.sched, 2, sim.now_us));
+}
+
+static void test_sched_overrun(void) {
+  struct sched_sim sim;
+
+  sched_sim_init(&sim);
+  sched_sim_warm_up(&sim);
+  for (int i = 0; i < 30; i++)
+    sched_sim_slot(&sim, (i == 12) ? 40000 : 0);
+
+  /* the sweep slot ran 40 ms long once, both listen windows waited for it */
+  TEST_ASSERT_EQUAL_UINT32(80000 + 3 * SCHED_RETUNE_US, sim.sched.session[0].revisit_max_us);
+  TEST_ASSERT_EQUAL_UINT32(50000 + 3 * SCHED_RETUNE_US + 40000, sim.sched.session[1].revisit_max_us);
+  TEST_ASSERT_EQUAL_UINT32(70000 + 3 * SCHED_RETUNE_US + 40000, sim.sched.session[2].revisit_max_us);
+}
+
+static void test_sched_restart(void) {
+  struct sched_sim sim;
+
+  sched_sim_init(&sim);
+  for (int i = 0; i < 10; i++)
+    sched_sim_slot(&sim, 0);
+  /* the first visit paid for the calibration */
+  TEST_ASSERT_EQUAL_UINT32(SCHED_CAL_US, sim.sched.session[1].switch_max_us);
+  ecrf_sched_start(&sim.sched, sim.now_us);
+
+  TEST_ASSERT_EQUAL_INT(3, sim.sched.count);
+  TEST_ASSERT_EQUAL_UINT32(50000, sim.sched.session[1].slot_us);
+  TEST_ASSERT_EQUAL_UINT32(0, sim.sched.session[1].slots);
+  TEST_ASSERT_EQUAL_UINT32(0, sim.sched.session[1].revisit_max_us);
+  TEST_ASSERT_EQUAL_INT(0, ecrf_sched_next(&sim.sched));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sched_plan);
+  RUN_TEST(test_sched_rejects);
+  RUN_TEST(test_sched_accounting);
+  RUN_TEST(test_sched_overrun);
+  RUN_TEST(test_sched_restart);
+  return UNITY_END();
+}
@@ -0,0 +1,152 @@
+#include <stdbool.h>
+#include <unity.h>
+
+#include <ecrf_survey.h>
+
+/*
+ * Survey aggregation against hand-made sweeps: threshold filtering, means
+ * over the hits only, and the top-K report.
+ */
+#define SURVEY_THRESHOLD -75
+#define SURVEY_QUIET -100
+
+static void survey_sweep(struct s_ecrf_survey *survey, uint32_t now_ms, size_t channel,
+                         int16_t rssi) {
+  int16_t channel_rssi[ECRF_SURVEY_MAX_CHANNELS];
+
+  for (size_t i = 0; i < ECRF_SURVEY_MAX_CHANNELS; i++)
+    channel_rssi[i] = SURVEY_QUIET;
+  channel_rssi[channel] = rssi;
+  ecrf_survey_add(survey, channel_rssi, now_ms);
+}
+
+/* at the threshold is not a hit, one above is */
+static void test_survey_threshold(void) {
+  static struct s_ecrf_survey survey;
+
+  ecrf_survey_reset(&survey, 8, SURVEY_THRESHOLD, 1000);
+  survey_sweep(&survey, 1100, 2, SURVEY_THRESHOLD);
+  survey_sweep(&survey, 1200, 2, SURVEY_THRESHOLD + 1);
+  survey_sweep(&survey, 1300, 3, SURVEY_THRESHOLD - 10);
+
+  TEST_ASSERT_EQUAL_UINT32(3, survey.sweeps);
+  TEST_ASSERT_EQUAL_UINT32(1, survey.channel[2].hits);
+  TEST_ASSERT_EQUAL_UINT32(1200, survey.channel[2].last_seen_ms);
+  TEST_ASSERT_EQUAL_INT(SURVEY_THRESHOLD + 1, survey.channel[2].rssi_max);
+  TEST_ASSERT_EQUAL_UINT32(0, survey.channel[3].hits);
+  TEST_ASSERT_EQUAL_UINT32(0, survey.channel[3].last_seen_ms);
+  TEST_ASSERT_EQUAL_INT(0, ecrf_survey_mean(&survey.channel[3]));
+}
+
+/* the quiet sweeps in between do not pull the mean down */
+static void test_survey_mean(void) {
+  static struct s_ecrf_survey survey;
+
+  ecrf_survey_reset(&survey, 8, SURVEY_THRESHOLD, 0);
+  survey_sweep(&survey, 10, 5, -60);
+  survey_sweep(&survey, 20, 5, SURVEY_QUIET);
+  survey_sweep(&survey, 30, 5, -70);
+  survey_sweep(&survey, 40, 5, SURVEY_QUIET);
+  survey_sweep(&survey, 50, 5, -65);
+
+  TEST_ASSERT_EQUAL_UINT32(5, survey.sweeps);
+  TEST_ASSERT_EQUAL_UINT32(3, survey.channel[5].hits);
+  TEST_ASSERT_EQUAL_INT(-65, ecrf_survey_mean(&survey.channel[5]));
+  TEST_ASSERT_EQUAL_INT(-60, survey.channel[5].rssi_max);
+  TEST_ASSERT_EQUAL_UINT32(50, survey.channel[5].last_seen_ms);
+
+  /* the first hit sets the max, whatever the zeroed channel held */
+  survey_sweep(&survey, 60, 6, -74);
+  TEST_ASSERT_EQUAL_INT(-74, survey.channel[6].rssi_max);
+  TEST_ASSERT_EQUAL_INT(-74, ecrf_survey_mean(&survey.channel[6]));
+}
+
+/* most hits first, then the strongest, then the lowest channel */
+static void test_survey_top_order(void) {
+  static struct s_ecrf_survey survey;
+  uint8_t top[8];
+
+  ecrf_survey_reset(&survey, 16, SURVEY_THRESHOLD, 0);
+  for (int i = 0; i < 3; i++)
+    survey_sweep(&survey, 0, 9, -70);
+  for (int i = 0; i < 2; i++)
+    survey_sweep(&survey, 0, 4, -72);
+  for (int i = 0; i < 2; i++)
+    survey_sweep(&survey, 0, 12, -50);
+  survey_sweep(&survey, 0, 1, -60);
+  survey_sweep(&survey, 0, 7, -60);
+  survey_sweep(&survey, 0, 3, -40);
+
+  TEST_ASSERT_EQUAL_INT(6, ecrf_survey_top(&survey, top, 8));
+  TEST_ASSERT_EQUAL_INT(9, top[0]);
+  TEST_ASSERT_EQUAL_INT(12, top[1]);
+  TEST_ASSERT_EQUAL_INT(4, top[2]);
+  TEST_ASSERT_EQUAL_INT(3, top[3]);
+  TEST_ASSERT_EQUAL_INT(1, top[4]);
+  TEST_ASSERT_EQUAL_INT(7, top[5]);
+
+  /* a shorter window keeps the head of the same order */
+  TEST_ASSERT_EQUAL_INT(3, ecrf_survey_top(&survey, top, 3));
+  TEST_ASSERT_EQUAL_INT(9, top[0]);
+  TEST_ASSERT_EQUAL_INT(12, top[1]);
+  TEST_ASSERT_EQUAL_INT(4, top[2]);
+
+  TEST_ASSERT_EQUAL_INT(1, ecrf_survey_top(&survey, top, 1));
+  TEST_ASSERT_EQUAL_INT(9, top[0]);
+}
+
+/* k above the active channels: only channels with hits, nothing written past */
+static void test_survey_top_few(void) {
+  static struct s_ecrf_survey survey;
+  uint8_t top[ECRF_SURVEY_MAX_CHANNELS];
+
+  for (size_t i = 0; i < ECRF_SURVEY_MAX_CHANNELS; i++)
+    top[i] = 0xAA;
+
+  ecrf_survey_reset(&survey, 32, SURVEY_THRESHOLD, 0);
+  TEST_ASSERT_EQUAL_INT(0, ecrf_survey_top(&survey, top, 16));
+
+  survey_sweep(&survey, 0, 20, -60);
+  survey_sweep(&survey, 0, 31, -55);
+  TEST_ASSERT_EQUAL_INT(2, ecrf_survey_top(&survey, top, 16));
+  TEST_ASSERT_EQUAL_INT(31, top[0]);
+  TEST_ASSERT_EQUAL_INT(20, top[1]);
+  for (size_t i = 2; i < ECRF_SURVEY_MAX_CHANNELS; i++)
+    TEST_ASSERT_EQUAL_INT(0xAA, top[i]);
+}
+
+/* a scan table larger than the survey is clamped, the extra channels ignored */
+static void test_survey_clamp(void) {
+  static struct s_ecrf_survey survey;
+  uint8_t top[ECRF_SURVEY_MAX_CHANNELS];
+
+  ecrf_survey_reset(&survey, ECRF_SURVEY_MAX_CHANNELS + 10, SURVEY_THRESHOLD, 0);
+  TEST_ASSERT_EQUAL_INT(ECRF_SURVEY_MAX_CHANNELS, survey.channels);
+
+  survey_sweep(&survey, 0, ECRF_SURVEY_MAX_CHANNELS - 1, -60);
+  TEST_ASSERT_EQUAL_UINT32(1, survey.channel[ECRF_SURVEY_MAX_CHANNELS - 1].hits);
+  TEST_ASSERT_EQUAL_INT(1, ecrf_survey_top(&survey, top, ECRF_SURVEY_MAX_CHANNELS));
+  TEST_ASSERT_EQUAL_INT(ECRF_SURVEY_MAX_CHANNELS - 1, top[0]);
+
+  ecrf_survey_reset(&survey, 8, SURVEY_THRESHOLD, 0);
+  TEST_ASSERT_EQUAL_INT(8, survey.channels);
+  survey_sweep(&survey, 0, 8, -60);
+  TEST_ASSERT_EQUAL_UINT32(0, survey.channel[8].hits);
+  TEST_ASSERT_EQUAL_INT(0, ecrf_survey_top(&survey, top, 8));
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_survey_threshold);
+  RUN_TEST(test_survey_mean);
+  RUN_TEST(test_survey_top_order);
+  RUN_TEST(test_survey_top_few);
+  RUN_TEST(test_survey_clamp);
+  return UNITY_END();
+}
@@ -0,0 +1,253 @@
+#include <stdbool.h>
+#include <string.h>
+#include <unity.h>
+
+#include <ecrf_symrate.h>
+
+/*
+ * Symbol rate estimation on synthetic oversampled streams: PWM and
+ * Manchester frames between silences, with jitter on every element and
+ * short runs of noise in the gaps. Same tolerance and fit as the firmware.
+ */
+#define SYMRATE_TOLERANCE 20
+#define SYMRATE_MIN_FIT 70
+#define SYMRATE_SILENCE (2 * ECRF_SYMRATE_MAX_RUN)
+#define SYMRATE_FRAMES 16
+#define SYMRATE_FRAME_BITS 24
+
+struct symrate_gen {
+  uint8_t buf[16384];
+  size_t samples;
+  float unit;
+  float clock; /* where the next edge is due, jitter aside */
+  int jitter; /* samples, either way, on every element */
+  int noise;  /* runs of noise before each frame */
+  unsigned seed;
+};
+
+static unsigned symrate_rand(struct symrate_gen *gen, unsigned range) {
+  gen->seed = gen->seed * 1103515245u + 12345u;
+  return (gen->seed >> 16) % range;
+}
+
+static void symrate_put(struct symrate_gen *gen, int level, size_t samples) {
+  for (size_t i = 0; i < samples; i++, gen->samples++) {
+    if (level)
+      gen->buf[gen->samples / 8] |= 0x80 >> (gen->samples % 8);
+  }
+}
+
+/* an element of units symbols at level, its end edge jittered */
+static void symrate_element(struct symrate_gen *gen, int level, unsigned units) {
+  int jitter = gen->jitter ? (int)symrate_rand(gen, 2 * gen->jitter + 1) - gen->jitter : 0;
+
+  gen->clock += units * gen->unit;
+  symrate_put(gen, level, (size_t)((long)(gen->clock + 0.5f) + jitter - (long)gen->samples));
+}
+
+static void symrate_gap(struct symrate_gen *gen) {
+  for (int i = 0; i < gen->noise; i++)
+    symrate_put(gen, i & 1, 1 + symrate_rand(gen, 6));
+  symrate_put(gen, 0, SYMRATE_SILENCE);
+  gen->clock = gen->samples;
+}
+
+/* 1:3 PWM, a 1 is a long mark, after a sync of a mark and 31 spaces */
+static void symrate_pwm_frame(struct symrate_gen *gen) {
+  symrate_element(gen, 1, 1);
+  symrate_element(gen, 0, 31);
+  for (int bit = 0; bit < SYMRATE_FRAME_BITS; bit++) {
+    unsigned one = symrate_rand(gen, 2);
+    symrate_element(gen, 1, one ? 3 : 1);
+    symrate_element(gen, 0, one ? 1 : 3);
+  }
+}
+
+static void symrate_pwm(struct symrate_gen *gen) {
+  for (int frame = 0; frame < SYMRATE_FRAMES; frame++) {
+    symrate_gap(gen);
+    symrate_pwm_frame(gen);
+  }
+  symrate_gap(gen);
+}
+
+/* half a bit per element, equal levels merge into runs of one or two units */
+static void symrate_manchester(struct symrate_gen *gen) {
+  for (int frame = 0; frame < SYMRATE_FRAMES; frame++) {
+    symrate_gap(gen);
+    for (int bit = 0; bit < SYMRATE_FRAME_BITS; bit++) {
+      int one = (int)symrate_rand(gen, 2);
+      symrate_element(gen, one, 1);
+      symrate_element(gen, !one, 1);
+    }
+  }
+  symrate_gap(gen);
+}
+
+static void symrate_gen_init(struct symrate_gen *gen, float unit, int jitter, int noise) {
+  memset(gen, 0, sizeof(*gen));
+  gen->unit = unit;
+  gen->jitter = jitter;
+  gen->noise = noise;
+  gen->seed = 1;
+}
+
+static bool symrate_run(const struct symrate_gen *gen, struct s_ecrf_symrate_estimate *estimate) {
+  static struct s_ecrf_symrate symrate;
+
+  TEST_ASSERT_TRUE(gen->samples <= 8 * sizeof(gen->buf));
+  ecrf_symrate_reset(&symrate);
+  ecrf_symrate_feed(&symrate, gen->buf, (gen->samples + 7) / 8);
+  return ecrf_symrate_estimate(&symrate, SYMRATE_TOLERANCE, SYMRATE_MIN_FIT, estimate);
+}
+
+static bool symrate_near(float value, float expected, float error) {
+  return (value > expected - error) && (value < expected + error);
+}
+
+static void test_symrate_pwm(void) {
+  static struct symrate_gen gen;
+  struct s_ecrf_symrate_estimate estimate;
+
+  symrate_gen_init(&gen, 10, 0, 0);
+  symrate_pwm(&gen);
+  TEST_ASSERT_TRUE(symrate_run(&gen, &estimate));
+  TEST_ASSERT_TRUE(symrate_near(estimate.unit, 10, 0.01f));
+  TEST_ASSERT_EQUAL_INT(100, estimate.fit);
+  TEST_ASSERT_EQUAL_INT(31, estimate.longest);
+  TEST_ASSERT_EQUAL_INT(0, estimate.short_runs);
+}
+
+static void test_symrate_manchester(void) {
+  static struct symrate_gen gen;
+  struct s_ecrf_symrate_estimate estimate;
+
+  symrate_gen_init(&gen, 12.5f, 0, 0);
+  symrate_manchester(&gen);
+  TEST_ASSERT_TRUE(symrate_run(&gen, &estimate));
+  TEST_ASSERT_TRUE(symrate_near(estimate.unit, 12.5f, 0.1f));
+  TEST_ASSERT_EQUAL_INT(100, estimate.fit);
+  TEST_ASSERT_EQUAL_INT(2, estimate.longest);
+}
+
+/* a sample either way on every element: still every run, unit averaged out */
+static void test_symrate_jitter(void) {
+  static struct symrate_gen gen;
+  struct s_ecrf_symrate_estimate estimate;
+
+  symrate_gen_init(&gen, 12, 1, 0);
+  symrate_pwm(&gen);
+  TEST_ASSERT_TRUE(symrate_run(&gen, &estimate));
+  TEST_ASSERT_TRUE(symrate_near(estimate.unit, 12, 0.25f));
+  TEST_ASSERT_EQUAL_INT(100, estimate.fit);
+
+  symrate_gen_init(&gen, 9, 1, 0);
+  symrate_manchester(&gen);
+  TEST_ASSERT_TRUE(symrate_run(&gen, &estimate));
+  TEST_ASSERT_TRUE(symrate_near(estimate.unit, 9, 0.25f));
+  TEST_ASSERT_EQUAL_INT(100, estimate.fit);
+}
+
+/* a fifth of the time in noise between frames, runs of 1 to 6 samples */
+static void test_symrate_noise(void) {
+  static struct symrate_gen gen;
+  struct s_ecrf_symrate_estimate estimate;
+
+  symrate_gen_init(&gen, 10, 1, 40);
+  symrate_manchester(&gen);
+  TEST_ASSERT_TRUE(symrate_run(&gen, &estimate));
+  TEST_ASSERT_TRUE(symrate_near(estimate.unit, 10, 0.25f));
+  /* what the unit leaves out is the noise */
+  TEST_ASSERT_TRUE(estimate.fit >= SYMRATE_MIN_FIT);
+  TEST_ASSERT_TRUE(estimate.short_runs >= 15);
+  TEST_ASSERT_TRUE(estimate.fit + estimate.short_runs >= 97);
+}
+
+/* runs of two and three units: the shortest peak is twice the unit */
+static void test_symrate_peak_multiple(void) {
+  static struct symrate_gen gen;
+  struct s_ecrf_symrate_estimate estimate;
+
+  symrate_gen_init(&gen, 10, 0, 0);
+  for (int frame = 0; frame < SYMRATE_FRAMES; frame++) {
+    symrate_gap(&gen);
+    for (int bit = 0; bit < SYMRATE_FRAME_BITS; bit++) {
+      unsigned one = symrate_rand(&gen, 2);
+      symrate_element(&gen, 1, one ? 3 : 2);
+      symrate_element(&gen, 0, one ? 2 : 3);
+    }
+  }
+  symrate_gap(&gen);
+  TEST_ASSERT_TRUE(symrate_run(&gen, &estimate));
+  TEST_ASSERT_TRUE(symrate_near(estimate.unit, 10, 0.01f));
+  TEST_ASSERT_EQUAL_INT(100, estimate.fit);
+  TEST_ASSERT_EQUAL_INT(3, estimate.longest);
+}
+
+/* under the shortest unit tried: no estimate, the short runs tell why */
+static void test_symrate_too_fast(void) {
+  static struct symrate_gen gen;
+  struct s_ecrf_symrate_estimate estimate;
+
+  symrate_gen_init(&gen, ECRF_SYMRATE_MIN_UNIT / 2, 0, 0);
+  symrate_manchester(&gen);
+  TEST_ASSERT_FALSE(symrate_run(&gen, &estimate));
+  TEST_ASSERT_TRUE(estimate.fit < SYMRATE_MIN_FIT);
+  TEST_ASSERT_TRUE(estimate.short_runs >= 30);
+}
+
+/* lost data: a run is not joined across the gap */
+static void test_symrate_break(void) {
+  static struct symrate_gen before, after;
+  static struct s_ecrf_symrate joined, broken;
+  struct s_ecrf_symrate_estimate estimate;
+
+  /* a frame cut 16 samples into a mark, the capture resumes on the next one */
+  symrate_gen_init(&before, 10, 0, 0);
+  symrate_gap(&before);
+  symrate_pwm_frame(&before);
+  symrate_put(&before, 1, 16);
+  symrate_gen_init(&after, 10, 0, 0);
+  symrate_element(&after, 1, 1);
+  symrate_element(&after, 0, 1);
+  symrate_pwm_frame(&after);
+  TEST_ASSERT_EQUAL_INT(0, before.samples % 8);
+
+  ecrf_symrate_reset(&joined);
+  ecrf_symrate_reset(&broken);
+  for (int frame = 0; frame < SYMRATE_FRAMES; frame++) {
+    ecrf_symrate_feed(&joined, before.buf, before.samples / 8);
+    ecrf_symrate_feed(&joined, after.buf, after.samples / 8);
+    ecrf_symrate_feed(&broken, before.buf, before.samples / 8);
+    ecrf_symrate_break(&broken);
+    ecrf_symrate_feed(&broken, after.buf, after.samples / 8);
+  }
+
+  TEST_ASSERT_TRUE(ecrf_symrate_estimate(&broken, SYMRATE_TOLERANCE, SYMRATE_MIN_FIT, &estimate));
+  TEST_ASSERT_TRUE(symrate_near(estimate.unit, 10, 0.01f));
+  TEST_ASSERT_EQUAL_INT(100, estimate.fit);
+
+  /* joined, the 16 samples and the next mark make a 26 sample misfit */
+  TEST_ASSERT_TRUE(ecrf_symrate_estimate(&joined, SYMRATE_TOLERANCE, SYMRATE_MIN_FIT, &estimate));
+  TEST_ASSERT_TRUE(symrate_near(estimate.unit, 10, 0.01f));
+  TEST_ASSERT_TRUE(estimate.fit < 100);
+  TEST_ASSERT_EQUAL_INT(broken.runs + SYMRATE_FRAMES, joined.runs);
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_symrate_pwm);
+  RUN_TEST(test_symrate_manchester);
+  RUN_TEST(test_symrate_jitter);
+  RUN_TEST(test_symrate_noise);
+  RUN_TEST(test_symrate_peak_multiple);
+  RUN_TEST(test_symrate_too_fast);
+  RUN_TEST(test_symrate_break);
+  return UNITY_END();
+}
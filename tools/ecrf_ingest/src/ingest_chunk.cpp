@@ -0,0 +1,124 @@
+#include <algorithm>
+
+#include "ingest_chunk.h"
+
+namespace ecrf {
+
+chunker::chunker(unsigned source, size_t chunk_size, size_t lead,
+                 std::function<void(chunk &&)> emit)
+    : source_(source),
+      /* a slice shorter than its lead-in would report frames twice */
+      chunk_size_(std::max(chunk_size, std::max(lead, (size_t)1))),
+      lead_(lead),
+      emit_(std::move(emit)),
+      seq_(0),
+      session_(0),
+      pending_offset_(0),
+      owned_from_(0) {
+}
+
+void chunker::emit_slice(void) {
+  chunk c;
+  size_t owned_end = owned_from_ + chunk_size_;
+
+  c.source = source_;
+  c.seq = seq_++;
+  c.session = session_;
+  c.offset = pending_offset_;
+  c.owned_begin = owned_from_;
+  c.owned_end = owned_end;
+  c.data.assign(pending_.begin(), pending_.begin() + owned_end + lead_);
+
+  /* text seen inside the owned bytes goes along */
+  uint64_t limit = pending_offset_ + owned_end;
+  auto split = std::stable_partition(records_.begin(), records_.end(),
+                                     [limit](const record &rec) { return rec.offset < limit; });
+  c.records.assign(std::make_move_iterator(records_.begin()), std::make_move_iterator(split));
+  records_.erase(records_.begin(), split);
+
+  size_t drop = owned_end - lead_;
+  pending_.erase(pending_.begin(), pending_.begin() + drop);
+  pending_offset_ += drop;
+  owned_from_ = lead_;
+
+  emit_(std::move(c));
+}
+
+void chunker::flush(void) {
+  size_t size = pending_.size();
+
+  if ((size > owned_from_) || !records_.empty()) {
+    chunk c;
+    c.source = source_;
+    c.seq = seq_++;
+    c.session = session_;
+    c.offset = pending_offset_;
+    c.owned_begin = std::min(owned_from_, size);
+    c.owned_end = size;
+    c.data = std::move(pending_);
+    c.records = std::move(records_);
+    emit_(std::move(c));
+  }
+
+  pending_offset_ += size;
+  pending_.clear();
+  records_.clear();
+  owned_from_ = 0;
+}
+
+void chunker::add_record(record &&rec) {
+  rec.session = session_;
+  records_.push_back(std::move(rec));
+}
+
+void chunker::on_data(const uint8_t *data, size_t len) {
+  pending_.insert(pending_.end(), data, data + len);
+  while (pending_.size() >= owned_from_ + chunk_size_ + lead_)
+    emit_slice();
+}
+
+void chunker::on_burst(uint64_t offset, int rssi, int64_t freq_offset) {
+  flush();
+  record rec;
+  rec.kind = RECORD_BURST;
+  rec.offset = offset;
+  rec.value = rssi;
+  rec.freq_offset = freq_offset;
+  add_record(std::move(rec));
+}
+
+void chunker::on_gap(uint64_t offset, int64_t lost, bool link) {
+  flush();
+  record rec;
+  rec.kind = RECORD_GAP;
+  rec.offset = offset;
+  rec.value = lost;
+  rec.link = link;
+  add_record(std::move(rec));
+  /* the parser skipped the missing bytes, offsets resume after them */
+  if (link && (lost > 0))
+    pending_offset_ += lost;
+}
+
+void chunker::on_session(void) {
+  flush();
+  session_++;
+  pending_offset_ = 0;
+  record rec;
+  rec.kind = RECORD_SESSION;
+  add_record(std::move(rec));
+}
+
+void chunker::on_text(uint64_t offset, const std::string &line) {
+  record rec;
+  rec.kind = RECORD_TEXT;
+  rec.offset = offset;
+  rec.text = line;
+  add_record(std::move(rec));
+}
+
+void chunker::finish(void) {
+  flush();
+}
+
+}  // namespace ecrf
@@ -0,0 +1,113 @@
+#ifndef _INGEST_CHUNK_H
+#define _INGEST_CHUNK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "ingest_parse.h"
+
+namespace ecrf {
+
+enum record_kind {
+  RECORD_CODE,
+  RECORD_PULSES,
+  RECORD_BURST,
+  RECORD_GAP,
+  RECORD_SESSION,
+  RECORD_TEXT,
+  RECORD_SCAN,
+};
+
+/*
+ * One output line. Positions are in the device stream: the data byte of
+ * the session and the bit in it, MSB first like the CC1101 shifts them.
+ */
+struct record {
+  record_kind kind;
+  unsigned session = 0;
+  uint64_t offset = 0;
+  unsigned bit = 0;
+  /* code */
+  const char *proto = nullptr;
+  uint64_t code = 0;
+  unsigned bits = 0;
+  unsigned repeats = 0;
+  unsigned base_us = 0;
+  /* pulses */
+  unsigned pulses = 0;
+  unsigned duration_us = 0;
+  std::vector<unsigned> widths_us;
+  /* burst RSSI, scan RSSI, gap length (INGEST_GAP_UNKNOWN) */
+  int64_t value = 0;
+  bool link = false;
+  /* burst carrier offset in Hz, INGEST_FREQ_NONE untracked */
+  int64_t freq_offset = INGEST_FREQ_NONE;
+  /* scan */
+  unsigned freq_khz = 0;
+  /* text, scan level */
+  std::string text;
+  /* formatted by the worker */
+  std::string line;
+};
+
+/*
+ * A slice of one source's data, decoded on its own by any worker. Frames
+ * are reported by the chunk owning their first pulse: data before
+ * owned_begin is lead-in, data after owned_end lookahead, so a frame
+ * crossing a slice boundary is seen whole by exactly one chunk.
+ */
+struct chunk {
+  unsigned source = 0;
+  uint64_t seq = 0;
+  unsigned session = 0;
+  /* stream offset of data[0] */
+  uint64_t offset = 0;
+  size_t owned_begin = 0;
+  size_t owned_end = 0;
+  std::vector<uint8_t> data;
+  /* markers and text first, decoded frames appended */
+  std::vector<record> records;
+  /* frames too short to be anything */
+  unsigned noise = 0;
+};
+
+/*
+ * Cuts one source into chunks as the parser hands data over. Slices are
+ * chunk_size owned bytes with lead bytes on both sides; a marker or a new
+ * session ends the current slice early, nothing is decoded across them.
+ */
+class chunker : public parse_sink {
+ public:
+  chunker(unsigned source, size_t chunk_size, size_t lead, std::function<void(chunk &&)> emit);
+
+  void on_data(const uint8_t *data, size_t len) override;
+  void on_burst(uint64_t offset, int rssi, int64_t freq_offset) override;
+  void on_gap(uint64_t offset, int64_t lost, bool link) override;
+  void on_session(void) override;
+  void on_text(uint64_t offset, const std::string &line) override;
+  /* end of input, emits whatever is pending */
+  void finish(void);
+
+ private:
+  void emit_slice(void);
+  void flush(void);
+  void add_record(record &&rec);
+
+  unsigned source_;
+  size_t chunk_size_;
+  size_t lead_;
+  std::function<void(chunk &&)> emit_;
+  uint64_t seq_;
+  unsigned session_;
+  std::vector<uint8_t> pending_;
+  uint64_t pending_offset_;
+  size_t owned_from_;
+  std::vector<record> records_;
+};
+
+}  // namespace ecrf
+
+#endif /* _INGEST_CHUNK_H */
@@ -0,0 +1,391 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "ingest_decode.h"
+
+namespace ecrf {
+
+const pulse_protocol pulse_protocols[] = {
+    {"rcswitch1", 350, 1, 31, 1, 3, 3, 1},
+    {"rcswitch2", 650, 1, 10, 1, 2, 2, 1},
+    {"rcswitch3", 100, 30, 71, 4, 11, 9, 6},
+    {"rcswitch4", 380, 1, 6, 1, 3, 3, 1},
+    {"rcswitch5", 500, 6, 14, 1, 2, 2, 1},
+};
+
+const size_t pulse_protocol_count = sizeof(pulse_protocols) / sizeof(pulse_protocols[0]);
+
+/* lib/cc1101_ecrf/ecrf_profile.cpp built-ins */
+static const struct {
+  const char *name;
+  unsigned rate;
+} profile_rates[] = {
+    {"ook433", 10000}, {"ook315", 10000}, {"ook868", 10000}, {"fsk433", 4800}, {"fsk868", 38400},
+};
+
+unsigned profile_rate(const std::string &name) {
+  for (const auto &profile : profile_rates) {
+    if (name == profile.name)
+      return profile.rate;
+  }
+
+  return 0;
+}
+
+struct run {
+  /* in samples from data[0] */
+  uint64_t start;
+  uint32_t length;
+  bool high;
+};
+
+/* level runs of the MSB first bit stream, whole bytes at a time when flat */
+static void slice_runs(const std::vector<uint8_t> &data, std::vector<run> &runs) {
+  uint64_t sample = 0;
+
+  for (uint8_t byte : data) {
+    if (!runs.empty() && (byte == (runs.back().high ? 0xFF : 0x00))) {
+      runs.back().length += 8;
+      sample += 8;
+      continue;
+    }
+
+    for (int bit = 7; bit >= 0; bit--, sample++) {
+      bool high = (byte >> bit) & 1;
+      if (!runs.empty() && (runs.back().high == high))
+        runs.back().length++;
+      else
+        runs.push_back({sample, 1, high});
+    }
+  }
+}
+
+struct pulse_pair {
+  double high_us;
+  double low_us;
+  uint64_t start;
+  /* the low is the silence ending the frame, or cut by the chunk end */
+  bool last;
+};
+
+struct code_word {
+  uint64_t code;
+  unsigned bits;
+  uint64_t start;
+  double base_us;
+  /* relative timing error summed over the symbols */
+  double error;
+};
+
+class frame_matcher {
+ public:
+  frame_matcher(const decode_config &config)
+      : tolerance_(config.tolerance / 100.0), slack_us_(1e6 / config.rate), min_bits_(config.min_bits) {
+  }
+
+  void match(const std::vector<pulse_pair> &pairs, const pulse_protocol &proto,
+             std::vector<code_word> &words) const {
+    size_t i = 0;
+
+    while (i < pairs.size()) {
+      const pulse_pair &sync = pairs[i];
+      double base = (sync.high_us + sync.low_us) / (proto.sync_high + proto.sync_low);
+      if (sync.last || !is(sync, proto.sync_high, proto.sync_low, base)) {
+        i++;
+        continue;
+      }
+
+      code_word word = {0, 0, 0, base, 0};
+      size_t j = i + 1;
+      /* the pair ending in silence is the closing sync, never a symbol */
+      for (; (j < pairs.size()) && !pairs[j].last; j++) {
+        const pulse_pair &pair = pairs[j];
+        bool zero = is(pair, proto.zero_high, proto.zero_low, base);
+        bool one = is(pair, proto.one_high, proto.one_low, base);
+        if (zero == one)
+          break;
+        if (word.bits == 0)
+          word.start = pair.start;
+        /* longer words keep their last 64 bits */
+        word.code = (word.code << 1) | (one ? 1 : 0);
+        word.bits++;
+        word.error += one ? error(pair, proto.one_high, proto.one_low, base)
+                          : error(pair, proto.zero_high, proto.zero_low, base);
+      }
+
+      if (word.bits >= min_bits_)
+        words.push_back(word);
+      i = std::max(j, i + 1);
+    }
+  }
+
+ private:
+  bool within(double us, double expected) const {
+    return std::fabs(us - expected) <= expected * tolerance_ + slack_us_;
+  }
+
+  bool is(const pulse_pair &pair, unsigned high, unsigned low, double base) const {
+    return within(pair.high_us, high * base) && within(pair.low_us, low * base);
+  }
+
+  static double error(const pulse_pair &pair, unsigned high, unsigned low, double base) {
+    return std::fabs(pair.high_us / (high * base) - 1) + std::fabs(pair.low_us / (low * base) - 1);
+  }
+
+  double tolerance_;
+  /* one sample of quantization either way */
+  double slack_us_;
+  unsigned min_bits_;
+};
+
+static void set_position(record &rec, const chunk &c, uint64_t sample) {
+  uint64_t bit = c.offset * 8 + sample;
+  rec.session = c.session;
+  rec.offset = bit / 8;
+  rec.bit = (unsigned)(bit % 8);
+}
+
+/* pulse widths clustered within the tolerance, the most used ones */
+static std::vector<unsigned> width_clusters(std::vector<double> &widths, const decode_config &config) {
+  struct cluster {
+    double first;
+    double sum;
+    unsigned count;
+  };
+  std::vector<cluster> clusters;
+  double slack = 1e6 / config.rate;
+
+  std::sort(widths.begin(), widths.end());
+  for (double width : widths) {
+    if (clusters.empty() || (width > clusters.back().first * (1 + config.tolerance / 100.0) + slack))
+      clusters.push_back({width, 0, 0});
+    clusters.back().sum += width;
+    clusters.back().count++;
+  }
+
+  std::stable_sort(clusters.begin(), clusters.end(),
+                   [](const cluster &a, const cluster &b) { return a.count > b.count; });
+  clusters.resize(std::min(clusters.size(), (size_t)4));
+
+  std::vector<unsigned> result;
+  for (const cluster &c : clusters)
+    result.push_back((unsigned)std::lround(c.sum / c.count));
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+static void decode_frame(chunk &c, const decode_config &config, const std::vector<run> &runs,
+                         size_t first, size_t last, uint64_t silence) {
+  uint64_t start = runs[first].start;
+  if ((start < c.owned_begin * 8) || (start >= c.owned_end * 8))
+    return;
+
+  double sample_us = 1e6 / config.rate;
+  std::vector<pulse_pair> pairs;
+  std::vector<double> widths;
+  for (size_t i = first; i <= last; i++) {
+    if (!runs[i].high)
+      continue;
+    pulse_pair pair = {runs[i].length * sample_us, 0, runs[i].start, true};
+    widths.push_back(pair.high_us);
+    if ((i < last) || ((i + 1 < runs.size()) && (runs[i + 1].length < silence))) {
+      pair.low_us = runs[i + 1].length * sample_us;
+      pair.last = (i + 1 == runs.size() - 1) && (runs[i + 1].length < silence);
+      if (!pair.last)
+        widths.push_back(pair.low_us);
+    }
+    pairs.push_back(pair);
+  }
+
+  if (pairs.size() < config.min_pulses) {
+    c.noise++;
+    return;
+  }
+
+  frame_matcher matcher(config);
+  const pulse_protocol *best = nullptr;
+  std::vector<code_word> bestWords;
+  unsigned bestBits = 0;
+  double bestError = 0;
+  /* timings overlap within the tolerance: most bits, then closest fit */
+  for (size_t p = 0; p < pulse_protocol_count; p++) {
+    std::vector<code_word> words;
+    matcher.match(pairs, pulse_protocols[p], words);
+    unsigned bits = 0;
+    double error = 0;
+    for (const code_word &word : words) {
+      bits += word.bits;
+      error += word.error;
+    }
+    if ((bits > bestBits) || ((bits == bestBits) && (bits > 0) && (error < bestError))) {
+      best = &pulse_protocols[p];
+      bestWords = std::move(words);
+      bestBits = bits;
+      bestError = error;
+    }
+  }
+
+  if (best == nullptr) {
+    record rec;
+    rec.kind = RECORD_PULSES;
+    set_position(rec, c, start);
+    rec.pulses = (unsigned)pairs.size();
+    const run &end = runs[last].high ? runs[last] : runs[last - 1];
+    rec.duration_us = (unsigned)std::lround((end.start + end.length - start) * sample_us);
+    rec.widths_us = width_clusters(widths, config);
+    c.records.push_back(std::move(rec));
+    return;
+  }
+
+  /* a remote repeats its word, one record per run of identical words */
+  for (size_t i = 0; i < bestWords.size();) {
+    size_t j = i + 1;
+    double base = bestWords[i].base_us;
+    while ((j < bestWords.size()) && (bestWords[j].code == bestWords[i].code) &&
+           (bestWords[j].bits == bestWords[i].bits)) {
+      base += bestWords[j].base_us;
+      j++;
+    }
+
+    record rec;
+    rec.kind = RECORD_CODE;
+    set_position(rec, c, bestWords[i].start);
+    rec.proto = best->name;
+    rec.code = bestWords[i].code;
+    rec.bits = bestWords[i].bits;
+    rec.repeats = (unsigned)(j - i);
+    rec.base_us = (unsigned)std::lround(base / (j - i));
+    c.records.push_back(std::move(rec));
+    i = j;
+  }
+}
+
+/* "FINE        Frequency: 433.92  RSSI: -60" from the scan command */
+static void decode_scan(record &rec) {
+  char level[8];
+  unsigned mhz;
+  unsigned hundredths;
+  int rssi;
+
+  if ((sscanf(rec.text.c_str(), "%7s Frequency: %u.%u RSSI: %d", level, &mhz, &hundredths, &rssi) != 4) ||
+      ((strcmp(level, "FINE") != 0) && (strcmp(level, "COARSE") != 0)))
+    return;
+
+  rec.kind = RECORD_SCAN;
+  rec.freq_khz = mhz * 1000 + hundredths * 10;
+  rec.value = rssi;
+  rec.text = (level[0] == 'F') ? "fine" : "coarse";
+}
+
+void decode_chunk(chunk &c, const decode_config &config) {
+  std::vector<run> runs;
+  uint64_t silence = std::max<uint64_t>(1, (uint64_t)config.silence_us * config.rate / 1000000);
+
+  for (record &rec : c.records) {
+    if (rec.kind == RECORD_TEXT)
+      decode_scan(rec);
+  }
+
+  slice_runs(c.data, runs);
+
+  /* a frame runs from a high level to the next silence or the data end */
+  bool inFrame = false;
+  size_t first = 0;
+  for (size_t i = 0; i < runs.size(); i++) {
+    if (runs[i].high && !inFrame) {
+      inFrame = true;
+      first = i;
+    } else if (!runs[i].high && inFrame && (runs[i].length >= silence)) {
+      decode_frame(c, config, runs, first, i - 1, silence);
+      inFrame = false;
+    }
+  }
+  if (inFrame)
+    decode_frame(c, config, runs, first, runs.size() - 1, silence);
+
+  std::stable_sort(c.records.begin(), c.records.end(), [](const record &a, const record &b) {
+    return (a.offset * 8 + a.bit) < (b.offset * 8 + b.bit);
+  });
+}
+
+static void json_string(std::string &out, const std::string &text) {
+  out += '"';
+  for (unsigned char ch : text) {
+    if ((ch == '"') || (ch == '\\')) {
+      out += '\\';
+      out += (char)ch;
+    } else if (ch < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof(escape), "\\u%04x", ch);
+      out += escape;
+    } else {
+      out += (char)ch;
+    }
+  }
+  out += '"';
+}
+
+std::string format_record(const record &rec, const std::string &source) {
+  static const char *const kinds[] = {"code", "pulses", "burst", "gap", "session", "text", "scan"};
+  std::string out = "{\"src\":";
+  char field[96];
+
+  json_string(out, source);
+  snprintf(field, sizeof(field), ",\"ses\":%u,\"off\":%" PRIu64 ",\"bit\":%u,\"kind\":\"%s\"",
+           rec.session, rec.offset, rec.bit, kinds[rec.kind]);
+  out += field;
+
+  switch (rec.kind) {
+    case RECORD_CODE:
+      snprintf(field, sizeof(field),
+               ",\"proto\":\"%s\",\"bits\":%u,\"code\":\"0x%" PRIx64 "\",\"base_us\":%u,\"repeats\":%u",
+               rec.proto, rec.bits, rec.code, rec.base_us, rec.repeats);
+      out += field;
+      break;
+    case RECORD_PULSES:
+      snprintf(field, sizeof(field), ",\"pulses\":%u,\"dur_us\":%u,\"widths_us\":[", rec.pulses,
+               rec.duration_us);
+      out += field;
+      for (size_t i = 0; i < rec.widths_us.size(); i++) {
+        snprintf(field, sizeof(field), "%s%u", (i > 0) ? "," : "", rec.widths_us[i]);
+        out += field;
+      }
+      out += ']';
+      break;
+    case RECORD_BURST:
+      snprintf(field, sizeof(field), ",\"rssi\":%d", (int)rec.value);
+      out += field;
+      if (rec.freq_offset != INGEST_FREQ_NONE) {
+        snprintf(field, sizeof(field), ",\"freq_hz\":%lld", (long long)rec.freq_offset);
+        out += field;
+      }
+      break;
+    case RECORD_GAP:
+      if (rec.value == INGEST_GAP_UNKNOWN)
+        snprintf(field, sizeof(field), ",\"lost\":null,\"link\":%s", rec.link ? "true" : "false");
+      else
+        snprintf(field, sizeof(field), ",\"lost\":%" PRId64 ",\"link\":%s", rec.value,
+                 rec.link ? "true" : "false");
+      out += field;
+      break;
+    case RECORD_TEXT:
+      out += ",\"text\":";
+      json_string(out, rec.text);
+      break;
+    case RECORD_SCAN:
+      snprintf(field, sizeof(field), ",\"level\":\"%s\",\"khz\":%u,\"rssi\":%d", rec.text.c_str(),
+               rec.freq_khz, (int)rec.value);
+      out += field;
+      break;
+    case RECORD_SESSION:
+      break;
+  }
+
+  out += "}\n";
+  return out;
+}
+
+}  // namespace ecrf
@@ -0,0 +1,53 @@
+#ifndef _INGEST_DECODE_H
+#define _INGEST_DECODE_H
+
+#include <cstdint>
+#include <string>
+
+#include "ingest_chunk.h"
+
+namespace ecrf {
+
+struct decode_config {
+  /* samples per second: the profile bit rate, each bit is one sample */
+  unsigned rate = 10000;
+  /* a low level this long ends a frame */
+  unsigned silence_us = 20000;
+  /* frames with fewer high pulses are counted as noise */
+  unsigned min_pulses = 16;
+  unsigned min_bits = 12;
+  /* pulse width tolerance against the protocol timings, percent */
+  unsigned tolerance = 35;
+};
+
+/*
+ * Pulse protocols with a (high, low) pair per symbol and a sync pair
+ * between code words, in units of the base pulse: the rc-switch table.
+ */
+struct pulse_protocol {
+  const char *name;
+  unsigned base_us;
+  uint8_t sync_high, sync_low;
+  uint8_t zero_high, zero_low;
+  uint8_t one_high, one_low;
+};
+
+extern const pulse_protocol pulse_protocols[];
+extern const size_t pulse_protocol_count;
+
+/* the bit rate of a firmware built-in profile, 0 when unknown */
+unsigned profile_rate(const std::string &name);
+
+/*
+ * Bit slicing, pulse extraction and protocol matching over the chunk's
+ * data, plus scan lines out of its text records. Appends the frames owned
+ * by the chunk to its records, in stream order. Thread safe.
+ */
+void decode_chunk(chunk &c, const decode_config &config);
+
+/* one JSON object per line */
+std::string format_record(const record &rec, const std::string &source);
+
+}  // namespace ecrf
+
+#endif /* _INGEST_DECODE_H */
@@ -0,0 +1,223 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "ingest_parse.h"
+
+namespace ecrf {
+
+#define INGEST_TOKEN_MAX 32
+#define INGEST_TEXT_MAX 512
+
+static int hex_value(char c) {
+  /* the firmware prints lowercase only, uppercase starts words like FINE */
+  if ((c >= '0') && (c <= '9'))
+    return c - '0';
+  if ((c >= 'a') && (c <= 'f'))
+    return c - 'a' + 10;
+  return -1;
+}
+
+stream_parser::stream_parser(parse_sink &sink, bool hex_mode)
+    : sink_(sink),
+      hex_mode_(hex_mode),
+      state_(LINE_START),
+      marker_from_(LINE_START),
+      nibble_(-1),
+      data_len_(0),
+      offset_(0),
+      tag_scale_(128) {
+}
+
+void stream_parser::flush_data(void) {
+  if (data_len_ > 0) {
+    sink_.on_data(data_, data_len_);
+    data_len_ = 0;
+  }
+}
+
+void stream_parser::start_text(void) {
+  flush_data();
+  nibble_ = -1;
+  state_ = TEXT;
+}
+
+void stream_parser::end_line(void) {
+  size_t len = token_.size();
+  while ((len > 0) && ((token_[len - 1] == '\r') || (token_[len - 1] == ' ')))
+    len--;
+  token_.resize(len);
+  if (!token_.empty())
+    sink_.on_text(offset_, token_);
+  token_.clear();
+  state_ = LINE_START;
+}
+
+void stream_parser::tag(void) {
+  bool digits = !token_.empty() && (token_.size() <= 10);
+  for (char c : token_)
+    digits = digits && (c >= '0') && (c <= '9');
+
+  if (!digits) {
+    token_ = "[" + token_ + "]";
+    start_text();
+    return;
+  }
+
+  uint64_t value = strtoull(token_.c_str(), NULL, 10);
+  flush_data();
+  nibble_ = -1;
+  if (value == 0) {
+    /* rx prints "[00]", cap "[00000]" */
+    tag_scale_ = (token_.size() >= 5) ? 1 : 128;
+    offset_ = 0;
+    sink_.on_session();
+  } else {
+    uint64_t expected = value * tag_scale_;
+    if (expected > offset_) {
+      sink_.on_gap(offset_, (int64_t)(expected - offset_), true);
+      offset_ = expected;
+    } else if (expected < offset_) {
+      /* the stream went back, nothing sane to stitch: start over */
+      offset_ = 0;
+      sink_.on_session();
+    }
+  }
+
+  token_.clear();
+  state_ = DATA;
+}
+
+void stream_parser::marker(void) {
+  int rssi;
+  long long freq;
+  unsigned long long lost;
+  char unit[8];
+
+  flush_data();
+  nibble_ = -1;
+  int fields = sscanf(token_.c_str(), "burst %d %7s %lld Hz", &rssi, unit, &freq);
+  if (fields >= 2) {
+    sink_.on_burst(offset_, rssi, (fields == 3) ? (int64_t)freq : INGEST_FREQ_NONE);
+  } else if (token_ == "gap ?") {
+    sink_.on_gap(offset_, INGEST_GAP_UNKNOWN, false);
+  } else if (sscanf(token_.c_str(), "gap %llu", &lost) == 1) {
+    sink_.on_gap(offset_, (int64_t)lost, false);
+  } else {
+    sink_.on_text(offset_, "<" + token_ + ">");
+  }
+
+  token_.clear();
+  state_ = marker_from_;
+}
+
+void stream_parser::feed(const char *text, size_t len) {
+  for (size_t i = 0; i < len; i++) {
+    char c = text[i];
+
+    switch (state_) {
+      case LINE_START:
+        if ((c == '\n') || (c == '\r') || (c == ' ')) {
+          break;
+        } else if (c == '[') {
+          token_.clear();
+          state_ = TAG;
+        } else if (hex_mode_ && (c == '<')) {
+          token_.clear();
+          marker_from_ = DATA;
+          state_ = MARKER;
+        } else if (hex_mode_ && (hex_value(c) >= 0)) {
+          state_ = DATA;
+          i--;
+        } else {
+          token_.assign(1, c);
+          start_text();
+        }
+        break;
+
+      case TAG:
+        if (c == ']') {
+          tag();
+        } else if (c == '\n') {
+          token_ = "[" + token_;
+          end_line();
+        } else if (token_.size() < INGEST_TOKEN_MAX) {
+          token_ += c;
+        } else {
+          token_ = "[" + token_ + c;
+          start_text();
+        }
+        break;
+
+      case DATA: {
+        int value = hex_value(c);
+        if (value >= 0) {
+          if (nibble_ < 0) {
+            nibble_ = value;
+          } else {
+            data_[data_len_++] = (uint8_t)((nibble_ << 4) | value);
+            nibble_ = -1;
+            offset_++;
+            if (data_len_ == sizeof(data_))
+              flush_data();
+          }
+        } else if ((c == ' ') || (c == '\r')) {
+          break;
+        } else if (c == '\n') {
+          /* an odd nibble never completes across lines */
+          nibble_ = -1;
+          if (!hex_mode_) {
+            flush_data();
+            state_ = LINE_START;
+          }
+        } else if (c == '<') {
+          token_.clear();
+          marker_from_ = DATA;
+          state_ = MARKER;
+        } else if (c == '[') {
+          flush_data();
+          token_.clear();
+          state_ = TAG;
+        } else {
+          token_.assign(1, c);
+          start_text();
+        }
+        break;
+      }
+
+      case MARKER:
+        if (c == '>') {
+          marker();
+        } else if (c == '\n') {
+          token_ = "<" + token_;
+          flush_data();
+          end_line();
+        } else if (token_.size() < INGEST_TOKEN_MAX) {
+          token_ += c;
+        } else {
+          token_ = "<" + token_ + c;
+          start_text();
+        }
+        break;
+
+      case TEXT:
+        if (c == '\n') {
+          end_line();
+        } else if (token_.size() < INGEST_TEXT_MAX) {
+          token_ += c;
+        }
+        break;
+    }
+  }
+}
+
+void stream_parser::finish(void) {
+  flush_data();
+  if (state_ == TAG)
+    token_ = "[" + token_;
+  else if (state_ == MARKER)
+    token_ = "<" + token_;
+  end_line();
+}
+
+}  // namespace ecrf
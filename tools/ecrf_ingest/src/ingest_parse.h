@@ -0,0 +1,78 @@
+#ifndef _INGEST_PARSE_H
+#define _INGEST_PARSE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace ecrf {
+
+/*
+ * What the parser finds in the device console stream. Offsets count data
+ * bytes since the start of the current session.
+ */
+class parse_sink {
+ public:
+  virtual ~parse_sink() = default;
+  virtual void on_data(const uint8_t *data, size_t len) = 0;
+  /* "<burst -61 dBm>", "<burst -61 dBm -3174 Hz>" when tracking: a gated burst starts here */
+  virtual void on_burst(uint64_t offset, int rssi, int64_t freq_offset) = 0;
+  /* "<gap N>" from the device, or bytes missing from the serial link */
+  virtual void on_gap(uint64_t offset, int64_t lost, bool link) = 0;
+  /* "[00]"/"[00000]": a new rx or cap session */
+  virtual void on_session(void) = 0;
+  /* anything that is not data: shell messages, prompts, scan results */
+  virtual void on_text(uint64_t offset, const std::string &line) = 0;
+};
+
+#define INGEST_GAP_UNKNOWN (-1)
+/* burst from an untracked session */
+#define INGEST_FREQ_NONE INT64_MIN
+
+/*
+ * Incremental parser of what the shell prints during a capture:
+ *   rx:   "\n[NN] " every 128 bytes, NN the line index, then hex
+ *   cap:  "\n[NNNNN] " before each 32 bytes, NNNNN the byte offset
+ * with "<burst N dBm>" and "<gap N>"/"<gap ?>" markers inside the hex. A
+ * line tag puts the rest of the line in data context, the first tag of a
+ * session tells which of the two formats follows. In hex mode (console
+ * sink, plain hex dumps) every line is data. Input may be split anywhere.
+ */
+class stream_parser {
+ public:
+  stream_parser(parse_sink &sink, bool hex_mode = false);
+
+  void feed(const char *text, size_t len);
+  /* end of input: flushes a pending text line */
+  void finish(void);
+  uint64_t offset(void) const {
+    return offset_;
+  }
+
+ private:
+  enum state { LINE_START, TAG, DATA, MARKER, TEXT };
+
+  void start_text(void);
+  void end_line(void);
+  void tag(void);
+  void marker(void);
+  void flush_data(void);
+
+  parse_sink &sink_;
+  bool hex_mode_;
+  state state_;
+  /* tag, marker or text being collected */
+  std::string token_;
+  /* a marker returns to the state it interrupted */
+  state marker_from_;
+  int nibble_;
+  uint8_t data_[256];
+  size_t data_len_;
+  uint64_t offset_;
+  /* bytes per tag step: 128 for rx line indexes, 1 for cap offsets */
+  unsigned tag_scale_;
+};
+
+}  // namespace ecrf
+
+#endif /* _INGEST_PARSE_H */
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstring>
+#include <map>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+
+#include "ingest_chunk.h"
+#include "ingest_parse.h"
+#include "ingest_pipeline.h"
+
+namespace ecrf {
+
+#define INGEST_READ_SIZE 65536
+/* how often a blocked reader looks at stop() */
+#define INGEST_POLL_MS 100
+
+pipeline::pipeline(const ingest_config &config, FILE *out, FILE *index)
+    : config_(config), out_(out), index_(index), stop_(false), position_(0) {
+}
+
+unsigned pipeline::add_source(const std::string &name, int fd) {
+  names_.push_back(name);
+  fds_.push_back(fd);
+  stats_.emplace_back();
+  return (unsigned)(names_.size() - 1);
+}
+
+void pipeline::read_source(unsigned source, work_queue<chunk> &chunks) {
+  std::vector<char> buffer(INGEST_READ_SIZE);
+  chunker slicer(source, config_.chunk_size, config_.lead,
+                 [&chunks](chunk &&c) { chunks.push(std::move(c)); });
+  stream_parser parser(slicer, config_.hex_mode);
+  int fd = fds_[source];
+
+  while (!stop_) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    int ready = poll(&pfd, 1, INGEST_POLL_MS);
+    if ((ready < 0) && (errno != EINTR)) {
+      fprintf(stderr, "[E] [ingest] %s: poll: %s\n", names_[source].c_str(), strerror(errno));
+      break;
+    }
+    if (ready <= 0)
+      continue;
+
+    ssize_t n = read(fd, buffer.data(), buffer.size());
+    if (n > 0) {
+      stats_[source].input += n;
+      parser.feed(buffer.data(), n);
+    } else if (n == 0) {
+      break;
+    } else if ((errno != EINTR) && (errno != EAGAIN)) {
+      /* EIO: the other end of a terminal hung up */
+      if (errno != EIO)
+        fprintf(stderr, "[E] [ingest] %s: read: %s\n", names_[source].c_str(), strerror(errno));
+      break;
+    }
+  }
+
+  parser.finish();
+  slicer.finish();
+  close(fd);
+}
+
+void pipeline::write_chunk(const chunk &c) {
+  source_stats &stats = stats_[c.source];
+
+  stats.chunks++;
+  stats.data += c.owned_end - c.owned_begin;
+  stats.noise += c.noise;
+  for (const record &rec : c.records) {
+    switch (rec.kind) {
+      case RECORD_CODE:
+        stats.codes++;
+        break;
+      case RECORD_PULSES:
+        stats.frames++;
+        break;
+      case RECORD_GAP:
+        stats.gaps++;
+        break;
+      case RECORD_TEXT:
+      case RECORD_SCAN:
+        stats.lines++;
+        break;
+      default:
+        break;
+    }
+
+    if (index_ != nullptr)
+      fprintf(index_, "%s\t%u\t%" PRIu64 "\t%" PRIu64 "\n", names_[c.source].c_str(), rec.session,
+              rec.offset, position_);
+    fwrite(rec.line.data(), 1, rec.line.size(), out_);
+    position_ += rec.line.size();
+  }
+
+  if (!c.records.empty()) {
+    fflush(out_);
+    if (index_ != nullptr)
+      fflush(index_);
+  }
+}
+
+void pipeline::run(void) {
+  unsigned threads = config_.threads;
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  size_t depth = (config_.queue_depth != 0) ? config_.queue_depth : 4 * threads;
+
+  work_queue<chunk> chunks(depth);
+  /* bounded by the chunk queue and the workers already */
+  work_queue<chunk> results;
+
+  std::thread writer([this, &results] {
+    std::vector<std::map<uint64_t, chunk>> early(names_.size());
+    std::vector<uint64_t> next(names_.size(), 0);
+    chunk c;
+
+    while (results.pop(c)) {
+      unsigned source = c.source;
+      early[source].emplace(c.seq, std::move(c));
+      auto &waiting = early[source];
+      while (!waiting.empty() && (waiting.begin()->first == next[source])) {
+        write_chunk(waiting.begin()->second);
+        waiting.erase(waiting.begin());
+        next[source]++;
+      }
+    }
+  });
+
+  std::vector<std::thread> workers;
+  for (unsigned i = 0; i < threads; i++) {
+    workers.emplace_back([this, &chunks, &results] {
+      chunk c;
+      while (chunks.pop(c)) {
+        decode_chunk(c, config_.decode);
+        for (record &rec : c.records)
+          rec.line = format_record(rec, names_[c.source]);
+        results.push(std::move(c));
+      }
+    });
+  }
+
+  std::vector<std::thread> readers;
+  for (unsigned source = 0; source < names_.size(); source++)
+    readers.emplace_back([this, source, &chunks] { read_source(source, chunks); });
+
+  for (std::thread &reader : readers)
+    reader.join();
+  chunks.close();
+  for (std::thread &worker : workers)
+    worker.join();
+  results.close();
+  writer.join();
+}
+
+}  // namespace ecrf
@@ -0,0 +1,81 @@
+#ifndef _INGEST_PIPELINE_H
+#define _INGEST_PIPELINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ingest_decode.h"
+#include "ingest_queue.h"
+
+namespace ecrf {
+
+struct ingest_config {
+  /* owned bytes per chunk and lead-in/lookahead on each side, the lead
+   * bounds the longest frame decoded across a chunk boundary */
+  size_t chunk_size = 16384;
+  size_t lead = 2048;
+  /* decode workers, 0 for one per core */
+  unsigned threads = 0;
+  /* chunks waiting for a worker, readers block beyond */
+  size_t queue_depth = 0;
+  bool hex_mode = false;
+  decode_config decode;
+};
+
+struct source_stats {
+  uint64_t input = 0;
+  uint64_t data = 0;
+  uint64_t chunks = 0;
+  uint64_t codes = 0;
+  uint64_t frames = 0;
+  uint64_t noise = 0;
+  uint64_t gaps = 0;
+  uint64_t lines = 0;
+};
+
+/*
+ * Readers, one thread per source, parse and chunk; a pool of workers
+ * decodes the chunks in any order; one writer puts each source back in
+ * stream order and writes the records as JSON lines. The optional index
+ * gets "source session offset position" per record, position being the
+ * byte of its line in the output.
+ */
+class pipeline {
+ public:
+  pipeline(const ingest_config &config, FILE *out, FILE *index = nullptr);
+
+  /* takes fd over, returns the source number */
+  unsigned add_source(const std::string &name, int fd);
+  /* until every source ends or stop() is called */
+  void run(void);
+  /* safe from a signal handler */
+  void stop(void) {
+    stop_ = true;
+  }
+  const std::vector<source_stats> &stats(void) const {
+    return stats_;
+  }
+  const std::string &name(unsigned source) const {
+    return names_[source];
+  }
+
+ private:
+  void read_source(unsigned source, work_queue<chunk> &chunks);
+  void write_chunk(const chunk &c);
+
+  ingest_config config_;
+  FILE *out_;
+  FILE *index_;
+  std::vector<std::string> names_;
+  std::vector<int> fds_;
+  std::vector<source_stats> stats_;
+  std::atomic<bool> stop_;
+  uint64_t position_;
+};
+
+}  // namespace ecrf
+
+#endif /* _INGEST_PIPELINE_H */
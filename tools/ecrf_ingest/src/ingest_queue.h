@@ -0,0 +1,58 @@
+#ifndef _INGEST_QUEUE_H
+#define _INGEST_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace ecrf {
+
+/*
+ * Blocking queue between the pipeline stages. push() waits while the queue
+ * holds capacity items (0: unbounded), pop() returns false once the queue
+ * is closed and drained.
+ */
+template <typename T>
+class work_queue {
+ public:
+  explicit work_queue(size_t capacity = 0) : capacity_(capacity), closed_(false) {
+  }
+
+  void push(T &&item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return (capacity_ == 0) || (items_.size() < capacity_); });
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+  }
+
+  bool pop(T &item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !items_.empty() || closed_; });
+    if (items_.empty())
+      return false;
+
+    item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  void close(void) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+ private:
+  size_t capacity_;
+  bool closed_;
+  std::deque<T> items_;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+};
+
+}  // namespace ecrf
+
+#endif /* _INGEST_QUEUE_H */
@@ -0,0 +1,99 @@
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "ingest_source.h"
+
+namespace ecrf {
+
+static const struct {
+  unsigned baud;
+  speed_t speed;
+} source_speeds[] = {
+    {9600, B9600},     {19200, B19200},   {38400, B38400},   {57600, B57600},
+    {115200, B115200}, {230400, B230400}, {460800, B460800}, {921600, B921600},
+};
+
+static bool source_set_raw(int fd, unsigned baud, std::string &error) {
+  struct termios tio;
+  speed_t speed = 0;
+
+  for (const auto &entry : source_speeds) {
+    if (entry.baud == baud)
+      speed = entry.speed;
+  }
+  if (speed == 0) {
+    error = "unsupported baud rate " + std::to_string(baud);
+    return false;
+  }
+
+  if (tcgetattr(fd, &tio) != 0) {
+    error = std::string("tcgetattr: ") + strerror(errno);
+    return false;
+  }
+  cfmakeraw(&tio);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  cfsetispeed(&tio, speed);
+  cfsetospeed(&tio, speed);
+  if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+    error = std::string("tcsetattr: ") + strerror(errno);
+    return false;
+  }
+
+  return true;
+}
+
+int open_source(const std::string &path, unsigned baud, std::string &error) {
+  if (path == "-")
+    return dup(STDIN_FILENO);
+
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    error = path + ": " + strerror(errno);
+    return -1;
+  }
+
+  /* a serial port is written to as well, for the commands */
+  int flags = S_ISCHR(st.st_mode) ? (O_RDWR | O_NOCTTY) : O_RDONLY;
+  int fd = open(path.c_str(), flags | O_CLOEXEC);
+  if (fd < 0) {
+    error = path + ": " + strerror(errno);
+    return -1;
+  }
+
+  if (isatty(fd) && !source_set_raw(fd, baud, error)) {
+    error = path + ": " + error;
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+bool source_is_tty(int fd) {
+  return isatty(fd) != 0;
+}
+
+bool send_command(int fd, const std::string &command) {
+  std::string line = command + "\r";
+  size_t sent = 0;
+
+  while (sent < line.size()) {
+    ssize_t n = write(fd, line.data() + sent, line.size() - sent);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    sent += n;
+  }
+
+  return true;
+}
+
+}  // namespace ecrf
@@ -0,0 +1,20 @@
+#ifndef _INGEST_SOURCE_H
+#define _INGEST_SOURCE_H
+
+#include <string>
+
+namespace ecrf {
+
+/*
+ * Opens a device stream: "-" for stdin, a serial port (set raw at baud),
+ * a FIFO or a recorded file. Returns the descriptor, -1 with error set.
+ */
+int open_source(const std::string &path, unsigned baud, std::string &error);
+/* true when fd is a terminal, the board's shell can be talked to */
+bool source_is_tty(int fd);
+/* a shell command line to the board, CR terminated like a terminal sends it */
+bool send_command(int fd, const std::string &command);
+
+}  // namespace ecrf
+
+#endif /* _INGEST_SOURCE_H */
@@ -0,0 +1,187 @@
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <string>
+#include <vector>
+
+#include "ingest_pipeline.h"
+#include "ingest_source.h"
+
+/*
+ * ecrf_ingest: decodes what the board prints during rx/cap sessions, from
+ * serial ports, pipes or recorded console logs, several at once.
+ *
+ *   ecrf_ingest -p ook433 -s "rx 0 1048576 ook433" /dev/ttyUSB0 /dev/ttyUSB1
+ *   ecrf_ingest -o codes.jsonl -i codes.idx capture.log
+ */
+static ecrf::pipeline *ingest_pipeline = nullptr;
+
+static void ingest_signal(int sig) {
+  (void)sig;
+  if (ingest_pipeline != nullptr)
+    ingest_pipeline->stop();
+}
+
+static void ingest_usage(FILE *out) {
+  fprintf(out,
+          "Usage: ecrf_ingest [options] [name=]source...\n"
+          "  source            serial port, FIFO, console log, - for stdin\n"
+          "  -o, --output F    JSON lines to F (stdout)\n"
+          "  -i, --index F     source, session, offset, output position per record\n"
+          "  -j, --jobs N      decode threads (one per core)\n"
+          "  -p, --profile P   sample rate of a firmware profile (ook433)\n"
+          "  -r, --rate BPS    sample rate in bit/s, overrides --profile\n"
+          "  -b, --baud B      serial speed (115200)\n"
+          "  -s, --send CMD    shell command sent to each serial source first\n"
+          "  -x, --hex         plain hex input (console sink), no line tags\n"
+          "      --chunk N     owned bytes per chunk (16384)\n"
+          "      --lead N      lead-in and lookahead bytes, longest frame (2048)\n"
+          "      --silence US  low level ending a frame (20000)\n"
+          "      --min-bits N  shortest code word reported (12)\n"
+          "  -q, --quiet       no statistics on stderr\n");
+}
+
+int main(int argc, char **argv) {
+  enum { OPT_CHUNK = 256, OPT_LEAD, OPT_SILENCE, OPT_MIN_BITS };
+  static const struct option options[] = {
+      {"output", required_argument, nullptr, 'o'},  {"index", required_argument, nullptr, 'i'},
+      {"jobs", required_argument, nullptr, 'j'},    {"profile", required_argument, nullptr, 'p'},
+      {"rate", required_argument, nullptr, 'r'},    {"baud", required_argument, nullptr, 'b'},
+      {"send", required_argument, nullptr, 's'},    {"hex", no_argument, nullptr, 'x'},
+      {"quiet", no_argument, nullptr, 'q'},         {"help", no_argument, nullptr, 'h'},
+      {"chunk", required_argument, nullptr, OPT_CHUNK},
+      {"lead", required_argument, nullptr, OPT_LEAD},
+      {"silence", required_argument, nullptr, OPT_SILENCE},
+      {"min-bits", required_argument, nullptr, OPT_MIN_BITS},
+      {nullptr, 0, nullptr, 0},
+  };
+  ecrf::ingest_config config;
+  const char *outPath = nullptr;
+  const char *indexPath = nullptr;
+  std::string profile = "ook433";
+  unsigned rate = 0;
+  unsigned baud = 115200;
+  std::vector<std::string> commands;
+  bool quiet = false;
+  int opt;
+
+  while ((opt = getopt_long(argc, argv, "o:i:j:p:r:b:s:xqh", options, nullptr)) != -1) {
+    switch (opt) {
+      case 'o':
+        outPath = optarg;
+        break;
+      case 'i':
+        indexPath = optarg;
+        break;
+      case 'j':
+        config.threads = (unsigned)atoi(optarg);
+        break;
+      case 'p':
+        profile = optarg;
+        break;
+      case 'r':
+        rate = (unsigned)atoi(optarg);
+        break;
+      case 'b':
+        baud = (unsigned)atoi(optarg);
+        break;
+      case 's':
+        commands.push_back(optarg);
+        break;
+      case 'x':
+        config.hex_mode = true;
+        break;
+      case 'q':
+        quiet = true;
+        break;
+      case OPT_CHUNK:
+        config.chunk_size = strtoul(optarg, nullptr, 0);
+        break;
+      case OPT_LEAD:
+        config.lead = strtoul(optarg, nullptr, 0);
+        break;
+      case OPT_SILENCE:
+        config.decode.silence_us = (unsigned)atoi(optarg);
+        break;
+      case OPT_MIN_BITS:
+        config.decode.min_bits = (unsigned)atoi(optarg);
+        break;
+      case 'h':
+        ingest_usage(stdout);
+        return 0;
+      default:
+        ingest_usage(stderr);
+        return 2;
+    }
+  }
+
+  if (optind == argc) {
+    ingest_usage(stderr);
+    return 2;
+  }
+
+  config.decode.rate = (rate != 0) ? rate : ecrf::profile_rate(profile);
+  if (config.decode.rate == 0) {
+    fprintf(stderr, "[E] [ingest] Unknown profile %s, give the rate with -r\n", profile.c_str());
+    return 2;
+  }
+
+  FILE *out = (outPath != nullptr) ? fopen(outPath, "w") : stdout;
+  FILE *index = (indexPath != nullptr) ? fopen(indexPath, "w") : nullptr;
+  if ((out == nullptr) || ((indexPath != nullptr) && (index == nullptr))) {
+    fprintf(stderr, "[E] [ingest] %s: %s\n", (out == nullptr) ? outPath : indexPath, strerror(errno));
+    return 1;
+  }
+
+  ecrf::pipeline pipeline(config, out, index);
+  for (int i = optind; i < argc; i++) {
+    std::string spec = argv[i];
+    std::string name = "dev" + std::to_string(i - optind);
+    size_t equal = spec.find('=');
+    if (equal != std::string::npos) {
+      name = spec.substr(0, equal);
+      spec = spec.substr(equal + 1);
+    }
+
+    std::string error;
+    int fd = ecrf::open_source(spec, baud, error);
+    if (fd < 0) {
+      fprintf(stderr, "[E] [ingest] %s\n", error.c_str());
+      return 1;
+    }
+    if (ecrf::source_is_tty(fd)) {
+      for (const std::string &command : commands)
+        ecrf::send_command(fd, command);
+    }
+    pipeline.add_source(name, fd);
+  }
+
+  ingest_pipeline = &pipeline;
+  signal(SIGINT, ingest_signal);
+  signal(SIGTERM, ingest_signal);
+  pipeline.run();
+  ingest_pipeline = nullptr;
+
+  if (!quiet) {
+    for (unsigned i = 0; i < pipeline.stats().size(); i++) {
+      const ecrf::source_stats &stats = pipeline.stats()[i];
+      fprintf(stderr,
+              "[ingest] %s: %llu bytes in, %llu data, %llu chunks, %llu codes, %llu frames, "
+              "%llu noise, %llu gaps, %llu lines\n",
+              pipeline.name(i).c_str(), (unsigned long long)stats.input,
+              (unsigned long long)stats.data, (unsigned long long)stats.chunks,
+              (unsigned long long)stats.codes, (unsigned long long)stats.frames,
+              (unsigned long long)stats.noise, (unsigned long long)stats.gaps,
+              (unsigned long long)stats.lines);
+    }
+  }
+
+  if (index != nullptr)
+    fclose(index);
+  if (out != stdout)
+    fclose(out);
+  return 0;
+}
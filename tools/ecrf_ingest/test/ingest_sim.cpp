@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "ingest_sim.h"
+
+namespace ecrf {
+
+void sim_signal::level(bool high, double us) {
+  /* samples from the running time, no drift over long streams */
+  time_us_ += us;
+  uint64_t end = (uint64_t)(time_us_ * rate_ / 1e6 + 0.5);
+  for (; samples_ < end; samples_++)
+    bits_.push_back(high);
+}
+
+void sim_signal::word(const pulse_protocol &proto, uint64_t code, unsigned bits, unsigned repeats) {
+  double base = proto.base_us;
+
+  for (unsigned r = 0; r < repeats; r++) {
+    for (int bit = (int)bits - 1; bit >= 0; bit--) {
+      bool one = (code >> bit) & 1;
+      level(true, (one ? proto.one_high : proto.zero_high) * base);
+      level(false, (one ? proto.one_low : proto.zero_low) * base);
+    }
+    level(true, proto.sync_high * base);
+    level(false, proto.sync_low * base);
+  }
+}
+
+void sim_signal::square(double us, unsigned periods) {
+  for (unsigned i = 0; i < periods; i++) {
+    level(true, us);
+    level(false, us);
+  }
+}
+
+std::vector<uint8_t> sim_signal::bytes(void) const {
+  std::vector<uint8_t> out((bits_.size() + 7) / 8, 0);
+
+  for (size_t i = 0; i < bits_.size(); i++) {
+    if (bits_[i])
+      out[i / 8] |= 0x80 >> (i % 8);
+  }
+
+  return out;
+}
+
+static void sim_hex(std::string &out, const uint8_t *data, size_t len) {
+  static const char digits[] = "0123456789abcdef";
+  for (size_t i = 0; i < len; i++) {
+    out += digits[data[i] >> 4];
+    out += digits[data[i] & 0x0F];
+  }
+}
+
+std::string sim_rx_console(const std::vector<uint8_t> &data, unsigned seed) {
+  std::mt19937 random(seed);
+  std::uniform_int_distribution<size_t> piece(1, 52);
+  std::string out = "rx 0 " + std::to_string(data.size()) + " ook433\r\n";
+  size_t received = 0;
+  char tag[16];
+
+  /* cc1101_receive_cmd(): one call per read, a tag when on a 128 boundary */
+  do {
+    if ((received % 128) == 0) {
+      snprintf(tag, sizeof(tag), "\n[%02u] ", (unsigned)(received / 128));
+      out += tag;
+    }
+    size_t len = std::min(piece(random), data.size() - received);
+    sim_hex(out, &data[received], len);
+    received += len;
+  } while (received < data.size());
+
+  out += "\r\n[root@FreeRTOS]# ";
+  return out;
+}
+
+std::string sim_cap_console(const std::vector<uint8_t> &data) {
+  std::string out = "cap 0 " + std::to_string(data.size()) + "\r\n";
+  char tag[48];
+
+  snprintf(tag, sizeof(tag), "[CC1101] Captured %u bytes in 812 ms", (unsigned)data.size());
+  out += tag;
+  for (size_t offset = 0; offset < data.size(); offset += 32) {
+    snprintf(tag, sizeof(tag), "\n[%05u] ", (unsigned)offset);
+    out += tag;
+    sim_hex(out, &data[offset], std::min((size_t)32, data.size() - offset));
+  }
+
+  out += "\n\r\n[root@FreeRTOS]# ";
+  return out;
+}
+
+const pulse_protocol &sim_protocol(const char *name) {
+  for (size_t i = 0; i < pulse_protocol_count; i++) {
+    if (strcmp(pulse_protocols[i].name, name) == 0)
+      return pulse_protocols[i];
+  }
+
+  return pulse_protocols[0];
+}
+
+}  // namespace ecrf
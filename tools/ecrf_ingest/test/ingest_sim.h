@@ -0,0 +1,54 @@
+#ifndef _INGEST_SIM_H
+#define _INGEST_SIM_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ingest_decode.h"
+
+namespace ecrf {
+
+/*
+ * Stand-in for the board: OOK sample streams as the CC1101 delivers them in
+ * raw mode, printed the way the rx and cap commands print them.
+ */
+class sim_signal {
+ public:
+  explicit sim_signal(unsigned rate) : rate_(rate), time_us_(0), samples_(0) {
+  }
+
+  void level(bool high, double us);
+  void idle(double us) {
+    level(false, us);
+  }
+  /* one rc-switch transmission, the word repeated with a sync after each */
+  void word(const pulse_protocol &proto, uint64_t code, unsigned bits, unsigned repeats);
+  /* square wave no protocol matches */
+  void square(double us, unsigned periods);
+  /* sample index where the next level starts */
+  uint64_t position(void) const {
+    return samples_;
+  }
+  std::vector<uint8_t> bytes(void) const;
+
+ private:
+  unsigned rate_;
+  double time_us_;
+  uint64_t samples_;
+  std::vector<bool> bits_;
+};
+
+/*
+ * What follows the prompt: the command echo, the output of "rx" with the
+ * data read in pieces of 1 to 52 bytes like the shell does, the next prompt.
+ */
+std::string sim_rx_console(const std::vector<uint8_t> &data, unsigned seed);
+/* same for "cap" */
+std::string sim_cap_console(const std::vector<uint8_t> &data);
+
+const pulse_protocol &sim_protocol(const char *name);
+
+}  // namespace ecrf
+
+#endif /* _INGEST_SIM_H */
@@ -0,0 +1,34 @@
+#ifndef _INGEST_TEST_H
+#define _INGEST_TEST_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+/* no framework on the host side, a failed check ends the test binary */
+static std::atomic<int> ingest_test_checks{0};
+
+#define CHECK(cond)                                                        \
+  do {                                                                     \
+    ingest_test_checks++;                                                  \
+    if (!(cond)) {                                                         \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      exit(1);                                                             \
+    }                                                                      \
+  } while (0)
+
+#define CHECK_EQ(a, b) CHECK((a) == (b))
+
+#define RUN_TEST(fn)                \
+  do {                              \
+    fprintf(stderr, "%s\n", #fn);   \
+    fn();                           \
+  } while (0)
+
+#define TEST_DONE()                                              \
+  do {                                                           \
+    fprintf(stderr, "%d checks passed\n", ingest_test_checks.load()); \
+    return 0;                                                    \
+  } while (0)
+
+#endif /* _INGEST_TEST_H */
@@ -0,0 +1,217 @@
+#include <map>
+#include <random>
+#include <set>
+#include <tuple>
+
+#include "ingest_chunk.h"
+#include "ingest_decode.h"
+#include "ingest_sim.h"
+#include "ingest_test.h"
+
+using namespace ecrf;
+
+static chunk whole_chunk(const std::vector<uint8_t> &data) {
+  chunk c;
+  c.data = data;
+  c.owned_end = data.size();
+  return c;
+}
+
+static std::vector<record> records_of(const chunk &c, record_kind kind) {
+  std::vector<record> out;
+  for (const record &rec : c.records) {
+    if (rec.kind == kind)
+      out.push_back(rec);
+  }
+  return out;
+}
+
+static void test_protocols(void) {
+  decode_config config;
+  config.rate = 50000;
+
+  for (size_t p = 0; p < pulse_protocol_count; p++) {
+    const pulse_protocol &proto = pulse_protocols[p];
+    sim_signal signal(config.rate);
+    signal.idle(30000);
+    uint64_t start = signal.position();
+    signal.word(proto, 0xA5C3E, 20, 5);
+    signal.idle(30000);
+
+    chunk c = whole_chunk(signal.bytes());
+    decode_chunk(c, config);
+    std::vector<record> codes = records_of(c, RECORD_CODE);
+    CHECK_EQ(codes.size(), 1u);
+    CHECK_EQ(std::string(codes[0].proto), proto.name);
+    CHECK_EQ(codes[0].code, 0xA5C3Eu);
+    CHECK_EQ(codes[0].bits, 20u);
+    /* the word ahead of the first sync has nothing to align on */
+    CHECK_EQ(codes[0].repeats, 4u);
+    CHECK((codes[0].base_us + 10 > proto.base_us) && (codes[0].base_us < proto.base_us + 10));
+    /* the second word, after the first sync */
+    CHECK(codes[0].offset * 8 + codes[0].bit > start);
+  }
+}
+
+/* the firmware's own profiles sample at 10 kbps, 100 us a sample */
+static void test_profile_rate(void) {
+  decode_config config;
+  config.rate = profile_rate("ook433");
+  CHECK_EQ(config.rate, 10000u);
+
+  sim_signal signal(config.rate);
+  signal.idle(25000);
+  signal.word(sim_protocol("rcswitch1"), 0x5A5A5A, 24, 4);
+  signal.idle(25000);
+  chunk c = whole_chunk(signal.bytes());
+  decode_chunk(c, config);
+  std::vector<record> codes = records_of(c, RECORD_CODE);
+  CHECK_EQ(codes.size(), 1u);
+  CHECK_EQ(codes[0].code, 0x5A5A5Au);
+  CHECK_EQ(codes[0].repeats, 3u);
+}
+
+static void test_pulses(void) {
+  decode_config config;
+  config.rate = 50000;
+  sim_signal signal(config.rate);
+
+  signal.idle(30000);
+  signal.square(500, 40);
+  signal.square(1000, 20);
+  signal.idle(30000);
+
+  chunk c = whole_chunk(signal.bytes());
+  decode_chunk(c, config);
+  CHECK(records_of(c, RECORD_CODE).empty());
+  std::vector<record> frames = records_of(c, RECORD_PULSES);
+  CHECK_EQ(frames.size(), 1u);
+  CHECK_EQ(frames[0].pulses, 60u);
+  CHECK_EQ(frames[0].widths_us.size(), 2u);
+  CHECK_EQ(frames[0].widths_us[0], 500u);
+  CHECK_EQ(frames[0].widths_us[1], 1000u);
+}
+
+static void test_noise(void) {
+  decode_config config;
+  sim_signal signal(config.rate);
+
+  signal.idle(30000);
+  signal.square(300, 3);
+  signal.idle(30000);
+  chunk c = whole_chunk(signal.bytes());
+  decode_chunk(c, config);
+  CHECK(c.records.empty());
+  CHECK_EQ(c.noise, 1u);
+}
+
+static void test_scan_text(void) {
+  chunk c;
+  record rec;
+  rec.kind = RECORD_TEXT;
+  rec.text = "COARSE      Frequency: 868.35  RSSI: -70";
+  c.records.push_back(rec);
+  rec.text = "[CC1101] Scanning completed (123 ms)";
+  c.records.push_back(rec);
+
+  decode_chunk(c, decode_config());
+  CHECK_EQ(c.records[0].kind, RECORD_SCAN);
+  CHECK_EQ(c.records[0].freq_khz, 868350u);
+  CHECK_EQ(c.records[0].value, -70);
+  CHECK_EQ(c.records[1].kind, RECORD_TEXT);
+}
+
+typedef std::tuple<uint64_t, uint64_t, unsigned> code_at;
+
+static std::set<code_at> decode_sliced(const std::vector<uint8_t> &data, const decode_config &config,
+                                       size_t chunk_size, size_t lead, size_t *count) {
+  std::vector<chunk> chunks;
+  chunker slicer(0, chunk_size, lead, [&chunks](chunk &&c) { chunks.push_back(std::move(c)); });
+
+  /* handed over in odd pieces, like the parser does */
+  for (size_t pos = 0; pos < data.size(); pos += 77)
+    slicer.on_data(&data[pos], std::min((size_t)77, data.size() - pos));
+  slicer.finish();
+
+  std::set<code_at> codes;
+  *count = 0;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    CHECK_EQ(chunks[i].seq, i);
+    decode_chunk(chunks[i], config);
+    for (const record &rec : records_of(chunks[i], RECORD_CODE)) {
+      codes.insert(code_at(rec.offset * 8 + rec.bit, rec.code, rec.repeats));
+      (*count)++;
+    }
+  }
+  return codes;
+}
+
+/* frames across slice boundaries come out once, as from one big chunk */
+static void test_chunk_boundaries(void) {
+  decode_config config;
+  std::mt19937 random(9);
+  sim_signal signal(config.rate);
+
+  for (int i = 0; i < 60; i++) {
+    signal.idle(25000 + random() % 200000);
+    signal.word(sim_protocol("rcswitch1"), random() & 0xFFFFFF, 24, 2 + random() % 4);
+  }
+  signal.idle(25000);
+  std::vector<uint8_t> data = signal.bytes();
+
+  chunk whole = whole_chunk(data);
+  decode_chunk(whole, config);
+  std::set<code_at> expected;
+  for (const record &rec : records_of(whole, RECORD_CODE))
+    expected.insert(code_at(rec.offset * 8 + rec.bit, rec.code, rec.repeats));
+  CHECK_EQ(expected.size(), 60u);
+
+  /* a frame is at most 5 words of 24 bits, under 300 bytes at 10 kbps */
+  const size_t sizes[] = {64, 500, 1024, 4096, 16384};
+  for (size_t size : sizes) {
+    size_t count;
+    std::set<code_at> codes = decode_sliced(data, config, size, 512, &count);
+    CHECK(codes == expected);
+    CHECK_EQ(count, expected.size());
+  }
+}
+
+static void test_format(void) {
+  record rec;
+  rec.kind = RECORD_CODE;
+  rec.session = 2;
+  rec.offset = 1234;
+  rec.bit = 5;
+  rec.proto = "rcswitch1";
+  rec.code = 0xabc;
+  rec.bits = 12;
+  rec.base_us = 351;
+  rec.repeats = 3;
+  CHECK_EQ(format_record(rec, "dev0"),
+           "{\"src\":\"dev0\",\"ses\":2,\"off\":1234,\"bit\":5,\"kind\":\"code\",\"proto\":\"rcswitch1\","
+           "\"bits\":12,\"code\":\"0xabc\",\"base_us\":351,\"repeats\":3}\n");
+
+  record burst;
+  burst.kind = RECORD_BURST;
+  burst.value = -70;
+  burst.freq_offset = -3174;
+  CHECK_EQ(format_record(burst, "a"),
+           "{\"src\":\"a\",\"ses\":0,\"off\":0,\"bit\":0,\"kind\":\"burst\",\"rssi\":-70,\"freq_hz\":-3174}\n");
+
+  record text;
+  text.kind = RECORD_TEXT;
+  text.text = "say \"hi\"\t";
+  CHECK_EQ(format_record(text, "a"),
+           "{\"src\":\"a\",\"ses\":0,\"off\":0,\"bit\":0,\"kind\":\"text\",\"text\":\"say \\\"hi\\\"\\u0009\"}\n");
+}
+
+int main(void) {
+  RUN_TEST(test_protocols);
+  RUN_TEST(test_profile_rate);
+  RUN_TEST(test_pulses);
+  RUN_TEST(test_noise);
+  RUN_TEST(test_scan_text);
+  RUN_TEST(test_chunk_boundaries);
+  RUN_TEST(test_format);
+  TEST_DONE();
+}
@@ -0,0 +1,192 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ingest_parse.h"
+#include "ingest_sim.h"
+#include "ingest_test.h"
+
+using namespace ecrf;
+
+struct parse_event {
+  char type;
+  uint64_t offset;
+  int64_t value;
+  std::string text;
+  int64_t freq = INGEST_FREQ_NONE;
+};
+
+class collect_sink : public parse_sink {
+ public:
+  void on_data(const uint8_t *data, size_t len) override {
+    this->data.insert(this->data.end(), data, data + len);
+  }
+  void on_burst(uint64_t offset, int rssi, int64_t freq_offset) override {
+    events.push_back({'b', offset, rssi, "", freq_offset});
+  }
+  void on_gap(uint64_t offset, int64_t lost, bool link) override {
+    events.push_back({link ? 'l' : 'g', offset, lost, ""});
+  }
+  void on_session(void) override {
+    events.push_back({'s', 0, 0, ""});
+  }
+  void on_text(uint64_t offset, const std::string &line) override {
+    events.push_back({'t', offset, 0, line});
+  }
+
+  std::vector<uint8_t> data;
+  std::vector<parse_event> events;
+};
+
+static std::vector<uint8_t> random_bytes(size_t len, unsigned seed) {
+  std::mt19937 random(seed);
+  std::vector<uint8_t> data(len);
+  for (uint8_t &byte : data)
+    byte = (uint8_t)random();
+  return data;
+}
+
+/* the same text fed whole and in random pieces down to single bytes */
+static void parse_pieces(const std::string &text, collect_sink &sink, bool hex, unsigned seed) {
+  std::mt19937 random(seed);
+  stream_parser parser(sink, hex);
+  size_t pos = 0;
+
+  while (pos < text.size()) {
+    size_t len = std::min<size_t>(1 + random() % 97, text.size() - pos);
+    parser.feed(text.data() + pos, len);
+    pos += len;
+  }
+  parser.finish();
+}
+
+static void test_rx_roundtrip(void) {
+  std::vector<uint8_t> data = random_bytes(5000, 1);
+  std::string text = "[root@FreeRTOS]# " + sim_rx_console(data, 7);
+
+  for (unsigned seed = 0; seed < 8; seed++) {
+    collect_sink sink;
+    parse_pieces(text, sink, false, seed);
+    CHECK(sink.data == data);
+    /* prompt and command echo, one session, the closing prompt */
+    CHECK_EQ(sink.events.size(), 3u);
+    CHECK_EQ(sink.events[0].type, 't');
+    CHECK_EQ(sink.events[0].text, "[root@FreeRTOS]# rx 0 5000 ook433");
+    CHECK_EQ(sink.events[1].type, 's');
+    CHECK_EQ(sink.events[2].text, "[root@FreeRTOS]#");
+    CHECK_EQ(sink.events[2].offset, 5000u);
+  }
+}
+
+static void test_cap_roundtrip(void) {
+  std::vector<uint8_t> data = random_bytes(1000, 2);
+  collect_sink sink;
+
+  parse_pieces("[root@FreeRTOS]# " + sim_cap_console(data), sink, false, 3);
+  CHECK(sink.data == data);
+  CHECK_EQ(sink.events[1].text, "[CC1101] Captured 1000 bytes in 812 ms");
+  CHECK_EQ(sink.events[2].type, 's');
+}
+
+static void test_markers(void) {
+  collect_sink sink;
+  std::string text = "\n[00] 0102<burst -61 dBm> 0304<gap 17> 05<gap ?> 06<what> 07\n";
+
+  parse_pieces(text, sink, false, 0);
+  CHECK_EQ(sink.data.size(), 7u);
+  CHECK_EQ(sink.events.size(), 5u);
+  CHECK_EQ(sink.events[1].type, 'b');
+  CHECK_EQ(sink.events[1].offset, 2u);
+  CHECK_EQ(sink.events[1].value, -61);
+  CHECK_EQ(sink.events[1].freq, INGEST_FREQ_NONE);
+  CHECK_EQ(sink.events[2].type, 'g');
+  CHECK_EQ(sink.events[2].offset, 4u);
+  CHECK_EQ(sink.events[2].value, 17);
+  CHECK_EQ(sink.events[3].value, INGEST_GAP_UNKNOWN);
+  CHECK_EQ(sink.events[4].text, "<what>");
+}
+
+/* sessions with frequency tracking add the burst's carrier offset */
+static void test_tracked_burst(void) {
+  collect_sink sink;
+  parse_pieces("\n[00] 01<burst -70 dBm -3174 Hz> 02<burst -65 dBm +1586 Hz> 03\n", sink, false, 0);
+
+  CHECK_EQ(sink.data.size(), 3u);
+  CHECK_EQ(sink.events.size(), 3u);
+  CHECK_EQ(sink.events[1].value, -70);
+  CHECK_EQ(sink.events[1].freq, -3174);
+  CHECK_EQ(sink.events[2].offset, 2u);
+  CHECK_EQ(sink.events[2].freq, 1586);
+}
+
+/* a line lost on the serial link shows as a jump between two tags */
+static void test_link_loss(void) {
+  std::vector<uint8_t> data = random_bytes(512, 4);
+  std::string text = "\n[00] ";
+  char tag[16];
+
+  for (size_t line = 0; line < 4; line++) {
+    if (line == 2)
+      continue;
+    if (line > 0) {
+      snprintf(tag, sizeof(tag), "\n[%02u] ", (unsigned)line);
+      text += tag;
+    }
+    for (size_t i = 0; i < 128; i++) {
+      snprintf(tag, sizeof(tag), "%02x", data[line * 128 + i]);
+      text += tag;
+    }
+  }
+
+  collect_sink sink;
+  stream_parser parser(sink);
+  parser.feed(text.data(), text.size());
+  parser.finish();
+  CHECK_EQ(sink.data.size(), 384u);
+  CHECK_EQ(sink.events.size(), 2u);
+  CHECK_EQ(sink.events[1].type, 'l');
+  CHECK_EQ(sink.events[1].offset, 256u);
+  CHECK_EQ(sink.events[1].value, 128);
+  CHECK_EQ(parser.offset(), 512u);
+}
+
+static void test_text(void) {
+  collect_sink sink;
+  std::string text =
+      "[root@FreeRTOS]# scan 0 10\r\n"
+      "[CC1101] Module 0 initialized!\n "
+      "[CC1101] Frequency scanning in progress (10 times)... \n"
+      "FINE        Frequency: 433.92  RSSI: -58\n"
+      "deadbeef\n"
+      "[E] [CC1101] Wrong module id\n";
+
+  parse_pieces(text, sink, false, 5);
+  CHECK(sink.data.empty());
+  CHECK_EQ(sink.events.size(), 6u);
+  CHECK_EQ(sink.events[2].text, "[CC1101] Frequency scanning in progress (10 times)...");
+  CHECK_EQ(sink.events[3].text, "FINE        Frequency: 433.92  RSSI: -58");
+  /* hex outside a tagged line is not data */
+  CHECK_EQ(sink.events[4].text, "deadbeef");
+}
+
+static void test_hex_mode(void) {
+  collect_sink sink;
+
+  parse_pieces("0a0b\n0c<burst -70 dBm>0d\nNoise here\n0e", sink, true, 6);
+  CHECK_EQ(sink.data.size(), 5u);
+  CHECK_EQ(sink.data[4], 0x0e);
+  CHECK_EQ(sink.events.size(), 2u);
+  CHECK_EQ(sink.events[0].offset, 3u);
+  CHECK_EQ(sink.events[1].text, "Noise here");
+}
+
+int main(void) {
+  RUN_TEST(test_rx_roundtrip);
+  RUN_TEST(test_cap_roundtrip);
+  RUN_TEST(test_markers);
+  RUN_TEST(test_tracked_burst);
+  RUN_TEST(test_link_loss);
+  RUN_TEST(test_text);
+  RUN_TEST(test_hex_mode);
+  TEST_DONE();
+}
@@ -0,0 +1,174 @@
+#include <cinttypes>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <pty.h>
+#include <sstream>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+
+#include "ingest_pipeline.h"
+#include "ingest_sim.h"
+#include "ingest_source.h"
+#include "ingest_test.h"
+
+using namespace ecrf;
+
+static std::string read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream text;
+  text << in.rdbuf();
+  return text.str();
+}
+
+static size_t count_of(const std::string &text, const std::string &what) {
+  size_t count = 0;
+  for (size_t pos = text.find(what); pos != std::string::npos; pos = text.find(what, pos + 1))
+    count++;
+  return count;
+}
+
+struct run_output {
+  std::string out;
+  std::string index;
+};
+
+static run_output run_pipeline(const ingest_config &config,
+                               const std::vector<std::pair<std::string, int>> &sources) {
+  char *out = nullptr;
+  char *index = nullptr;
+  size_t outLen = 0;
+  size_t indexLen = 0;
+  FILE *outFile = open_memstream(&out, &outLen);
+  FILE *indexFile = open_memstream(&index, &indexLen);
+
+  {
+    pipeline pipe(config, outFile, indexFile);
+    for (const auto &source : sources)
+      pipe.add_source(source.first, source.second);
+    pipe.run();
+  }
+  fclose(outFile);
+  fclose(indexFile);
+
+  run_output result = {std::string(out, outLen), std::string(index, indexLen)};
+  free(out);
+  free(index);
+  return result;
+}
+
+/*
+ * A console log recorded from the scan, rx and cap commands, decoded with
+ * any thread count and chunk size into the same records.
+ */
+static void test_recorded(void) {
+  std::string expected = read_file(INGEST_TEST_DATA "/ook433_console.jsonl");
+  CHECK(!expected.empty());
+
+  const unsigned threads[] = {1, 4};
+  const size_t sizes[] = {512, 16384};
+  for (unsigned jobs : threads) {
+    for (size_t size : sizes) {
+      ingest_config config;
+      config.threads = jobs;
+      config.chunk_size = size;
+      config.lead = 512;
+      std::string error;
+      int fd = open_source(INGEST_TEST_DATA "/ook433_console.log", 115200, error);
+      CHECK(fd >= 0);
+
+      run_output result = run_pipeline(config, {{"dev0", fd}});
+      CHECK_EQ(result.out, expected);
+      CHECK_EQ(count_of(result.index, "\n"), count_of(result.out, "\n"));
+    }
+  }
+}
+
+/* the board end of a pseudo-terminal: takes the command, prints a session */
+static void board(int master, const std::string &slave, const std::string &session,
+                  std::string *command) {
+  char c;
+  while ((read(master, &c, 1) == 1) && (c != '\r'))
+    *command += c;
+
+  for (size_t pos = 0; pos < session.size(); pos += 200) {
+    size_t len = std::min((size_t)200, session.size() - pos);
+    CHECK_EQ(write(master, session.data() + pos, len), (ssize_t)len);
+    usleep(200);
+  }
+
+  /* a terminal drops what the other side has not read yet on hang up */
+  int peek = open(slave.c_str(), O_RDONLY | O_NOCTTY);
+  int pending = 1;
+  for (int i = 0; (i < 5000) && (pending > 0); i++) {
+    ioctl(peek, FIONREAD, &pending);
+    usleep(1000);
+  }
+  close(peek);
+  close(master);
+}
+
+static std::vector<uint8_t> remote(uint64_t code, unsigned presses) {
+  sim_signal signal(profile_rate("ook433"));
+  for (unsigned i = 0; i < presses; i++) {
+    signal.idle(100000);
+    signal.word(sim_protocol("rcswitch1"), code, 24, 4);
+  }
+  signal.idle(100000);
+  return signal.bytes();
+}
+
+/* two boards on serial ports at once, each with its own remote */
+static void test_pty_devices(void) {
+  const char *const names[] = {"north", "south"};
+  const uint64_t codes[] = {0x13579B, 0x2468AC};
+  int masters[2];
+  std::string slaves[2];
+  std::string commands[2];
+  std::vector<std::thread> boards;
+  std::vector<std::pair<std::string, int>> sources;
+
+  for (int i = 0; i < 2; i++) {
+    int slave;
+    char path[64];
+    CHECK_EQ(openpty(&masters[i], &slave, path, nullptr, nullptr), 0);
+    slaves[i] = path;
+    close(slave);
+
+    std::string error;
+    int fd = open_source(slaves[i], 921600, error);
+    CHECK(fd >= 0);
+    CHECK(source_is_tty(fd));
+    CHECK(send_command(fd, "rx 0 65536 ook433"));
+    sources.push_back({names[i], fd});
+
+    std::string session = "[root@FreeRTOS]# " + sim_rx_console(remote(codes[i], 3 + i), 100 + i);
+    boards.emplace_back(board, masters[i], slaves[i], session, &commands[i]);
+  }
+
+  ingest_config config;
+  config.threads = 3;
+  config.chunk_size = 256;
+  config.lead = 512;
+  run_output result = run_pipeline(config, sources);
+  for (std::thread &t : boards)
+    t.join();
+
+  char code[32];
+  for (int i = 0; i < 2; i++) {
+    CHECK_EQ(commands[i], "rx 0 65536 ook433");
+    snprintf(code, sizeof(code), "\"code\":\"0x%" PRIx64 "\"", codes[i]);
+    CHECK_EQ(count_of(result.out, code), (size_t)(3 + i));
+    CHECK_EQ(count_of(result.out, std::string("\"src\":\"") + names[i] + "\",\"ses\":1"),
+             (size_t)(3 + i + 2));
+    CHECK_EQ(count_of(result.index, std::string(names[i]) + "\t"),
+             count_of(result.out, std::string("\"src\":\"") + names[i] + "\""));
+  }
+}
+
+int main(void) {
+  RUN_TEST(test_recorded);
+  RUN_TEST(test_pty_devices);
+  TEST_DONE();
+}